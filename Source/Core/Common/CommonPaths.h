@@ -41,6 +41,7 @@
 #define CACHE_DIR "Cache"
 #define SHADERCACHE_DIR "Shaders"
 #define SHADERUIDCACHE_DIR  "ShadersUIDS"
+#define TEXTURECACHE_DIR "Textures"
 #define STATESAVES_DIR "StateSaves"
 #define SCREENSHOTS_DIR "ScreenShots"
 #define OPENCL_DIR			 "OpenCL"
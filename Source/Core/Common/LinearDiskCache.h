@@ -4,27 +4,55 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstdio>
 #include <cstring>
-#include <fstream>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <xxhash.h>
 
 #include "Common/CommonTypes.h"
+#include "Common/File.h"
 #include "Common/FileUtil.h"
+#include "Common/MappedFile.h"
+#include "Common/ThreadPool.h"
 #include "Common/Version.h"
 
 // On disk format:
 // header{
 // u32 'DCAC';
-// u32 version;  // svn_rev
 // u16 sizeof(key_type);
 // u16 sizeof(value_type);
+// char version[40];  // scm_rev_cache_str unless the user passes one
 //}
 
 // key_value_pair{
 // u32 value_size;
 // key_type   key;
 // value_type[value_size]   value;
+// u32 entry_number;  // starts at 1, a mismatch marks the end of the valid records
+//}
+
+// The hash index is stored next to the cache in <filename>.idx:
+// index_header{
+// u32 'DCIX';
+// u32 version;
+// u64 data_size;           // end of the last indexed record
+// u64 last_record_offset;
+// u64 last_record_hash;    // XXH64 of the last indexed record, ties the index to the cache
+// u32 record_count;        // indexed records, including the ones replaced by a newer record
+// u32 entry_count;
+//}
+
+// index_entry[entry_count]{  // sorted by key_hash
+// u64 key_hash;  // XXH64 of the key
+// u64 offset;    // of the newest record with this key
 //}
 
 template <typename K, typename V>
@@ -34,12 +62,21 @@ public:
   virtual void Read(const K& key, const V* value, u32 value_size) = 0;
 };
 
-// Dead simple unsorted key-value store with append functionality.
-// No random read functionality, all reading is done in OpenAndRead.
-// Keys and values can contain any characters, including \0.
+// Unsorted key-value store with append functionality.
+// Keys and values can contain any characters, including \0, keys are compared bytewise.
 //
 // Suitable for caching generated shader bytecode between executions.
-// Not tuned for extreme performance but should be reasonably fast.
+// The cache file is memory mapped and never read in as a whole: the hash index finds the newest
+// record of a key, only the records appended after the index was written are parsed at open.
+// Caches without a valid index are indexed at open and get an index file at close.
+// OpenAndRead passes every key with its newest value to the reader; Open only loads the index and
+// leaves the values on disk until they are looked up.
+//
+// Appends are batched and written on the thread pool, Sync waits for them. Close writes the index
+// and compacts the file if at least a quarter of its records were replaced by newer ones.
+// Open, OpenAndRead, Close and Compact must not run concurrently with anything else; Append,
+// Contains and Lookup can be called from any thread.
+//
 // Does not support keys or values larger than 2GB, which should be reasonable.
 // Keys must have non-zero length; values can have zero length.
 
@@ -50,11 +87,16 @@ template <typename K, typename V>
 class LinearDiskCache
 {
 public:
-  // return number of read entries
-  u32 OpenAndRead(const std::string& filename, LinearDiskCacheReader<K, V>& reader, std::string version = {})
-  {
-    using std::ios_base;
+  LinearDiskCache() = default;
+  ~LinearDiskCache() { Close(); }
 
+  LinearDiskCache(const LinearDiskCache&) = delete;
+  LinearDiskCache& operator=(const LinearDiskCache&) = delete;
+
+  // Opens the cache without reading the values, the file is recreated if it is missing or was
+  // written by another version. Returns the number of entries.
+  u32 Open(const std::string& filename, std::string version = {})
+  {
 // Since we're reading/writing directly to the storage of K instances,
 // K must be trivially copyable. TODO: Remove #if once GCC 5.0 is a
 // minimum requirement.
@@ -67,122 +109,568 @@ public:
 
     // close any currently opened file
     Close();
-    m_num_entries = 0;
+    m_filename = filename;
+    m_version = std::move(version);
+    if (m_version.empty())
+      m_header.Init();
+    else
+      m_header.Init(m_version);
 
-    // try opening for reading/writing
-    File::OpenFStream(m_file, filename, ios_base::in | ios_base::out | ios_base::binary);
+    if (!m_data.Open(filename) || m_data.GetSize() < sizeof(Header) ||
+        std::memcmp(m_data.GetData(), &m_header, sizeof(Header)) != 0)
+    {
+      // failed to open file for reading or bad header
+      // recreate file
+      m_data.Close();
+      if (File::Exists(GetIndexFileName()))
+        File::Delete(GetIndexFileName());
+      m_file.Open(filename, "wb");
+      m_file.WriteBytes(&m_header, sizeof(Header));
+      m_end = sizeof(Header);
+      m_index_stale = true;
+      return 0;
+    }
 
-    m_file.seekg(0, std::ios::end);
-    std::fstream::pos_type end_pos = m_file.tellg();
-    m_file.seekg(0, std::ios::beg);
-    std::fstream::pos_type start_pos = m_file.tellg();
-    std::streamoff file_size = end_pos - start_pos;
-    if (version.empty())
+    LoadIndex();
+    if (m_index.IsOpen())
     {
-    m_header.Init();
+      // Whatever follows the indexed records was appended later
+      ParseUnindexedRecords();
     }
     else
     {
-      m_header.Init(version);
+      BuildIndex();
     }
-    if (m_file.is_open() && ValidateHeader())
-    {
-      // good header, read some key/value pairs
+    m_file.Open(filename, "r+b");
+    // Overwrite a torn record at the end
+    m_file.Seek(m_end, SEEK_SET);
+    return m_num_entries;
+  }
+
+  // return number of read entries
+  u32 OpenAndRead(const std::string& filename, LinearDiskCacheReader<K, V>& reader,
+                  std::string version = {})
+  {
+    const u32 count = Open(filename, std::move(version));
+    std::vector<V> aligned_value;
+    ForEachMappedRecord([&](const u8* record, u64, u64) {
+      if (!IsNewest(record))
+        return;
       K key;
+      std::memcpy(&key, GetRecordKey(record), sizeof(K));
+      const u32 value_size = GetValueSize(record);
+      const u8* value = GetRecordValue(record);
+      // Values in the mapping are only as aligned as the key size allows
+      if (reinterpret_cast<uintptr_t>(value) % alignof(V) != 0)
+      {
+        aligned_value.resize(value_size);
+        std::memcpy(aligned_value.data(), value, value_size * sizeof(V));
+        value = reinterpret_cast<const u8*>(aligned_value.data());
+      }
+      reader.Read(key, reinterpret_cast<const V*>(value), value_size);
+    });
+    return count;
+  }
+
+  bool Contains(const K& key) const
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    return FindRecord(&key, HashKey(&key)) != nullptr;
+  }
+
+  // Copies the newest value stored for key.
+  bool Lookup(const K& key, std::vector<V>* value) const
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    const u8* record = FindRecord(&key, HashKey(&key));
+    if (!record)
+      return false;
+    value->resize(GetValueSize(record));
+    std::memcpy(value->data(), GetRecordValue(record), value->size() * sizeof(V));
+    return true;
+  }
+
+  u32 GetEntryCount() const
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    return m_num_entries;
+  }
+
+  // Waits for the pending appends and flushes them to the OS.
+  void Sync()
+  {
+    m_flush_tasks.Wait();
+    Flush();
+    std::lock_guard<std::mutex> guard(m_file_mutex);
+    if (m_file.IsOpen())
+      m_file.Flush();
+  }
+
+  void Close()
+  {
+    if (m_filename.empty())
+      return;
+    Finish(m_dead_records > 0 && m_dead_records * 4 >= m_num_records);
+    Reset();
+  }
+
+  // Rewrites the file with only the newest record of every key and reopens it.
+  bool Compact()
+  {
+    if (m_filename.empty())
+      return false;
+    const std::string filename = m_filename;
+    std::string version = m_version;
+    const bool result = Finish(true);
+    Reset();
+    Open(filename, std::move(version));
+    return result;
+  }
+
+  // Appends a key-value pair to the store, a pair with the same key is replaced.
+  void Append(const K& key, const V* value, u32 value_size)
+  {
+    const u64 record_size = GetRecordSize(value_size);
+    std::unique_ptr<u8[]> record(new u8[record_size]);
+    std::memcpy(record.get(), &value_size, sizeof(u32));
+    std::memcpy(record.get() + sizeof(u32), &key, sizeof(K));
+    if (value_size)
+      std::memcpy(record.get() + sizeof(u32) + sizeof(K), value, value_size * sizeof(V));
+
+    std::lock_guard<std::mutex> guard(m_mutex);
+    if (m_filename.empty())
+      return;
+    const u32 entry_number = ++m_num_records;
+    std::memcpy(record.get() + record_size - sizeof(u32), &entry_number, sizeof(u32));
+    AddUnindexedRecord(record.get(), m_end);
+    m_end += record_size;
+    m_last_record = record.get();
+    m_last_record_size = record_size;
+    m_index_stale = true;
+
+    // The flush task writes everything appended until it runs
+    m_pending.emplace_back(record.get(), record_size);
+    m_added.push_back(std::move(record));
+    if (!m_flush_scheduled)
+    {
+      m_flush_scheduled = true;
+      m_flush_tasks.Run([this] { Flush(); });
+    }
+  }
+
+private:
+  static constexpr u32 INDEX_ID = 0x58494344;  // "DCIX"
+  static constexpr u32 INDEX_VERSION = 1;
+  static constexpr u64 RECORD_OVERHEAD = sizeof(u32) + sizeof(K) + sizeof(u32);
+
+  struct IndexHeader
+  {
+    u32 id;
+    u32 version;
+    u64 data_size;
+    u64 last_record_offset;
+    u64 last_record_hash;
+    u32 record_count;
+    u32 entry_count;
+  };
+
+  struct IndexEntry
+  {
+    u64 key_hash;
+    u64 offset;
+
+    bool operator<(const IndexEntry& rhs) const
+    {
+      return key_hash < rhs.key_hash || (key_hash == rhs.key_hash && offset < rhs.offset);
+    }
+  };
+  static_assert(sizeof(IndexHeader) % alignof(IndexEntry) == 0,
+                "index entries are aligned in the mapping");
+
+  struct UnindexedRecord
+  {
+    const u8* data;
+    u64 offset;
+  };
+
+  std::string GetIndexFileName() const { return m_filename + ".idx"; }
 
-      V* value = nullptr;
-      u32 value_size = 0;
-      u32 entry_number = 0;
+  static u32 ReadU32(const u8* data)
+  {
+    u32 value;
+    std::memcpy(&value, data, sizeof(u32));
+    return value;
+  }
+  static u64 GetRecordSize(u32 value_size) { return RECORD_OVERHEAD + u64(value_size) * sizeof(V); }
+  static u32 GetValueSize(const u8* record) { return ReadU32(record); }
+  static const u8* GetRecordKey(const u8* record) { return record + sizeof(u32); }
+  static const u8* GetRecordValue(const u8* record) { return record + sizeof(u32) + sizeof(K); }
+  static u64 HashKey(const void* key) { return XXH64(key, sizeof(K), 0); }
+
+  void LoadIndex()
+  {
+    m_indexed_size = sizeof(Header);
+    if (!m_index.Open(GetIndexFileName()) || m_index.GetSize() < sizeof(IndexHeader))
+    {
+      m_index.Close();
+      return;
+    }
+
+    IndexHeader header;
+    std::memcpy(&header, m_index.GetData(), sizeof(IndexHeader));
+    bool valid = header.id == INDEX_ID && header.version == INDEX_VERSION &&
+                 header.entry_count <= header.record_count &&
+                 m_index.GetSize() ==
+                     sizeof(IndexHeader) + u64(header.entry_count) * sizeof(IndexEntry) &&
+                 header.data_size >= sizeof(Header) && header.data_size <= m_data.GetSize();
+    const u8* last_record = nullptr;
+    u64 last_record_size = 0;
+    if (valid && header.record_count == 0)
+    {
+      valid = header.data_size == sizeof(Header);
+    }
+    else if (valid)
+    {
+      // The index belongs to this file if it ends with the same record
+      valid = header.last_record_offset >= sizeof(Header) &&
+              header.last_record_offset <= header.data_size &&
+              header.data_size - header.last_record_offset >= RECORD_OVERHEAD;
+      if (valid)
+      {
+        last_record = m_data.GetData() + header.last_record_offset;
+        last_record_size = GetRecordSize(GetValueSize(last_record));
+        valid = last_record_size == header.data_size - header.last_record_offset &&
+                ReadU32(last_record + last_record_size - sizeof(u32)) == header.record_count &&
+                XXH64(last_record, last_record_size, 0) == header.last_record_hash;
+      }
+    }
+    if (!valid)
+    {
+      m_index.Close();
+      return;
+    }
 
-      std::fstream::pos_type last_pos = m_file.tellg();
+    m_index_entries = reinterpret_cast<const IndexEntry*>(m_index.GetData() + sizeof(IndexHeader));
+    m_index_count = header.entry_count;
+    m_indexed_size = header.data_size;
+    m_num_records = header.record_count;
+    m_num_entries = header.entry_count;
+    m_dead_records = header.record_count - header.entry_count;
+    m_last_record = last_record;
+    m_last_record_size = last_record_size;
+  }
 
-      while (Read(&value_size))
+  void ParseUnindexedRecords()
+  {
+    const u8* data = m_data.GetData();
+    const u64 size = m_data.GetSize();
+    u64 offset = m_indexed_size;
+    while (size - offset >= RECORD_OVERHEAD)
+    {
+      const u8* record = data + offset;
+      const u64 record_size = GetRecordSize(GetValueSize(record));
+      if (record_size > size - offset ||
+          ReadU32(record + record_size - sizeof(u32)) != m_num_records + 1)
       {
-        std::streamoff next_extent = (last_pos - start_pos) + sizeof(value_size) + value_size;
-        if (next_extent > file_size)
-          break;
+        break;
+      }
+      m_num_records++;
+      AddUnindexedRecord(record, offset);
+      m_last_record = record;
+      m_last_record_size = record_size;
+      offset += record_size;
+    }
+    m_end = offset;
+    m_mapped_end = offset;
+    m_index_stale = !m_unindexed.empty();
+  }
 
-        delete[] value;
-        value = new V[value_size];
+  // Indexes all records of a cache without a valid index, e.g. one written before the index
+  // existed. Sorting them at once is much cheaper than adding them one by one.
+  void BuildIndex()
+  {
+    const u8* data = m_data.GetData();
+    const u64 size = m_data.GetSize();
+    u64 offset = sizeof(Header);
+    while (size - offset >= RECORD_OVERHEAD)
+    {
+      const u8* record = data + offset;
+      const u64 record_size = GetRecordSize(GetValueSize(record));
+      if (record_size > size - offset ||
+          ReadU32(record + record_size - sizeof(u32)) != m_num_records + 1)
+      {
+        break;
+      }
+      m_num_records++;
+      m_built_index.push_back({HashKey(GetRecordKey(record)), offset});
+      m_last_record = record;
+      m_last_record_size = record_size;
+      offset += record_size;
+    }
+    std::sort(m_built_index.begin(), m_built_index.end());
 
-        // read key/value and pass to reader
-        if (Read(&key) && Read(value, value_size) && Read(&entry_number) &&
-            entry_number == m_num_entries + 1)
-        {
-          reader.Read(key, value, value_size);
-        }
-        else
+    // Only keep the newest record of every key, it has the highest offset
+    auto is_replaced = [&](const IndexEntry& entry) {
+      for (auto it = &entry + 1; it != m_built_index.data() + m_built_index.size() &&
+                                 it->key_hash == entry.key_hash;
+           ++it)
+      {
+        if (std::memcmp(GetRecordKey(data + it->offset), GetRecordKey(data + entry.offset),
+                        sizeof(K)) == 0)
         {
-          break;
+          return true;
         }
+      }
+      return false;
+    };
+    std::vector<IndexEntry> entries;
+    entries.reserve(m_built_index.size());
+    for (const IndexEntry& entry : m_built_index)
+    {
+      if (!is_replaced(entry))
+        entries.push_back(entry);
+    }
+    m_built_index.swap(entries);
+
+    m_index_entries = m_built_index.data();
+    m_index_count = static_cast<u32>(m_built_index.size());
+    m_indexed_size = offset;
+    m_num_entries = m_index_count;
+    m_dead_records = m_num_records - m_num_entries;
+    m_end = offset;
+    m_mapped_end = offset;
+    m_index_stale = true;
+  }
+
+  void AddUnindexedRecord(const u8* record, u64 offset)
+  {
+    const u8* key = GetRecordKey(record);
+    const u64 hash = HashKey(key);
+    const auto range = m_unindexed.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+      if (std::memcmp(GetRecordKey(it->second.data), key, sizeof(K)) == 0)
+      {
+        it->second = {record, offset};
+        m_dead_records++;
+        return;
+      }
+    }
+    m_unindexed.emplace(hash, UnindexedRecord{record, offset});
+    if (FindIndexedRecord(key, hash, nullptr))
+      m_dead_records++;
+    else
+      m_num_entries++;
+  }
 
-        m_num_entries++;
-        last_pos = m_file.tellg();
+  const u8* FindIndexedRecord(const void* key, u64 hash, u64* offset) const
+  {
+    const IndexEntry* end = m_index_entries + m_index_count;
+    const IndexEntry* it = std::lower_bound(
+        m_index_entries, end, hash,
+        [](const IndexEntry& entry, u64 value) { return entry.key_hash < value; });
+    for (; it != end && it->key_hash == hash; ++it)
+    {
+      // Don't trust the offsets further than the checked part of the file
+      if (it->offset < sizeof(Header) || it->offset > m_indexed_size ||
+          m_indexed_size - it->offset < RECORD_OVERHEAD)
+      {
+        continue;
       }
-      m_file.seekp(last_pos);
-      m_file.clear();
+      const u8* record = m_data.GetData() + it->offset;
+      if (GetRecordSize(GetValueSize(record)) > m_indexed_size - it->offset)
+        continue;
+      if (std::memcmp(GetRecordKey(record), key, sizeof(K)) == 0)
+      {
+        if (offset)
+          *offset = it->offset;
+        return record;
+      }
+    }
+    return nullptr;
+  }
 
-      delete[] value;
-      return m_num_entries;
+  const u8* FindRecord(const void* key, u64 hash) const
+  {
+    const auto range = m_unindexed.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+      if (std::memcmp(GetRecordKey(it->second.data), key, sizeof(K)) == 0)
+        return it->second.data;
     }
+    return FindIndexedRecord(key, hash, nullptr);
+  }
 
-    // failed to open file for reading or bad header
-    // close and recreate file
-    Close();
-    File::OpenFStream(m_file, filename, ios_base::out | ios_base::trunc | ios_base::binary);
-    WriteHeader();
-    return 0;
+  bool IsNewest(const u8* record) const
+  {
+    if (m_dead_records == 0)
+      return true;
+    const u8* key = GetRecordKey(record);
+    return FindRecord(key, HashKey(key)) == record;
   }
 
-  void Sync() { m_file.flush(); }
-  void Close()
+  // Calls func(record, offset, size) for the records of the mapping in file order.
+  template <typename F>
+  void ForEachMappedRecord(F&& func) const
   {
-    if (m_file.is_open())
-      m_file.close();
-    // clear any error flags
-    m_file.clear();
+    const u8* data = m_data.GetData();
+    u64 offset = sizeof(Header);
+    while (offset < m_mapped_end && m_mapped_end - offset >= RECORD_OVERHEAD)
+    {
+      const u8* record = data + offset;
+      const u64 size = GetRecordSize(GetValueSize(record));
+      if (size > m_mapped_end - offset)
+        break;
+      func(record, offset, size);
+      offset += size;
+    }
   }
 
-  // Appends a key-value pair to the store.
-  void Append(const K& key, const V* value, u32 value_size)
+  void Flush()
   {
-    // TODO: Should do a check that we don't already have "key"? (I think each caller does that
-    // already.)
-    Write(&value_size);
-    Write(&key);
-    Write(value, value_size);
-    m_num_entries++;
-    Write(&m_num_entries);
+    // Held while writing, so batches are written in the order they were taken
+    std::lock_guard<std::mutex> file_guard(m_file_mutex);
+    std::vector<std::pair<const u8*, u64>> records;
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      records.swap(m_pending);
+      m_flush_scheduled = false;
+    }
+    if (records.empty())
+      return;
+
+    m_write_buffer.clear();
+    for (const auto& record : records)
+      m_write_buffer.insert(m_write_buffer.end(), record.first, record.first + record.second);
+    m_file.WriteBytes(m_write_buffer.data(), m_write_buffer.size());
   }
 
-private:
-  void WriteHeader() { Write(&m_header); }
-  bool ValidateHeader()
+  bool WriteIndex(std::vector<IndexEntry>* entries, u64 data_size, const u8* last_record,
+                  u64 last_record_size, u32 record_count)
+  {
+    std::sort(entries->begin(), entries->end());
+    IndexHeader header = {};
+    header.id = INDEX_ID;
+    header.version = INDEX_VERSION;
+    header.data_size = data_size;
+    header.record_count = record_count;
+    header.entry_count = static_cast<u32>(entries->size());
+    if (last_record)
+    {
+      header.last_record_offset = data_size - last_record_size;
+      header.last_record_hash = XXH64(last_record, last_record_size, 0);
+    }
+
+    // The old index can't be replaced while it is mapped
+    m_index.Close();
+    File::IOFile file(GetIndexFileName(), "wb");
+    return file.WriteBytes(&header, sizeof(IndexHeader)) &&
+           file.WriteArray(entries->data(), entries->size());
+  }
+
+  bool WriteIndex()
+  {
+    std::vector<IndexEntry> entries;
+    entries.reserve(m_num_entries);
+    std::vector<u64> replaced;
+    for (const auto& it : m_unindexed)
+    {
+      u64 offset;
+      if (FindIndexedRecord(GetRecordKey(it.second.data), it.first, &offset))
+        replaced.push_back(offset);
+      entries.push_back({it.first, it.second.offset});
+    }
+    std::sort(replaced.begin(), replaced.end());
+    for (u32 i = 0; i < m_index_count; ++i)
+    {
+      if (!std::binary_search(replaced.begin(), replaced.end(), m_index_entries[i].offset))
+        entries.push_back(m_index_entries[i]);
+    }
+    return WriteIndex(&entries, m_end, m_last_record, m_last_record_size, m_num_records);
+  }
+
+  bool WriteCompacted()
   {
-    char file_header[sizeof(Header)];
+    const std::string temp_filename = m_filename + ".tmp";
+    File::IOFile file(temp_filename, "wb");
+    bool success = file.WriteBytes(&m_header, sizeof(Header));
 
-    return (Read(file_header, sizeof(Header)) &&
-            !memcmp((const char*)&m_header, file_header, sizeof(Header)));
+    std::vector<IndexEntry> entries;
+    entries.reserve(m_num_entries);
+    std::vector<u8> record_copy;
+    u64 offset = sizeof(Header);
+    u32 count = 0;
+    auto write_record = [&](const u8* record, u64 size) {
+      if (!IsNewest(record))
+        return;
+      // Renumber, the replaced records leave gaps
+      record_copy.assign(record, record + size);
+      const u32 entry_number = ++count;
+      std::memcpy(record_copy.data() + size - sizeof(u32), &entry_number, sizeof(u32));
+      success &= file.WriteBytes(record_copy.data(), size);
+      entries.push_back({HashKey(GetRecordKey(record)), offset});
+      offset += size;
+    };
+    ForEachMappedRecord([&](const u8* record, u64, u64 size) { write_record(record, size); });
+    for (const auto& record : m_added)
+      write_record(record.get(), GetRecordSize(GetValueSize(record.get())));
+    success &= file.Close();
+
+    // Windows can't replace a mapped file
+    m_data.Close();
+    if (!success || !File::Rename(temp_filename, m_filename))
+    {
+      File::Delete(temp_filename);
+      File::Delete(GetIndexFileName());
+      return false;
+    }
+    return WriteIndex(&entries, offset, count ? record_copy.data() : nullptr, record_copy.size(),
+                      count);
   }
 
-  template <typename D>
-  bool Write(const D* data, u32 count = 1)
+  // Writes the pending appends and then the index or a compacted file.
+  bool Finish(bool compact)
   {
-    return m_file.write(reinterpret_cast<const char*>(data), count * sizeof(D)).good();
+    m_flush_tasks.Wait();
+    Flush();
+    m_file.Close();
+    if (compact)
+      return WriteCompacted();
+    if (m_index_stale)
+      return WriteIndex();
+    return true;
   }
 
-  template <typename D>
-  bool Read(D* data, u32 count = 1)
+  void Reset()
   {
-    return m_file.read(reinterpret_cast<char*>(data), count * sizeof(D)).good();
+    m_data.Close();
+    m_index.Close();
+    m_index_entries = nullptr;
+    m_index_count = 0;
+    m_built_index.clear();
+    m_unindexed.clear();
+    m_added.clear();
+    m_pending.clear();
+    m_filename.clear();
+    m_version.clear();
+    m_indexed_size = 0;
+    m_mapped_end = 0;
+    m_end = 0;
+    m_last_record = nullptr;
+    m_last_record_size = 0;
+    m_num_records = 0;
+    m_num_entries = 0;
+    m_dead_records = 0;
+    m_index_stale = false;
   }
 
   struct Header
   {
-    void Init(std::string version)
+    void Init(const std::string& version)
     {
       // Null-terminator is intentionally not copied.
       std::memcpy(&id, "DCAC", sizeof(u32));
+      std::memset(ver, 0, sizeof(ver));
       std::memcpy(ver, version.c_str(), std::min(version.size(), sizeof(ver)));
     }
     void Init()
@@ -198,6 +686,35 @@ private:
 
   } m_header;
 
-  std::fstream m_file;
-  u32 m_num_entries;
+  std::string m_filename;
+  std::string m_version;
+  File::MappedFile m_data;
+  File::MappedFile m_index;
+  // Points into the index file, or into m_built_index if it had to be rebuilt
+  const IndexEntry* m_index_entries = nullptr;
+  u32 m_index_count = 0;
+  std::vector<IndexEntry> m_built_index;
+  // Records after the indexed part of the file, appended ones point into m_added
+  std::unordered_multimap<u64, UnindexedRecord> m_unindexed;
+  std::vector<std::unique_ptr<u8[]>> m_added;
+
+  u64 m_indexed_size = 0;
+  u64 m_mapped_end = 0;
+  u64 m_end = 0;
+  const u8* m_last_record = nullptr;
+  u64 m_last_record_size = 0;
+  u32 m_num_records = 0;
+  u32 m_num_entries = 0;
+  // Records replaced by a newer one with the same key
+  u32 m_dead_records = 0;
+  bool m_index_stale = false;
+
+  mutable std::mutex m_mutex;
+  // Guards m_file and m_write_buffer
+  std::mutex m_file_mutex;
+  File::IOFile m_file;
+  std::vector<u8> m_write_buffer;
+  std::vector<std::pair<const u8*, u64>> m_pending;
+  bool m_flush_scheduled = false;
+  Common::TaskGroup m_flush_tasks;
 };
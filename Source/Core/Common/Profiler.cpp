@@ -19,6 +19,7 @@ static const u32 PROFILER_FIELD_LENGTH = 8;
 static const u32 PROFILER_FIELD_LENGTH_FP = PROFILER_FIELD_LENGTH + 3;
 static const int PROFILER_LAZY_DELAY = 60;  // in frames
 
+bool Profiler::s_enabled = false;
 std::list<Profiler*> Profiler::s_all_profilers;
 std::mutex Profiler::s_mutex;
 u32 Profiler::s_max_length = 0;
@@ -30,7 +31,7 @@ int Profiler::s_lazy_delay = 0;
 
 Profiler::Profiler(const std::string& name)
     : m_name(name), m_usecs(0), m_usecs_min(UINT64_MAX), m_usecs_max(0), m_usecs_quad(0),
-      m_calls(0), m_depth(0)
+      m_calls(0), m_total{name, 0, 0, UINT64_MAX, 0}, m_depth(0)
 {
   m_time = Common::Timer::GetTimeUs();
   s_max_length = std::max<u32>(s_max_length, u32(m_name.length()));
@@ -50,8 +51,16 @@ bool Profiler::operator<(const Profiler& b) const
   return m_usecs < b.m_usecs;
 }
 
+void Profiler::SetEnabled(bool enabled)
+{
+  s_enabled = enabled;
+}
+
 std::string Profiler::ToString()
 {
+  if (!s_enabled)
+    return "";
+
   if (s_lazy_delay > 0)
   {
     s_lazy_delay--;
@@ -97,6 +106,19 @@ std::string Profiler::ToString()
   return s_lazy_result;
 }
 
+std::vector<Profiler::Result> Profiler::ReadAll()
+{
+  std::lock_guard<std::mutex> lk(s_mutex);
+  std::vector<Result> results;
+  results.reserve(s_all_profilers.size());
+  for (auto profiler : s_all_profilers)
+    results.push_back(profiler->ReadResult());
+
+  std::sort(results.begin(), results.end(),
+            [](const Result& a, const Result& b) { return a.usecs > b.usecs; });
+  return results;
+}
+
 void Profiler::Start()
 {
   if (!m_depth++)
@@ -118,6 +140,11 @@ void Profiler::Stop()
     m_usecs_max = std::max(m_usecs_max, diff);
     m_usecs_quad += diff * diff;
     m_calls++;
+
+    m_total.calls++;
+    m_total.usecs += diff;
+    m_total.usecs_min = std::min(m_total.usecs_min, diff);
+    m_total.usecs_max = std::max(m_total.usecs_max, diff);
   }
 }
 
@@ -161,4 +188,18 @@ std::string Profiler::Read()
 
   return buffer.str();
 }
+
+Profiler::Result Profiler::ReadResult()
+{
+  Result result = m_total;
+  if (!result.calls)
+    result.usecs_min = 0;
+
+  m_total.calls = 0;
+  m_total.usecs = 0;
+  m_total.usecs_min = UINT64_MAX;
+  m_total.usecs_max = 0;
+
+  return result;
+}
 }
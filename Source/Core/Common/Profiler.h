@@ -7,6 +7,7 @@
 #include <list>
 #include <mutex>
 #include <string>
+#include <vector>
 
 #include "CommonTypes.h"
 
@@ -15,18 +16,36 @@ namespace Common
 class Profiler
 {
 public:
+  struct Result
+  {
+    std::string name;
+    u64 calls;
+    u64 usecs;
+    u64 usecs_min;
+    u64 usecs_max;
+  };
+
   Profiler(const std::string& name);
   ~Profiler();
 
+  // Profiling is off by default, the profiled scopes only test this flag then.
+  static void SetEnabled(bool enabled);
+  static bool IsEnabled() { return s_enabled; }
+
   static std::string ToString();
+  // Returns the totals of all profilers since the last call, sorted by time. They are counted
+  // separately from the overlay, which resets its counters whenever it is refreshed.
+  static std::vector<Result> ReadAll();
 
   void Start();
   void Stop();
   std::string Read();
+  Result ReadResult();
 
   bool operator<(const Profiler& b) const;
 
 private:
+  static bool s_enabled;
   static std::list<Profiler*> s_all_profilers;
   static std::mutex s_mutex;
   static u32 s_max_length;
@@ -43,20 +62,33 @@ private:
   u64 m_usecs_quad;
   u64 m_calls;
   u64 m_time;
+  Result m_total;
   int m_depth;
 };
 
 class ProfilerExecuter
 {
 public:
-  ProfilerExecuter(Profiler* _p) : m_p(_p) { m_p->Start(); }
-  ~ProfilerExecuter() { m_p->Stop(); }
+  ProfilerExecuter(Profiler* _p) : m_p(Profiler::IsEnabled() ? _p : nullptr)
+  {
+    if (m_p)
+      m_p->Start();
+  }
+  ~ProfilerExecuter()
+  {
+    if (m_p)
+      m_p->Stop();
+  }
 private:
   Profiler* m_p;
 };
 };
 
+#define PROFILER_CONCAT_IMPL(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_IMPL(a, b)
+
 // Warning: This profiler isn't thread safe. Only profile functions which doesn't run simultaneously
+// The names of the locals contain the line, so scopes with their own PROFILE can be nested.
 #define PROFILE(name)                                                                              \
-  static Common::Profiler prof_gen(name);                                                          \
-  Common::ProfilerExecuter prof_e(&prof_gen);
+  static Common::Profiler PROFILER_CONCAT(prof_gen, __LINE__)(name);                               \
+  Common::ProfilerExecuter PROFILER_CONCAT(prof_e, __LINE__)(&PROFILER_CONCAT(prof_gen, __LINE__));
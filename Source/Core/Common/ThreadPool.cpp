@@ -1,158 +1,269 @@
+#include <algorithm>
+#include <deque>
+
 #include "Common/Common.h"
 #include "Common/CPUDetect.h"
+#include "Common/Event.h"
+#include "Common/StringUtil.h"
 #include "Common/ThreadPool.h"
 #ifdef _WIN32
 #include <windows.h>
 #endif
 using namespace Common;
-std::mutex ThreadPool::m_workerLock;
 
-ThreadPool::ThreadPool() : m_workflag(0), m_workercount(0), m_workers(16)
+namespace
+{
+struct TaskQueue
+{
+  std::mutex mutex;
+  std::deque<ThreadPool::Task> tasks;
+};
+
+// Index of the deque owned by the current thread, -1 for threads outside the pool
+thread_local int t_worker_index = -1;
+
+class Scheduler
 {
-  m_working.store(true);
-  int workers = cpu_info.logical_cpu_count - 2;
-  workers = workers < 1 ? 1 : workers;
-  for (size_t i = 0; i < workers; i++)
+public:
+  static Scheduler& GetInstance()
   {
-    std::thread* current = new std::thread(&ThreadPool::Workloop, std::ref(*this), i);
-    m_workerThreads.push_back(std::unique_ptr<std::thread>(current));
-#ifdef _WIN32
-    SetThreadPriority(current->native_handle(), THREAD_MODE_BACKGROUND_BEGIN);
-#endif
+    static Scheduler instance;
+    return instance;
   }
-}
 
-ThreadPool::~ThreadPool()
-{
-  m_working.store(false);
-  for (u32 i = 0; i < m_workerThreads.size(); i++)
+  size_t GetThreadCount() const { return m_threads.size(); }
+
+  void Push(ThreadPool::Task&& task)
   {
-    std::thread* current = m_workerThreads[i].get();
-    if (current->joinable())
+    TaskQueue& queue = t_worker_index >= 0 ? *m_queues[t_worker_index] : m_injection;
     {
-      current->join();
+      std::lock_guard<std::mutex> guard(queue.mutex);
+      queue.tasks.push_back(std::move(task));
     }
-  };
-}
+    // Pairs with the check in WorkerLoop, either the worker sees the new task or the task sees
+    // the sleeping worker.
+    m_queued.fetch_add(1);
+    if (m_sleeping.load() > 0)
+    {
+      std::lock_guard<std::mutex> guard(m_sleep_mutex);
+      m_wake.notify_one();
+    }
+  }
 
-ThreadPool& ThreadPool::Getinstance()
-{
-  static ThreadPool instance;
-  return instance;
-}
+  bool TryPop(ThreadPool::Task* task)
+  {
+    if (m_queued.load() == 0)
+      return false;
 
-void ThreadPool::NotifyWorkPending()
-{
-  ThreadPool::Getinstance().m_workflag.fetch_add(2);
-}
+    const int self = t_worker_index;
+    // Newest own task first, it is the most likely one to still be in the cache
+    if (self >= 0 && PopBack(*m_queues[self], task))
+      return true;
+    if (PopFront(m_injection, task))
+      return true;
+    // Steal the oldest tasks of the others
+    const size_t count = m_queues.size();
+    const size_t start = self >= 0 ? self + 1 : 0;
+    for (size_t i = 0; i < count; i++)
+    {
+      if (PopFront(*m_queues[(start + i) % count], task))
+        return true;
+    }
+    return false;
+  }
 
-void ThreadPool::RegisterWorker(IWorker* worker)
-{
-  std::lock_guard<std::mutex> guard(m_workerLock);
-  ThreadPool& instance = ThreadPool::Getinstance();
-  size_t count = instance.m_workercount.fetch_add(1);
-  instance.m_workers[count] = worker;
-}
+private:
+  static size_t GetWorkerCount()
+  {
+    // Keep the cores of the CPU and GPU threads free. With SMT their sibling threads are
+    // left alone too, they would only compete with the emulation for the same core.
+    const size_t logical = std::max(std::thread::hardware_concurrency(), 1u);
+    size_t threads_per_core = 1;
+    if (cpu_info.HTT && cpu_info.num_cores > 0 && logical > size_t(cpu_info.num_cores))
+      threads_per_core = logical / cpu_info.num_cores;
+    const size_t reserved = 2 * threads_per_core;
+    return logical > reserved ? logical - reserved : 1;
+  }
 
-void ThreadPool::UnregisterWorker(IWorker* worker)
-{
-  std::lock_guard<std::mutex> guard(m_workerLock);
-  ThreadPool& instance = ThreadPool::Getinstance();
-  s32 count = instance.m_workercount.load();
-  s32 index = -1;
-  for (s32 i = 0; i < count; i++)
+  Scheduler()
   {
-    if (instance.m_workers[i] == worker)
+    const size_t count = GetWorkerCount();
+    for (size_t i = 0; i < count; i++)
+      m_queues.push_back(std::make_unique<TaskQueue>());
+    for (size_t i = 0; i < count; i++)
     {
-      index = i;
-      break;
+      m_threads.emplace_back(&Scheduler::WorkerLoop, this, static_cast<int>(i));
+#ifdef _WIN32
+      SetThreadPriority(m_threads.back().native_handle(), THREAD_MODE_BACKGROUND_BEGIN);
+#endif
     }
   }
-  if (index > -1 && index < count)
+
+  ~Scheduler()
   {
-    instance.m_workers[index] = instance.m_workers[count - 1];
-    instance.m_workercount.fetch_sub(1);
+    {
+      std::lock_guard<std::mutex> guard(m_sleep_mutex);
+      m_exit = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& thread : m_threads)
+      thread.join();
   }
-}
 
-void ThreadPool::Workloop(ThreadPool &state, size_t ID)
-{
-  u32 rest_time = 1;
-  while (state.m_working.load())
+  bool PopBack(TaskQueue& queue, ThreadPool::Task* task)
+  {
+    std::lock_guard<std::mutex> guard(queue.mutex);
+    if (queue.tasks.empty())
+      return false;
+    *task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    m_queued.fetch_sub(1);
+    return true;
+  }
+
+  bool PopFront(TaskQueue& queue, ThreadPool::Task* task)
   {
-    if (state.m_workflag.load() > ID)
+    std::lock_guard<std::mutex> guard(queue.mutex);
+    if (queue.tasks.empty())
+      return false;
+    *task = std::move(queue.tasks.front());
+    queue.tasks.pop_front();
+    m_queued.fetch_sub(1);
+    return true;
+  }
+
+  void WorkerLoop(int index)
+  {
+    Common::SetCurrentThreadName(StringFromFormat("Worker %i", index).c_str());
+    t_worker_index = index;
+    ThreadPool::Task task;
+    while (true)
     {
-      bool worked = false;
-      u32 count = state.m_workercount.load();
-      for (u32 i = 0; i < count; i++)
-      {
-        IWorker* worker = state.m_workers[i];
-        if (worker)
-        {
-          if (worker->NextTask(ID))
-          {
-            worked = true;
-            state.m_workflag.fetch_sub(1);
-          }
-        }
-      }
-      if (worked)
+      if (TryPop(&task))
       {
-        Common::YieldCPU();
+        task();
+        task = nullptr;
         continue;
       }
-      else if (state.m_workflag.load() > ID)
-      {
-        state.m_workflag.fetch_sub(1);
-      }
-      rest_time = 1;
-    }
-    else
-    {
-      rest_time++;
-      rest_time = rest_time > 5 ? 5 : rest_time;
+
+      std::unique_lock<std::mutex> lock(m_sleep_mutex);
+      m_sleeping.fetch_add(1);
+      m_wake.wait(lock, [this] { return m_exit || m_queued.load() > 0; });
+      m_sleeping.fetch_sub(1);
+      if (m_exit && m_queued.load() == 0)
+        return;
     }
-    SleepCurrentThread(rest_time);
   }
+
+  std::vector<std::unique_ptr<TaskQueue>> m_queues;
+  TaskQueue m_injection;
+  std::vector<std::thread> m_threads;
+  // Tasks in all queues
+  std::atomic<size_t> m_queued{ 0 };
+  std::atomic<size_t> m_sleeping{ 0 };
+  std::mutex m_sleep_mutex;
+  std::condition_variable m_wake;
+  bool m_exit = false;
+};
+}  // namespace
+
+size_t ThreadPool::GetThreadCount()
+{
+  return Scheduler::GetInstance().GetThreadCount();
 }
 
-AsyncWorker& AsyncWorker::Getinstance()
+void ThreadPool::Execute(Task func)
 {
-  static AsyncWorker intance;
-  return intance;
+  Scheduler::GetInstance().Push(std::move(func));
 }
 
-AsyncWorker::AsyncWorker() : m_inputsize(0), m_TaskQueue()
+void ThreadPool::ParallelFor(int begin, int end, int min_band_size, const std::function<void(int, int)>& func)
 {
-  ThreadPool::RegisterWorker(this);
+  const s64 range = end - begin;
+  const s64 band_count = std::min<s64>(GetThreadCount() + 1, range / std::max(min_band_size, 1));
+  if (band_count <= 1)
+  {
+    if (range > 0)
+      func(begin, end);
+    return;
+  }
+
+  struct BandState
+  {
+    std::atomic<s64> next_band{ 0 };
+    std::atomic<s64> remaining{ 0 };
+    Common::Event done;
+  };
+  // Tasks can still be queued after the last band is finished, so the state
+  // must outlive this call. func is only touched by tasks that claimed a band.
+  auto state = std::make_shared<BandState>();
+  state->remaining.store(band_count);
+  auto run_bands = [state, &func, begin, range, band_count]
+  {
+    s64 band;
+    while ((band = state->next_band.fetch_add(1)) < band_count)
+    {
+      func(static_cast<int>(begin + range * band / band_count),
+        static_cast<int>(begin + range * (band + 1) / band_count));
+      if (state->remaining.fetch_sub(1) == 1)
+        state->done.Set();
+    }
+  };
+  for (s64 i = 1; i < band_count; i++)
+  {
+    Execute(run_bands);
+  }
+  run_bands();
+  state->done.Wait();
 }
 
-AsyncWorker::~AsyncWorker()
+TaskGroup::TaskGroup() : m_state(std::make_shared<State>())
 {
-  ThreadPool::UnregisterWorker(this);
 }
 
-bool AsyncWorker::NextTask(size_t ID)
+TaskGroup::~TaskGroup()
+{
+  Wait();
+}
+
+void TaskGroup::Run(ThreadPool::Task func)
 {
-  if (m_inputsize.load() > 0)
   {
-    std::function<void()> func;
-    if (m_TaskQueue.try_pop(func))
-    {
-      func();
-      m_inputsize.fetch_sub(1);
-      return true;
-    }
+    std::lock_guard<std::mutex> guard(m_state->mutex);
+    m_state->tasks.push_back(std::move(func));
+    m_state->pending++;
   }
-  return false;
+  ThreadPool::Execute([state = m_state] { RunQueuedTask(*state); });
 }
 
-void AsyncWorker::ExecuteAsync(std::function<void()> &&func)
+bool TaskGroup::RunQueuedTask()
 {
-  AsyncWorker& instance = Getinstance();
-  instance.m_inputsize.fetch_add(1);
-  instance.m_TaskQueue.push(std::move(func));
-  ThreadPool::NotifyWorkPending();
+  return RunQueuedTask(*m_state);
 }
 
+bool TaskGroup::RunQueuedTask(State& state)
+{
+  ThreadPool::Task task;
+  {
+    std::lock_guard<std::mutex> guard(state.mutex);
+    if (state.tasks.empty())
+      return false;
+    task = std::move(state.tasks.front());
+    state.tasks.pop_front();
+  }
+  task();
+  std::lock_guard<std::mutex> guard(state.mutex);
+  if (--state.pending == 0)
+    state.done.notify_all();
+  return true;
+}
 
+void TaskGroup::Wait()
+{
+  while (RunQueuedTask())
+  {
+  }
+  // Whatever is left is running on other threads
+  std::unique_lock<std::mutex> lock(m_state->mutex);
+  m_state->done.wait(lock, [this] { return m_state->pending == 0; });
+}
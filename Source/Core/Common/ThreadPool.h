@@ -32,13 +32,18 @@
 #pragma once
 #include <atomic>
 #include <condition_variable>
+#include <cstddef>
+#include <deque>
 #include <functional>
+#include <future>
 #include <memory>
 #include <mutex>
 #include <thread>
 #include <utility>
 #include <vector>
 
+#include "Common/Common.h"
+#include "Common/CommonTypes.h"
 #include "Common/Thread.h"
 
 namespace Common
@@ -222,7 +227,7 @@ template<typename T>
 class CircularQueue
 {
 private:
-  const size_t m_capacity;
+  size_t m_capacity;
   size_t increment(size_t idx) const
   {
     return (idx + 1) % m_capacity;
@@ -232,17 +237,17 @@ private:
   std::atomic<size_t>  m_head;
 public:
   CircularQueue(size_t capacity) :
+    m_capacity(capacity),
     m_tail(0),
-    m_head(0),
-    m_capacity(capacity)
+    m_head(0)
   {
     m_container.resize(capacity);
   }
 
   CircularQueue() :
+    m_capacity(128),
     m_tail(0),
-    m_head(0),
-    m_capacity(128)
+    m_head(0)
   {
     m_container.resize(m_capacity);
   }
@@ -250,9 +255,14 @@ public:
   virtual ~CircularQueue()
   {}
 
+  // Drops the queued items, must not be called while other threads use the queue.
   void resize(size_t capacity)
   {
-    m_container.resize(m_capacity);
+    m_capacity = capacity;
+    m_container.clear();
+    m_container.resize(capacity);
+    m_tail.store(0);
+    m_head.store(0);
   }
 
   bool push(const T& item)
@@ -302,175 +312,261 @@ public:
   }
 };
 
-// One Producer - Multiple Consumers
-template <typename T, class Container = OneToOneQueue<T>>
-struct OneToManyQueue
+// Bounded lock free Multiple Producers - Multiple Consumers queue.
+// Every slot carries a sequence number that tells producers and consumers whether it is free
+// for the current lap of the ring, so push and try_pop only contend on a single compare exchange
+// of the enqueue or dequeue position. Both positions live on their own cache line.
+// wait_push and wait_pop block the calling thread while the queue is full or empty, the
+// waiter bookkeeping is only touched by the other side when somebody is actually waiting.
+template <typename T>
+class BoundedQueue
 {
-private:
-  std::mutex m_dequeueLock;
-  Container m_inner;
 public:
-  OneToManyQueue() : m_inner(), m_dequeueLock()
-  {}
-  OneToManyQueue(size_t capacity) : m_inner(capacity), m_dequeueLock()
-  {}
-  ~OneToManyQueue()
-  {}
+  static constexpr size_t CACHE_LINE_SIZE = 64;
 
-  bool push(const T &item)
+  // The capacity is rounded up to the next power of two.
+  explicit BoundedQueue(size_t capacity = 1024)
   {
-    return m_inner.push(item);
+    size_t size = 2;
+    while (size < capacity)
+      size <<= 1;
+    m_mask = size - 1;
+    m_cells.reset(new Cell[size]);
+    for (size_t i = 0; i < size; i++)
+      m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    m_enqueue_pos.store(0, std::memory_order_relaxed);
+    m_dequeue_pos.store(0, std::memory_order_relaxed);
   }
 
-  bool push(T &&item)
+  size_t capacity() const
   {
-    return m_inner.push(std::move(item));
+    return m_mask + 1;
   }
 
-  bool try_pop(T &item)
+  // Returns false if the queue is full.
+  bool push(const T& item)
   {
-    std::lock_guard<std::mutex> guard(m_dequeueLock);
-    bool success = m_inner.try_pop(item);
-    return success;
+    return emplace(item);
   }
 
-  bool empty()
+  bool push(T&& item)
   {
-    return m_inner.empty();
+    return emplace(std::move(item));
   }
-};
-
-// Multiple Producer - One Consumers
-template <typename T, class Container = OneToOneQueue<T>, bool ContentionControl = true>
-struct ManyToOneQueue
-{
-private:
-  std::mutex m_equeueLock;
-  Container m_inner;
-public:
-  ManyToOneQueue() : m_inner(), m_equeueLock()
-  {}
-  ManyToOneQueue(size_t capacity) : m_inner(capacity), m_equeueLock()
-  {}
-  ~ManyToOneQueue()
-  {}
 
-  bool push(const T &item)
+  // Returns false if the queue is empty.
+  bool try_pop(T& item)
   {
-    std::lock_guard<std::mutex> guard(m_equeueLock);
-    bool success = m_inner.push(item);
-    return success;
+    Cell* cell;
+    size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+    while (true)
+    {
+      cell = &m_cells[pos & m_mask];
+      const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence - (pos + 1));
+      if (diff == 0)
+      {
+        if (m_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          break;
+      }
+      else if (diff < 0)
+      {
+        return false;
+      }
+      else
+      {
+        pos = m_dequeue_pos.load(std::memory_order_relaxed);
+      }
+    }
+    item = std::move(cell->value);
+    // Frees the slot for the next lap of the producers
+    cell->sequence.store(pos + m_mask + 1, std::memory_order_release);
+    Notify(m_push_waiters, m_not_full);
+    return true;
   }
-  bool push(T &&item)
+
+  void wait_push(const T& item)
   {
-    std::lock_guard<std::mutex> guard(m_equeueLock);
-    bool success = m_inner.push(std::move(item));
-    return success;
+    Wait(m_push_waiters, m_not_full, [&] { return emplace(item); }, [this] { return !full(); });
   }
-  bool try_pop(T &item)
+
+  void wait_push(T&& item)
   {
-    return m_inner.try_pop(item);
+    Wait(m_push_waiters, m_not_full, [&] { return emplace(std::move(item)); },
+         [this] { return !full(); });
   }
-  bool empty()
+
+  void wait_pop(T& item)
   {
-    return m_inner.empty();
+    Wait(m_pop_waiters, m_not_empty, [&] { return try_pop(item); }, [this] { return !empty(); });
   }
-};
 
-// Multiple Producer - Multiple Consumers
-template <typename T, class Container = OneToOneQueue<T>, bool ContentionControl = true>
-struct ManyToManyQueue
-{
-private:
-  std::mutex m_dequeueLock;
-  std::mutex m_equeueLock;
-  Container m_inner;
-public:
-  ManyToManyQueue() :
-    m_inner(),
-    m_dequeueLock(),
-    m_equeueLock()
+  bool empty() const
   {
+    const size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+    const size_t sequence = m_cells[pos & m_mask].sequence.load(std::memory_order_acquire);
+    return static_cast<std::ptrdiff_t>(sequence - (pos + 1)) < 0;
+  }
 
+  bool full() const
+  {
+    const size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+    const size_t sequence = m_cells[pos & m_mask].sequence.load(std::memory_order_acquire);
+    return static_cast<std::ptrdiff_t>(sequence - pos) < 0;
   }
-  ManyToManyQueue(size_t capacity) :
-    m_inner(capacity),
-    m_dequeueLock(),
-    m_equeueLock()
-  {}
 
-  ~ManyToManyQueue()
-  {}
+private:
+  BoundedQueue(const BoundedQueue&);
+  void operator=(const BoundedQueue&);
 
-  bool push(const T &item)
+  struct Cell
   {
-    std::lock_guard<std::mutex> guard(m_equeueLock);
-    bool success = m_inner.push(item);
-    return success;
-  }
+    std::atomic<size_t> sequence;
+    T value;
+  };
 
-  bool push(T &&item)
+  template <typename U>
+  bool emplace(U&& item)
   {
-    std::lock_guard<std::mutex> guard(m_equeueLock);
-    bool success = m_inner.push(std::move(item));
-    return success;
+    Cell* cell;
+    size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+    while (true)
+    {
+      cell = &m_cells[pos & m_mask];
+      const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence - pos);
+      if (diff == 0)
+      {
+        if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          break;
+      }
+      else if (diff < 0)
+      {
+        return false;
+      }
+      else
+      {
+        pos = m_enqueue_pos.load(std::memory_order_relaxed);
+      }
+    }
+    cell->value = std::forward<U>(item);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    Notify(m_pop_waiters, m_not_empty);
+    return true;
   }
 
-  bool try_pop(T &item)
+  void Notify(std::atomic<size_t>& waiters, std::condition_variable& condition)
   {
-    std::lock_guard<std::mutex> guard(m_dequeueLock);
-    bool success = m_inner.try_pop(item);
-    return success;
+    // Pairs with the fence in Wait, either the waiter sees the slot or we see the waiter.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters.load(std::memory_order_relaxed) == 0)
+      return;
+    std::lock_guard<std::mutex> guard(m_wait_mutex);
+    condition.notify_all();
   }
 
-  bool empty()
+  template <typename F, typename R>
+  void Wait(std::atomic<size_t>& waiters, std::condition_variable& condition, F&& attempt,
+            R&& ready)
   {
-    return m_inner.empty();
-  }
+    for (size_t count = 0; count < 16; count++)
+    {
+      if (attempt())
+        return;
+      cYield(count);
+    }
+    waiters.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    // The attempt runs unlocked, it takes the lock itself to notify the other side
+    while (!attempt())
+    {
+      std::unique_lock<std::mutex> lock(m_wait_mutex);
+      condition.wait(lock, ready);
+    }
+    waiters.fetch_sub(1);
+  }
+
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_enqueue_pos;
+  // Explicit padding, the queue may be allocated without the alignment of its members
+  u8 m_enqueue_padding[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_dequeue_pos;
+  u8 m_dequeue_padding[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+  alignas(CACHE_LINE_SIZE) std::unique_ptr<Cell[]> m_cells;
+  size_t m_mask;
+  std::atomic<size_t> m_push_waiters{ 0 };
+  std::atomic<size_t> m_pop_waiters{ 0 };
+  std::mutex m_wait_mutex;
+  std::condition_variable m_not_full;
+  std::condition_variable m_not_empty;
 };
 
-class IWorker
-{
-public:
-  virtual ~IWorker()
-  {}
-  virtual bool NextTask(size_t ID) = 0;
-};
+// One Producer - Multiple Consumers
+template <typename T>
+using OneToManyQueue = BoundedQueue<T>;
+
+// Multiple Producers - One Consumer
+template <typename T>
+using ManyToOneQueue = BoundedQueue<T>;
+
+// Multiple Producers - Multiple Consumers
+template <typename T>
+using ManyToManyQueue = BoundedQueue<T>;
 
+// Work stealing task scheduler. Every worker thread owns a deque: tasks spawned by a worker are
+// pushed to and popped from the back of its own deque, idle workers steal from the front of the
+// others. Tasks submitted by other threads go to a shared injection queue. Workers without work
+// block on a condition variable instead of polling.
 class ThreadPool
 {
-private:
-  std::vector<std::unique_ptr<std::thread>> m_workerThreads;
-  std::vector<IWorker*> m_workers;
-  std::atomic<s32> m_workflag;
-  std::atomic<s32> m_workercount;
-  std::atomic<bool> m_working;
-  static std::mutex m_workerLock;
-  static void Workloop(ThreadPool &state, size_t ID);
-  static ThreadPool &Getinstance();
-  ThreadPool(ThreadPool const&);
-  void operator=(ThreadPool const&);
-  ThreadPool();
 public:
-  virtual ~ThreadPool();
-  static void NotifyWorkPending();
-  static void RegisterWorker(IWorker* worker);
-  static void UnregisterWorker(IWorker* worker);
-  static inline size_t GetThreadCount() {
-    return Getinstance().m_workerThreads.size();
-  }
+  typedef std::function<void()> Task;
+
+  static size_t GetThreadCount();
+  // Runs func on a worker.
+  static void Execute(Task func);
+  template <typename F>
+  static auto Async(F&& func) -> std::future<decltype(func())>
+  {
+    typedef decltype(func()) Result;
+    auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(func));
+    std::future<Result> result = task->get_future();
+    Execute([task] { (*task)(); });
+    return result;
+  }
+  // Splits [begin, end) into bands of at least min_band_size items and runs
+  // func(lower, upper) for every band on the pool. The calling thread processes
+  // bands too and only returns once all of them are done.
+  static void ParallelFor(int begin, int end, int min_band_size, const std::function<void(int, int)>& func);
 };
 
-class AsyncWorker final : IWorker
+// A set of tasks that can be waited for. Wait runs the tasks of the group that no worker has
+// started yet on the calling thread and blocks until the others are finished, so groups can be
+// nested inside tasks. Tasks of other groups are never run by the waiting thread.
+class TaskGroup
 {
-private:
-  std::atomic<s32> m_inputsize;
-  ManyToManyQueue<std::function<void()>, OneToOneQueue<std::function<void()>>> m_TaskQueue;
-  static AsyncWorker &Getinstance();
-  AsyncWorker();
 public:
-  virtual ~AsyncWorker();
-  bool NextTask(size_t ID) override;
-  static void ExecuteAsync(std::function<void()> &&func);
+  TaskGroup();
+  ~TaskGroup();
+  void Run(ThreadPool::Task func);
+  void Wait();
+  // Runs one task of the group on the calling thread, returns false if none was left to start.
+  bool RunQueuedTask();
+
+private:
+  TaskGroup(const TaskGroup&);
+  void operator=(const TaskGroup&);
+
+  struct State
+  {
+    std::mutex mutex;
+    std::deque<ThreadPool::Task> tasks;  // not started yet
+    size_t pending = 0;                  // queued or running
+    std::condition_variable done;
+  };
+  static bool RunQueuedTask(State& state);
+
+  // The pool only gets a task to run the next queued one of the group, which may find the queue
+  // empty long after the group is gone
+  std::shared_ptr<State> m_state;
 };
 }
@@ -62,6 +62,22 @@ u64 Timer::GetTimeUs()
 #endif
 }
 
+u64 Timer::GetThreadTimeUs()
+{
+#ifdef _WIN32
+  FILETIME creation_time, exit_time, kernel_time, user_time;
+  GetThreadTimes(GetCurrentThread(), &creation_time, &exit_time, &kernel_time, &user_time);
+  const u64 kernel = (u64)kernel_time.dwHighDateTime << 32 | kernel_time.dwLowDateTime;
+  const u64 user = (u64)user_time.dwHighDateTime << 32 | user_time.dwLowDateTime;
+  // 100 ns units
+  return (kernel + user) / 10;
+#else
+  struct timespec t;
+  (void)clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+  return ((u64)(t.tv_sec * 1000000 + t.tv_nsec / 1000));
+#endif
+}
+
 // --------------------------------------------
 // Initiate, Start, Stop, and Update the time
 // --------------------------------------------
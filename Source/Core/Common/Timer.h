@@ -38,6 +38,8 @@ public:
 
   static u32 GetTimeMs();
   static u64 GetTimeUs();
+  // CPU time used by the calling thread
+  static u64 GetThreadTimeUs();
 
   // Arbitrarily chosen value (38 years) that is subtracted in GetDoubleTime()
   // to increase sub-second precision of the resulting double timestamp
@@ -1795,12 +1795,11 @@ static int GetVEXpp(u8 opPrefix)
 }
 
 void XEmitter::WriteVEXOp(u8 opPrefix, u16 op, X64Reg regOp1, X64Reg regOp2, const OpArg& arg,
-                          int W, int extrabytes)
+                          int W, int extrabytes, int L)
 {
   int mmmmm = GetVEXmmmmm(op);
   int pp = GetVEXpp(opPrefix);
-  // FIXME: we currently don't support 256-bit instructions, and "size" is not the vector size here
-  arg.WriteVEX(this, regOp1, regOp2, 0, pp, mmmmm, W);
+  arg.WriteVEX(this, regOp1, regOp2, L, pp, mmmmm, W);
   Write8(op & 0xFF);
   arg.WriteRest(this, extrabytes, regOp1);
 }
@@ -1813,11 +1812,19 @@ void XEmitter::WriteVEXOp4(u8 opPrefix, u16 op, X64Reg regOp1, X64Reg regOp2, co
 }
 
 void XEmitter::WriteAVXOp(u8 opPrefix, u16 op, X64Reg regOp1, X64Reg regOp2, const OpArg& arg,
-                          int W, int extrabytes)
+                          int W, int extrabytes, int L)
 {
   if (!cpu_info.bAVX)
     PanicAlert("Trying to use AVX on a system that doesn't support it. Bad programmer.");
-  WriteVEXOp(opPrefix, op, regOp1, regOp2, arg, W, extrabytes);
+  WriteVEXOp(opPrefix, op, regOp1, regOp2, arg, W, extrabytes, L);
+}
+
+void XEmitter::WriteAVX2Op(int bits, u8 opPrefix, u16 op, X64Reg regOp1, X64Reg regOp2,
+                           const OpArg& arg, int extrabytes)
+{
+  if (bits == 256 && !cpu_info.bAVX2)
+    PanicAlert("Trying to use AVX2 on a system that doesn't support it. Bad programmer.");
+  WriteAVXOp(opPrefix, op, regOp1, regOp2, arg, 0, extrabytes, bits == 256);
 }
 
 void XEmitter::WriteAVXOp4(u8 opPrefix, u16 op, X64Reg regOp1, X64Reg regOp2, const OpArg& arg,
@@ -2917,6 +2924,80 @@ void XEmitter::VPXOR(X64Reg regOp1, X64Reg regOp2, const OpArg& arg)
   WriteAVXOp(0x66, 0xEF, regOp1, regOp2, arg);
 }
 
+void XEmitter::VMOVD_xmm(X64Reg dest, const OpArg& arg)
+{
+  WriteAVXOp(0x66, 0x6E, dest, INVALID_REG, arg);
+}
+void XEmitter::VMOVQ_xmm(X64Reg dest, const OpArg& arg)
+{
+  WriteAVXOp(0xF3, 0x7E, dest, INVALID_REG, arg);
+}
+void XEmitter::VMOVDQU(int bits, X64Reg dest, const OpArg& arg)
+{
+  WriteAVXOp(0xF3, 0x6F, dest, INVALID_REG, arg, 0, 0, bits == 256);
+}
+void XEmitter::VMOVUPS(int bits, const OpArg& arg, X64Reg src)
+{
+  WriteAVXOp(0x00, sseMOVUPtoRM, src, INVALID_REG, arg, 0, 0, bits == 256);
+}
+void XEmitter::VMOVSS(const OpArg& arg, X64Reg src)
+{
+  WriteAVXOp(0xF3, sseMOVUPtoRM, src, INVALID_REG, arg);
+}
+void XEmitter::VMOVLPS(const OpArg& arg, X64Reg src)
+{
+  if (!arg.IsSimpleReg())
+    WriteAVXOp(0x00, sseMOVLPtoRM, src, INVALID_REG, arg);
+  else
+    PanicAlert("VMOVLPS only stores to memory");
+}
+void XEmitter::VCVTSI2SS(int bits, X64Reg regOp1, X64Reg regOp2, const OpArg& arg)
+{
+  WriteAVXOp(0xF3, 0x2A, regOp1, regOp2, arg, bits == 64);
+}
+void XEmitter::VCVTDQ2PS(int bits, X64Reg dest, const OpArg& arg)
+{
+  WriteAVXOp(0x00, 0x5B, dest, INVALID_REG, arg, 0, 0, bits == 256);
+}
+void XEmitter::VMULPS(int bits, X64Reg regOp1, X64Reg regOp2, const OpArg& arg)
+{
+  WriteAVXOp(0x00, sseMUL, regOp1, regOp2, arg, 0, 0, bits == 256);
+}
+void XEmitter::VPSHUFB(int bits, X64Reg regOp1, X64Reg regOp2, const OpArg& arg)
+{
+  WriteAVX2Op(bits, 0x66, 0x3800, regOp1, regOp2, arg);
+}
+void XEmitter::VPSRAD(int bits, X64Reg dest, X64Reg reg, u8 shift)
+{
+  // The destination is encoded in VEX.vvvv, the reg field holds the /4 extension.
+  WriteAVX2Op(bits, 0x66, 0x72, (X64Reg)4, dest, R(reg), 1);
+  Write8(shift);
+}
+void XEmitter::VBROADCASTSS(int bits, X64Reg dest, const OpArg& arg)
+{
+  if (arg.IsSimpleReg() && !cpu_info.bAVX2)
+    PanicAlert("VBROADCASTSS from a register requires AVX2");
+  WriteAVXOp(0x66, 0x3818, dest, INVALID_REG, arg, 0, 0, bits == 256);
+}
+void XEmitter::VINSERTF128(X64Reg regOp1, X64Reg regOp2, const OpArg& arg, u8 index)
+{
+  WriteAVXOp(0x66, 0x3A18, regOp1, regOp2, arg, 0, 1, 1);
+  Write8(index);
+}
+void XEmitter::VEXTRACTF128(const OpArg& arg, X64Reg src, u8 index)
+{
+  WriteAVXOp(0x66, 0x3A19, src, INVALID_REG, arg, 0, 1, 1);
+  Write8(index);
+}
+void XEmitter::VZEROUPPER()
+{
+  if (!cpu_info.bAVX)
+    PanicAlert("Trying to use AVX on a system that doesn't support it. Bad programmer.");
+  Write8(0xC5);
+  Write8(0xF8);
+  Write8(0x77);
+}
+
 void XEmitter::VFMADD132PS(X64Reg regOp1, X64Reg regOp2, const OpArg& arg)
 {
   WriteFMA3Op(0x98, regOp1, regOp2, arg);
@@ -347,11 +347,13 @@ private:
   void WriteSSSE3Op(u8 opPrefix, u16 op, X64Reg regOp, const OpArg& arg, int extrabytes = 0);
   void WriteSSE41Op(u8 opPrefix, u16 op, X64Reg regOp, const OpArg& arg, int extrabytes = 0);
   void WriteVEXOp(u8 opPrefix, u16 op, X64Reg regOp1, X64Reg regOp2, const OpArg& arg, int W = 0,
-                  int extrabytes = 0);
+                  int extrabytes = 0, int L = 0);
   void WriteVEXOp4(u8 opPrefix, u16 op, X64Reg regOp1, X64Reg regOp2, const OpArg& arg,
                    X64Reg regOp3, int W = 0);
   void WriteAVXOp(u8 opPrefix, u16 op, X64Reg regOp1, X64Reg regOp2, const OpArg& arg, int W = 0,
-                  int extrabytes = 0);
+                  int extrabytes = 0, int L = 0);
+  void WriteAVX2Op(int bits, u8 opPrefix, u16 op, X64Reg regOp1, X64Reg regOp2, const OpArg& arg,
+                   int extrabytes = 0);
   void WriteAVXOp4(u8 opPrefix, u16 op, X64Reg regOp1, X64Reg regOp2, const OpArg& arg,
                    X64Reg regOp3, int W = 0);
   void WriteFMA3Op(u8 op, X64Reg regOp1, X64Reg regOp2, const OpArg& arg, int W = 0);
@@ -868,6 +870,23 @@ public:
   void VPOR(X64Reg regOp1, X64Reg regOp2, const OpArg& arg);
   void VPXOR(X64Reg regOp1, X64Reg regOp2, const OpArg& arg);
 
+  // AVX with a vector size, bits is 128 or 256. 256-bit integer ops require AVX2.
+  void VMOVD_xmm(X64Reg dest, const OpArg& arg);
+  void VMOVQ_xmm(X64Reg dest, const OpArg& arg);
+  void VMOVDQU(int bits, X64Reg dest, const OpArg& arg);
+  void VMOVUPS(int bits, const OpArg& arg, X64Reg src);
+  void VMOVSS(const OpArg& arg, X64Reg src);
+  void VMOVLPS(const OpArg& arg, X64Reg src);
+  void VCVTSI2SS(int bits, X64Reg regOp1, X64Reg regOp2, const OpArg& arg);
+  void VCVTDQ2PS(int bits, X64Reg dest, const OpArg& arg);
+  void VMULPS(int bits, X64Reg regOp1, X64Reg regOp2, const OpArg& arg);
+  void VPSHUFB(int bits, X64Reg regOp1, X64Reg regOp2, const OpArg& arg);
+  void VPSRAD(int bits, X64Reg dest, X64Reg reg, u8 shift);
+  void VBROADCASTSS(int bits, X64Reg dest, const OpArg& arg);
+  void VINSERTF128(X64Reg regOp1, X64Reg regOp2, const OpArg& arg, u8 index);
+  void VEXTRACTF128(const OpArg& arg, X64Reg src, u8 index);
+  void VZEROUPPER();
+
   // FMA3
   void VFMADD132PS(X64Reg regOp1, X64Reg regOp2, const OpArg& arg);
   void VFMADD213PS(X64Reg regOp1, X64Reg regOp2, const OpArg& arg);
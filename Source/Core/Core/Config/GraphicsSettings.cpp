@@ -45,6 +45,10 @@ const ConfigInfo<bool> GFX_CACHE_HIRES_TEXTURES{{System::GFX, "Settings", "Cache
                                                 false};
 const ConfigInfo<bool> GFX_WAIT_CACHE_HIRES_TEXTURES{{System::GFX, "Settings", "WaitForCachedHiresTextures"},
                                                 false};
+const ConfigInfo<bool> GFX_DISK_TEXTURE_CACHE{{System::GFX, "Settings", "DiskTextureCache"},
+                                              false};
+const ConfigInfo<int> GFX_DISK_TEXTURE_CACHE_SIZE{
+    {System::GFX, "Settings", "DiskTextureCacheSizeMB"}, 1024};
 const ConfigInfo<bool> GFX_DUMP_EFB_TARGET{{System::GFX, "Settings", "DumpEFBTarget"}, false};
 const ConfigInfo<bool> GFX_DUMP_FRAMES_AS_IMAGES{{System::GFX, "Settings", "DumpFramesAsImages"},
                                                  false};
@@ -111,6 +115,8 @@ const ConfigInfo<bool> GFX_DISABLE_SPECIALIZED_SHADERS{
 
 const ConfigInfo<bool> GFX_SW_ZCOMPLOC{{System::GFX, "Settings", "SWZComploc"}, true};
 const ConfigInfo<bool> GFX_SW_ZFREEZE{{System::GFX, "Settings", "SWZFreeze"}, true};
+const ConfigInfo<bool> GFX_SW_TILED_RASTERIZER{{System::GFX, "Settings", "SWTiledRasterizer"},
+                                               true};
 const ConfigInfo<bool> GFX_SW_DUMP_OBJECTS{{System::GFX, "Settings", "SWDumpObjects"}, false};
 const ConfigInfo<bool> GFX_SW_DUMP_TEV_STAGES{{System::GFX, "Settings", "SWDumpTevStages"}, false};
 const ConfigInfo<bool> GFX_SW_DUMP_TEV_TEX_FETCHES{{System::GFX, "Settings", "SWDumpTevTexFetches"},
@@ -151,6 +157,7 @@ const ConfigInfo<int> GFX_ENHANCE_TEXTURE_SCALING_TYPE{ { System::GFX, "Enhancem
 const ConfigInfo<int> GFX_ENHANCE_TEXTURE_SCALING_FACTOR{ { System::GFX, "Enhancements", "TextureScalingFactor" }, 2 };
 const ConfigInfo<bool> GFX_ENHANCE_USE_DEPOSTERIZE{ { System::GFX, "Enhancements", "UseDePosterize" },
 true };
+const ConfigInfo<bool> GFX_ENHANCE_ASYNC_TEXTURE_SCALING{ { System::GFX, "Enhancements", "AsyncTextureScaling" }, false };
 
 const ConfigInfo<bool> GFX_ENHANCE_TESSELLATION{ { System::GFX, "Enhancements", "Tessellation" }, true };
 const ConfigInfo<bool> GFX_ENHANCE_TESSELLATION_EARLY_CULLING{ { System::GFX, "Enhancements", "TessellationEarlyCulling" }, false };
@@ -194,6 +201,12 @@ const ConfigInfo<bool> GFX_HACK_FULL_ASYNC_SHADER_COMPILATION{ { System::GFX, "H
 const ConfigInfo<bool> GFX_HACK_LAST_HISTORY_EFBTORAM{ { System::GFX, "Hacks", "LastStoryEFBToRam" }, false };
 const ConfigInfo<bool> GFX_HACK_FORCE_LOGICOP_BLEND{ { System::GFX, "Hacks", "ForceLogicOpBlend" }, false };
 const ConfigInfo<int> GFX_HACK_CULL_MODE{ { System::GFX, "Hacks", "CullMode" }, 0 };
+const ConfigInfo<bool> GFX_HACK_DISPLAY_LIST_CACHE{ { System::GFX, "Hacks", "DisplayListCache" }, false };
+const ConfigInfo<bool> GFX_HACK_VERTEX_CACHE{ { System::GFX, "Hacks", "VertexCache" }, false };
+const ConfigInfo<bool> GFX_HACK_PARALLEL_VERTEX_LOADING{ { System::GFX, "Hacks", "ParallelVertexLoading" }, false };
+const ConfigInfo<int> GFX_HACK_PARALLEL_VERTEX_LOADING_THRESHOLD{ { System::GFX, "Hacks", "ParallelVertexLoadingThreshold" }, 8192 };
+const ConfigInfo<bool> GFX_HACK_BATCHED_FIFO{ { System::GFX, "Hacks", "BatchedFifo" }, false };
+const ConfigInfo<bool> GFX_HACK_FIFO_PREPROCESS_THREAD{ { System::GFX, "Hacks", "FifoPreprocessThread" }, false };
 
 // Graphics.GameSpecific
 
@@ -38,6 +38,8 @@ extern const ConfigInfo<bool> GFX_HIRES_MATERIAL_MAPS;
 extern const ConfigInfo<bool> GFX_HIRES_MATERIAL_MAPS_BUILD;
 extern const ConfigInfo<bool> GFX_CACHE_HIRES_TEXTURES;
 extern const ConfigInfo<bool> GFX_WAIT_CACHE_HIRES_TEXTURES;
+extern const ConfigInfo<bool> GFX_DISK_TEXTURE_CACHE;
+extern const ConfigInfo<int> GFX_DISK_TEXTURE_CACHE_SIZE;
 extern const ConfigInfo<bool> GFX_DUMP_EFB_TARGET;
 extern const ConfigInfo<bool> GFX_DUMP_FRAMES_AS_IMAGES;
 extern const ConfigInfo<bool> GFX_FREE_LOOK;
@@ -86,6 +88,7 @@ extern const ConfigInfo<bool> GFX_DISABLE_SPECIALIZED_SHADERS;
 
 extern const ConfigInfo<bool> GFX_SW_ZCOMPLOC;
 extern const ConfigInfo<bool> GFX_SW_ZFREEZE;
+extern const ConfigInfo<bool> GFX_SW_TILED_RASTERIZER;
 extern const ConfigInfo<bool> GFX_SW_DUMP_OBJECTS;
 extern const ConfigInfo<bool> GFX_SW_DUMP_TEV_STAGES;
 extern const ConfigInfo<bool> GFX_SW_DUMP_TEV_TEX_FETCHES;
@@ -113,6 +116,7 @@ extern const ConfigInfo<bool> GFX_ENHANCE_USE_SCALING_FILTER;
 extern const ConfigInfo<int> GFX_ENHANCE_TEXTURE_SCALING_TYPE;
 extern const ConfigInfo<int> GFX_ENHANCE_TEXTURE_SCALING_FACTOR;
 extern const ConfigInfo<bool> GFX_ENHANCE_USE_DEPOSTERIZE;
+extern const ConfigInfo<bool> GFX_ENHANCE_ASYNC_TEXTURE_SCALING;
 extern const ConfigInfo<bool> GFX_ENHANCE_TESSELLATION;
 extern const ConfigInfo<bool> GFX_ENHANCE_TESSELLATION_EARLY_CULLING;
 extern const ConfigInfo<int> GFX_ENHANCE_TESSELLATION_DISTANCE;
@@ -148,6 +152,12 @@ extern const ConfigInfo<bool> GFX_HACK_FULL_ASYNC_SHADER_COMPILATION;
 extern const ConfigInfo<bool> GFX_HACK_LAST_HISTORY_EFBTORAM;
 extern const ConfigInfo<bool> GFX_HACK_FORCE_LOGICOP_BLEND;
 extern const ConfigInfo<int> GFX_HACK_CULL_MODE;
+extern const ConfigInfo<bool> GFX_HACK_DISPLAY_LIST_CACHE;
+extern const ConfigInfo<bool> GFX_HACK_VERTEX_CACHE;
+extern const ConfigInfo<bool> GFX_HACK_PARALLEL_VERTEX_LOADING;
+extern const ConfigInfo<int> GFX_HACK_PARALLEL_VERTEX_LOADING_THRESHOLD;
+extern const ConfigInfo<bool> GFX_HACK_BATCHED_FIFO;
+extern const ConfigInfo<bool> GFX_HACK_FIFO_PREPROCESS_THREAD;
 
 // Graphics.GameSpecific
 
@@ -47,6 +47,8 @@ bool IsSettingSaveable(const Config::ConfigLocation& config_location)
       Config::GFX_HIRES_MATERIAL_MAPS_BUILD.location,
       Config::GFX_CACHE_HIRES_TEXTURES.location,
       Config::GFX_WAIT_CACHE_HIRES_TEXTURES.location,
+      Config::GFX_DISK_TEXTURE_CACHE.location,
+      Config::GFX_DISK_TEXTURE_CACHE_SIZE.location,
       Config::GFX_DUMP_EFB_TARGET.location,
       Config::GFX_DUMP_FRAMES_AS_IMAGES.location,
       Config::GFX_FREE_LOOK.location,
@@ -89,6 +91,7 @@ bool IsSettingSaveable(const Config::ConfigLocation& config_location)
 
       Config::GFX_SW_ZCOMPLOC.location,
       Config::GFX_SW_ZFREEZE.location,
+      Config::GFX_SW_TILED_RASTERIZER.location,
       Config::GFX_SW_DUMP_OBJECTS.location,
       Config::GFX_SW_DUMP_TEV_STAGES.location,
       Config::GFX_SW_DUMP_TEV_TEX_FETCHES.location,
@@ -114,6 +117,7 @@ bool IsSettingSaveable(const Config::ConfigLocation& config_location)
       Config::GFX_ENHANCE_TEXTURE_SCALING_TYPE.location,
       Config::GFX_ENHANCE_TEXTURE_SCALING_FACTOR.location,
       Config::GFX_ENHANCE_USE_DEPOSTERIZE.location,
+      Config::GFX_ENHANCE_ASYNC_TEXTURE_SCALING.location,
       Config::GFX_ENHANCE_TESSELLATION.location,
       Config::GFX_ENHANCE_TESSELLATION_EARLY_CULLING.location,
       Config::GFX_ENHANCE_TESSELLATION_DISTANCE.location,
@@ -148,6 +152,12 @@ bool IsSettingSaveable(const Config::ConfigLocation& config_location)
       Config::GFX_HACK_LAST_HISTORY_EFBTORAM.location,
       Config::GFX_HACK_FORCE_LOGICOP_BLEND.location,
       Config::GFX_HACK_CULL_MODE.location,
+      Config::GFX_HACK_DISPLAY_LIST_CACHE.location,
+      Config::GFX_HACK_VERTEX_CACHE.location,
+      Config::GFX_HACK_PARALLEL_VERTEX_LOADING.location,
+      Config::GFX_HACK_PARALLEL_VERTEX_LOADING_THRESHOLD.location,
+      Config::GFX_HACK_BATCHED_FIFO.location,
+      Config::GFX_HACK_FIFO_PREPROCESS_THREAD.location,
 
       // Graphics.GameSpecific
 
@@ -0,0 +1,240 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "Core/FifoPlayer/FifoBenchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include <picojson/picojson.h>
+
+#include "Core/FifoPlayer/FifoDataFile.h"
+#include "Core/HW/Memmap.h"
+
+#include "VideoCommon/BPMemory.h"
+#include "VideoCommon/DataReader.h"
+#include "VideoCommon/OpcodeDecoding.h"
+#include "VideoCommon/RenderBase.h"
+#include "VideoCommon/TextureDecoder.h"
+#include "VideoCommon/VertexManagerBase.h"
+#include "VideoCommon/VideoBackendBase.h"
+
+namespace FifoBenchmark
+{
+// The registers FifoPlayer leaves out when it loads the state of a log
+static bool ShouldLoadBP(u32 address)
+{
+  switch (address)
+  {
+  case BPMEM_SETDRAWDONE:
+  case BPMEM_PE_TOKEN_ID:
+  case BPMEM_PE_TOKEN_INT_ID:
+  case BPMEM_TRIGGER_EFB_COPY:
+  case BPMEM_LOADTLUT1:
+  case BPMEM_PRELOAD_MODE:
+  case BPMEM_PERF1:
+    return false;
+  default:
+    return true;
+  }
+}
+
+static void Write32(std::vector<u8>& stream, u32 value)
+{
+  for (int shift = 24; shift >= 0; shift -= 8)
+    stream.push_back(static_cast<u8>(value >> shift));
+}
+
+// Runs the commands between data and end, returns where the decoder stopped
+static u8* Decode(u8* data, u8* end)
+{
+  g_VideoData.SetReadPosition(data, end);
+  return OpcodeDecoder::Run(g_VideoData, nullptr);
+}
+
+// Same commands as FifoPlayer::LoadRegisters, decoded right away instead of written to the FIFO
+static void LoadRegisters(FifoDataFile* file)
+{
+  std::vector<u8> stream;
+
+  const u32* regs = file->GetBPMem();
+  for (u32 i = 0; i < FifoDataFile::BP_MEM_SIZE; ++i)
+  {
+    if (!ShouldLoadBP(i))
+      continue;
+    stream.push_back(OpcodeDecoder::GX_LOAD_BP_REG);
+    Write32(stream, i << 24 | (regs[i] & 0x00ffffff));
+  }
+
+  regs = file->GetCPMem();
+  auto load_cp = [&stream, regs](u32 reg) {
+    stream.push_back(OpcodeDecoder::GX_LOAD_CP_REG);
+    stream.push_back(static_cast<u8>(reg));
+    Write32(stream, regs[reg]);
+  };
+  for (u32 reg : {0x30, 0x40, 0x50, 0x60})
+    load_cp(reg);
+  for (u32 i = 0; i < 8; ++i)
+  {
+    load_cp(0x70 + i);
+    load_cp(0x80 + i);
+    load_cp(0x90 + i);
+  }
+  for (u32 i = 0; i < 16; ++i)
+  {
+    load_cp(0xa0 + i);
+    load_cp(0xb0 + i);
+  }
+
+  regs = file->GetXFMem();
+  for (u32 i = 0; i < FifoDataFile::XF_MEM_SIZE; i += 16)
+  {
+    stream.push_back(OpcodeDecoder::GX_LOAD_XF_REG);
+    Write32(stream, 0x000f0000 | i);
+    for (u32 j = 0; j < 16; ++j)
+      Write32(stream, regs[i + j]);
+  }
+
+  regs = file->GetXFRegs();
+  for (u32 i = 0; i < FifoDataFile::XF_REGS_SIZE; ++i)
+  {
+    stream.push_back(OpcodeDecoder::GX_LOAD_XF_REG);
+    Write32(stream, 0x1000 | i);
+    Write32(stream, regs[i]);
+  }
+
+  Decode(stream.data(), stream.data() + stream.size());
+
+  std::memcpy(texMem, file->GetTexMem(), FifoDataFile::TEX_MEM_SIZE);
+}
+
+static void WriteMemory(const MemoryUpdate& update)
+{
+  u8* mem;
+  if (update.address & 0x10000000)
+    mem = &Memory::m_pEXRAM[update.address & Memory::EXRAM_MASK];
+  else
+    mem = &Memory::m_pRAM[update.address & Memory::RAM_MASK];
+
+  std::copy(update.data.begin(), update.data.end(), mem);
+}
+
+// The frame can be a view of the mapped log, but the vertex loaders read a little past the end
+// of the commands, so they are decoded from a padded copy like the one of the FIFO
+static std::vector<u8> CopyCommands(const FifoFrameInfo& frame)
+{
+  std::vector<u8> commands(frame.fifoData.size() + 4);
+  std::copy(frame.fifoData.begin(), frame.fifoData.end(), commands.begin());
+  return commands;
+}
+
+static void ReplayFrame(const FifoFrameInfo& frame, std::vector<u8>& commands)
+{
+  PROFILE("FifoBenchmark::Frame");
+
+  u8* const start = commands.data();
+  u8* const end = start + frame.fifoData.size();
+  u8* position = start;
+
+  // Memory updates happen between the commands, at the position they were recorded at
+  for (const MemoryUpdate& update : frame.memoryUpdates)
+  {
+    u8* update_position = start + std::min<size_t>(update.fifoPosition, frame.fifoData.size());
+    if (update_position > position)
+      position = Decode(position, update_position);
+    WriteMemory(update);
+  }
+  Decode(position, end);
+
+  // Draw what is left of the frame, like the end of a frame on the console would
+  g_vertex_manager->Flush();
+}
+
+Result Run(FifoDataFile* file, u32 loops)
+{
+  Result result;
+  result.backend = g_video_backend->GetName();
+  result.loops = loops;
+
+  LoadRegisters(file);
+  g_vertex_manager->Flush();
+
+  const bool was_enabled = Common::Profiler::IsEnabled();
+  Common::Profiler::SetEnabled(true);
+  Common::Profiler::ReadAll();
+
+  // Only the replay is timed, the frames are copied before the clock starts
+  std::vector<FifoFrameInfo> frames;
+  std::vector<std::vector<u8>> commands;
+  for (u32 i = 0; i < file->GetFrameCount(); ++i)
+  {
+    frames.push_back(file->GetFrame(i));
+    commands.push_back(CopyCommands(frames.back()));
+  }
+
+  const int first_frame = frameCount;
+  const auto start = std::chrono::steady_clock::now();
+  for (u32 loop = 0; loop < loops; ++loop)
+  {
+    for (size_t i = 0; i < frames.size(); ++i)
+    {
+      ReplayFrame(frames[i], commands[i]);
+      result.frames++;
+      result.fifo_bytes += frames[i].fifoData.size();
+    }
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  result.seconds = elapsed.count();
+  result.swaps = static_cast<u32>(frameCount - first_frame);
+
+  // Profilers that weren't entered during the replay belong to other parts of the emulator
+  for (const Common::Profiler::Result& stage : Common::Profiler::ReadAll())
+  {
+    if (stage.calls)
+      result.stages.push_back(stage);
+  }
+  Common::Profiler::SetEnabled(was_enabled);
+
+  return result;
+}
+
+static picojson::value ToValue(const Result& result)
+{
+  picojson::array stages;
+  for (const Common::Profiler::Result& stage : result.stages)
+  {
+    picojson::object obj;
+    obj["name"] = picojson::value(stage.name);
+    obj["calls"] = picojson::value(static_cast<double>(stage.calls));
+    obj["total_us"] = picojson::value(static_cast<double>(stage.usecs));
+    obj["min_us"] = picojson::value(static_cast<double>(stage.usecs_min));
+    obj["max_us"] = picojson::value(static_cast<double>(stage.usecs_max));
+    obj["avg_us"] = picojson::value(static_cast<double>(stage.usecs) / stage.calls);
+    obj["per_frame_us"] =
+        picojson::value(result.frames ? static_cast<double>(stage.usecs) / result.frames : 0.0);
+    stages.emplace_back(obj);
+  }
+
+  picojson::object obj;
+  obj["log"] = picojson::value(result.log);
+  obj["backend"] = picojson::value(result.backend);
+  obj["loops"] = picojson::value(static_cast<double>(result.loops));
+  obj["frames"] = picojson::value(static_cast<double>(result.frames));
+  obj["swaps"] = picojson::value(static_cast<double>(result.swaps));
+  obj["fifo_bytes"] = picojson::value(static_cast<double>(result.fifo_bytes));
+  obj["seconds"] = picojson::value(result.seconds);
+  obj["fps"] = picojson::value(result.GetFramesPerSecond());
+  obj["stages"] = picojson::value(stages);
+  return picojson::value(obj);
+}
+
+std::string ToJSON(const std::vector<Result>& results)
+{
+  picojson::array array;
+  for (const Result& result : results)
+    array.push_back(ToValue(result));
+  return picojson::value(array).serialize(true);
+}
+}
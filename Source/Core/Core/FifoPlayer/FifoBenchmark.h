@@ -0,0 +1,47 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/Profiler.h"
+
+class FifoDataFile;
+
+// Replays FIFO logs through the active video backend as fast as it can draw them. Unlike the
+// FIFO player, the commands are decoded directly on the calling thread, there is no emulated CPU,
+// FIFO or VI timing in between. Combined with the headless software renderer this measures the
+// GPU pipeline of the emulator alone, e.g. to compare changes of it on the same logs.
+namespace FifoBenchmark
+{
+struct Result
+{
+  // Name of the log, filled in by the caller
+  std::string log;
+  std::string backend;
+  u32 loops = 0;
+  // Frames of the log replayed over all loops
+  u32 frames = 0;
+  // Frames the renderer finished, i.e. copies to the XFB
+  u32 swaps = 0;
+  u64 fifo_bytes = 0;
+  // Wall time of the replay, without setting up the registers
+  double seconds = 0;
+  // Totals of the profiled stages during the replay. The stages nest, e.g. the draw is part of
+  // the flush, so their times don't add up.
+  std::vector<Common::Profiler::Result> stages;
+
+  double GetFramesPerSecond() const { return seconds > 0 ? frames / seconds : 0; }
+};
+
+// Has to be called on the thread the video backend was prepared on, with the emulated memory
+// allocated. Profiling is enabled for the duration of the replay.
+Result Run(FifoDataFile* file, u32 loops);
+
+// An array with an object for each result
+std::string ToJSON(const std::vector<Result>& results);
+}
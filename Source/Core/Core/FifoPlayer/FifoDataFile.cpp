@@ -8,15 +8,30 @@
 #include <cstring>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include <xxhash.h>
+#include <zlib.h>
+
 #include "Common/File.h"
+#include "Common/Logging/Log.h"
+#include "Common/MappedFile.h"
 
 enum
 {
   FILE_ID = 0x0d01f1f0,
-  VERSION_NUMBER = 4,
+  VERSION_NUMBER = 5,
   MIN_LOADER_VERSION = 1,
+  // Compressed data was added in version 5
+  COMPRESSED_MIN_LOADER_VERSION = 5,
+};
+
+enum
+{
+  COMPRESSION_NONE = 0,
+  // Each piece of data is stored as its u32 compressed size, followed by a zlib stream
+  COMPRESSION_ZLIB = 1,
 };
 
 #pragma pack(push, 1)
@@ -39,7 +54,8 @@ struct FileHeader
   u32 flags;
   u64 texMemOffset;
   u32 texMemSize;
-  u8 reserved[40];
+  u32 compression;
+  u8 reserved[36];
 };
 static_assert(sizeof(FileHeader) == 128, "FileHeader should be 128 bytes");
 
@@ -68,6 +84,84 @@ static_assert(sizeof(FileMemoryUpdate) == 24, "FileMemoryUpdate should be 24 byt
 
 #pragma pack(pop)
 
+FifoBytes::FifoBytes(std::vector<u8> data)
+{
+  auto owned = std::make_shared<std::vector<u8>>(std::move(data));
+  m_data = owned->data();
+  m_size = owned->size();
+  m_owner = std::move(owned);
+}
+
+namespace
+{
+// Writes the data of the frames and memory updates, data that was written before is only
+// referenced again
+class DataWriter
+{
+public:
+  DataWriter(File::IOFile& file, bool compress) : m_file(file), m_compress(compress) {}
+
+  // False if the data couldn't be compressed
+  bool Write(const FifoBytes& data, u64* offset)
+  {
+    *offset = 0;
+    if (data.empty())
+      return true;
+
+    const u64 hash = XXH64(data.data(), data.size(), 0);
+    const auto range = m_written.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+      const FifoBytes& written = it->second.data;
+      if (written.size() == data.size() &&
+          (written.data() == data.data() ||
+           std::memcmp(written.data(), data.data(), data.size()) == 0))
+      {
+        *offset = it->second.offset;
+        return true;
+      }
+    }
+
+    m_file.Seek(0, SEEK_END);
+    *offset = m_file.Tell();
+    if (m_compress)
+    {
+      uLongf compressed_size = compressBound(static_cast<uLong>(data.size()));
+      m_buffer.resize(compressed_size);
+      const int result = compress2(m_buffer.data(), &compressed_size, data.data(),
+                                   static_cast<uLong>(data.size()), Z_DEFAULT_COMPRESSION);
+      if (result != Z_OK)
+      {
+        ERROR_LOG(VIDEO, "Failed to compress %zu bytes of a FIFO log: %d", data.size(), result);
+        return false;
+      }
+      const u32 size = static_cast<u32>(compressed_size);
+      m_file.WriteArray(&size, 1);
+      m_file.WriteBytes(m_buffer.data(), compressed_size);
+    }
+    else
+    {
+      m_file.WriteBytes(data.data(), data.size());
+    }
+
+    m_written.emplace(hash, WrittenData{data, *offset});
+    return true;
+  }
+
+private:
+  struct WrittenData
+  {
+    FifoBytes data;
+    u64 offset;
+  };
+
+  File::IOFile& m_file;
+  bool m_compress;
+  std::unordered_multimap<u64, WrittenData> m_written;
+  std::vector<u8> m_buffer;
+};
+}
+
 FifoDataFile::FifoDataFile() = default;
 
 FifoDataFile::~FifoDataFile() = default;
@@ -97,18 +191,20 @@ void FifoDataFile::AddFrame(const FifoFrameInfo& frameInfo)
   m_Frames.push_back(frameInfo);
 }
 
-bool FifoDataFile::Save(const std::string& filename)
+bool FifoDataFile::Save(const std::string& filename, bool compress)
 {
   File::IOFile file;
   if (!file.Open(filename, "wb"))
     return false;
 
+  const u32 frameCount = GetFrameCount();
+
   // Add space for header
   PadFile(sizeof(FileHeader), file);
 
   // Add space for frame list
   u64 frameListOffset = file.Tell();
-  PadFile(m_Frames.size() * sizeof(FileFrameInfo), file);
+  PadFile(frameCount * sizeof(FileFrameInfo), file);
 
   u64 bpMemOffset = file.Tell();
   file.WriteArray(m_BPMem, BP_MEM_SIZE);
@@ -126,10 +222,10 @@ bool FifoDataFile::Save(const std::string& filename)
   file.WriteArray(m_TexMem, TEX_MEM_SIZE);
 
   // Write header
-  FileHeader header;
+  FileHeader header = {};
   header.fileId = FILE_ID;
   header.file_version = VERSION_NUMBER;
-  header.min_loader_version = MIN_LOADER_VERSION;
+  header.min_loader_version = compress ? COMPRESSED_MIN_LOADER_VERSION : MIN_LOADER_VERSION;
 
   header.bpMemOffset = bpMemOffset;
   header.bpMemSize = BP_MEM_SIZE;
@@ -147,26 +243,49 @@ bool FifoDataFile::Save(const std::string& filename)
   header.texMemSize = TEX_MEM_SIZE;
 
   header.frameListOffset = frameListOffset;
-  header.frameCount = (u32)m_Frames.size();
+  header.frameCount = frameCount;
 
   header.flags = m_Flags;
+  header.compression = compress ? COMPRESSION_ZLIB : COMPRESSION_NONE;
 
   file.Seek(0, SEEK_SET);
   file.WriteBytes(&header, sizeof(FileHeader));
 
   // Write frames list
-  for (unsigned int i = 0; i < m_Frames.size(); ++i)
+  DataWriter writer(file, compress);
+  std::vector<FileMemoryUpdate> dstUpdates;
+  for (u32 i = 0; i < frameCount; ++i)
   {
-    const FifoFrameInfo& srcFrame = m_Frames[i];
-
-    // Write FIFO data
+    const FifoFrameInfo srcFrame = GetFrame(i);
+
+    // Write FIFO data and memory
+    u64 dataOffset;
+    if (!writer.Write(srcFrame.fifoData, &dataOffset))
+      return false;
+
+    dstUpdates.resize(srcFrame.memoryUpdates.size());
+    for (size_t j = 0; j < srcFrame.memoryUpdates.size(); ++j)
+    {
+      const MemoryUpdate& srcUpdate = srcFrame.memoryUpdates[j];
+
+      FileMemoryUpdate& dstUpdate = dstUpdates[j];
+      std::memset(&dstUpdate, 0, sizeof(FileMemoryUpdate));
+      dstUpdate.address = srcUpdate.address;
+      u64 updateOffset;
+      if (!writer.Write(srcUpdate.data, &updateOffset))
+        return false;
+      dstUpdate.dataOffset = updateOffset;
+      dstUpdate.dataSize = static_cast<u32>(srcUpdate.data.size());
+      dstUpdate.fifoPosition = srcUpdate.fifoPosition;
+      dstUpdate.type = srcUpdate.type;
+    }
+
+    // Write memory update list
     file.Seek(0, SEEK_END);
-    u64 dataOffset = file.Tell();
-    file.WriteBytes(srcFrame.fifoData.data(), srcFrame.fifoData.size());
-
-    u64 memoryUpdatesOffset = WriteMemoryUpdates(srcFrame.memoryUpdates, file);
+    u64 memoryUpdatesOffset = file.Tell();
+    file.WriteArray(dstUpdates.data(), dstUpdates.size());
 
-    FileFrameInfo dstFrame;
+    FileFrameInfo dstFrame = {};
     dstFrame.fifoDataSize = static_cast<u32>(srcFrame.fifoData.size());
     dstFrame.fifoDataOffset = dataOffset;
     dstFrame.fifoStart = srcFrame.fifoStart;
@@ -188,19 +307,15 @@ bool FifoDataFile::Save(const std::string& filename)
 
 std::unique_ptr<FifoDataFile> FifoDataFile::Load(const std::string& filename, bool flagsOnly)
 {
-  File::IOFile file;
-  file.Open(filename, "rb");
-  if (!file)
+  auto mapping = std::make_shared<File::MappedFile>();
+  if (!mapping->Open(filename) || mapping->GetSize() < sizeof(FileHeader))
     return nullptr;
 
   FileHeader header;
-  file.ReadBytes(&header, sizeof(header));
+  std::memcpy(&header, mapping->GetData(), sizeof(header));
 
   if (header.fileId != FILE_ID || header.min_loader_version > VERSION_NUMBER)
-  {
-    file.Close();
     return nullptr;
-  }
 
   auto dataFile = std::make_unique<FifoDataFile>();
 
@@ -208,61 +323,160 @@ std::unique_ptr<FifoDataFile> FifoDataFile::Load(const std::string& filename, bo
   dataFile->m_Version = header.file_version;
 
   if (flagsOnly)
-  {
-    file.Close();
     return dataFile;
-  }
-
-  u32 size = std::min<u32>(BP_MEM_SIZE, header.bpMemSize);
-  file.Seek(header.bpMemOffset, SEEK_SET);
-  file.ReadArray(dataFile->m_BPMem, size);
-
-  size = std::min<u32>(CP_MEM_SIZE, header.cpMemSize);
-  file.Seek(header.cpMemOffset, SEEK_SET);
-  file.ReadArray(dataFile->m_CPMem, size);
 
-  size = std::min<u32>(XF_MEM_SIZE, header.xfMemSize);
-  file.Seek(header.xfMemOffset, SEEK_SET);
-  file.ReadArray(dataFile->m_XFMem, size);
+  // Older versions left the reserved bytes uninitialized
+  if (dataFile->m_Version >= 5)
+    dataFile->m_Compression = header.compression;
+  if (dataFile->m_Compression != COMPRESSION_NONE && dataFile->m_Compression != COMPRESSION_ZLIB)
+    return nullptr;
 
-  size = std::min<u32>(XF_REGS_SIZE, header.xfRegsSize);
-  file.Seek(header.xfRegsOffset, SEEK_SET);
-  file.ReadArray(dataFile->m_XFRegs, size);
+  const u8* const data = mapping->GetData();
+  const u64 fileSize = mapping->GetSize();
+  auto readArray = [data, fileSize](auto* dst, u64 offset, u32 count) {
+    const u64 size = u64(count) * sizeof(*dst);
+    if (offset > fileSize || size > fileSize - offset)
+      return false;
+    std::memcpy(dst, data + offset, size);
+    return true;
+  };
+
+  bool valid = readArray(dataFile->m_BPMem, header.bpMemOffset,
+                         std::min<u32>(BP_MEM_SIZE, header.bpMemSize));
+  valid &= readArray(dataFile->m_CPMem, header.cpMemOffset,
+                     std::min<u32>(CP_MEM_SIZE, header.cpMemSize));
+  valid &= readArray(dataFile->m_XFMem, header.xfMemOffset,
+                     std::min<u32>(XF_MEM_SIZE, header.xfMemSize));
+  valid &= readArray(dataFile->m_XFRegs, header.xfRegsOffset,
+                     std::min<u32>(XF_REGS_SIZE, header.xfRegsSize));
 
   // Texture memory saving was added in version 4.
   std::memset(dataFile->m_TexMem, 0, TEX_MEM_SIZE);
   if (dataFile->m_Version >= 4)
   {
-    size = std::min<u32>(TEX_MEM_SIZE, header.texMemSize);
-    file.Seek(header.texMemOffset, SEEK_SET);
-    file.ReadArray(dataFile->m_TexMem, size);
+    valid &= readArray(dataFile->m_TexMem, header.texMemOffset,
+                       std::min<u32>(TEX_MEM_SIZE, header.texMemSize));
   }
 
-  // Read frames
+  if (!valid)
+    return nullptr;
+
+  // The frames stay in the file, only their tables are checked here
+  dataFile->m_Mapping = std::move(mapping);
+  dataFile->m_FrameListOffset = header.frameListOffset;
+  dataFile->m_FileFrameCount = header.frameCount;
   for (u32 i = 0; i < header.frameCount; ++i)
   {
-    u64 frameOffset = header.frameListOffset + (i * sizeof(FileFrameInfo));
-    file.Seek(frameOffset, SEEK_SET);
-    FileFrameInfo srcFrame;
-    file.ReadBytes(&srcFrame, sizeof(FileFrameInfo));
+    if (!dataFile->IsValidFileFrame(i))
+      return nullptr;
+  }
 
-    FifoFrameInfo dstFrame;
-    dstFrame.fifoData.resize(srcFrame.fifoDataSize);
-    dstFrame.fifoStart = srcFrame.fifoStart;
-    dstFrame.fifoEnd = srcFrame.fifoEnd;
+  return dataFile;
+}
 
-    file.Seek(srcFrame.fifoDataOffset, SEEK_SET);
-    file.ReadBytes(dstFrame.fifoData.data(), srcFrame.fifoDataSize);
+FifoFrameInfo FifoDataFile::GetFrame(u32 frame) const
+{
+  if (frame >= m_FileFrameCount)
+    return m_Frames[frame - m_FileFrameCount];
+
+  const u8* const data = m_Mapping->GetData();
+  FileFrameInfo srcFrame;
+  std::memcpy(&srcFrame, data + m_FrameListOffset + frame * sizeof(FileFrameInfo),
+              sizeof(FileFrameInfo));
+
+  FifoFrameInfo dstFrame;
+  dstFrame.fifoData = ReadData(srcFrame.fifoDataOffset, srcFrame.fifoDataSize);
+  dstFrame.fifoStart = srcFrame.fifoStart;
+  dstFrame.fifoEnd = srcFrame.fifoEnd;
 
-    ReadMemoryUpdates(srcFrame.memoryUpdatesOffset, srcFrame.numMemoryUpdates,
-                      dstFrame.memoryUpdates, file);
+  dstFrame.memoryUpdates.resize(srcFrame.numMemoryUpdates);
+  for (u32 i = 0; i < srcFrame.numMemoryUpdates; ++i)
+  {
+    FileMemoryUpdate srcUpdate;
+    std::memcpy(&srcUpdate, data + srcFrame.memoryUpdatesOffset + i * sizeof(FileMemoryUpdate),
+                sizeof(FileMemoryUpdate));
 
-    dataFile->AddFrame(dstFrame);
+    MemoryUpdate& dstUpdate = dstFrame.memoryUpdates[i];
+    dstUpdate.address = srcUpdate.address;
+    dstUpdate.fifoPosition = srcUpdate.fifoPosition;
+    dstUpdate.data = ReadData(srcUpdate.dataOffset, srcUpdate.dataSize);
+    dstUpdate.type = static_cast<MemoryUpdate::Type>(srcUpdate.type);
   }
 
-  file.Close();
+  return dstFrame;
+}
 
-  return dataFile;
+FifoBytes FifoDataFile::ReadData(u64 offset, u32 size) const
+{
+  if (size == 0)
+    return {};
+
+  const u8* const data = m_Mapping->GetData() + offset;
+  if (m_Compression == COMPRESSION_NONE)
+    return FifoBytes(m_Mapping, data, size);
+
+  u32 compressedSize;
+  std::memcpy(&compressedSize, data, sizeof(compressedSize));
+  std::vector<u8> buffer(size);
+  uLongf uncompressedSize = size;
+  if (uncompress(buffer.data(), &uncompressedSize, data + sizeof(compressedSize),
+                 compressedSize) != Z_OK ||
+      uncompressedSize != size)
+  {
+    ERROR_LOG(VIDEO, "Corrupted compressed data at offset %llu of a FIFO log",
+              static_cast<unsigned long long>(offset));
+  }
+  return FifoBytes(std::move(buffer));
+}
+
+bool FifoDataFile::IsValidFileFrame(u32 frame) const
+{
+  const u64 fileSize = m_Mapping->GetSize();
+  const u64 frameOffset = m_FrameListOffset + u64(frame) * sizeof(FileFrameInfo);
+  if (m_FrameListOffset > fileSize || frameOffset + sizeof(FileFrameInfo) > fileSize)
+    return false;
+
+  const u8* const data = m_Mapping->GetData();
+  FileFrameInfo srcFrame;
+  std::memcpy(&srcFrame, data + frameOffset, sizeof(FileFrameInfo));
+  if (!IsValidData(srcFrame.fifoDataOffset, srcFrame.fifoDataSize))
+    return false;
+
+  const u64 updatesSize = u64(srcFrame.numMemoryUpdates) * sizeof(FileMemoryUpdate);
+  if (srcFrame.memoryUpdatesOffset > fileSize ||
+      updatesSize > fileSize - srcFrame.memoryUpdatesOffset)
+  {
+    return false;
+  }
+
+  for (u32 i = 0; i < srcFrame.numMemoryUpdates; ++i)
+  {
+    FileMemoryUpdate srcUpdate;
+    std::memcpy(&srcUpdate, data + srcFrame.memoryUpdatesOffset + i * sizeof(FileMemoryUpdate),
+                sizeof(FileMemoryUpdate));
+    if (!IsValidData(srcUpdate.dataOffset, srcUpdate.dataSize))
+      return false;
+  }
+
+  return true;
+}
+
+bool FifoDataFile::IsValidData(u64 offset, u32 size) const
+{
+  if (size == 0)
+    return true;
+
+  const u64 fileSize = m_Mapping->GetSize();
+  if (offset > fileSize)
+    return false;
+  if (m_Compression == COMPRESSION_NONE)
+    return size <= fileSize - offset;
+
+  u32 compressedSize;
+  if (sizeof(compressedSize) > fileSize - offset)
+    return false;
+  std::memcpy(&compressedSize, m_Mapping->GetData() + offset, sizeof(compressedSize));
+  return compressedSize <= fileSize - offset - sizeof(compressedSize);
 }
 
 void FifoDataFile::PadFile(size_t numBytes, File::IOFile& file)
@@ -283,57 +497,3 @@ bool FifoDataFile::GetFlag(u32 flag) const
 {
   return !!(m_Flags & flag);
 }
-
-u64 FifoDataFile::WriteMemoryUpdates(const std::vector<MemoryUpdate>& memUpdates,
-                                     File::IOFile& file)
-{
-  // Add space for memory update list
-  u64 updateListOffset = file.Tell();
-  PadFile(memUpdates.size() * sizeof(FileMemoryUpdate), file);
-
-  for (unsigned int i = 0; i < memUpdates.size(); ++i)
-  {
-    const MemoryUpdate& srcUpdate = memUpdates[i];
-
-    // Write memory
-    file.Seek(0, SEEK_END);
-    u64 dataOffset = file.Tell();
-    file.WriteBytes(srcUpdate.data.data(), srcUpdate.data.size());
-
-    FileMemoryUpdate dstUpdate;
-    dstUpdate.address = srcUpdate.address;
-    dstUpdate.dataOffset = dataOffset;
-    dstUpdate.dataSize = static_cast<u32>(srcUpdate.data.size());
-    dstUpdate.fifoPosition = srcUpdate.fifoPosition;
-    dstUpdate.type = srcUpdate.type;
-
-    u64 updateOffset = updateListOffset + (i * sizeof(FileMemoryUpdate));
-    file.Seek(updateOffset, SEEK_SET);
-    file.WriteBytes(&dstUpdate, sizeof(FileMemoryUpdate));
-  }
-
-  return updateListOffset;
-}
-
-void FifoDataFile::ReadMemoryUpdates(u64 fileOffset, u32 numUpdates,
-                                     std::vector<MemoryUpdate>& memUpdates, File::IOFile& file)
-{
-  memUpdates.resize(numUpdates);
-
-  for (u32 i = 0; i < numUpdates; ++i)
-  {
-    u64 updateOffset = fileOffset + (i * sizeof(FileMemoryUpdate));
-    file.Seek(updateOffset, SEEK_SET);
-    FileMemoryUpdate srcUpdate;
-    file.ReadBytes(&srcUpdate, sizeof(FileMemoryUpdate));
-
-    MemoryUpdate& dstUpdate = memUpdates[i];
-    dstUpdate.address = srcUpdate.address;
-    dstUpdate.fifoPosition = srcUpdate.fifoPosition;
-    dstUpdate.data.resize(srcUpdate.dataSize);
-    dstUpdate.type = static_cast<MemoryUpdate::Type>(srcUpdate.type);
-
-    file.Seek(srcUpdate.dataOffset, SEEK_SET);
-    file.ReadBytes(dstUpdate.data.data(), srcUpdate.dataSize);
-  }
-}
@@ -6,6 +6,7 @@
 
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "Common/CommonTypes.h"
@@ -13,8 +14,35 @@
 namespace File
 {
 class IOFile;
+class MappedFile;
 }
 
+// Bytes of a frame or a memory update. They are either a copy the object owns, or a view of the
+// mapping of a loaded file that keeps the mapping alive. Copies share the bytes.
+class FifoBytes
+{
+public:
+  FifoBytes() = default;
+  FifoBytes(std::vector<u8> data);
+  FifoBytes(std::shared_ptr<const void> owner, const u8* data, size_t size)
+      : m_owner(std::move(owner)), m_data(data), m_size(size)
+  {
+  }
+
+  const u8* data() const { return m_data; }
+  size_t size() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+  const u8& operator[](size_t index) const { return m_data[index]; }
+  const u8* begin() const { return m_data; }
+  const u8* end() const { return m_data + m_size; }
+  std::vector<u8> ToVector() const { return std::vector<u8>(begin(), end()); }
+
+private:
+  std::shared_ptr<const void> m_owner;
+  const u8* m_data = nullptr;
+  size_t m_size = 0;
+};
+
 struct MemoryUpdate
 {
   enum Type
@@ -27,13 +55,13 @@ struct MemoryUpdate
 
   u32 fifoPosition;
   u32 address;
-  std::vector<u8> data;
+  FifoBytes data;
   Type type;
 };
 
 struct FifoFrameInfo
 {
-  std::vector<u8> fifoData;
+  FifoBytes fifoData;
 
   u32 fifoStart;
   u32 fifoEnd;
@@ -68,9 +96,13 @@ public:
   u32* GetXFRegs() { return m_XFRegs; }
   u8* GetTexMem() { return m_TexMem; }
   void AddFrame(const FifoFrameInfo& frameInfo);
-  const FifoFrameInfo& GetFrame(u32 frame) const { return m_Frames[frame]; }
-  u32 GetFrameCount() const { return static_cast<u32>(m_Frames.size()); }
-  bool Save(const std::string& filename);
+  // The frames of a loaded file are read from its mapping when they are requested, the data of
+  // an uncompressed file isn't copied.
+  FifoFrameInfo GetFrame(u32 frame) const;
+  u32 GetFrameCount() const { return m_FileFrameCount + static_cast<u32>(m_Frames.size()); }
+  // Identical memory updates are only stored once. A compressed file is a lot smaller, but needs
+  // a version of the loader that supports it.
+  bool Save(const std::string& filename, bool compress = false);
 
   static std::unique_ptr<FifoDataFile> Load(const std::string& filename, bool flagsOnly);
 
@@ -85,9 +117,9 @@ private:
   void SetFlag(u32 flag, bool set);
   bool GetFlag(u32 flag) const;
 
-  u64 WriteMemoryUpdates(const std::vector<MemoryUpdate>& memUpdates, File::IOFile& file);
-  static void ReadMemoryUpdates(u64 fileOffset, u32 numUpdates,
-                                std::vector<MemoryUpdate>& memUpdates, File::IOFile& file);
+  FifoBytes ReadData(u64 offset, u32 size) const;
+  bool IsValidFileFrame(u32 frame) const;
+  bool IsValidData(u64 offset, u32 size) const;
 
   u32 m_BPMem[BP_MEM_SIZE];
   u32 m_CPMem[CP_MEM_SIZE];
@@ -97,6 +129,11 @@ private:
 
   u32 m_Flags = 0;
   u32 m_Version = 0;
+  u32 m_Compression = 0;
 
+  // Frames of the loaded file, then the added ones
+  std::shared_ptr<File::MappedFile> m_Mapping;
+  u64 m_FrameListOffset = 0;
+  u32 m_FileFrameCount = 0;
   std::vector<FifoFrameInfo> m_Frames;
 };
@@ -141,8 +141,7 @@ void FifoRecorder::UseMemory(u32 address, u32 size, MemoryUpdate::Type type, boo
     memUpdate.address = address;
     memUpdate.fifoPosition = (u32)(m_FifoData.size());
     memUpdate.type = type;
-    memUpdate.data.resize(size);
-    std::copy(newData, newData + size, memUpdate.data.begin());
+    memUpdate.data = std::vector<u8>(newData, newData + size);
 
     m_CurrentFrame.memoryUpdates.push_back(std::move(memUpdate));
   }
@@ -0,0 +1,225 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "Core/FifoPlayer/FifoShaderAnalyzer.h"
+
+#include <cstring>
+#include <iterator>
+#include <numeric>
+
+#include "Core/FifoPlayer/FifoDataFile.h"
+
+#include "VideoCommon/NativeVertexFormat.h"
+#include "VideoCommon/OpcodeDecoding.h"
+#include "VideoCommon/VertexManagerBase.h"
+
+// Same as the native components of the vertex loader for this format
+static u32 GetComponents(const TVtxDesc& vtx_desc, const VAT& vtx_attr)
+{
+  u32 components = 0;
+  for (int i = 0; i < 8; ++i)
+  {
+    if ((vtx_desc.Hex >> (1 + i)) & 1)
+      components |= VB_HAS_TEXMTXIDX0 << i;
+  }
+  if (vtx_desc.Normal != NOT_PRESENT)
+  {
+    components |= VB_HAS_NRM0;
+    if (vtx_attr.g0.NormalElements)
+      components |= VB_HAS_NRM1 | VB_HAS_NRM2;
+  }
+  for (int i = 0; i < 2; ++i)
+  {
+    if (vtx_desc.GetVertexArrayStatus(2 + i) != NOT_PRESENT)
+      components |= VB_HAS_COL0 << i;
+  }
+  for (int i = 0; i < 8; ++i)
+  {
+    // A texture matrix index without coordinates still outputs a texture coordinate
+    if (vtx_desc.GetVertexArrayStatus(4 + i) != NOT_PRESENT ||
+        (components & (VB_HAS_TEXMTXIDX0 << i)))
+    {
+      components |= VB_HAS_UV0 << i;
+    }
+  }
+  return components;
+}
+
+FifoShaderAnalyzer::FifoShaderAnalyzer(bool dual_source_blend)
+    : m_dual_source_blend(dual_source_blend), m_bpmem(std::make_unique<BPMemory>()),
+      m_xfmem(std::make_unique<XFMemory>())
+{
+  std::memset(static_cast<void*>(m_bpmem.get()), 0, sizeof(BPMemory));
+  std::memset(static_cast<void*>(m_xfmem.get()), 0, sizeof(XFMemory));
+  m_bpmem->bpMask = 0xFFFFFF;
+  // Vertex sizes depend on the normal loader tables
+  FifoAnalyzer::Init();
+}
+
+void FifoShaderAnalyzer::LoadRegisters(FifoDataFile* file)
+{
+  static_assert(sizeof(BPMemory) >= FifoDataFile::BP_MEM_SIZE * sizeof(u32),
+                "BP registers of the log fit into BPMemory");
+  std::memcpy(static_cast<void*>(m_bpmem.get()), file->GetBPMem(), FifoDataFile::BP_MEM_SIZE * sizeof(u32));
+  m_bpmem->bpMask = 0xFFFFFF;
+
+  const u32* cp_regs = file->GetCPMem();
+  FifoAnalyzer::LoadCPReg(0x50, cp_regs[0x50], m_cpmem);
+  FifoAnalyzer::LoadCPReg(0x60, cp_regs[0x60], m_cpmem);
+  for (u32 i = 0; i < 8; ++i)
+  {
+    FifoAnalyzer::LoadCPReg(0x70 + i, cp_regs[0x70 + i], m_cpmem);
+    FifoAnalyzer::LoadCPReg(0x80 + i, cp_regs[0x80 + i], m_cpmem);
+    FifoAnalyzer::LoadCPReg(0x90 + i, cp_regs[0x90 + i], m_cpmem);
+  }
+
+  u32* xf_words = reinterpret_cast<u32*>(m_xfmem.get());
+  std::memcpy(xf_words, file->GetXFMem(), FifoDataFile::XF_MEM_SIZE * sizeof(u32));
+  std::memcpy(xf_words + 0x1000, file->GetXFRegs(), FifoDataFile::XF_REGS_SIZE * sizeof(u32));
+}
+
+bool FifoShaderAnalyzer::AnalyzeFile(FifoDataFile* file)
+{
+  LoadRegisters(file);
+  bool success = true;
+  for (u32 i = 0; i < file->GetFrameCount(); ++i)
+  {
+    const FifoFrameInfo& frame = file->GetFrame(i);
+    success &= AnalyzeCommands(frame.fifoData.data(), static_cast<u32>(frame.fifoData.size()));
+  }
+  return success;
+}
+
+bool FifoShaderAnalyzer::AnalyzeCommands(const u8* data, u32 size)
+{
+  using namespace OpcodeDecoder;
+
+  const u8* const end = data + size;
+  while (data < end)
+  {
+    const u8 cmd = FifoAnalyzer::ReadFifo8(data);
+    const u32 remaining = static_cast<u32>(end - data);
+    switch (cmd)
+    {
+    case GX_NOP:
+    case GX_CMD_UNKNOWN_METRICS:
+    case GX_CMD_INVL_VC:
+      break;
+
+    case GX_LOAD_CP_REG:
+    {
+      if (remaining < GX_LOAD_CP_REG_SIZE)
+        return false;
+      const u8 sub_cmd = FifoAnalyzer::ReadFifo8(data);
+      const u32 value = FifoAnalyzer::ReadFifo32(data);
+      FifoAnalyzer::LoadCPReg(sub_cmd, value, m_cpmem);
+      break;
+    }
+
+    case GX_LOAD_XF_REG:
+    {
+      if (remaining < GX_LOAD_XF_REG_SIZE)
+        return false;
+      const u32 cmd2 = FifoAnalyzer::ReadFifo32(data);
+      const u32 count = ((cmd2 >> 16) & 15) + 1;
+      if (remaining - GX_LOAD_XF_REG_SIZE < count * sizeof(u32))
+        return false;
+      LoadXFRegs(cmd2 & 0xFFFF, count, data);
+      data += count * sizeof(u32);
+      break;
+    }
+
+    case GX_LOAD_INDX_A:
+    case GX_LOAD_INDX_B:
+    case GX_LOAD_INDX_C:
+    case GX_LOAD_INDX_D:
+      // Indexed loads only fill matrices and lights, which never change a shader
+      if (remaining < GX_LOAD_INDX_SIZE)
+        return false;
+      data += GX_LOAD_INDX_SIZE;
+      break;
+
+    case GX_CMD_CALL_DL:
+      // Display lists are expanded into the stream when a log is recorded
+      if (remaining < GX_CMD_CALL_DL_SIZE)
+        return false;
+      data += GX_CMD_CALL_DL_SIZE;
+      break;
+
+    case GX_LOAD_BP_REG:
+      if (remaining < GX_LOAD_BP_REG_SIZE)
+        return false;
+      LoadBPReg(FifoAnalyzer::ReadFifo32(data));
+      break;
+
+    default:
+    {
+      if (!(cmd & 0x80) || remaining < GX_DRAW_PRIMITIVES_SIZE)
+        return false;
+      int sizes[21];
+      FifoAnalyzer::CalculateVertexElementSizes(sizes, cmd & GX_VAT_MASK, m_cpmem);
+      const u32 vertex_size = std::accumulate(std::begin(sizes), std::end(sizes), 0u);
+      const u32 vertex_count = FifoAnalyzer::ReadFifo16(data);
+      if (remaining - GX_DRAW_PRIMITIVES_SIZE < vertex_count * vertex_size)
+        return false;
+      data += vertex_count * vertex_size;
+      if (vertex_count)
+        AddDraw(cmd);
+      break;
+    }
+    }
+  }
+  return true;
+}
+
+void FifoShaderAnalyzer::LoadBPReg(u32 value)
+{
+  // Same masking as LoadBPReg, without the side effects of the write
+  const u32 address = value >> 24;
+  u32& reg = reinterpret_cast<u32*>(m_bpmem.get())[address];
+  reg = (reg & ~m_bpmem->bpMask) | (value & m_bpmem->bpMask);
+  if (address != BPMEM_BP_MASK)
+    m_bpmem->bpMask = 0xFFFFFF;
+}
+
+void FifoShaderAnalyzer::LoadXFRegs(u32 address, u32 count, const u8* data)
+{
+  constexpr u32 XF_WORDS = sizeof(XFMemory) / sizeof(u32);
+  u32* xf_words = reinterpret_cast<u32*>(m_xfmem.get());
+  for (u32 i = 0; i < count && address + i < XF_WORDS; ++i)
+    xf_words[address + i] = FifoAnalyzer::ReadFifo32(data);
+}
+
+void FifoShaderAnalyzer::AddDraw(u8 command)
+{
+  m_draw_count++;
+  const u32 vat = command & OpcodeDecoder::GX_VAT_MASK;
+  const u32 components = GetComponents(m_cpmem.vtxDesc, m_cpmem.vtxAttr[vat]);
+  const PrimitiveType primitive_type = VertexManagerBase::GetPrimitiveType(
+      (command & OpcodeDecoder::GX_PRIMITIVE_MASK) >> OpcodeDecoder::GX_PRIMITIVE_SHIFT);
+
+  VertexShaderUid vs_uid;
+  GetVertexShaderUID(vs_uid, components, *m_xfmem, *m_bpmem);
+  m_vertex_shaders.insert(vs_uid);
+
+  GeometryShaderUid gs_uid;
+  GetGeometryShaderUid(gs_uid, primitive_type, *m_xfmem, components);
+  if (!gs_uid.GetUidData().IsPassthrough())
+    m_geometry_shaders.insert(gs_uid);
+
+  // Destination alpha is handled like in VertexManagerBase::Flush and the backends
+  const bool use_dst_alpha = m_bpmem->dstalpha.enable && m_bpmem->blendmode.alphaupdate &&
+                             m_bpmem->zcontrol.pixel_format == PEControl::RGBA6_Z24;
+  const bool logic_op = m_bpmem->blendmode.logicopenable && !m_bpmem->blendmode.blendenable;
+  PixelShaderUid ps_uid;
+  GetPixelShaderUID(ps_uid, use_dst_alpha && m_dual_source_blend ? PSRM_DUAL_SOURCE_BLEND :
+                                                                    PSRM_DEFAULT,
+                    components, *m_xfmem, *m_bpmem);
+  m_pixel_shaders.insert(ps_uid);
+  if (use_dst_alpha && (!m_dual_source_blend || logic_op))
+  {
+    GetPixelShaderUID(ps_uid, PSRM_ALPHA_PASS, components, *m_xfmem, *m_bpmem);
+    m_pixel_shaders.insert(ps_uid);
+  }
+}
@@ -0,0 +1,65 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <memory>
+#include <unordered_set>
+
+#include "Common/CommonTypes.h"
+#include "Core/FifoPlayer/FifoAnalyzer.h"
+
+#include "VideoCommon/BPMemory.h"
+#include "VideoCommon/GeometryShaderGen.h"
+#include "VideoCommon/PixelShaderGen.h"
+#include "VideoCommon/VertexShaderGen.h"
+#include "VideoCommon/XFMemory.h"
+
+class FifoDataFile;
+
+// Collects the shader uids the draws of a FIFO log need. The analyzer keeps its own copy of the
+// BP, CP and XF registers and never touches the emulated GPU, so it runs without a video backend,
+// e.g. to compile the shaders of a game ahead of time. The uids depend on the active video config
+// like the ones computed during emulation.
+class FifoShaderAnalyzer
+{
+public:
+  typedef std::unordered_set<VertexShaderUid, VertexShaderUid::ShaderUidHasher> VertexShaderSet;
+  typedef std::unordered_set<PixelShaderUid, PixelShaderUid::ShaderUidHasher> PixelShaderSet;
+  typedef std::unordered_set<GeometryShaderUid, GeometryShaderUid::ShaderUidHasher>
+      GeometryShaderSet;
+
+  // dual_source_blend selects how draws with destination alpha are rendered, like the backends
+  // do: in a single pass with dual source blending, or with an additional alpha pass.
+  explicit FifoShaderAnalyzer(bool dual_source_blend);
+
+  // Starts from the register state saved at the beginning of a log.
+  void LoadRegisters(FifoDataFile* file);
+  // Decodes a command stream, returns false if it contains an unknown opcode or ends in the
+  // middle of a command.
+  bool AnalyzeCommands(const u8* data, u32 size);
+  // Loads the registers of the log and analyzes all of its frames.
+  bool AnalyzeFile(FifoDataFile* file);
+
+  const VertexShaderSet& GetVertexShaderUids() const { return m_vertex_shaders; }
+  const PixelShaderSet& GetPixelShaderUids() const { return m_pixel_shaders; }
+  // Passthrough geometry shaders are left out, the backends don't compile them.
+  const GeometryShaderSet& GetGeometryShaderUids() const { return m_geometry_shaders; }
+  u32 GetDrawCount() const { return m_draw_count; }
+
+private:
+  void LoadBPReg(u32 value);
+  void LoadXFRegs(u32 address, u32 count, const u8* data);
+  void AddDraw(u8 command);
+
+  bool m_dual_source_blend;
+  std::unique_ptr<BPMemory> m_bpmem;
+  std::unique_ptr<XFMemory> m_xfmem;
+  FifoAnalyzer::CPMemory m_cpmem = {};
+  u32 m_draw_count = 0;
+
+  VertexShaderSet m_vertex_shaders;
+  PixelShaderSet m_pixel_shaders;
+  GeometryShaderSet m_geometry_shaders;
+};
@@ -38,6 +38,7 @@
 #include "Core/HW/Memmap.h"
 #include "Core/HW/ProcessorInterface.h"
 #include "Core/PowerPC/PowerPC.h"
+#include "VideoCommon/VertexCache.h"
 
 namespace DSP
 {
@@ -493,6 +494,7 @@ static void Do_ARAM_DMA()
     // Outgoing data from ARAM is mirrored every 64MB (verified on real HW)
     s_arDMA.ARAddr &= 0x3ffffff;
     s_arDMA.MMAddr &= 0x3ffffff;
+    VertexCache::InvalidateRange(s_arDMA.MMAddr, s_arDMA.Cnt.count);
 
     if (s_arDMA.ARAddr < s_ARAM.size)
     {
@@ -35,6 +35,8 @@
 #include "DiscIO/Enums.h"
 #include "DiscIO/Volume.h"
 
+#include "VideoCommon/VertexCache.h"
+
 namespace DVDThread
 {
 struct ReadRequest
@@ -327,7 +329,10 @@ static void FinishRead(u64 id, s64 cycles_late)
   else
   {
     if (request.copy_to_ram)
+    {
       Memory::CopyToEmu(request.output_address, buffer.data(), request.length);
+      VertexCache::InvalidateRange(request.output_address, request.length);
+    }
   }
 
   // Notify the emulated software that the command has been executed
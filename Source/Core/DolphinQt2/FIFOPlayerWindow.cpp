@@ -185,7 +185,7 @@ void FIFOPlayerWindow::SaveRecording()
 
   FifoDataFile* file = FifoRecorder::GetInstance().GetRecordedFile();
 
-  bool result = file->Save(path.toStdString());
+  bool result = file->Save(path.toStdString(), true);
 
   if (!result)
     QMessageBox::critical(this, tr("Error"), tr("Failed to save FIFO log."));
@@ -252,8 +252,9 @@ void FIFOPlayerWindow::UpdateInfo()
 
     for (u32 i = 0; i < file->GetFrameCount(); ++i)
     {
-      fifo_bytes += file->GetFrame(i).fifoData.size();
-      for (const auto& mem_update : file->GetFrame(i).memoryUpdates)
+      const FifoFrameInfo frame = file->GetFrame(i);
+      fifo_bytes += frame.fifoData.size();
+      for (const auto& mem_update : frame.memoryUpdates)
         mem_bytes += mem_update.data.size();
     }
 
@@ -382,7 +382,7 @@ void FifoPlayerDlg::OnSaveFile(wxCommandEvent& WXUNUSED(event))
     {
       // Attempt to save the file to the path the user chose
       wxBeginBusyCursor();
-      bool result = file->Save(WxStrToStr(path));
+      bool result = file->Save(WxStrToStr(path), true);
       wxEndBusyCursor();
 
       // Wasn't able to save the file, shit's whack, yo.
@@ -927,8 +927,8 @@ wxString FifoPlayerDlg::CreateRecordingMemSizeLabel() const
     size_t memBytes = 0;
     for (size_t frameNum = 0; frameNum < file->GetFrameCount(); ++frameNum)
     {
-      const std::vector<MemoryUpdate>& memUpdates = file->GetFrame(frameNum).memoryUpdates;
-      for (const auto& memUpdate : memUpdates)
+      const FifoFrameInfo frame = file->GetFrame(frameNum);
+      for (const auto& memUpdate : frame.memoryUpdates)
         memBytes += memUpdate.data.size();
     }
 
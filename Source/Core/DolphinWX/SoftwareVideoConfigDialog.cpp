@@ -81,6 +81,10 @@ SoftwareVideoConfigDialog::SoftwareVideoConfigDialog(wxWindow* parent, const std
       // xfb
       szr_rendering->Add(
         new SettingCheckBox(page_general, _("Bypass XFB"), "", Config::GFX_USE_XFB, true));
+
+      // tiled rasterizer
+      szr_rendering->Add(new SettingCheckBox(page_general, _("Multithreaded Rasterizer"), "",
+        Config::GFX_SW_TILED_RASTERIZER));
     }
 
     // - info
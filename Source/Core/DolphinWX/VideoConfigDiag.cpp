@@ -278,6 +278,26 @@ static wxString dump_VertexTranslators_desc =
 static wxString fullAsyncShaderCompilation_desc =
     _("Make shader compilation process fully asynchronous. This can cause glitches but will give "
       "a smooth game experience.");
+static wxString display_list_cache_desc =
+    _("Keep the vertex data of display lists after they are first decoded and reuse it when the "
+      "same display list gets called again.\nSpeeds up games that make heavy use of static "
+      "display lists.\n\nIf unsure, leave this unchecked.");
+static wxString vertex_cache_desc =
+    _("Keep the converted vertices of draws and reuse them when a game submits the same vertex "
+      "data again.\nSpeeds up games that redraw the same models every frame, but can show "
+      "outdated geometry in games that change their vertex arrays without telling the GPU."
+      "\n\nIf unsure, leave this unchecked.");
+static wxString parallel_vertex_loading_desc =
+    _("Convert the vertices of large draw calls on several threads. Speeds up games drawing "
+      "detailed models on CPUs with many cores.\n\nIf unsure, leave this unchecked.");
+static wxString batched_fifo_desc =
+    _("In dual core mode, let the GPU thread decode all graphics commands the CPU has written "
+      "at once instead of 32 bytes at a time. Lowers the GPU thread overhead, but the CPU can "
+      "notice the GPU progress a bit later.\n\nIf unsure, leave this unchecked.");
+static wxString fifo_preprocess_thread_desc =
+    _("In dual core mode, copy and parse the graphics commands on an extra thread so the GPU "
+      "thread only has to execute them. Speeds up games limited by the GPU thread on CPUs with "
+      "spare cores. Takes effect when emulation starts.\n\nIf unsure, leave this unchecked.");
 static wxString compute_texture_decoding_desc =
     _("Decode textures using compute shaders. Can improve performance in some scenarios.");
 static wxString Compute_texture_encoding_desc =
@@ -301,6 +321,11 @@ static wxString wait_cache_hires_textures_desc =
     "but improves stability and reduces stuttering in-game. Most useful with textures on "
     "networked drive. "
     "\n\nIf unsure, leave this unchecked.");
+static wxString disk_texture_cache_desc =
+    _("Store decoded and scaled textures in User/Cache/Textures/, so they don't have to be "
+      "decoded and scaled again the next time the game is started. The least recently used "
+      "textures are removed once the cache grows past its size limit.\n\nIf unsure, leave this "
+      "unchecked.");
 static wxString dump_efb_desc =
     _("Dump the contents of EFB copies to User/Dump/Textures/\n\nIf unsure, leave this unchecked.");
 static wxString internal_resolution_frame_dumping_desc = _(
@@ -422,6 +447,10 @@ static wxString Tessellation_displacement_desc =
 static wxString scaling_factor_desc = _("Multiplier applied to the texture size.");
 static wxString texture_deposterize_desc =
     _("Decrease some gradient artifacts caused by scaling.");
+static wxString async_texture_scaling_desc =
+    _("Scale textures on background threads. New textures are shown at their original "
+      "resolution until scaling finishes, instead of stalling the emulation.\n\nIf unsure, leave "
+      "this unchecked.");
 static wxString stereoshader_desc =
     _("Select which shader will be used to transform the two images when stereoscopy is enabled.");
 static wxString forcedLogivOp_desc =
@@ -825,6 +854,10 @@ VideoConfigDiag::VideoConfigDiag(wxWindow* parent, const std::string& title)
       szr_texturescaling->Add(label_TextureScale = new wxStaticText(
                                   page_enh, wxID_ANY, sf_choices[vconfig.iTexScalingFactor - 1]),
                               1, wxRIGHT | wxTOP | wxBOTTOM, 5);
+      szr_texturescaling->Add(CreateCheckBox(page_enh, _("Scale in Background"),
+                                             (async_texture_scaling_desc),
+                                             Config::GFX_ENHANCE_ASYNC_TEXTURE_SCALING),
+                              1, wxALIGN_CENTER_VERTICAL);
 
       wxStaticBoxSizer* const group_scaling =
           new wxStaticBoxSizer(wxVERTICAL, page_enh, _("Texture Scaling"));
@@ -1398,6 +1431,18 @@ VideoConfigDiag::VideoConfigDiag(wxWindow* parent, const std::string& title)
                          CreateCheckBox(page_hacks, _("Full Async Shader Compilation"),
                                         (fullAsyncShaderCompilation_desc),
                                         Config::GFX_HACK_FULL_ASYNC_SHADER_COMPILATION));
+      szr_other->Add(CreateCheckBox(page_hacks, _("Cache Display Lists"), (display_list_cache_desc),
+                                    Config::GFX_HACK_DISPLAY_LIST_CACHE));
+      szr_other->Add(CreateCheckBox(page_hacks, _("Cache Converted Vertices"), (vertex_cache_desc),
+                                    Config::GFX_HACK_VERTEX_CACHE));
+      szr_other->Add(CreateCheckBox(page_hacks, _("Parallel Vertex Loading"),
+                                    (parallel_vertex_loading_desc),
+                                    Config::GFX_HACK_PARALLEL_VERTEX_LOADING));
+      szr_other->Add(CreateCheckBox(page_hacks, _("Batched FIFO Reads"), (batched_fifo_desc),
+                                    Config::GFX_HACK_BATCHED_FIFO));
+      szr_other->Add(CreateCheckBox(page_hacks, _("FIFO Preprocessing Thread"),
+                                    (fifo_preprocess_thread_desc),
+                                    Config::GFX_HACK_FIFO_PREPROCESS_THREAD));
       szr_other->Add(GPU_Texture_decoding = CreateCheckBox(
                          page_hacks, _("GPU Texture Decoding"), (compute_texture_decoding_desc),
                          Config::GFX_ENABLE_GPU_TEXTURE_DECODING));
@@ -1472,6 +1517,8 @@ VideoConfigDiag::VideoConfigDiag(wxWindow* parent, const std::string& title)
                                         Config::GFX_INTERNAL_RESOLUTION_FRAME_DUMPS));
       }
       szr_utility->Add(hires_texturemaps);
+      szr_utility->Add(CreateCheckBox(page_advanced, _("Cache Textures on Disk"),
+                                      (disk_texture_cache_desc), Config::GFX_DISK_TEXTURE_CACHE));
       szr_utility->Add(CreateCheckBox(page_advanced, _("Dump EFB Target"), (dump_efb_desc),
                                       Config::GFX_DUMP_EFB_TARGET));
       szr_utility->Add(
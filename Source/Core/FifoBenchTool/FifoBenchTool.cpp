@@ -0,0 +1,119 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+// Replays FIFO logs through a video backend as fast as it can draw them and reports the time
+// spent in the stages of the GPU pipeline. The software renderer runs headless, so the results
+// don't depend on a GPU or its driver and can be compared between builds.
+
+#include <OptionParser.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/FileUtil.h"
+
+#include "Core/ConfigManager.h"
+#include "Core/FifoPlayer/FifoBenchmark.h"
+#include "Core/FifoPlayer/FifoDataFile.h"
+#include "Core/HW/Memmap.h"
+
+#include "UICommon/UICommon.h"
+
+#include "VideoCommon/VideoBackendBase.h"
+
+static void PrintResult(const FifoBenchmark::Result& result)
+{
+  printf("%s: %u frames, %u swaps in %.3f s, %.2f fps, %.1f MB of commands\n", result.log.c_str(),
+         result.frames, result.swaps, result.seconds, result.GetFramesPerSecond(),
+         result.fifo_bytes / 1e6);
+  for (const Common::Profiler::Result& stage : result.stages)
+  {
+    printf("  %-40s %8llu calls %12.3f ms %10.3f ms/frame\n", stage.name.c_str(),
+           static_cast<unsigned long long>(stage.calls), stage.usecs / 1e3,
+           stage.usecs / 1e3 / result.frames);
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  optparse::OptionParser parser;
+  parser.usage("%prog [options] <FIFO logs...>");
+  parser.description("Replays FIFO logs at maximum speed and reports the time spent in the "
+                     "stages of the GPU pipeline.");
+  parser.add_option("-u", "--user").action("store").help("User folder path");
+  parser.add_option("-n", "--loops")
+      .action("store")
+      .type("int")
+      .set_default(1)
+      .help("How often each log is replayed [default: %default]");
+  parser.add_option("-j", "--json").action("store").help("Write the results as JSON to this file");
+  optparse::Values& options = parser.parse_args(argc, argv);
+  const std::vector<std::string> args = parser.args();
+  if (args.empty())
+  {
+    parser.print_help();
+    return 1;
+  }
+
+  std::vector<std::unique_ptr<FifoDataFile>> files;
+  for (const std::string& path : args)
+  {
+    std::unique_ptr<FifoDataFile> file = FifoDataFile::Load(path, false);
+    if (!file)
+    {
+      fprintf(stderr, "Failed to load %s\n", path.c_str());
+      return 1;
+    }
+    files.push_back(std::move(file));
+  }
+
+  UICommon::SetUserDirectory(static_cast<const char*>(options.get("user")));
+  UICommon::Init();
+
+  // A single memory layout for all logs, the Wii one has room for the GameCube logs too
+  SConfig::GetInstance().bWii = false;
+  for (const auto& file : files)
+    SConfig::GetInstance().bWii |= file->GetIsWii();
+  Memory::Init();
+  // The commands are decoded on this thread
+  SConfig::GetInstance().bCPUThread = false;
+
+  VideoBackendBase::ActivateHeadlessBackend();
+  if (!g_video_backend->Initialize(nullptr))
+  {
+    fprintf(stderr, "Failed to initialize %s\n", g_video_backend->GetDisplayName().c_str());
+    Memory::Shutdown();
+    UICommon::Shutdown();
+    return 1;
+  }
+  g_video_backend->Video_Prepare();
+
+  const u32 loops = static_cast<u32>(std::max(1, static_cast<int>(options.get("loops"))));
+  std::vector<FifoBenchmark::Result> results;
+  for (size_t i = 0; i < files.size(); ++i)
+  {
+    FifoBenchmark::Result result = FifoBenchmark::Run(files[i].get(), loops);
+    result.log = args[i];
+    PrintResult(result);
+    results.push_back(std::move(result));
+  }
+
+  g_video_backend->Video_Cleanup();
+  g_video_backend->Shutdown();
+  Memory::Shutdown();
+  UICommon::Shutdown();
+
+  if (options.is_set("json") &&
+      !File::WriteStringToFile(FifoBenchmark::ToJSON(results), options["json"]))
+  {
+    fprintf(stderr, "Failed to write %s\n", options["json"].c_str());
+    return 1;
+  }
+  return 0;
+}
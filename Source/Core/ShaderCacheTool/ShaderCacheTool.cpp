@@ -0,0 +1,237 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+// Compiles the shaders of a game ahead of time, so its first run does not stutter. The shader
+// uids come from the usage profiles recorded while the game ran and from FIFO logs of it. The
+// shaders are compiled for the Vulkan backend, which needs no GPU to compile, into the disk
+// caches of the game and into the shader artifact cache shared by all games.
+
+#include <OptionParser.h>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/Config/Config.h"
+#include "Common/FileUtil.h"
+#include "Common/LinearDiskCache.h"
+#include "Common/ThreadPool.h"
+
+#include "Core/ConfigLoaders/GameConfigLoader.h"
+#include "Core/FifoPlayer/FifoDataFile.h"
+#include "Core/FifoPlayer/FifoShaderAnalyzer.h"
+
+#include "UICommon/UICommon.h"
+
+#include "VideoBackends/Vulkan/ShaderCompiler.h"
+
+#include "VideoCommon/GeometryShaderGen.h"
+#include "VideoCommon/ObjectUsageProfiler.h"
+#include "VideoCommon/PixelShaderGen.h"
+#include "VideoCommon/ShaderArtifactCache.h"
+#include "VideoCommon/VertexShaderGen.h"
+#include "VideoCommon/VideoBackendBase.h"
+#include "VideoCommon/VideoConfig.h"
+
+namespace
+{
+// The uids in the order they are compiled in: the most used ones of the profiles first, so an
+// interrupted run still covers the shaders that matter most. The set only drops duplicates.
+template <typename Uid>
+class UidList
+{
+public:
+  void Add(const Uid& uid)
+  {
+    if (m_seen.insert(uid).second)
+      m_uids.push_back(uid);
+  }
+  template <typename Container>
+  void AddAll(const Container& uids)
+  {
+    for (const Uid& uid : uids)
+      Add(uid);
+  }
+  const std::vector<Uid>& Get() const { return m_uids; }
+  size_t size() const { return m_uids.size(); }
+
+private:
+  std::vector<Uid> m_uids;
+  std::unordered_set<Uid, typename Uid::ShaderUidHasher> m_seen;
+};
+
+// The profiles only provide the uids here
+struct UsageInfo
+{
+};
+
+template <typename Uid>
+void ReadUsageProfile(const std::string& filename, pKey_t version, UidList<Uid>* uids)
+{
+  if (!File::Exists(filename))
+    return;
+  ObjectUsageProfiler<Uid, pKey_t, UsageInfo, typename Uid::ShaderUidHasher> profile(version);
+  profile.ReadFromFile(filename);
+  profile.ForEachMostUsed([uids](const Uid& uid) {
+    Uid item = uid;
+    item.ClearHASH();
+    item.CalculateUIDHash();
+    uids->Add(item);
+  });
+}
+
+// Compiles the uids missing in the disk cache of the given type on all cores
+template <typename Uid, typename GenerateFunction, typename CompileFunction>
+void CompileShaders(const char* type, ShaderArtifactCache::Stage stage, u16 generator_version,
+                    const std::string& game_id, const UidList<Uid>& uids,
+                    ShaderArtifactCache& artifacts, GenerateFunction generate,
+                    CompileFunction compile)
+{
+  // Only the index is needed to find the missing uids
+  LinearDiskCache<Uid, u32> disk_cache;
+  disk_cache.Open(GetDiskShaderCacheFileNameForGame(API_VULKAN, type, game_id, true));
+
+  std::vector<const Uid*> pending;
+  for (const Uid& uid : uids.Get())
+  {
+    if (!disk_cache.Contains(uid))
+      pending.push_back(&uid);
+  }
+
+  std::atomic<size_t> done{0};
+  std::atomic<size_t> failed{0};
+  Common::ThreadPool::ParallelFor(0, static_cast<int>(pending.size()), 1, [&](int begin, int end) {
+    for (int i = begin; i < end; ++i)
+    {
+      const Uid& uid = *pending[i];
+      Vulkan::ShaderCompiler::SPIRVCodeVector spirv;
+      if (artifacts.GetOrCompileSPIRV(stage, API_VULKAN, generator_version, uid,
+                                      [&](ShaderCode& code, const ShaderHostConfig& host_config) {
+                                        generate(code, uid.GetUidData(), host_config);
+                                      },
+                                      compile, &spirv))
+      {
+        disk_cache.Append(uid, spirv.data(), static_cast<u32>(spirv.size()));
+      }
+      else
+      {
+        failed++;
+      }
+      printf("\r%s: %zu/%zu", type, ++done, pending.size());
+      fflush(stdout);
+    }
+  });
+  disk_cache.Sync();
+  disk_cache.Close();
+  printf("\r%s: %zu shaders, %zu were cached already, %zu compiled, %zu failed\n", type,
+         uids.size(), uids.size() - pending.size(), pending.size() - failed, failed.load());
+}
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+  optparse::OptionParser parser;
+  parser.usage("%prog [options] <game id> [FIFO logs...]");
+  parser.description("Compiles the Vulkan shaders of a game into its shader cache, using the "
+                     "shader usage profile of the game and the draws of the given FIFO logs.");
+  parser.add_option("-u", "--user").action("store").help("User folder path");
+  parser.add_option("--no-usage-profile")
+      .action("store_true")
+      .help("Only compile the shaders used by the FIFO logs");
+  optparse::Values& options = parser.parse_args(argc, argv);
+  const std::vector<std::string> args = parser.args();
+  if (args.empty())
+  {
+    parser.print_help();
+    return 1;
+  }
+  const std::string& game_id = args[0];
+
+  UICommon::SetUserDirectory(static_cast<const char*>(options.get("user")));
+  UICommon::Init();
+  // The game settings can change the shaders and the host config
+  Config::AddLayer(ConfigLoaders::GenerateGlobalGameConfigLoader(game_id, 0));
+  Config::AddLayer(ConfigLoaders::GenerateLocalGameConfigLoader(game_id, 0));
+
+  VideoBackendBase::ActivateBackend("Vulkan");
+  if (!g_video_backend || g_video_backend->GetName() != "Vulkan")
+  {
+    fprintf(stderr, "This build has no Vulkan backend\n");
+    UICommon::Shutdown();
+    return 1;
+  }
+  // Fills in the features of the first GPU when there is one, so the host config matches the
+  // one of the emulator on this machine
+  g_video_backend->InitBackendInfo();
+  g_Config.Refresh();
+  g_Config.UpdateProjectionHack();
+  UpdateActiveConfig();
+
+  UidList<VertexShaderUid> vertex_shaders;
+  UidList<PixelShaderUid> pixel_shaders;
+  UidList<GeometryShaderUid> geometry_shaders;
+  if (!options.get("no_usage_profile"))
+  {
+    const std::string profile = File::GetUserPath(D_SHADERUIDCACHE_IDX) + game_id;
+    ReadUsageProfile(profile + ".vs.usage", VERTEXSHADERGEN_UID_VERSION, &vertex_shaders);
+    ReadUsageProfile(profile + ".ps.usage", PIXELSHADERGEN_UID_VERSION, &pixel_shaders);
+    printf("Usage profile: %zu vertex shaders, %zu pixel shaders\n", vertex_shaders.size(),
+           pixel_shaders.size());
+  }
+
+  for (size_t i = 1; i < args.size(); ++i)
+  {
+    std::unique_ptr<FifoDataFile> file = FifoDataFile::Load(args[i], false);
+    if (!file)
+    {
+      fprintf(stderr, "Failed to load %s\n", args[i].c_str());
+      continue;
+    }
+    FifoShaderAnalyzer analyzer(g_ActiveConfig.backend_info.bSupportsDualSourceBlend);
+    if (!analyzer.AnalyzeFile(file.get()))
+      fprintf(stderr, "%s contains unknown commands, skipped the rest of a frame\n", args[i].c_str());
+    vertex_shaders.AddAll(analyzer.GetVertexShaderUids());
+    pixel_shaders.AddAll(analyzer.GetPixelShaderUids());
+    geometry_shaders.AddAll(analyzer.GetGeometryShaderUids());
+    printf("%s: %u draws, %zu vertex shaders, %zu pixel shaders, %zu geometry shaders\n",
+           args[i].c_str(), analyzer.GetDrawCount(), analyzer.GetVertexShaderUids().size(),
+           analyzer.GetPixelShaderUids().size(), analyzer.GetGeometryShaderUids().size());
+  }
+
+  ShaderArtifactCache artifacts;
+  File::CreateFullPath(File::GetUserPath(D_SHADERCACHE_IDX));
+  artifacts.Open(File::GetUserPath(D_SHADERCACHE_IDX) + "artifacts.cache");
+
+  CompileShaders("vs", ShaderArtifactCache::STAGE_VERTEX, VERTEXSHADERGEN_UID_VERSION, game_id,
+                 vertex_shaders, artifacts,
+                 [](ShaderCode& code, const vertex_shader_uid_data& uid_data,
+                    const ShaderHostConfig& host_config) {
+                   GenerateVertexShaderCode(code, uid_data, host_config);
+                 },
+                 Vulkan::ShaderCompiler::CompileVertexShader);
+  CompileShaders("ps", ShaderArtifactCache::STAGE_PIXEL, PIXELSHADERGEN_UID_VERSION, game_id,
+                 pixel_shaders, artifacts,
+                 [](ShaderCode& code, const pixel_shader_uid_data& uid_data,
+                    const ShaderHostConfig& host_config) {
+                   GeneratePixelShaderCode(code, uid_data, host_config);
+                 },
+                 Vulkan::ShaderCompiler::CompileFragmentShader);
+  if (g_ActiveConfig.backend_info.bSupportsGeometryShaders)
+  {
+    CompileShaders("gs", ShaderArtifactCache::STAGE_GEOMETRY, GEOMETRYSHADERGEN_UID_VERSION,
+                   game_id, geometry_shaders, artifacts,
+                   [](ShaderCode& code, const geometry_shader_uid_data& uid_data,
+                      const ShaderHostConfig& host_config) {
+                     GenerateGeometryShaderCode(code, uid_data, host_config);
+                   },
+                   Vulkan::ShaderCompiler::CompileGeometryShader);
+  }
+
+  artifacts.Close();
+  UICommon::Shutdown();
+  return 0;
+}
@@ -0,0 +1,77 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+// Converts a custom texture directory into a single memory mappable pack file, which is
+// mounted instead of loading every image when it is placed in the texture directory of a game.
+
+#include <OptionParser.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/FileUtil.h"
+
+#include "VideoCommon/HiresTexturePack.h"
+#include "VideoCommon/HiresTextures.h"
+#include "VideoCommon/VideoConfig.h"
+
+int main(int argc, char* argv[])
+{
+  optparse::OptionParser parser;
+  parser.usage("%prog [options] <texture directory> <output.texpack>");
+  parser.description("Packs the custom textures of a game into a single file. DDS files keep "
+                     "their compressed blocks, other images are stored as RGBA.");
+  parser.add_option("--no-material-maps")
+      .action("store_true")
+      .help("Leave out the normal (.nrm) and emissive (.lum) maps");
+  optparse::Values& options = parser.parse_args(argc, argv);
+  const std::vector<std::string> args = parser.args();
+  if (args.size() != 2)
+  {
+    parser.print_help();
+    return 1;
+  }
+  if (!File::IsDirectory(args[0]))
+  {
+    fprintf(stderr, "%s is not a directory\n", args[0].c_str());
+    return 1;
+  }
+
+  // Load accepts every format and map the pack can hold, whether the backend which ends up
+  // using the pack supports a format is checked when the texture is looked up.
+  g_Config.bHiresTextures = true;
+  g_Config.bHiresMaterialMaps = !options.get("no_material_maps");
+  g_Config.bHiresMaterialMapsBuild = false;
+  g_Config.backend_info.bSupportsNormalMaps = true;
+  for (bool& supported : g_Config.backend_info.bSupportedFormats)
+    supported = true;
+  UpdateActiveConfig();
+
+  size_t last_percent = 101;
+  const bool success = HiresTexture::BuildPack(args[0], args[1], [&](size_t done, size_t total) {
+    const size_t percent = total ? done * 100 / total : 100;
+    if (percent == last_percent)
+      return;
+    last_percent = percent;
+    printf("\r%zu/%zu textures (%zu%%)", done, total, percent);
+    fflush(stdout);
+  });
+  printf("\n");
+  if (!success)
+  {
+    fprintf(stderr, "Failed to write %s\n", args[1].c_str());
+    return 1;
+  }
+
+  HiresTexturePack pack;
+  if (!pack.Open(args[1]))
+  {
+    fprintf(stderr, "Failed to read back %s\n", args[1].c_str());
+    return 1;
+  }
+  printf("Packed %zu textures into %s (%.1f MB)\n", pack.GetTextureCount(), args[1].c_str(),
+         File::GetSize(args[1]) / (1024.0 * 1024.0));
+  return 0;
+}
@@ -28,7 +28,6 @@ public:
 
 protected:
   void ResetBuffer(u32 stride) override;
-  u16* GetIndexBuffer() override;
 private:
 
   void PrepareDrawBuffers(u32 stride);
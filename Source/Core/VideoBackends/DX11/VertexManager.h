@@ -38,10 +38,6 @@ public:
     const BPMemory &bpm);
 protected:
   void ResetBuffer(u32 stride) override;
-  u16* GetIndexBuffer() override
-  {
-    return m_index_buffer_start;
-  }
 private:
 
   void PrepareDrawBuffers(u32 stride);
@@ -33,6 +33,7 @@
 #include "VideoCommon/BPFunctions.h"
 #include "VideoCommon/BPStructs.h"
 #include "VideoCommon/Debugger.h"
+#include "VideoCommon/DLCache.h"
 #include "VideoCommon/FPSCounter.h"
 #include "VideoCommon/Fifo.h"
 #include "VideoCommon/OnScreenDisplay.h"
@@ -40,6 +41,7 @@
 #include "VideoCommon/PixelEngine.h"
 #include "VideoCommon/PixelShaderManager.h"
 #include "VideoCommon/Statistics.h"
+#include "VideoCommon/VertexCache.h"
 #include "VideoCommon/VertexLoaderManager.h"
 #include "VideoCommon/VertexShaderManager.h"
 #include "VideoCommon/VideoConfig.h"
@@ -62,6 +64,8 @@ void Renderer::SetupDeviceObjects()
 {
   D3D::font.Init();
   VertexLoaderManager::Init();
+  DLCache::Init();
+  VertexCache::Init();
   g_framebuffer_manager = std::make_unique<FramebufferManager>(m_target_width, m_target_height);
 
   VertexShaderManager::Dirty();
@@ -88,6 +92,8 @@ void Renderer::TeardownDeviceObjects()
   static_cast<PerfQuery*>(g_perf_query.get())->DestroyDeviceObjects();
   D3D::font.Shutdown();
   g_texture_cache->Invalidate();
+  DLCache::Shutdown();
+  VertexCache::Shutdown();
   VertexLoaderManager::Shutdown();
   VertexShaderCache::Shutdown();
   PixelShaderCache::Shutdown();
@@ -45,7 +45,7 @@ public:
   void PrepareShaders(PrimitiveType primitive, u32 components, const XFMemory &xfr, const BPMemory &bpm);
 protected:
   void ResetBuffer(u32 stride) override;
-  u16* GetIndexBuffer() override
+  u16* GetIndexBuffer()
   {
     return &LocalIBuffer[0];
   }
@@ -107,6 +107,7 @@ void VideoBackend::InitBackendInfo()
   g_Config.backend_info.bSupportsBitfield = false;
   g_Config.backend_info.bSupportsUberShaders = false;
   g_Config.backend_info.bSupportsHighPrecisionFrameBuffer = false;
+  g_Config.backend_info.bSupportsPrimitiveRestart = false;
   g_Config.ClearFormats();
   // adapters
   g_Config.backend_info.Adapters.clear();
@@ -533,6 +533,11 @@ Renderer::Renderer()
   g_ogl_config.bSupportsConservativeDepth = GLExtensions::Supports("GL_ARB_conservative_depth");
   g_ogl_config.bSupportsAniso = GLExtensions::Supports("GL_EXT_texture_filter_anisotropic");
   g_Config.backend_info.bSupportsComputeShaders = GLExtensions::Supports("GL_ARB_compute_shader");
+  // Desktop OpenGL supports primitive restart since 3.1, OpenGL ES 3.0 with the fixed index only
+  g_Config.backend_info.bSupportsPrimitiveRestart =
+      !DriverDetails::HasBug(DriverDetails::BUG_PRIMITIVE_RESTART) &&
+      (GLInterface->GetMode() == GLInterfaceMode::MODE_OPENGLES3 ||
+       GLExtensions::Version() >= 310 || GLExtensions::Supports("GL_NV_primitive_restart"));
 
   if (GLInterface->GetMode() == GLInterfaceMode::MODE_OPENGLES3)
   {
@@ -737,6 +742,25 @@ Renderer::Renderer()
     return;
   }
 
+  // The vertex manager uses 32-bit indices, so the restart index is 0xFFFFFFFF
+  if (g_Config.backend_info.bSupportsPrimitiveRestart)
+  {
+    if (GLInterface->GetMode() == GLInterfaceMode::MODE_OPENGLES3)
+    {
+      glEnable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
+    }
+    else if (GLExtensions::Version() >= 310)
+    {
+      glEnable(GL_PRIMITIVE_RESTART);
+      glPrimitiveRestartIndex(0xFFFFFFFF);
+    }
+    else
+    {
+      glEnableClientState(GL_PRIMITIVE_RESTART_NV);
+      glPrimitiveRestartIndexNV(0xFFFFFFFF);
+    }
+  }
+
   glGetIntegerv(GL_MAX_SAMPLES, &g_ogl_config.max_samples);
   if (g_ogl_config.max_samples < 1 || !g_ogl_config.bSupportsMSAA)
     g_ogl_config.max_samples = 1;
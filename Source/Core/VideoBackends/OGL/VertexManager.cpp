@@ -27,7 +27,7 @@
 namespace OGL
 {
 // This are the initially requested size for the buffers expressed in bytes
-const u32 MAX_IBUFFER_SIZE = 2 * 1024 * 1024;
+const u32 MAX_IBUFFER_SIZE = 4 * 1024 * 1024;
 const u32 MAX_VBUFFER_SIZE = 32 * 1024 * 1024;
 
 
@@ -69,7 +69,7 @@ GLuint VertexManager::GetIndexBufferHandle() const
 void VertexManager::PrepareDrawBuffers(u32 stride)
 {
   u32 vertex_data_size = IndexGenerator::GetNumVerts() * stride;
-  u32 index_data_size = IndexGenerator::GetIndexLen() * sizeof(u16);
+  u32 index_data_size = IndexGenerator::GetIndexLen() * sizeof(u32);
   m_baseVertex = m_vertexBuffer->Stream(vertex_data_size, stride, m_cpu_v_buffer.data()) / stride;
   m_index_offset = m_indexBuffer->Stream(index_data_size, m_cpu_i_buffer.data());
   ADDSTAT(stats.thisFrame.bytesVertexStreamed, vertex_data_size);
@@ -80,7 +80,6 @@ void VertexManager::ResetBuffer(u32 stride)
 {
   m_pCurBufferPointer = m_pBaseBufferPointer = m_cpu_v_buffer.data();
   m_pEndBufferPointer = m_pBaseBufferPointer + m_cpu_v_buffer.size();
-  m_index_buffer_base = m_cpu_i_buffer.data();
   IndexGenerator::Start(m_cpu_i_buffer.data());
 }
 
@@ -89,19 +88,20 @@ void VertexManager::Draw(u32 stride)
   u32 index_size = IndexGenerator::GetIndexLen();
   u32 max_index = IndexGenerator::GetNumVerts();
   GLenum primitive_mode = 0;
-  static const GLenum modes[3] = {
+  static const GLenum modes[4] = {
       GL_POINTS,
       GL_LINES,
-      GL_TRIANGLES
+      GL_TRIANGLES,
+      GL_TRIANGLE_STRIP
   };
   primitive_mode = modes[static_cast<u32>(m_current_primitive_type)];
   if (g_ogl_config.bSupportsGLBaseVertex)
   {
-    glDrawRangeElementsBaseVertex(primitive_mode, 0, max_index, index_size, GL_UNSIGNED_SHORT, (u8*)nullptr + m_index_offset, (GLint)m_baseVertex);
+    glDrawRangeElementsBaseVertex(primitive_mode, 0, max_index, index_size, GL_UNSIGNED_INT, (u8*)nullptr + m_index_offset, (GLint)m_baseVertex);
   }
   else
   {
-    glDrawRangeElements(primitive_mode, 0, max_index, index_size, GL_UNSIGNED_SHORT, (u8*)nullptr + m_index_offset);
+    glDrawRangeElements(primitive_mode, 0, max_index, index_size, GL_UNSIGNED_INT, (u8*)nullptr + m_index_offset);
   }
 
   INCSTAT(stats.thisFrame.numDrawCalls);
@@ -130,10 +130,6 @@ void VertexManager::PrepareShaders(PrimitiveType primitive, u32 components, cons
   }
 }
 
-u16* VertexManager::GetIndexBuffer()
-{
-  return m_index_buffer_base;
-}
 void VertexManager::vFlush(bool useDstAlpha)
 {
   GLVertexFormat* nativeVertexFmt = (GLVertexFormat*)VertexLoaderManager::GetCurrentVertexFormat();
@@ -38,7 +38,6 @@ public:
 
 protected:
   void ResetBuffer(u32 stride) override;
-  u16* GetIndexBuffer() override;
 private:
   void Draw(u32 stride);
   void vFlush(bool useDstAlpha) override;
@@ -49,11 +48,11 @@ private:
 
   // Alternative buffers in CPU memory for primatives we are going to discard.
   std::vector<u8, Common::aligned_allocator<u8, 16>> m_cpu_v_buffer;
-  std::vector<u16, Common::aligned_allocator<u16, 16>> m_cpu_i_buffer;
+  // 32-bit indices, so large batches don't have to be split at 65535 vertices
+  std::vector<u32, Common::aligned_allocator<u32, 16>> m_cpu_i_buffer;
   std::unique_ptr<StreamBuffer> m_vertexBuffer;
   std::unique_ptr<StreamBuffer> m_indexBuffer;
   size_t m_baseVertex;
   size_t m_index_offset;
-  u16* m_index_buffer_base;
 };
 }
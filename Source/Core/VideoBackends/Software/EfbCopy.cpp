@@ -25,7 +25,8 @@ namespace EfbCopy
 {
 static void CopyToXfb(u32 xfbAddr, u32 fbWidth, u32 fbHeight, const EFBRectangle& sourceRc, float Gamma)
 {
-  GLInterface->Update(); // update the render window position and the backbuffer size
+  if (GLInterface)
+    GLInterface->Update(); // update the render window position and the backbuffer size
 
   INFO_LOG(VIDEO, "xfbaddr: %x, fbwidth: %i, fbheight: %i, source: (%i, %i, %i, %i), Gamma %f",
     xfbAddr, fbWidth, fbHeight, sourceRc.top, sourceRc.left, sourceRc.bottom, sourceRc.right, Gamma);
@@ -30,6 +30,20 @@ static inline u32 GetDepthOffset(u16 x, u16 y)
   return (x + y * EFB_WIDTH) * 3 + DEPTH_BUFFER_START;
 }
 
+// Pixels are 3 bytes wide, only their own bytes are accessed so pixels next to each other
+// can be drawn by different threads
+static inline u32 ReadPixel(u32 offset)
+{
+  return efb[offset] | efb[offset + 1] << 8 | efb[offset + 2] << 16;
+}
+
+static inline void WritePixel(u32 offset, u32 value)
+{
+  efb[offset] = static_cast<u8>(value);
+  efb[offset + 1] = static_cast<u8>(value >> 8);
+  efb[offset + 2] = static_cast<u8>(value >> 16);
+}
+
 static void SetPixelAlphaOnly(u32 offset, u8 a)
 {
   switch (bpmem.zcontrol.pixel_format)
@@ -42,10 +56,9 @@ static void SetPixelAlphaOnly(u32 offset, u8 a)
   case PEControl::RGBA6_Z24:
   {
     u32 a32 = a;
-    u32 *dst = (u32*)&efb[offset];
-    u32 val = *dst & 0xffffffc0;
+    u32 val = ReadPixel(offset) & 0xffffc0;
     val |= (a32 >> 2) & 0x0000003f;
-    *dst = val;
+    WritePixel(offset, val);
   }
   break;
   default:
@@ -61,31 +74,26 @@ static void SetPixelColorOnly(u32 offset, u8 *rgb)
   case PEControl::Z24:
   {
     u32 src = *(u32*)rgb;
-    u32 *dst = (u32*)&efb[offset];
-    u32 val = *dst & 0xff000000;
-    val |= src >> 8;
-    *dst = val;
+    u32 val = src >> 8;
+    WritePixel(offset, val);
   }
   break;
   case PEControl::RGBA6_Z24:
   {
     u32 src = *(u32*)rgb;
-    u32 *dst = (u32*)&efb[offset];
-    u32 val = *dst & 0xff00003f;
+    u32 val = ReadPixel(offset) & 0x3f;
     val |= (src >> 4) & 0x00000fc0; // blue
     val |= (src >> 6) & 0x0003f000; // green
     val |= (src >> 8) & 0x00fc0000; // red
-    *dst = val;
+    WritePixel(offset, val);
   }
   break;
   case PEControl::RGB565_Z16:
   {
     INFO_LOG(VIDEO, "RGB565_Z16 is not supported correctly yet");
     u32 src = *(u32*)rgb;
-    u32 *dst = (u32*)&efb[offset];
-    u32 val = *dst & 0xff000000;
-    val |= src >> 8;
-    *dst = val;
+    u32 val = src >> 8;
+    WritePixel(offset, val);
   }
   break;
   default:
@@ -101,32 +109,26 @@ static void SetPixelAlphaColor(u32 offset, u8 *color)
   case PEControl::Z24:
   {
     u32 src = *(u32*)color;
-    u32 *dst = (u32*)&efb[offset];
-    u32 val = *dst & 0xff000000;
-    val |= src >> 8;
-    *dst = val;
+    u32 val = src >> 8;
+    WritePixel(offset, val);
   }
   break;
   case PEControl::RGBA6_Z24:
   {
     u32 src = *(u32*)color;
-    u32 *dst = (u32*)&efb[offset];
-    u32 val = *dst & 0xff000000;
-    val |= (src >> 2) & 0x0000003f; // alpha
+    u32 val = (src >> 2) & 0x0000003f; // alpha
     val |= (src >> 4) & 0x00000fc0; // blue
     val |= (src >> 6) & 0x0003f000; // green
     val |= (src >> 8) & 0x00fc0000; // red
-    *dst = val;
+    WritePixel(offset, val);
   }
   break;
   case PEControl::RGB565_Z16:
   {
     INFO_LOG(VIDEO, "RGB565_Z16 is not supported correctly yet");
     u32 src = *(u32*)color;
-    u32 *dst = (u32*)&efb[offset];
-    u32 val = *dst & 0xff000000;
-    val |= src >> 8;
-    *dst = val;
+    u32 val = src >> 8;
+    WritePixel(offset, val);
   }
   break;
   default:
@@ -141,7 +143,7 @@ static void GetPixelColor(u32 offset, u8 *color)
   case PEControl::RGB8_Z24:
   case PEControl::Z24:
   {
-    u32 src = *(u32*)&efb[offset];
+    u32 src = ReadPixel(offset);
     u32 *dst = (u32*)color;
     u32 val = 0xff | ((src & 0x00ffffff) << 8);
     *dst = val;
@@ -149,7 +151,7 @@ static void GetPixelColor(u32 offset, u8 *color)
   break;
   case PEControl::RGBA6_Z24:
   {
-    u32 src = *(u32*)&efb[offset];
+    u32 src = ReadPixel(offset);
     color[ALP_C] = Convert6To8(src & 0x3f);
     color[BLU_C] = Convert6To8((src >> 6) & 0x3f);
     color[GRN_C] = Convert6To8((src >> 12) & 0x3f);
@@ -159,7 +161,7 @@ static void GetPixelColor(u32 offset, u8 *color)
   case PEControl::RGB565_Z16:
   {
     INFO_LOG(VIDEO, "RGB565_Z16 is not supported correctly yet");
-    u32 src = *(u32*)&efb[offset];
+    u32 src = ReadPixel(offset);
     u32 *dst = (u32*)color;
     u32 val = 0xff | ((src & 0x00ffffff) << 8);
     *dst = val;
@@ -178,19 +180,13 @@ static void SetPixelDepth(u32 offset, u32 depth)
   case PEControl::RGBA6_Z24:
   case PEControl::Z24:
   {
-    u32 *dst = (u32*)&efb[offset];
-    u32 val = *dst & 0xff000000;
-    val |= depth & 0x00ffffff;
-    *dst = val;
+    WritePixel(offset, depth & 0x00ffffff);
   }
   break;
   case PEControl::RGB565_Z16:
   {
     INFO_LOG(VIDEO, "RGB565_Z16 is not supported correctly yet");
-    u32 *dst = (u32*)&efb[offset];
-    u32 val = *dst & 0xff000000;
-    val |= depth & 0x00ffffff;
-    *dst = val;
+    WritePixel(offset, depth & 0x00ffffff);
   }
   break;
   default:
@@ -208,13 +204,13 @@ static u32 GetPixelDepth(u32 offset)
   case PEControl::RGBA6_Z24:
   case PEControl::Z24:
   {
-    depth = (*(u32*)&efb[offset]) & 0x00ffffff;
+    depth = ReadPixel(offset);
   }
   break;
   case PEControl::RGB565_Z16:
   {
     INFO_LOG(VIDEO, "RGB565_Z16 is not supported correctly yet");
-    depth = (*(u32*)&efb[offset]) & 0x00ffffff;
+    depth = ReadPixel(offset);
   }
   break;
   default:
@@ -619,4 +615,16 @@ bool ZCompare(u16 x, u16 y, u32 z)
 
   return pass;
 }
+
+void IncPerfCounterQuadCount(PerfQueryType type, u32 pixels)
+{
+  // NOTE: hardware doesn't process individual pixels but quads instead.
+  // Current software renderer architecture works on pixels though, so
+  // we have this "quad" hack here to only increment the registers on
+  // every fourth rendered pixel
+  static u32 quad[PQ_NUM_MEMBERS];
+  quad[type] += pixels;
+  perf_values[type] += quad[type] / 3;
+  quad[type] %= 3;
+}
 }
@@ -4,8 +4,11 @@
 
 #include <algorithm>
 #include <cstring>
+#include <mutex>
+#include <vector>
 
 #include "Common/CommonTypes.h"
+#include "Common/ThreadPool.h"
 #include "VideoBackends/Software/EfbInterface.h"
 #include "VideoBackends/Software/NativeVertexFormat.h"
 #include "VideoBackends/Software/Rasterizer.h"
@@ -19,28 +22,63 @@
 namespace Rasterizer
 {
 static constexpr int BLOCK_SIZE = 2;
+// Size of the screen tiles the triangles are binned into, a multiple of BLOCK_SIZE
+static constexpr int TILE_SIZE = 32;
+static constexpr int TILES_X = (EFB_WIDTH + TILE_SIZE - 1) / TILE_SIZE;
+static constexpr int TILES_Y = (EFB_HEIGHT + TILE_SIZE - 1) / TILE_SIZE;
 
-static Slope ZSlope;
-static Slope WSlope;
-static Slope ColorSlopes[2][4];
-static Slope TexSlopes[8][3];
+// Everything needed to draw the pixels of a triangle
+struct Triangle
+{
+  Slope ZSlope;
+  Slope WSlope;
+  Slope ColorSlopes[2][4];
+  Slope TexSlopes[8][3];
+
+  s32 vertex0X;
+  s32 vertex0Y;
+  float vertexOffsetX;
+  float vertexOffsetY;
+
+  // Half-edge constants and deltas in 28.4 fixed point
+  s32 C1, C2, C3;
+  s32 DX12, DX23, DX31;
+  s32 DY12, DY23, DY31;
+
+  // Blocks covering the triangle, minx and miny are aligned to BLOCK_SIZE
+  s32 minx, maxx, miny, maxy;
+};
+
+// Pixel pipeline of a thread drawing triangles
+struct PixelUnit
+{
+  Tev tev;
+  RasterBlock rasterBlock;
+};
 
-static s32 vertex0X;
-static s32 vertex0Y;
-static float vertexOffsetX;
-static float vertexOffsetY;
+static Slope ZSlope;
 
 static s32 scissorLeft = 0;
 static s32 scissorTop = 0;
 static s32 scissorRight = 0;
 static s32 scissorBottom = 0;
 
-static Tev tev;
-static RasterBlock rasterBlock;
+static PixelUnit unit;
+// Color registers, copied to the units of the worker threads
+static s16 tevRegs[2][4][4];
+
+// Triangles waiting to be drawn by the worker threads, and the indices of the triangles
+// overlapping each tile in drawing order.
+static std::vector<Triangle> binnedTriangles;
+static std::vector<u32> tileBins[TILES_X * TILES_Y];
+static std::mutex countersLock;
 
 void Init()
 {
-  tev.Init();
+  unit.tev.Init();
+  binnedTriangles.clear();
+  for (std::vector<u32>& bin : tileBins)
+    bin.clear();
 
   // Set initial z reference plane in the unlikely case that zfreeze is enabled when drawing the first primitive.
   // TODO: This is just a guess!
@@ -94,31 +132,53 @@ void SetScissor()
 
 void SetTevReg(int reg, int comp, bool konst, s16 color)
 {
-  tev.SetRegColor(reg, comp, konst, color);
+  unit.tev.SetRegColor(reg, comp, konst, color);
+  tevRegs[konst][reg][comp] = color;
 }
 
-static void Draw(s32 x, s32 y, s32 xi, s32 yi)
+// Adds the pixels counted by a unit to the statistics, performance counters and bounding box
+static void AddCounters(TevCounters& counters)
 {
-  INCSTAT(stats.thisFrame.rasterizedPixels);
+  ADDSTAT(stats.thisFrame.rasterizedPixels, counters.rasterizedPixels);
+  ADDSTAT(stats.thisFrame.tevPixelsIn, counters.tevPixelsIn);
+  ADDSTAT(stats.thisFrame.tevPixelsOut, counters.tevPixelsOut);
+  for (int i = 0; i < PQ_NUM_MEMBERS; i++)
+  {
+    if (counters.perfPixels[i])
+      EfbInterface::IncPerfCounterQuadCount(static_cast<PerfQueryType>(i), counters.perfPixels[i]);
+  }
+  u16* bbox = BoundingBox::coords;
+  bbox[BoundingBox::LEFT] = std::min(counters.bbox[BoundingBox::LEFT], bbox[BoundingBox::LEFT]);
+  bbox[BoundingBox::RIGHT] = std::max(counters.bbox[BoundingBox::RIGHT], bbox[BoundingBox::RIGHT]);
+  bbox[BoundingBox::TOP] = std::min(counters.bbox[BoundingBox::TOP], bbox[BoundingBox::TOP]);
+  bbox[BoundingBox::BOTTOM] = std::max(counters.bbox[BoundingBox::BOTTOM], bbox[BoundingBox::BOTTOM]);
+  counters.Reset();
+}
+
+static void Draw(const Triangle& tri, PixelUnit& pu, s32 x, s32 y, s32 xi, s32 yi)
+{
+  Tev& tev = pu.tev;
+  tev.Counters.rasterizedPixels++;
 
-  float dx = vertexOffsetX + (float)(x - vertex0X);
-  float dy = vertexOffsetY + (float)(y - vertex0Y);
+  float dx = tri.vertexOffsetX + (float)(x - tri.vertex0X);
+  float dy = tri.vertexOffsetY + (float)(y - tri.vertex0Y);
 
-  s32 z = (s32)MathUtil::Clamp<float>(ZSlope.GetValue(dx, dy), 0.0f, 16777215.0f);
+  s32 z = (s32)MathUtil::Clamp<float>(tri.ZSlope.GetValue(dx, dy), 0.0f, 16777215.0f);
 
   if (!BoundingBox::active && bpmem.UseEarlyDepthTest() && g_ActiveConfig.bZComploc)
   {
     // TODO: Test if perf regs are incremented even if test is disabled
-    EfbInterface::IncPerfCounterQuadCount(PQ_ZCOMP_INPUT_ZCOMPLOC);
+    tev.Counters.perfPixels[PQ_ZCOMP_INPUT_ZCOMPLOC]++;
     if (bpmem.zmode.testenable)
     {
       // early z
       if (!EfbInterface::ZCompare(x, y, z))
         return;
     }
-    EfbInterface::IncPerfCounterQuadCount(PQ_ZCOMP_OUTPUT_ZCOMPLOC);
+    tev.Counters.perfPixels[PQ_ZCOMP_OUTPUT_ZCOMPLOC]++;
   }
 
+  RasterBlock& rasterBlock = pu.rasterBlock;
   RasterBlockPixel& pixel = rasterBlock.Pixel[xi][yi];
 
   tev.Position[0] = x;
@@ -130,7 +190,7 @@ static void Draw(s32 x, s32 y, s32 xi, s32 yi)
   {
     for (int comp = 0; comp < 4; comp++)
     {
-      u16 color = (u16)ColorSlopes[i][comp].GetValue(dx, dy);
+      u16 color = (u16)tri.ColorSlopes[i][comp].GetValue(dx, dy);
 
       // clamp color value to 0
       u16 mask = ~(color >> 8);
@@ -162,16 +222,16 @@ static void Draw(s32 x, s32 y, s32 xi, s32 yi)
   tev.Draw();
 }
 
-static void InitTriangle(float X1, float Y1, s32 xi, s32 yi)
+static void InitTriangle(Triangle* tri, float X1, float Y1, s32 xi, s32 yi)
 {
-  vertex0X = xi;
-  vertex0Y = yi;
+  tri->vertex0X = xi;
+  tri->vertex0Y = yi;
 
   // adjust a little less than 0.5
   const float adjust = 0.495f;
 
-  vertexOffsetX = ((float)xi - X1) + adjust;
-  vertexOffsetY = ((float)yi - Y1) + adjust;
+  tri->vertexOffsetX = ((float)xi - X1) + adjust;
+  tri->vertexOffsetY = ((float)yi - Y1) + adjust;
 }
 
 static void InitSlope(Slope *slope, float f1, float f2, float f3, float DX31, float DX12, float DY12, float DY31)
@@ -186,7 +246,7 @@ static void InitSlope(Slope *slope, float f1, float f2, float f3, float DX31, fl
   slope->f0 = f1;
 }
 
-static inline void CalculateLOD(s32* lodp, bool* linear, u32 texmap, u32 texcoord)
+static inline void CalculateLOD(const RasterBlock& rasterBlock, s32* lodp, bool* linear, u32 texmap, u32 texcoord)
 {
   const FourTexUnits& texUnit = bpmem.tex[(texmap >> 2) & 1];
   const u8 subTexmap = texmap & 3;
@@ -199,17 +259,17 @@ static inline void CalculateLOD(s32* lodp, bool* linear, u32 texmap, u32 texcoor
   float sDelta, tDelta;
   if (tm0.diag_lod)
   {
-    float *uv0 = rasterBlock.Pixel[0][0].Uv[texcoord];
-    float *uv1 = rasterBlock.Pixel[1][1].Uv[texcoord];
+    const float *uv0 = rasterBlock.Pixel[0][0].Uv[texcoord];
+    const float *uv1 = rasterBlock.Pixel[1][1].Uv[texcoord];
 
     sDelta = fabsf(uv0[0] - uv1[0]);
     tDelta = fabsf(uv0[1] - uv1[1]);
   }
   else
   {
-    float *uv0 = rasterBlock.Pixel[0][0].Uv[texcoord];
-    float *uv1 = rasterBlock.Pixel[1][0].Uv[texcoord];
-    float *uv2 = rasterBlock.Pixel[0][1].Uv[texcoord];
+    const float *uv0 = rasterBlock.Pixel[0][0].Uv[texcoord];
+    const float *uv1 = rasterBlock.Pixel[1][0].Uv[texcoord];
+    const float *uv2 = rasterBlock.Pixel[0][1].Uv[texcoord];
 
     sDelta = std::max(fabsf(uv0[0] - uv1[0]), fabsf(uv0[0] - uv2[0]));
     tDelta = std::max(fabsf(uv0[1] - uv1[1]), fabsf(uv0[1] - uv2[1]));
@@ -234,7 +294,7 @@ static inline void CalculateLOD(s32* lodp, bool* linear, u32 texmap, u32 texcoor
   *lodp = lod;
 }
 
-static void BuildBlock(s32 blockX, s32 blockY)
+static void BuildBlock(const Triangle& tri, RasterBlock& rasterBlock, s32 blockX, s32 blockY)
 {
   for (s32 yi = 0; yi < BLOCK_SIZE; yi++)
   {
@@ -242,10 +302,10 @@ static void BuildBlock(s32 blockX, s32 blockY)
     {
       RasterBlockPixel& pixel = rasterBlock.Pixel[xi][yi];
 
-      float dx = vertexOffsetX + (float)(xi + blockX - vertex0X);
-      float dy = vertexOffsetY + (float)(yi + blockY - vertex0Y);
+      float dx = tri.vertexOffsetX + (float)(xi + blockX - tri.vertex0X);
+      float dy = tri.vertexOffsetY + (float)(yi + blockY - tri.vertex0Y);
 
-      float invW = 1.0f / WSlope.GetValue(dx, dy);
+      float invW = 1.0f / tri.WSlope.GetValue(dx, dy);
       pixel.InvW = invW;
 
       // tex coords
@@ -254,13 +314,13 @@ static void BuildBlock(s32 blockX, s32 blockY)
         float projection = invW;
         if (xfmem.texMtxInfo[i].projection)
         {
-          float q = TexSlopes[i][2].GetValue(dx, dy) * invW;
+          float q = tri.TexSlopes[i][2].GetValue(dx, dy) * invW;
           if (q != 0.0f)
             projection = invW / q;
         }
 
-        pixel.Uv[i][0] = TexSlopes[i][0].GetValue(dx, dy) * projection;
-        pixel.Uv[i][1] = TexSlopes[i][1].GetValue(dx, dy) * projection;
+        pixel.Uv[i][0] = tri.TexSlopes[i][0].GetValue(dx, dy) * projection;
+        pixel.Uv[i][1] = tri.TexSlopes[i][1].GetValue(dx, dy) * projection;
       }
     }
   }
@@ -273,7 +333,7 @@ static void BuildBlock(s32 blockX, s32 blockY)
     u32 texcoord = indref & 3;
     indref >>= 3;
 
-    CalculateLOD(&rasterBlock.IndirectLod[i], &rasterBlock.IndirectLinear[i], texmap, texcoord);
+    CalculateLOD(rasterBlock, &rasterBlock.IndirectLod[i], &rasterBlock.IndirectLinear[i], texmap, texcoord);
   }
 
   for (unsigned int i = 0; i <= bpmem.genMode.numtevstages; i++)
@@ -285,12 +345,12 @@ static void BuildBlock(s32 blockX, s32 blockY)
       u32 texmap = order.getTexMap(stageOdd);
       u32 texcoord = order.getTexCoord(stageOdd);
 
-      CalculateLOD(&rasterBlock.TextureLod[i], &rasterBlock.TextureLinear[i], texmap, texcoord);
+      CalculateLOD(rasterBlock, &rasterBlock.TextureLod[i], &rasterBlock.TextureLinear[i], texmap, texcoord);
     }
   }
 }
 
-static inline void PrepareBlock(s32 blockX, s32 blockY)
+static inline void PrepareBlock(const Triangle& tri, s32 blockX, s32 blockY)
 {
   static s32 x = -1;
   static s32 y = -1;
@@ -302,10 +362,202 @@ static inline void PrepareBlock(s32 blockX, s32 blockY)
   {
     x = blockX;
     y = blockY;
-    BuildBlock(x, y);
+    BuildBlock(tri, unit.rasterBlock, x, y);
+  }
+}
+
+// Draws the blocks of a triangle within [minx, maxx) x [miny, maxy), minx and miny are
+// aligned to BLOCK_SIZE
+static void DrawBlocks(const Triangle& tri, PixelUnit& pu, s32 minx, s32 maxx, s32 miny, s32 maxy)
+{
+  const s32 C1 = tri.C1;
+  const s32 C2 = tri.C2;
+  const s32 C3 = tri.C3;
+  const s32 DX12 = tri.DX12;
+  const s32 DX23 = tri.DX23;
+  const s32 DX31 = tri.DX31;
+  const s32 DY12 = tri.DY12;
+  const s32 DY23 = tri.DY23;
+  const s32 DY31 = tri.DY31;
+
+  // Fixed-pos32 deltas
+  const s32 FDX12 = DX12 * 16;
+  const s32 FDX23 = DX23 * 16;
+  const s32 FDX31 = DX31 * 16;
+
+  const s32 FDY12 = DY12 * 16;
+  const s32 FDY23 = DY23 * 16;
+  const s32 FDY31 = DY31 * 16;
+
+  // Loop through blocks
+  for (s32 y = miny; y < maxy; y += BLOCK_SIZE)
+  {
+    for (s32 x = minx; x < maxx; x += BLOCK_SIZE)
+    {
+      // Corners of block
+      s32 x0 = x << 4;
+      s32 x1 = (x + BLOCK_SIZE - 1) << 4;
+      s32 y0 = y << 4;
+      s32 y1 = (y + BLOCK_SIZE - 1) << 4;
+
+      // Evaluate half-space functions
+      bool a00 = C1 + DX12 * y0 - DY12 * x0 > 0;
+      bool a10 = C1 + DX12 * y0 - DY12 * x1 > 0;
+      bool a01 = C1 + DX12 * y1 - DY12 * x0 > 0;
+      bool a11 = C1 + DX12 * y1 - DY12 * x1 > 0;
+      int a = (a00 << 0) | (a10 << 1) | (a01 << 2) | (a11 << 3);
+
+      bool b00 = C2 + DX23 * y0 - DY23 * x0 > 0;
+      bool b10 = C2 + DX23 * y0 - DY23 * x1 > 0;
+      bool b01 = C2 + DX23 * y1 - DY23 * x0 > 0;
+      bool b11 = C2 + DX23 * y1 - DY23 * x1 > 0;
+      int b = (b00 << 0) | (b10 << 1) | (b01 << 2) | (b11 << 3);
+
+      bool c00 = C3 + DX31 * y0 - DY31 * x0 > 0;
+      bool c10 = C3 + DX31 * y0 - DY31 * x1 > 0;
+      bool c01 = C3 + DX31 * y1 - DY31 * x0 > 0;
+      bool c11 = C3 + DX31 * y1 - DY31 * x1 > 0;
+      int c = (c00 << 0) | (c10 << 1) | (c01 << 2) | (c11 << 3);
+
+      // Skip block when outside an edge
+      if (a == 0x0 || b == 0x0 || c == 0x0)
+        continue;
+
+      BuildBlock(tri, pu.rasterBlock, x, y);
+
+      // Accept whole block when totally covered
+      if (a == 0xF && b == 0xF && c == 0xF)
+      {
+        for (s32 iy = 0; iy < BLOCK_SIZE; iy++)
+        {
+          for (s32 ix = 0; ix < BLOCK_SIZE; ix++)
+          {
+            Draw(tri, pu, x + ix, y + iy, ix, iy);
+          }
+        }
+      }
+      else // Partially covered block
+      {
+        s32 CY1 = C1 + DX12 * y0 - DY12 * x0;
+        s32 CY2 = C2 + DX23 * y0 - DY23 * x0;
+        s32 CY3 = C3 + DX31 * y0 - DY31 * x0;
+
+        for (s32 iy = 0; iy < BLOCK_SIZE; iy++)
+        {
+          s32 CX1 = CY1;
+          s32 CX2 = CY2;
+          s32 CX3 = CY3;
+
+          for (s32 ix = 0; ix < BLOCK_SIZE; ix++)
+          {
+            if (CX1 > 0 && CX2 > 0 && CX3 > 0)
+            {
+              Draw(tri, pu, x + ix, y + iy, ix, iy);
+            }
+
+            CX1 -= FDY12;
+            CX2 -= FDY23;
+            CX3 -= FDY31;
+          }
+
+          CY1 += FDX12;
+          CY2 += FDX23;
+          CY3 += FDX31;
+        }
+      }
+    }
   }
 }
 
+static bool UseTiles()
+{
+  // The TEV dumps write to shared buffers
+  return g_ActiveConfig.bTiledRasterizer && !g_ActiveConfig.bDumpTevStages &&
+         !g_ActiveConfig.bDumpTevTextureFetches;
+}
+
+// Returns false if one of the edges of the triangle has all the pixel centers of the area on
+// its outer side
+static bool CoversArea(const Triangle& tri, s32 minx, s32 maxx, s32 miny, s32 maxy)
+{
+  const s32 x0 = minx << 4;
+  const s32 x1 = (maxx - 1) << 4;
+  const s32 y0 = miny << 4;
+  const s32 y1 = (maxy - 1) << 4;
+  const auto outside = [&](s32 C, s32 DX, s32 DY) {
+    return C + DX * y0 - DY * x0 <= 0 && C + DX * y0 - DY * x1 <= 0 &&
+           C + DX * y1 - DY * x0 <= 0 && C + DX * y1 - DY * x1 <= 0;
+  };
+  return !outside(tri.C1, tri.DX12, tri.DY12) && !outside(tri.C2, tri.DX23, tri.DY23) &&
+         !outside(tri.C3, tri.DX31, tri.DY31);
+}
+
+static void BinTriangle(const Triangle& tri)
+{
+  const u32 index = static_cast<u32>(binnedTriangles.size());
+  binnedTriangles.push_back(tri);
+  for (s32 ty = tri.miny / TILE_SIZE; ty <= (tri.maxy - 1) / TILE_SIZE; ty++)
+  {
+    const s32 y0 = ty * TILE_SIZE;
+    for (s32 tx = tri.minx / TILE_SIZE; tx <= (tri.maxx - 1) / TILE_SIZE; tx++)
+    {
+      const s32 x0 = tx * TILE_SIZE;
+      if (CoversArea(tri, x0, x0 + TILE_SIZE, y0, y0 + TILE_SIZE))
+        tileBins[ty * TILES_X + tx].push_back(index);
+    }
+  }
+}
+
+// Draws the triangles binned into a tile in submission order. The tiles are aligned to
+// BLOCK_SIZE, so every block is drawn exactly like without tiles.
+static void DrawTile(int tile, PixelUnit& pu)
+{
+  const s32 x0 = (tile % TILES_X) * TILE_SIZE;
+  const s32 y0 = (tile / TILES_X) * TILE_SIZE;
+  for (u32 index : tileBins[tile])
+  {
+    const Triangle& tri = binnedTriangles[index];
+    DrawBlocks(tri, pu, std::max(tri.minx, x0), std::min(tri.maxx, x0 + TILE_SIZE),
+               std::max(tri.miny, y0), std::min(tri.maxy, y0 + TILE_SIZE));
+  }
+}
+
+void Flush()
+{
+  if (binnedTriangles.empty())
+    return;
+
+  static std::vector<int> tiles;
+  tiles.clear();
+  for (int i = 0; i < TILES_X * TILES_Y; i++)
+  {
+    if (!tileBins[i].empty())
+      tiles.push_back(i);
+  }
+
+  Common::ThreadPool::ParallelFor(0, static_cast<int>(tiles.size()), 1, [](int lower, int upper) {
+    PixelUnit pu;
+    pu.tev.Init();
+    for (int konst = 0; konst < 2; konst++)
+    {
+      for (int reg = 0; reg < 4; reg++)
+      {
+        for (int comp = 0; comp < 4; comp++)
+          pu.tev.SetRegColor(reg, comp, konst != 0, tevRegs[konst][reg][comp]);
+      }
+    }
+    for (int i = lower; i < upper; i++)
+      DrawTile(tiles[i], pu);
+
+    std::lock_guard<std::mutex> guard(countersLock);
+    AddCounters(pu.tev.Counters);
+  });
+
+  binnedTriangles.clear();
+  for (int tile : tiles)
+    tileBins[tile].clear();
+}
+
 void DrawTriangleFrontFace(OutputVertexData *v0, OutputVertexData *v1, OutputVertexData *v2)
 {
   INCSTAT(stats.thisFrame.numTrianglesDrawn);
@@ -363,10 +615,11 @@ void DrawTriangleFrontFace(OutputVertexData *v0, OutputVertexData *v1, OutputVer
   float fltdy12 = flty1 - v1->screenPosition.y;
   float fltdy31 = v2->screenPosition.y - flty1;
 
-  InitTriangle(fltx1, flty1, (X1 + 0xF) >> 4, (Y1 + 0xF) >> 4);
+  Triangle tri;
+  InitTriangle(&tri, fltx1, flty1, (X1 + 0xF) >> 4, (Y1 + 0xF) >> 4);
 
   float w[3] = { 1.0f / v0->projectedPosition.w, 1.0f / v1->projectedPosition.w, 1.0f / v2->projectedPosition.w };
-  InitSlope(&WSlope, w[0], w[1], w[2], fltdx31, fltdx12, fltdy12, fltdy31);
+  InitSlope(&tri.WSlope, w[0], w[1], w[2], fltdx31, fltdx12, fltdy12, fltdy31);
 
   // TODO: The zfreeze emulation is not quite correct, yet!
   // Many things might prevent us from reaching this line (culling, clipping, scissoring).
@@ -374,17 +627,18 @@ void DrawTriangleFrontFace(OutputVertexData *v0, OutputVertexData *v1, OutputVer
   // We're currently sloppy at this since we abort early if any of the culling/clipping/scissoring tests fail.
   if (!bpmem.genMode.zfreeze || !g_ActiveConfig.bZFreeze)
     InitSlope(&ZSlope, v0->screenPosition[2], v1->screenPosition[2], v2->screenPosition[2], fltdx31, fltdx12, fltdy12, fltdy31);
+  tri.ZSlope = ZSlope;
 
   for (unsigned int i = 0; i < bpmem.genMode.numcolchans; i++)
   {
     for (int comp = 0; comp < 4; comp++)
-      InitSlope(&ColorSlopes[i][comp], v0->color[i][comp], v1->color[i][comp], v2->color[i][comp], fltdx31, fltdx12, fltdy12, fltdy31);
+      InitSlope(&tri.ColorSlopes[i][comp], v0->color[i][comp], v1->color[i][comp], v2->color[i][comp], fltdx31, fltdx12, fltdy12, fltdy31);
   }
 
   for (unsigned int i = 0; i < bpmem.genMode.numtexgens; i++)
   {
     for (int comp = 0; comp < 3; comp++)
-      InitSlope(&TexSlopes[i][comp], v0->texCoords[i][comp] * w[0], v1->texCoords[i][comp] * w[1], v2->texCoords[i][comp] * w[2], fltdx31, fltdx12, fltdy12, fltdy31);
+      InitSlope(&tri.TexSlopes[i][comp], v0->texCoords[i][comp] * w[0], v1->texCoords[i][comp] * w[1], v2->texCoords[i][comp] * w[2], fltdx31, fltdx12, fltdy12, fltdy31);
   }
 
   // Half-edge constants
@@ -397,88 +651,34 @@ void DrawTriangleFrontFace(OutputVertexData *v0, OutputVertexData *v1, OutputVer
   if (DY23 < 0 || (DY23 == 0 && DX23 > 0)) C2++;
   if (DY31 < 0 || (DY31 == 0 && DX31 > 0)) C3++;
 
+  tri.C1 = C1;
+  tri.C2 = C2;
+  tri.C3 = C3;
+  tri.DX12 = DX12;
+  tri.DX23 = DX23;
+  tri.DX31 = DX31;
+  tri.DY12 = DY12;
+  tri.DY23 = DY23;
+  tri.DY31 = DY31;
+
   if (!BoundingBox::active)
   {
     // Start in corner of 8x8 block
-    minx &= ~(BLOCK_SIZE - 1);
-    miny &= ~(BLOCK_SIZE - 1);
-    // Loop through blocks
-    for (s32 y = miny; y < maxy; y += BLOCK_SIZE)
-    {
-      for (s32 x = minx; x < maxx; x += BLOCK_SIZE)
-      {
-        // Corners of block
-        s32 x0 = x << 4;
-        s32 x1 = (x + BLOCK_SIZE - 1) << 4;
-        s32 y0 = y << 4;
-        s32 y1 = (y + BLOCK_SIZE - 1) << 4;
-
-        // Evaluate half-space functions
-        bool a00 = C1 + DX12 * y0 - DY12 * x0 > 0;
-        bool a10 = C1 + DX12 * y0 - DY12 * x1 > 0;
-        bool a01 = C1 + DX12 * y1 - DY12 * x0 > 0;
-        bool a11 = C1 + DX12 * y1 - DY12 * x1 > 0;
-        int a = (a00 << 0) | (a10 << 1) | (a01 << 2) | (a11 << 3);
-
-        bool b00 = C2 + DX23 * y0 - DY23 * x0 > 0;
-        bool b10 = C2 + DX23 * y0 - DY23 * x1 > 0;
-        bool b01 = C2 + DX23 * y1 - DY23 * x0 > 0;
-        bool b11 = C2 + DX23 * y1 - DY23 * x1 > 0;
-        int b = (b00 << 0) | (b10 << 1) | (b01 << 2) | (b11 << 3);
-
-        bool c00 = C3 + DX31 * y0 - DY31 * x0 > 0;
-        bool c10 = C3 + DX31 * y0 - DY31 * x1 > 0;
-        bool c01 = C3 + DX31 * y1 - DY31 * x0 > 0;
-        bool c11 = C3 + DX31 * y1 - DY31 * x1 > 0;
-        int c = (c00 << 0) | (c10 << 1) | (c01 << 2) | (c11 << 3);
-
-        // Skip block when outside an edge
-        if (a == 0x0 || b == 0x0 || c == 0x0)
-          continue;
-
-        BuildBlock(x, y);
-
-        // Accept whole block when totally covered
-        if (a == 0xF && b == 0xF && c == 0xF)
-        {
-          for (s32 iy = 0; iy < BLOCK_SIZE; iy++)
-          {
-            for (s32 ix = 0; ix < BLOCK_SIZE; ix++)
-            {
-              Draw(x + ix, y + iy, ix, iy);
-            }
-          }
-        }
-        else // Partially covered block
-        {
-          s32 CY1 = C1 + DX12 * y0 - DY12 * x0;
-          s32 CY2 = C2 + DX23 * y0 - DY23 * x0;
-          s32 CY3 = C3 + DX31 * y0 - DY31 * x0;
+    tri.minx = minx & ~(BLOCK_SIZE - 1);
+    tri.miny = miny & ~(BLOCK_SIZE - 1);
+    tri.maxx = maxx;
+    tri.maxy = maxy;
 
-          for (s32 iy = 0; iy < BLOCK_SIZE; iy++)
-          {
-            s32 CX1 = CY1;
-            s32 CX2 = CY2;
-            s32 CX3 = CY3;
-
-            for (s32 ix = 0; ix < BLOCK_SIZE; ix++)
-            {
-              if (CX1 > 0 && CX2 > 0 && CX3 > 0)
-              {
-                Draw(x + ix, y + iy, ix, iy);
-              }
-
-              CX1 -= FDY12;
-              CX2 -= FDY23;
-              CX3 -= FDY31;
-            }
-
-            CY1 += FDX12;
-            CY2 += FDX23;
-            CY3 += FDX31;
-          }
-        }
-      }
+    if (UseTiles())
+    {
+      BinTriangle(tri);
+    }
+    else
+    {
+      // Triangles are drawn in order, a previous one may still wait in the bins
+      Flush();
+      DrawBlocks(tri, unit, tri.minx, tri.maxx, tri.miny, tri.maxy);
+      AddCounters(unit.tev.Counters);
     }
   }
   else
@@ -532,8 +732,8 @@ void DrawTriangleFrontFace(OutputVertexData *v0, OutputVertexData *v1, OutputVer
         if (CX1 > 0 && CX2 > 0 && CX3 > 0)
         {
           // Build the new raster block every other pixel
-          PrepareBlock(x, y);
-          Draw(x, y, x & (BLOCK_SIZE - 1), y & (BLOCK_SIZE - 1));
+          PrepareBlock(tri, x, y);
+          Draw(tri, unit, x, y, x & (BLOCK_SIZE - 1), y & (BLOCK_SIZE - 1));
 
           if (y >= BoundingBox::coords[BoundingBox::TOP])
             break;
@@ -572,8 +772,8 @@ void DrawTriangleFrontFace(OutputVertexData *v0, OutputVertexData *v1, OutputVer
       {
         if (CY1 > 0 && CY2 > 0 && CY3 > 0)
         {
-          PrepareBlock(x, y);
-          Draw(x, y, x & (BLOCK_SIZE - 1), y & (BLOCK_SIZE - 1));
+          PrepareBlock(tri, x, y);
+          Draw(tri, unit, x, y, x & (BLOCK_SIZE - 1), y & (BLOCK_SIZE - 1));
 
           if (x >= BoundingBox::coords[BoundingBox::LEFT])
             break;
@@ -612,8 +812,8 @@ void DrawTriangleFrontFace(OutputVertexData *v0, OutputVertexData *v1, OutputVer
         if (CX1 > 0 && CX2 > 0 && CX3 > 0)
         {
           // Build the new raster block every other pixel
-          PrepareBlock(x, y);
-          Draw(x, y, x & (BLOCK_SIZE - 1), y & (BLOCK_SIZE - 1));
+          PrepareBlock(tri, x, y);
+          Draw(tri, unit, x, y, x & (BLOCK_SIZE - 1), y & (BLOCK_SIZE - 1));
 
           if (y <= BoundingBox::coords[BoundingBox::BOTTOM])
             break;
@@ -653,8 +853,8 @@ void DrawTriangleFrontFace(OutputVertexData *v0, OutputVertexData *v1, OutputVer
         if (CY1 > 0 && CY2 > 0 && CY3 > 0)
         {
           // Build the new raster block every other pixel
-          PrepareBlock(x, y);
-          Draw(x, y, x & (BLOCK_SIZE - 1), y & (BLOCK_SIZE - 1));
+          PrepareBlock(tri, x, y);
+          Draw(tri, unit, x, y, x & (BLOCK_SIZE - 1), y & (BLOCK_SIZE - 1));
 
           if (x <= BoundingBox::coords[BoundingBox::RIGHT])
             break;
@@ -669,6 +869,8 @@ void DrawTriangleFrontFace(OutputVertexData *v0, OutputVertexData *v1, OutputVer
       CX2 += FDY23;
       CX3 += FDY31;
     }
+
+    AddCounters(unit.tev.Counters);
   }
 }
 
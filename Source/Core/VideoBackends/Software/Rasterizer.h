@@ -14,6 +14,11 @@ void Init();
 
 void DrawTriangleFrontFace(OutputVertexData *v0, OutputVertexData *v1, OutputVertexData *v2);
 
+// With the tiled rasterizer, triangles are only set up by DrawTriangleFrontFace and binned
+// into screen tiles. Flush draws the tiles on the thread pool and waits for them, it has to be
+// called before the render state or the EFB change.
+void Flush();
+
 void SetScissor();
 
 void SetTevReg(int reg, int comp, bool konst, s16 color);
@@ -24,7 +29,7 @@ struct Slope
   float dfdy;
   float f0;
 
-  float GetValue(float dx, float dy)
+  float GetValue(float dx, float dy) const
   {
     return f0 + (dfdx * dx) + (dfdy * dy);
   }
@@ -12,22 +12,28 @@
 
 std::unique_ptr<SWOGLWindow> SWOGLWindow::s_instance;
 
-void SWOGLWindow::Init(void *window_handle)
+void SWOGLWindow::Init(void *window_handle, bool headless)
 {
+  s_instance.reset(new SWOGLWindow());
+  s_instance->m_headless = headless;
+  if (headless)
+    return;
+
   InitInterface();
   GLInterface->SetMode(GLInterfaceMode::MODE_DETECT);
   if (!GLInterface->Create(window_handle))
   {
     INFO_LOG(VIDEO, "GLInterface::Create failed.");
   }
-
-  s_instance.reset(new SWOGLWindow());
 }
 
 void SWOGLWindow::Shutdown()
 {
-  GLInterface->Shutdown();
-  GLInterface.reset();
+  if (GLInterface)
+  {
+    GLInterface->Shutdown();
+    GLInterface.reset();
+  }
 
   s_instance.reset();
 }
@@ -94,6 +100,12 @@ void SWOGLWindow::PrintText(const std::string& text, int x, int y, u32 color)
 
 void SWOGLWindow::ShowImage(u8* data, int stride, int width, int height, float aspect)
 {
+  if (m_headless)
+  {
+    m_text.clear();
+    return;
+  }
+
   GLInterface->MakeCurrent();
   GLInterface->Update();
   Prepare();
@@ -126,6 +138,8 @@ void SWOGLWindow::ShowImage(u8* data, int stride, int width, int height, float a
 
 int SWOGLWindow::PeekMessages()
 {
+  if (m_headless)
+    return 0;
   return GLInterface->PeekMessages();
 }
 
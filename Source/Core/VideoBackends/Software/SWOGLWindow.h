@@ -13,7 +13,8 @@
 class SWOGLWindow
 {
 public:
-  static void Init(void* window_handle);
+  // A headless window doesn't create a GL context and drops the images.
+  static void Init(void* window_handle, bool headless = false);
   static void Shutdown();
 
   // Will be printed on the *next* image
@@ -41,6 +42,7 @@ private:
   std::vector<TextData> m_text;
 
   bool m_init{ false };
+  bool m_headless{ false };
 
   u32 m_image_program, m_image_texture, m_image_vao;
 };
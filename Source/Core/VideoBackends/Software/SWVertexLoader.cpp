@@ -134,6 +134,9 @@ void SWVertexLoader::vFlush(bool useDstAlpha)
     INCSTAT(stats.thisFrame.numVerticesLoaded)
   }
 
+  // The render state may change after the flush
+  Rasterizer::Flush();
+
   DebugUtil::OnObjectEnd();
 }
 
@@ -213,8 +216,6 @@ static void ReadVertexAttribute(T* dst, DataReader src, const AttributeFormat& f
         dst[i_dst] = ReadNormalized<T, float>(src.Read<float, swap>());
         break;
       }
-
-      ASSERT_MSG(VIDEO, format.type != FORMAT_FLOAT, "only non-float values are allowed to be streamed as integer");
     }
     for (; i < components; i++)
     {
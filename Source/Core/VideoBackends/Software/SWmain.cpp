@@ -25,6 +25,7 @@
 
 #include "VideoCommon/BPStructs.h"
 #include "VideoCommon/CommandProcessor.h"
+#include "VideoCommon/DLCache.h"
 #include "VideoCommon/Fifo.h"
 #include "VideoCommon/FramebufferManagerBase.h"
 #include "VideoCommon/IndexGenerator.h"
@@ -33,6 +34,7 @@
 #include "VideoCommon/PixelEngine.h"
 #include "VideoCommon/PixelShaderManager.h"
 #include "VideoCommon/TextureCacheBase.h"
+#include "VideoCommon/VertexCache.h"
 #include "VideoCommon/VertexLoaderManager.h"
 #include "VideoCommon/VertexShaderManager.h"
 #include "VideoCommon/VideoConfig.h"
@@ -148,6 +150,7 @@ void VideoSoftware::InitBackendInfo()
   g_Config.backend_info.bSupportsDualSourceBlend = true;
   g_Config.backend_info.bSupportsEarlyZ = true;
   g_Config.backend_info.bSupportsOversizedViewports = true;
+  g_Config.backend_info.bSupportsPrimitiveRestart = false;
 
   // aamodes
   g_Config.backend_info.AAModes = { 1 };
@@ -162,43 +165,31 @@ bool VideoSoftware::Initialize(void *window_handle)
   g_Config.UpdateProjectionHack();
   UpdateActiveConfig();
 
-  SWOGLWindow::Init(window_handle);
+  SWOGLWindow::Init(window_handle, m_headless);
 
-  PixelEngine::Init();
   Clipper::Init();
   Rasterizer::Init();
-  g_renderer->Init();
   DebugUtil::Init();
 
-  // Do our OSD callbacks
-  OSD::DoCallbacks(OSD::CallbackType::Initialization);
-
-  m_initialized = true;
-
   return true;
 }
 
 void VideoSoftware::Shutdown()
 {
-  m_initialized = false;
-
-  // Do our OSD callbacks
-  OSD::DoCallbacks(OSD::CallbackType::Shutdown);
-
   SWOGLWindow::Shutdown();
+
+  ShutdownShared();
 }
 
 void VideoSoftware::Video_Cleanup()
 {
   if (g_renderer)
   {
-    Fifo::Shutdown();
-    g_renderer->Shutdown();
-    DebugUtil::Shutdown();
     // The following calls are NOT Thread Safe
     // And need to be called from the video thread
+    CleanupShared();
     g_renderer->Shutdown();
-    VertexLoaderManager::Shutdown();
+    DebugUtil::Shutdown();
     g_framebuffer_manager.reset();
     g_texture_cache.reset();
     g_perf_query.reset();
@@ -211,26 +202,12 @@ void VideoSoftware::Video_Cleanup()
 void VideoSoftware::Video_Prepare()
 {
   g_renderer = std::make_unique<SWRenderer>();
-
-  CommandProcessor::Init();
-  PixelEngine::Init();
-
-  BPInit();
   g_vertex_manager = std::make_unique<SWVertexLoader>();
   g_perf_query = std::make_unique<PerfQuery>();
-  Fifo::Init(); // must be done before OpcodeDecoder_Init()
-  OpcodeDecoder::Init();
-  IndexGenerator::Init();
-  VertexShaderManager::Init();
-  PixelShaderManager::Init(true);
   g_texture_cache = std::make_unique<TextureCache>();
   g_renderer->Init();
-  VertexLoaderManager::Init();
   g_framebuffer_manager = std::make_unique<FramebufferManager>();
 
-  // Notify the core that the video backend is ready
-  Host_Message(WM_USER_CREATE);
-
   INFO_LOG(VIDEO, "Video backend initialized.");
 }
 
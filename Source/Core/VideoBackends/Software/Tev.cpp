@@ -2,7 +2,9 @@
 // Licensed under GPLv2+
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 
 #include "Common/ChunkFile.h"
 #include "Common/CommonTypes.h"
@@ -13,7 +15,6 @@
 
 #include "VideoCommon/BoundingBox.h"
 #include "VideoCommon/PerfQueryBase.h"
-#include "VideoCommon/Statistics.h"
 #include "VideoCommon/VideoConfig.h"
 #include "VideoCommon/XFMemory.h"
 
@@ -23,8 +24,23 @@
 #define ALLOW_TEV_DUMPS 0
 #endif
 
+void TevCounters::Reset()
+{
+  rasterizedPixels = 0;
+  tevPixelsIn = 0;
+  tevPixelsOut = 0;
+  for (u32& count : perfPixels)
+    count = 0;
+  bbox[BoundingBox::LEFT] = 0xFFFF;
+  bbox[BoundingBox::RIGHT] = 0;
+  bbox[BoundingBox::TOP] = 0xFFFF;
+  bbox[BoundingBox::BOTTOM] = 0;
+}
+
 void Tev::Init()
 {
+  Counters.Reset();
+
   FixedConstants[0] = 0;
   FixedConstants[1] = 32;
   FixedConstants[2] = 64;
@@ -511,7 +527,15 @@ void Tev::Draw()
   ASSERT(Position[0] >= 0 && Position[0] < EFB_WIDTH);
   ASSERT(Position[1] >= 0 && Position[1] < EFB_HEIGHT);
 
-  INCSTAT(stats.thisFrame.tevPixelsIn);
+  Counters.tevPixelsIn++;
+
+  // Nothing carries over from the previous pixel, every pixel starts with the registers set by
+  // the game like the pixel shaders do. This keeps the output independent of the drawing order.
+  memcpy(Reg, InitialReg, sizeof(Reg));
+  memset(TexColor, 0, sizeof(TexColor));
+  memset(IndirectTex, 0, sizeof(IndirectTex));
+  TexCoord.s = 0;
+  TexCoord.t = 0;
 
   for (unsigned int stageNum = 0; stageNum < bpmem.genMode.numindstages.Value(); stageNum++)
   {
@@ -763,19 +787,22 @@ void Tev::Draw()
     if (late_ztest && bpmem.zmode.testenable)
     {
       // TODO: Check against hw if these values get incremented even if depth testing is disabled
-      EfbInterface::IncPerfCounterQuadCount(PQ_ZCOMP_INPUT);
+      Counters.perfPixels[PQ_ZCOMP_INPUT]++;
 
       if (!EfbInterface::ZCompare(Position[0], Position[1], Position[2]))
         return;
 
-      EfbInterface::IncPerfCounterQuadCount(PQ_ZCOMP_OUTPUT);
+      Counters.perfPixels[PQ_ZCOMP_OUTPUT]++;
     }
   }
   // branchless bounding box update
-  BoundingBox::coords[BoundingBox::LEFT] = std::min((u16)Position[0], BoundingBox::coords[BoundingBox::LEFT]);
-  BoundingBox::coords[BoundingBox::RIGHT] = std::max((u16)Position[0], BoundingBox::coords[BoundingBox::RIGHT]);
-  BoundingBox::coords[BoundingBox::TOP] = std::min((u16)Position[1], BoundingBox::coords[BoundingBox::TOP]);
-  BoundingBox::coords[BoundingBox::BOTTOM] = std::max((u16)Position[1], BoundingBox::coords[BoundingBox::BOTTOM]);
+  // the bounding box pass of the rasterizer stops as soon as the global box grows, so it is
+  // updated right away there
+  u16* bbox = BoundingBox::active ? BoundingBox::coords : Counters.bbox;
+  bbox[BoundingBox::LEFT] = std::min((u16)Position[0], bbox[BoundingBox::LEFT]);
+  bbox[BoundingBox::RIGHT] = std::max((u16)Position[0], bbox[BoundingBox::RIGHT]);
+  bbox[BoundingBox::TOP] = std::min((u16)Position[1], bbox[BoundingBox::TOP]);
+  bbox[BoundingBox::BOTTOM] = std::max((u16)Position[1], bbox[BoundingBox::BOTTOM]);
 
   // if we are only calculating the bounding box,
   // there's no need to actually draw anything
@@ -802,8 +829,8 @@ void Tev::Draw()
   }
 #endif
 
-  INCSTAT(stats.thisFrame.tevPixelsOut);
-  EfbInterface::IncPerfCounterQuadCount(PQ_BLEND_INPUT);
+  Counters.tevPixelsOut++;
+  Counters.perfPixels[PQ_BLEND_INPUT]++;
 
   EfbInterface::BlendTev(Position[0], Position[1], output);
 }
@@ -816,7 +843,7 @@ void Tev::SetRegColor(int reg, int comp, bool konst, s16 color)
   }
   else
   {
-    Reg[reg][comp] = color;
+    InitialReg[reg][comp] = color;
   }
 }
 
@@ -5,6 +5,21 @@
 #pragma once
 
 #include "VideoCommon/BPMemory.h"
+#include "VideoCommon/PerfQueryBase.h"
+
+// Statistics, performance counters and bounding box of the pixels drawn by a Tev unit.
+// Every unit counts its own pixels so several of them can draw at the same time, the
+// rasterizer adds them to the global state afterwards.
+struct TevCounters
+{
+  u32 rasterizedPixels;
+  u32 tevPixelsIn;
+  u32 tevPixelsOut;
+  u32 perfPixels[PQ_NUM_MEMBERS];
+  u16 bbox[4];
+
+  void Reset();
+};
 
 class Tev
 {
@@ -24,6 +39,8 @@ class Tev
 
   // color order: ABGR
   s16 Reg[4][4];
+  // Register values set by the game, every pixel starts with them
+  s16 InitialReg[4][4];
   s16 KonstantColors[4][4];
   s16 TexColor[4];
   s16 RasColor[4];
@@ -74,6 +91,7 @@ public:
   bool IndirectLinear[4];
   s32 TextureLod[16];
   bool TextureLinear[16];
+  TevCounters Counters;
 
   enum
   {
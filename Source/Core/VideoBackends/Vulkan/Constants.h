@@ -127,6 +127,12 @@ constexpr u32 MINIMUM_DRAW_CALLS_PER_COMMAND_BUFFER_FOR_READBACK = 10;
 /// Multisampling state info that we don't expose in VideoCommon.
 union MultisamplingState
 {
+  MultisamplingState& operator=(const MultisamplingState& rhs)
+  {
+    hex = rhs.hex;
+    return *this;
+  }
+
   BitField<0, 1, u32> per_sample_shading;  // SSAA
   BitField<1, 5, u32> samples;             // 1-16
   u32 hex;
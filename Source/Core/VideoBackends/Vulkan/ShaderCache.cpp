@@ -12,6 +12,7 @@
 
 #include "Common/Assert.h"
 #include "Common/CommonFuncs.h"
+#include "Common/FileUtil.h"
 #include "Common/LinearDiskCache.h"
 #include "Common/MsgHandler.h"
 
@@ -25,6 +26,7 @@
 #include "VideoBackends/Vulkan/VertexFormat.h"
 #include "VideoBackends/Vulkan/VulkanContext.h"
 #include "VideoCommon/GeometryShaderGen.h"
+#include "VideoCommon/ShaderArtifactCache.h"
 #include "VideoCommon/Statistics.h"
 #include "VideoCommon/UberShaderPixel.h"
 #include "VideoCommon/UberShaderVertex.h"
@@ -40,6 +42,7 @@ ShaderCache::ShaderCache()
 
 ShaderCache::~ShaderCache()
 {
+  WaitForBackgroundCompiles();
   DestroyPipelineCache();
   DestroyShaderCaches();
   DestroySharedShaders();
@@ -255,6 +258,13 @@ VkPipeline ShaderCache::CreatePipeline(const PipelineInfo& info)
       VK_FALSE                  // VkBool32                                   primitiveRestartEnable
   };
 
+  // Indexed strips are separated by restart indices, this doesn't affect the non-indexed draws
+  if (info.rasterization_state.primitive == PrimitiveType::TriangleStrip &&
+      g_ActiveConfig.backend_info.bSupportsPrimitiveRestart)
+  {
+    input_assembly_state.primitiveRestartEnable = VK_TRUE;
+  }
+
   // Shaders to stages
   VkPipelineShaderStageCreateInfo shader_stages[3];
   uint32_t num_shader_stages = 0;
@@ -361,17 +371,69 @@ VkPipeline ShaderCache::GetPipeline(const PipelineInfo& info)
   return GetPipelineWithCacheResult(info).first;
 }
 
-std::pair<VkPipeline, bool> ShaderCache::GetPipelineWithCacheResult(const PipelineInfo& info)
+std::pair<VkPipeline, bool> ShaderCache::GetPipelineWithCacheResult(const PipelineInfo& info,
+                                                                    bool async)
 {
+  if (!m_pending_pipelines.empty())
+    ProcessCompletedPipelines();
+
   auto iter = m_pipeline_objects.find(info);
   if (iter != m_pipeline_objects.end())
     return iter->second;
 
+  if (m_pending_pipelines.count(info))
+  {
+    if (async)
+      return { VK_NULL_HANDLE, true };
+    // Requested synchronously while it is compiling in the background
+    while (m_pending_pipelines.count(info))
+    {
+      if (!m_async_compiles.RunQueuedTask())
+        Common::YieldCPU();
+      ProcessCompletedPipelines();
+    }
+    return m_pipeline_objects[info];
+  }
+
+  if (async)
+  {
+    // Too many pipelines in flight, try again on a later draw
+    if (m_pending_pipelines.size() >= MAX_PENDING_PIPELINES)
+      return { VK_NULL_HANDLE, true };
+    m_pending_pipelines.insert(info);
+    m_async_compiles.Run([this, info] {
+      m_completed_pipelines.push(std::make_pair(info, CreatePipeline(info)));
+    });
+    return { VK_NULL_HANDLE, false };
+  }
+
   VkPipeline pipeline = CreatePipeline(info);
   m_pipeline_objects.emplace(info, std::make_pair(pipeline, true));
   return{ pipeline, false };
 }
 
+void ShaderCache::ProcessCompletedPipelines()
+{
+  std::pair<PipelineInfo, VkPipeline> result;
+  while (m_completed_pipelines.try_pop(result))
+  {
+    m_pending_pipelines.erase(result.first);
+    m_pipeline_objects.emplace(result.first, std::make_pair(result.second, true));
+  }
+}
+
+void ShaderCache::WaitForBackgroundCompiles()
+{
+  m_async_compiles.Wait();
+  ProcessCompletedPipelines();
+}
+
+bool ShaderCache::UsingHybridUberShaders()
+{
+  return g_ActiveConfig.backend_info.bSupportsUberShaders &&
+         g_ActiveConfig.bBackgroundShaderCompiling && !g_ActiveConfig.bDisableSpecializedShaders;
+}
+
 VkPipeline ShaderCache::CreateComputePipeline(const ComputePipelineInfo& info)
 {
   VkComputePipelineCreateInfo pipeline_info =
@@ -411,7 +473,7 @@ VkPipeline ShaderCache::GetComputePipeline(const ComputePipelineInfo& info)
 
 void ShaderCache::ClearPipelineCache()
 {
-  // TODO: Stop any async compiling happening.
+  WaitForBackgroundCompiles();
   for (const auto& it : m_pipeline_objects)
   {
     if (it.second.first != VK_NULL_HANDLE)
@@ -671,6 +733,8 @@ void ShaderCache::LoadShaderCaches(bool forcecompile)
     StringFromFormat("%s.ps", SConfig::GetInstance().GetGameID().c_str())
   ));
 
+  m_artifact_cache.Open(File::GetUserPath(D_SHADERCACHE_IDX) + "artifacts.cache");
+
   ShaderUsageCacheReader<VertexShaderUid, VertexShaderUid::ShaderUidHasher> vs_reader(m_vs_cache.shader_map.get());
   m_vs_cache.disk_cache.OpenAndRead(GetDiskShaderCacheFileName(API_VULKAN, "vs", true, true), vs_reader);
 
@@ -799,6 +863,7 @@ void ShaderCache::CompileShaders()
 
 void ShaderCache::Reload()
 {
+  WaitForBackgroundCompiles();
   SavePipelineCache();
   ClearPipelineCache();
   DestroyShaderCaches();
@@ -852,6 +917,7 @@ void ShaderCache::DestroyShaderCaches()
 
   DestroyShaderCache(m_vus_cache);
   DestroyShaderCache(m_pus_cache);
+  m_artifact_cache.Close();
 
   SETSTAT(stats.numPixelShadersCreated, 0);
   SETSTAT(stats.numPixelShadersAlive, 0);
@@ -864,24 +930,27 @@ void ShaderCache::CompileVertexShaderForUid(const VertexShaderUid& uid, ShaderCa
   // Not in the cache, so compile the shader.
   ShaderCompiler::SPIRVCodeVector spv;
   VkShaderModule module = VK_NULL_HANDLE;
-  ShaderCode source_code;
-  GenerateVertexShaderCode(source_code, uid.GetUidData(), ShaderHostConfig::GetCurrent());
-  if (ShaderCompiler::CompileVertexShader(&spv, source_code.data(),
-    source_code.size()))
+  if (m_artifact_cache.GetOrCompileSPIRV(
+          ShaderArtifactCache::STAGE_VERTEX, API_VULKAN, VERTEXSHADERGEN_UID_VERSION, uid,
+          [&](ShaderCode& code, const ShaderHostConfig& host_config) {
+            GenerateVertexShaderCode(code, uid.GetUidData(), host_config);
+          },
+          ShaderCompiler::CompileVertexShader, &spv))
   {
     module = Util::CreateShaderModule(spv.data(), spv.size());
 
     // Append to shader cache if it created successfully.
     if (module != VK_NULL_HANDLE)
     {
+      std::lock_guard<std::mutex> guard(m_disk_cache_lock);
       m_vs_cache.disk_cache.Append(uid, spv.data(), static_cast<u32>(spv.size()));
       INCSTAT(stats.numVertexShadersCreated);
       INCSTAT(stats.numVertexShadersAlive);
     }
   }
-  it.compiled = true;
   // We still insert null entries to prevent further compilation attempts.
   it.module = module;
+  it.compiled.store(true);
 }
 
 void ShaderCache::CompileVertexUberShaderForUid(const UberShader::VertexUberShaderUid& uid, ShaderCache::vkShaderItem& it)
@@ -889,22 +958,25 @@ void ShaderCache::CompileVertexUberShaderForUid(const UberShader::VertexUberShad
   // Not in the cache, so compile the shader.
   ShaderCompiler::SPIRVCodeVector spv;
   VkShaderModule module = VK_NULL_HANDLE;
-  ShaderCode source_code;
-  UberShader::GenVertexShader(source_code, API_VULKAN, ShaderHostConfig::GetCurrent(), uid.GetUidData());
-  if (ShaderCompiler::CompileVertexShader(&spv, source_code.data(),
-    source_code.size()))
+  if (m_artifact_cache.GetOrCompileSPIRV(
+          ShaderArtifactCache::STAGE_VERTEX_UBER, API_VULKAN, VERTEXUBERSHADERGEN_UID_VERSION, uid,
+          [&](ShaderCode& code, const ShaderHostConfig& host_config) {
+            UberShader::GenVertexShader(code, API_VULKAN, host_config, uid.GetUidData());
+          },
+          ShaderCompiler::CompileVertexShader, &spv))
   {
     module = Util::CreateShaderModule(spv.data(), spv.size());
 
     // Append to shader cache if it created successfully.
     if (module != VK_NULL_HANDLE)
     {
+      std::lock_guard<std::mutex> guard(m_disk_cache_lock);
       m_vus_cache.disk_cache.Append(uid, spv.data(), static_cast<u32>(spv.size()));
     }
   }
-  it.compiled = true;
   // We still insert null entries to prevent further compilation attempts.
   it.module = module;
+  it.compiled.store(true);
 }
 
 void ShaderCache::CompileGeometryShaderForUid(const GeometryShaderUid& uid, ShaderCache::vkShaderItem& it)
@@ -912,20 +984,25 @@ void ShaderCache::CompileGeometryShaderForUid(const GeometryShaderUid& uid, Shad
   // Not in the cache, so compile the shader.
   ShaderCompiler::SPIRVCodeVector spv;
   VkShaderModule module = VK_NULL_HANDLE;
-  ShaderCode source_code;
-  GenerateGeometryShaderCode(source_code, uid.GetUidData(), ShaderHostConfig::GetCurrent());
-  if (ShaderCompiler::CompileGeometryShader(&spv, source_code.data(),
-    source_code.size()))
+  if (m_artifact_cache.GetOrCompileSPIRV(
+          ShaderArtifactCache::STAGE_GEOMETRY, API_VULKAN, GEOMETRYSHADERGEN_UID_VERSION, uid,
+          [&](ShaderCode& code, const ShaderHostConfig& host_config) {
+            GenerateGeometryShaderCode(code, uid.GetUidData(), host_config);
+          },
+          ShaderCompiler::CompileGeometryShader, &spv))
   {
     module = Util::CreateShaderModule(spv.data(), spv.size());
 
     // Append to shader cache if it created successfully.
     if (module != VK_NULL_HANDLE)
+    {
+      std::lock_guard<std::mutex> guard(m_disk_cache_lock);
       m_gs_cache.disk_cache.Append(uid, spv.data(), static_cast<u32>(spv.size()));
+    }
   }
-  it.compiled = true;
   // We still insert null entries to prevent further compilation attempts.
   it.module = module;
+  it.compiled.store(true);
 }
 
 void ShaderCache::CompilePixelShaderForUid(const PixelShaderUid& uid, ShaderCache::vkShaderItem& it)
@@ -933,24 +1010,27 @@ void ShaderCache::CompilePixelShaderForUid(const PixelShaderUid& uid, ShaderCach
   // Not in the cache, so compile the shader.
   ShaderCompiler::SPIRVCodeVector spv;
   VkShaderModule module = VK_NULL_HANDLE;
-  ShaderCode source_code;
-  GeneratePixelShaderCode(source_code, uid.GetUidData(), ShaderHostConfig::GetCurrent());
-  if (ShaderCompiler::CompileFragmentShader(&spv, source_code.data(),
-    source_code.size()))
+  if (m_artifact_cache.GetOrCompileSPIRV(
+          ShaderArtifactCache::STAGE_PIXEL, API_VULKAN, PIXELSHADERGEN_UID_VERSION, uid,
+          [&](ShaderCode& code, const ShaderHostConfig& host_config) {
+            GeneratePixelShaderCode(code, uid.GetUidData(), host_config);
+          },
+          ShaderCompiler::CompileFragmentShader, &spv))
   {
     module = Util::CreateShaderModule(spv.data(), spv.size());
 
     // Append to shader cache if it created successfully.
     if (module != VK_NULL_HANDLE)
     {
+      std::lock_guard<std::mutex> guard(m_disk_cache_lock);
       m_ps_cache.disk_cache.Append(uid, spv.data(), static_cast<u32>(spv.size()));
       INCSTAT(stats.numPixelShadersCreated);
       INCSTAT(stats.numPixelShadersAlive);
     }
   }
-  it.compiled = true;
   // We still insert null entries to prevent further compilation attempts.
   it.module = module;
+  it.compiled.store(true);
 }
 
 void ShaderCache::CompilePixelUberShaderForUid(const UberShader::PixelUberShaderUid& uid, ShaderCache::vkShaderItem& it)
@@ -958,32 +1038,55 @@ void ShaderCache::CompilePixelUberShaderForUid(const UberShader::PixelUberShader
   // Not in the cache, so compile the shader.
   ShaderCompiler::SPIRVCodeVector spv;
   VkShaderModule module = VK_NULL_HANDLE;
-  ShaderCode source_code;
-  UberShader::GenPixelShader(source_code, API_VULKAN, ShaderHostConfig::GetCurrent(), uid.GetUidData());
-  if (ShaderCompiler::CompileFragmentShader(&spv, source_code.data(),
-    source_code.size()))
+  if (m_artifact_cache.GetOrCompileSPIRV(
+          ShaderArtifactCache::STAGE_PIXEL_UBER, API_VULKAN, PIXELUBERSHADERGEN_UID_VERSION, uid,
+          [&](ShaderCode& code, const ShaderHostConfig& host_config) {
+            UberShader::GenPixelShader(code, API_VULKAN, host_config, uid.GetUidData());
+          },
+          ShaderCompiler::CompileFragmentShader, &spv))
   {
     module = Util::CreateShaderModule(spv.data(), spv.size());
 
     // Append to shader cache if it created successfully.
     if (module != VK_NULL_HANDLE)
     {
+      std::lock_guard<std::mutex> guard(m_disk_cache_lock);
       m_pus_cache.disk_cache.Append(uid, spv.data(), static_cast<u32>(spv.size()));
       INCSTAT(stats.numPixelShadersCreated);
       INCSTAT(stats.numPixelShadersAlive);
     }
   }
-  it.compiled = true;
   // We still insert null entries to prevent further compilation attempts.
   it.module = module;
+  it.compiled.store(true);
+}
+
+VkShaderModule ShaderCache::GetCompiledModule(vkShaderItem& it, bool async)
+{
+  // The shader may still be compiling in the background
+  while (!it.compiled.load())
+  {
+    if (async)
+      return VK_NULL_HANDLE;
+    if (!m_async_compiles.RunQueuedTask())
+      Common::YieldCPU();
+  }
+  return it.module;
 }
 
-VkShaderModule ShaderCache::GetVertexShaderForUid(const VertexShaderUid& uid)
+VkShaderModule ShaderCache::GetVertexShaderForUid(const VertexShaderUid& uid, bool async)
 {
   vkShaderItem& it = m_vs_cache.shader_map->GetOrAdd(uid);
   if (it.initialized.test_and_set())
-    return it.module;
+    return GetCompiledModule(it, async);
 
+  if (async)
+  {
+    // The map never moves its items, so the reference stays valid until the caches are
+    // destroyed, which waits for the background compiles first.
+    m_async_compiles.Run([this, uid, &it] { CompileVertexShaderForUid(uid, it); });
+    return VK_NULL_HANDLE;
+  }
   CompileVertexShaderForUid(uid, it);
   return it.module;
 }
@@ -999,12 +1102,17 @@ VkShaderModule ShaderCache::GetGeometryShaderForUid(const GeometryShaderUid& uid
   return it.module;
 }
 
-VkShaderModule ShaderCache::GetPixelShaderForUid(const PixelShaderUid& uid)
+VkShaderModule ShaderCache::GetPixelShaderForUid(const PixelShaderUid& uid, bool async)
 {
   vkShaderItem& it = m_ps_cache.shader_map->GetOrAdd(uid);
   if (it.initialized.test_and_set())
-    return it.module;
+    return GetCompiledModule(it, async);
 
+  if (async)
+  {
+    m_async_compiles.Run([this, uid, &it] { CompilePixelShaderForUid(uid, it); });
+    return VK_NULL_HANDLE;
+  }
   CompilePixelShaderForUid(uid, it);
   return it.module;
 }
@@ -8,12 +8,15 @@
 #include <cstddef>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 
 #include "Common/CommonTypes.h"
 #include "Common/LinearDiskCache.h"
+#include "Common/ThreadPool.h"
 
 #include "VideoBackends/Vulkan/Constants.h"
 #include "VideoBackends/Vulkan/ObjectCache.h"
@@ -23,6 +26,7 @@
 #include "VideoCommon/ObjectUsageProfiler.h"
 #include "VideoCommon/PixelShaderGen.h"
 #include "VideoCommon/RenderState.h"
+#include "VideoCommon/ShaderArtifactCache.h"
 #include "VideoCommon/UberShaderPixel.h"
 #include "VideoCommon/UberShaderVertex.h"
 #include "VideoCommon/VertexShaderGen.h"
@@ -132,10 +136,15 @@ public:
   // Get utility shader header based on current config.
   std::string GetUtilityShaderHeader() const;
 
-  // Accesses ShaderGen shader caches
-  VkShaderModule GetVertexShaderForUid(const VertexShaderUid& uid);
+  // Hybrid ubershader mode: specialized shaders and pipelines are compiled on the thread pool,
+  // draws use the ubershaders until they are ready.
+  static bool UsingHybridUberShaders();
+
+  // Accesses ShaderGen shader caches. With async set, a shader that is not compiled yet is queued
+  // for background compilation and VK_NULL_HANDLE is returned until it is done.
+  VkShaderModule GetVertexShaderForUid(const VertexShaderUid& uid, bool async = false);
   VkShaderModule GetGeometryShaderForUid(const GeometryShaderUid& uid);
-  VkShaderModule GetPixelShaderForUid(const PixelShaderUid& uid);
+  VkShaderModule GetPixelShaderForUid(const PixelShaderUid& uid, bool async = false);
 
   // Ubershader caches
   VkShaderModule GetVertexUberShaderForUid(const UberShader::VertexUberShaderUid& uid);
@@ -154,8 +163,10 @@ public:
 
   // Find a pipeline by the specified description, if not found, attempts to create it. If this
   // resulted in a pipeline being created, the second field of the return value will be false,
-  // otherwise for a cache hit it will be true.
-  std::pair<VkPipeline, bool> GetPipelineWithCacheResult(const PipelineInfo& info);
+  // otherwise for a cache hit it will be true. With async set, new pipelines are created on the
+  // thread pool and VK_NULL_HANDLE is returned until they are ready.
+  std::pair<VkPipeline, bool> GetPipelineWithCacheResult(const PipelineInfo& info,
+                                                         bool async = false);
   
   // Creates a compute pipeline, and does not track the handle.
   VkPipeline CreateComputePipeline(const ComputePipelineInfo& info);
@@ -188,7 +199,8 @@ public:
   class vkShaderItem
   {
   public:
-    bool compiled{};
+    // Set once module is valid, the compilation may run on another thread.
+    std::atomic<bool> compiled{ false };
     std::atomic_flag initialized{};
     VkShaderModule module = VK_NULL_HANDLE;
     vkShaderItem() {}
@@ -205,7 +217,11 @@ private:
   bool CompileSharedShaders();
   void DestroySharedShaders();
 
-  
+  // Waits until no shader or pipeline compiles are running in the background and moves the
+  // finished pipelines into the pipeline map.
+  void WaitForBackgroundCompiles();
+  void ProcessCompletedPipelines();
+  VkShaderModule GetCompiledModule(vkShaderItem& it, bool async);
 
   template <typename Uid, typename UidHasher>
   class ShaderUsageModuleCache
@@ -234,6 +250,8 @@ private:
   using PUShaderCache = ShaderModuleCache<UberShader::PixelUberShaderUid, UberShader::PixelUberShaderUid::ShaderUidHasher>;
 
 
+  // Generated source and SPIR-V shared by all games
+  ShaderArtifactCache m_artifact_cache;
   VShaderCache m_vs_cache;
   GShaderCache m_gs_cache;
   PShaderCache m_ps_cache;
@@ -251,6 +269,16 @@ private:
       m_pipeline_objects;
   std::unordered_map<ComputePipelineInfo, VkPipeline, ComputePipelineInfoHash>
       m_compute_pipeline_objects;
+
+  // Background compilation. The number of pipelines in flight is limited to the capacity of
+  // the completion queue, so the workers never wait for the GPU thread.
+  static constexpr size_t MAX_PENDING_PIPELINES = 256;
+  Common::TaskGroup m_async_compiles;
+  std::unordered_set<PipelineInfo, PipelineInfoHash> m_pending_pipelines;
+  Common::ManyToOneQueue<std::pair<PipelineInfo, VkPipeline>> m_completed_pipelines{
+      MAX_PENDING_PIPELINES };
+  // Guards the disk caches and statistics against the background compiles
+  std::mutex m_disk_cache_lock;
   VkPipelineCache m_pipeline_cache = VK_NULL_HANDLE;
   std::string m_pipeline_cache_filename;
 
@@ -295,20 +295,19 @@ void CopyGLSLToSPVVector(SPIRVCodeVector* out_code, const char* stage_filename,
 
 bool InitializeGlslang()
 {
-  static bool glslang_initialized = false;
-  if (glslang_initialized)
-    return true;
-
-  if (!glslang::InitializeProcess())
-  {
-    PanicAlert("Failed to initialize glslang shader compiler");
-    return false;
-  }
-
-  std::atexit([]() { glslang::FinalizeProcess(); });
+  // Shaders are compiled on the thread pool too, the static initialization makes sure only the
+  // first caller initializes glslang.
+  static const bool glslang_initialized = [] {
+    if (!glslang::InitializeProcess())
+    {
+      PanicAlert("Failed to initialize glslang shader compiler");
+      return false;
+    }
 
-  glslang_initialized = true;
-  return true;
+    std::atexit([]() { glslang::FinalizeProcess(); });
+    return true;
+  }();
+  return glslang_initialized;
 }
 
 const TBuiltInResource* GetCompilerResourceLimits()
@@ -411,10 +410,16 @@ const TBuiltInResource* GetCompilerResourceLimits()
   return &limits;
 }
 
+// Shaders compiled without a device, e.g. by offline tools, are always SPIR-V
+static bool UseNVGLSLExtension()
+{
+  return g_vulkan_context && g_vulkan_context->SupportsNVGLSLExtension();
+}
+
 bool CompileVertexShader(SPIRVCodeVector* out_code, const char* source_code,
   size_t source_code_length)
 {
-  if (g_vulkan_context->SupportsNVGLSLExtension())
+  if (UseNVGLSLExtension())
   {
     CopyGLSLToSPVVector(out_code, "vs", source_code, source_code_length, SHADER_HEADER,
       sizeof(SHADER_HEADER) - 1);
@@ -428,7 +433,7 @@ bool CompileVertexShader(SPIRVCodeVector* out_code, const char* source_code,
 bool CompileGeometryShader(SPIRVCodeVector* out_code, const char* source_code,
   size_t source_code_length)
 {
-  if (g_vulkan_context->SupportsNVGLSLExtension())
+  if (UseNVGLSLExtension())
   {
     CopyGLSLToSPVVector(out_code, "gs", source_code, source_code_length, SHADER_HEADER,
       sizeof(SHADER_HEADER) - 1);
@@ -442,7 +447,7 @@ bool CompileGeometryShader(SPIRVCodeVector* out_code, const char* source_code,
 bool CompileFragmentShader(SPIRVCodeVector* out_code, const char* source_code,
   size_t source_code_length)
 {
-  if (g_vulkan_context->SupportsNVGLSLExtension())
+  if (UseNVGLSLExtension())
   {
     CopyGLSLToSPVVector(out_code, "ps", source_code, source_code_length, SHADER_HEADER,
       sizeof(SHADER_HEADER) - 1);
@@ -456,7 +461,7 @@ bool CompileFragmentShader(SPIRVCodeVector* out_code, const char* source_code,
 bool CompileComputeShader(SPIRVCodeVector* out_code, const char* source_code,
   size_t source_code_length)
 {
-  if (g_vulkan_context->SupportsNVGLSLExtension())
+  if (UseNVGLSLExtension())
   {
     CopyGLSLToSPVVector(out_code, "cs", source_code, source_code_length, COMPUTE_SHADER_HEADER,
       sizeof(COMPUTE_SHADER_HEADER) - 1);
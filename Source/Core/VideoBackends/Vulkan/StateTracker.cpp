@@ -109,6 +109,10 @@ void StateTracker::InvalidateShaderPointers()
   m_pipeline_state.vs = VK_NULL_HANDLE;
   m_pipeline_state.gs = VK_NULL_HANDLE;
   m_pipeline_state.ps = VK_NULL_HANDLE;
+  m_specialized_vs = VK_NULL_HANDLE;
+  m_specialized_ps = VK_NULL_HANDLE;
+  m_uber_vs = VK_NULL_HANDLE;
+  m_uber_ps = VK_NULL_HANDLE;
 }
 
 void StateTracker::ReloadPipelineUIDCache()
@@ -178,7 +182,7 @@ void StateTracker::AppendToUberPipelineUIDCache(const PipelineInfo& info)
   sinfo.blend_state_bits = info.blend_state.hex;
   sinfo.rasterizer_state_bits = info.rasterization_state.hex;
   sinfo.depth_state_bits = info.depth_state.hex;
-  sinfo.vertex_decl = m_pipeline_state.vertex_format->GetVertexDeclaration();
+  sinfo.vertex_decl = info.vertex_format->GetVertexDeclaration();
   sinfo.vs_uid = m_uber_vs_uid;
   sinfo.gs_uid = m_gs_uid;
   sinfo.ps_uid = m_uber_ps_uid;
@@ -193,7 +197,7 @@ void StateTracker::AppendToPipelineUIDCache(const PipelineInfo& info)
   sinfo.blend_state_bits = info.blend_state.hex;
   sinfo.rasterizer_state_bits = info.rasterization_state.hex;
   sinfo.depth_state_bits = info.depth_state.hex;
-  sinfo.vertex_decl = m_pipeline_state.vertex_format->GetVertexDeclaration();
+  sinfo.vertex_decl = info.vertex_format->GetVertexDeclaration();
   sinfo.vs_uid = m_vs_uid;
   sinfo.gs_uid = m_gs_uid;
   sinfo.ps_uid = m_ps_uid;
@@ -412,19 +416,21 @@ bool StateTracker::CheckForShaderChanges(PrimitiveType gx_primitive_type, u32 co
   GetPixelShaderUID(ps_uid, dstalpha_mode, components, xfmem, bpmem);
 
   bool changed = false;
-  bool use_ubershaders = g_ActiveConfig.bDisableSpecializedShaders;
-  if (!use_ubershaders)
+  const bool exclusive_ubershaders = g_ActiveConfig.bDisableSpecializedShaders;
+  m_hybrid_ubershaders = !exclusive_ubershaders && ShaderCache::UsingHybridUberShaders();
+  if (!exclusive_ubershaders)
   {
-    if (vs_uid != m_vs_uid)
+    // In hybrid mode shaders which are still compiling are looked up again on every draw
+    if (vs_uid != m_vs_uid || (m_hybrid_ubershaders && m_specialized_vs == VK_NULL_HANDLE))
     {
-      m_pipeline_state.vs = g_shader_cache->GetVertexShaderForUid(vs_uid);
+      m_specialized_vs = g_shader_cache->GetVertexShaderForUid(vs_uid, m_hybrid_ubershaders);
       m_vs_uid = vs_uid;
       changed = true;
     }
 
-    if (ps_uid != m_ps_uid)
+    if (ps_uid != m_ps_uid || (m_hybrid_ubershaders && m_specialized_ps == VK_NULL_HANDLE))
     {
-      m_pipeline_state.ps = g_shader_cache->GetPixelShaderForUid(ps_uid);
+      m_specialized_ps = g_shader_cache->GetPixelShaderForUid(ps_uid, m_hybrid_ubershaders);
       m_ps_uid = ps_uid;
       changed = true;
     }
@@ -457,41 +463,64 @@ bool StateTracker::CheckForShaderChanges(PrimitiveType gx_primitive_type, u32 co
     m_dstalpha_mode = dstalpha_mode;
   }
 
-  // Switching to/from ubershaders? Have to adjust the vertex format and pipeline layout.
-  if (use_ubershaders != m_using_ubershaders)
-  {
-    m_using_ubershaders = use_ubershaders;
-    UpdatePipelineLayout();
-    UpdatePipelineVertexFormat();
-  }
-
-  if (use_ubershaders)
+  if (exclusive_ubershaders || m_hybrid_ubershaders)
   {
     UberShader::VertexUberShaderUid uber_vs_uid = UberShader::GetVertexUberShaderUid(components, xfmem);
     VkShaderModule vs = g_shader_cache->GetVertexUberShaderForUid(uber_vs_uid);
-    if (vs != m_pipeline_state.vs)
+    if (vs != m_uber_vs)
     {
       m_uber_vs_uid = uber_vs_uid;
-      m_pipeline_state.vs = vs;
+      m_uber_vs = vs;
       changed = true;
     }
 
     UberShader::PixelUberShaderUid uber_ps_uid = UberShader::GetPixelUberShaderUid(components, xfmem, bpmem);
     VkShaderModule ps = g_shader_cache->GetPixelUberShaderForUid(uber_ps_uid);
-    if (ps != m_pipeline_state.ps)
+    if (ps != m_uber_ps)
     {
       m_uber_ps_uid = uber_ps_uid;
-      m_pipeline_state.ps = ps;
+      m_uber_ps = ps;
       changed = true;
     }
   }
 
+  if (m_hybrid_ubershaders)
+  {
+    // UpdatePipeline picks the shaders, keep checking until the specialized pipeline is ready
+    changed |= m_pipeline_pending;
+  }
+  else
+  {
+    m_pipeline_pending = false;
+    SelectShaders(exclusive_ubershaders);
+  }
+
   if (changed)
     m_dirty_flags |= DIRTY_FLAG_PIPELINE;
 
   return changed;
 }
 
+void StateTracker::SelectShaders(bool use_ubershaders)
+{
+  // Switching to/from ubershaders? Have to adjust the vertex format and pipeline layout.
+  if (use_ubershaders != m_using_ubershaders)
+  {
+    m_using_ubershaders = use_ubershaders;
+    UpdatePipelineLayout();
+    UpdatePipelineVertexFormat();
+  }
+
+  VkShaderModule vs = use_ubershaders ? m_uber_vs : m_specialized_vs;
+  VkShaderModule ps = use_ubershaders ? m_uber_ps : m_specialized_ps;
+  if (m_pipeline_state.vs != vs || m_pipeline_state.ps != ps)
+  {
+    m_pipeline_state.vs = vs;
+    m_pipeline_state.ps = ps;
+    m_dirty_flags |= DIRTY_FLAG_PIPELINE;
+  }
+}
+
 void StateTracker::ClearShaders()
 {
   // Set the UIDs to something that will never match, so on the first access they are checked.
@@ -505,6 +534,10 @@ void StateTracker::ClearShaders()
   m_pipeline_state.gs = VK_NULL_HANDLE;
   m_pipeline_state.ps = VK_NULL_HANDLE;
   m_pipeline_state.vertex_format = nullptr;
+  m_specialized_vs = VK_NULL_HANDLE;
+  m_specialized_ps = VK_NULL_HANDLE;
+  m_uber_vs = VK_NULL_HANDLE;
+  m_uber_ps = VK_NULL_HANDLE;
 
   m_dirty_flags |= DIRTY_FLAG_PIPELINE;
 }
@@ -1085,8 +1118,35 @@ bool StateTracker::IsSSBODescriptorRequired() const
   return m_bbox_enabled || (m_using_ubershaders && g_ActiveConfig.iBBoxMode == BBoxMode::BBoxGPU);
 }
 
+void StateTracker::UpdateHybridPipeline()
+{
+  // The specialized pipeline is used as soon as it is compiled, the ubershaders until then.
+  m_pipeline_pending = true;
+  if (m_specialized_vs != VK_NULL_HANDLE && m_specialized_ps != VK_NULL_HANDLE)
+  {
+    PipelineInfo info = m_pipeline_state;
+    info.vs = m_specialized_vs;
+    info.ps = m_specialized_ps;
+    info.vertex_format = m_vertex_format;
+    info.pipeline_layout = g_object_cache->GetPipelineLayout(
+        m_bbox_enabled ? PIPELINE_LAYOUT_BBOX : PIPELINE_LAYOUT_STANDARD);
+    if (m_dstalpha_mode == PSRM_ALPHA_PASS)
+      info = GetAlphaPassPipelineConfig(info);
+
+    auto result = g_shader_cache->GetPipelineWithCacheResult(info, true);
+    if (!result.second)
+      AppendToPipelineUIDCache(info);
+    m_pipeline_pending = result.first == VK_NULL_HANDLE;
+  }
+
+  SelectShaders(m_pipeline_pending);
+}
+
 bool StateTracker::UpdatePipeline()
 {
+  if (m_hybrid_ubershaders)
+    UpdateHybridPipeline();
+
   // We need at least a vertex and fragment shader
   if (m_pipeline_state.vs == VK_NULL_HANDLE || m_pipeline_state.ps == VK_NULL_HANDLE)
     return false;
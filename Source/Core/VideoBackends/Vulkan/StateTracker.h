@@ -198,6 +198,10 @@ private:
   bool IsSSBODescriptorRequired() const;
 
   bool UpdatePipeline();
+  // Hybrid ubershader mode, switches between the specialized and ubershaders depending on
+  // whether the specialized pipeline finished compiling.
+  void UpdateHybridPipeline();
+  void SelectShaders(bool use_ubershaders);
   void UpdatePipelineLayout();
   void UpdatePipelineVertexFormat();
   bool UpdateDescriptorSet();
@@ -225,6 +229,13 @@ private:
   UberShader::VertexUberShaderUid m_uber_vs_uid = {};
   UberShader::PixelUberShaderUid m_uber_ps_uid = {};
   bool m_using_ubershaders = false;
+  bool m_hybrid_ubershaders = false;
+  // The specialized pipeline for the current state is compiling in the background
+  bool m_pipeline_pending = false;
+  VkShaderModule m_specialized_vs = VK_NULL_HANDLE;
+  VkShaderModule m_specialized_ps = VK_NULL_HANDLE;
+  VkShaderModule m_uber_vs = VK_NULL_HANDLE;
+  VkShaderModule m_uber_ps = VK_NULL_HANDLE;
 
   // pipeline state
   PipelineInfo m_pipeline_state = {};
@@ -27,8 +27,8 @@ namespace Vulkan
 // TODO: Clean up this mess
 constexpr size_t INITIAL_VERTEX_BUFFER_SIZE = VertexManager::MAXVBUFFERSIZE * 2;
 constexpr size_t MAX_VERTEX_BUFFER_SIZE = VertexManager::MAXVBUFFERSIZE * 16;
-constexpr size_t INITIAL_INDEX_BUFFER_SIZE = VertexManager::MAXIBUFFERSIZE * sizeof(u16) * 2;
-constexpr size_t MAX_INDEX_BUFFER_SIZE = VertexManager::MAXIBUFFERSIZE * sizeof(u16) * 16;
+constexpr size_t INITIAL_INDEX_BUFFER_SIZE = VertexManager::MAXIBUFFERSIZE * sizeof(u32) * 2;
+constexpr size_t MAX_INDEX_BUFFER_SIZE = VertexManager::MAXIBUFFERSIZE * sizeof(u32) * 16;
 
 VertexManager::VertexManager()
   : m_cpu_vertex_buffer(MAXVBUFFERSIZE), m_cpu_index_buffer(MAXIBUFFERSIZE)
@@ -70,11 +70,11 @@ VertexManager::CreateNativeVertexFormat(const PortableVertexDeclaration& vtx_dec
 void VertexManager::PrepareDrawBuffers(u32 stride)
 {
   size_t vertex_data_size = IndexGenerator::GetNumVerts() * stride;
-  size_t index_data_size = IndexGenerator::GetIndexLen() * sizeof(u16);
+  size_t index_data_size = IndexGenerator::GetIndexLen() * sizeof(u32);
 
   // Attempt to allocate from buffers
   bool has_vbuffer_allocation = m_vertex_stream_buffer->ReserveMemory(vertex_data_size, stride);
-  bool has_ibuffer_allocation = m_index_stream_buffer->ReserveMemory(index_data_size, sizeof(u16));
+  bool has_ibuffer_allocation = m_index_stream_buffer->ReserveMemory(index_data_size, sizeof(u32));
   if (!has_vbuffer_allocation || !has_ibuffer_allocation)
   {
     // Flush any pending commands first, so that we can wait on the fences
@@ -85,7 +85,7 @@ void VertexManager::PrepareDrawBuffers(u32 stride)
     if (!has_vbuffer_allocation)
       has_vbuffer_allocation = m_vertex_stream_buffer->ReserveMemory(vertex_data_size, stride);
     if (!has_ibuffer_allocation)
-      has_ibuffer_allocation = m_index_stream_buffer->ReserveMemory(index_data_size, sizeof(u16));
+      has_ibuffer_allocation = m_index_stream_buffer->ReserveMemory(index_data_size, sizeof(u32));
 
     // If we still failed, that means the allocation was too large and will never succeed, so panic
     if (!has_vbuffer_allocation || !has_ibuffer_allocation)
@@ -99,7 +99,7 @@ void VertexManager::PrepareDrawBuffers(u32 stride)
   m_current_draw_base_vertex =
     static_cast<u32>(m_vertex_stream_buffer->GetCurrentOffset() / stride);
   m_current_draw_base_index =
-    static_cast<u32>(m_index_stream_buffer->GetCurrentOffset() / sizeof(u16));
+    static_cast<u32>(m_index_stream_buffer->GetCurrentOffset() / sizeof(u32));
 
   m_vertex_stream_buffer->CommitMemory(vertex_data_size);
   m_index_stream_buffer->CommitMemory(index_data_size);
@@ -108,7 +108,7 @@ void VertexManager::PrepareDrawBuffers(u32 stride)
   ADDSTAT(stats.thisFrame.bytesIndexStreamed, static_cast<int>(index_data_size));
 
   StateTracker::GetInstance()->SetVertexBuffer(m_vertex_stream_buffer->GetBuffer(), 0);
-  StateTracker::GetInstance()->SetIndexBuffer(m_index_stream_buffer->GetBuffer(), 0, VK_INDEX_TYPE_UINT16);
+  StateTracker::GetInstance()->SetIndexBuffer(m_index_stream_buffer->GetBuffer(), 0, VK_INDEX_TYPE_UINT32);
 }
 
 void VertexManager::ResetBuffer(u32 stride)
@@ -118,11 +118,6 @@ void VertexManager::ResetBuffer(u32 stride)
   IndexGenerator::Start(m_cpu_index_buffer.data());
 }
 
-u16* VertexManager::GetIndexBuffer()
-{
-  return reinterpret_cast<u16*>(IndexGenerator::GetBasePointer());
-}
-
 void VertexManager::vFlush(bool use_dst_alpha)
 {
   const VertexFormat* vertex_format =
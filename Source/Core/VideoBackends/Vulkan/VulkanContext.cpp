@@ -254,6 +254,7 @@ void VulkanContext::PopulateBackendInfo(VideoConfig* config)
   config->backend_info.bSupportsAsyncShaderCompilation = false;
   config->backend_info.bSupportsUberShaders = true;
   config->backend_info.bSupportsHighPrecisionFrameBuffer = false;
+  config->backend_info.bSupportsPrimitiveRestart = true;      // Assumed support.
 }
 
 void VulkanContext::PopulateBackendInfoAdapters(VideoConfig* config, const GPUList& gpu_list)
@@ -184,6 +184,10 @@ bool VideoBackend::Initialize(void* window_handle)
     return false;
   }
 
+  // Primitive restart is broken on some drivers, triangles are generated as lists there.
+  if (DriverDetails::HasBug(DriverDetails::BUG_PRIMITIVE_RESTART))
+    g_Config.backend_info.bSupportsPrimitiveRestart = false;
+
   // Create swap chain. This has to be done early so that the target size is correct for auto-scale.
   std::unique_ptr<SwapChain> swap_chain;
   if (surface != VK_NULL_HANDLE)
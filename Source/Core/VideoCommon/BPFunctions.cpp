@@ -24,6 +24,30 @@ namespace BPFunctions
 // ----------------------------------------------
 
 
+static u32 s_pending_state;
+
+void SetStatePending(u32 state)
+{
+  s_pending_state |= state;
+}
+
+void ApplyPendingState()
+{
+  if (!s_pending_state)
+    return;
+
+  const u32 state = s_pending_state;
+  s_pending_state = 0;
+  if (state & PENDING_GENERATION_MODE)
+    SetGenerationMode();
+  if (state & PENDING_SCISSOR)
+    SetScissor();
+  if (state & PENDING_DEPTH_MODE)
+    SetDepthMode();
+  if (state & PENDING_BLEND_MODE)
+    SetBlendMode();
+}
+
 void FlushPipeline()
 {
   g_vertex_manager->Flush();
@@ -15,6 +15,18 @@ struct BPCmd;
 
 namespace BPFunctions
 {
+// Backend state generated from bpmem. BP writes only mark it as pending, it's generated once
+// before the next draw, so a run of writes affecting the same state costs a single update.
+enum PendingState : u32
+{
+  PENDING_GENERATION_MODE = 1 << 0,
+  PENDING_SCISSOR = 1 << 1,
+  PENDING_DEPTH_MODE = 1 << 2,
+  PENDING_BLEND_MODE = 1 << 3,
+};
+
+void SetStatePending(u32 state);
+void ApplyPendingState();
 
 void FlushPipeline();
 void SetGenerationMode();
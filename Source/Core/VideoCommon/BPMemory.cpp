@@ -8,6 +8,7 @@
 
 #include "VideoCommon/BPMemory.h"
 #include "VideoCommon/BPStructs.h"
+#include "VideoCommon/Fifo.h"
 #include "VideoCommon/PixelEngine.h"
 // BP state
 // STATE_TO_SAVE
@@ -46,6 +47,10 @@ void LoadBPReg(u32 value0)
 
 void LoadBPRegPreprocess(u32 value0)
 {
+  // The preprocessing thread leaves these to the GPU thread, like in normal dual core mode.
+  if (!Fifo::UseDeterministicGPUThread())
+    return;
+
   int regNum = value0 >> 24;
   // masking could hypothetically be a problem
   u32 newval = value0 & 0xffffff;
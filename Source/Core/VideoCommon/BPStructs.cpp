@@ -132,7 +132,7 @@ void BPWritten(const BPCmd& bp)
       PixelShaderManager::SetGenModeChanged();
     // Only call SetGenerationMode when cull mode changes.
     if (bp.changes & 0xC000)
-      SetGenerationMode();
+      SetStatePending(PENDING_GENERATION_MODE);
     return;
   case BPMEM_IND_MTXA: // Index Matrix Changed
   case BPMEM_IND_MTXB:
@@ -166,7 +166,7 @@ void BPWritten(const BPCmd& bp)
   case BPMEM_SCISSORTL: // Scissor Rectable Top, Left
   case BPMEM_SCISSORBR: // Scissor Rectable Bottom, Right
   case BPMEM_SCISSOROFFSET: // Scissor Offset
-    SetScissor();
+    SetStatePending(PENDING_SCISSOR);
     return;
   case BPMEM_LINEPTWIDTH: // Line Width
     SetLineWidth();
@@ -174,7 +174,7 @@ void BPWritten(const BPCmd& bp)
   case BPMEM_ZMODE: // Depth Control
     PRIM_LOG("zmode: test=%u, func=%u, upd=%u", bpmem.zmode.testenable.Value(),
       bpmem.zmode.func.Value(), bpmem.zmode.updateenable.Value());
-    SetDepthMode();
+    SetStatePending(PENDING_DEPTH_MODE);
     PixelShaderManager::SetZModeControl();
     return;
   case BPMEM_BLENDMODE: // Blending Control
@@ -186,7 +186,7 @@ void BPWritten(const BPCmd& bp)
         bpmem.blendmode.dstfactor.Value(), bpmem.blendmode.srcfactor.Value(),
         bpmem.blendmode.subtract.Value(), bpmem.blendmode.logicmode.Value());
 
-      SetBlendMode();
+      SetStatePending(PENDING_BLEND_MODE);
 
       if (bp.changes & 0x04)
         PixelShaderManager::SetBlendModeChanged();
@@ -201,7 +201,7 @@ void BPWritten(const BPCmd& bp)
       PixelShaderManager::SetDestAlphaChanged();
     }
     if (bp.changes & 0x100)
-      SetBlendMode();
+      SetStatePending(PENDING_BLEND_MODE);
     return;
 
     // This is called when the game is done drawing the new frame (eg: like in DX: Begin(); Draw(); End();)
@@ -237,6 +237,9 @@ void BPWritten(const BPCmd& bp)
     // It can also optionally clear the EFB while copying from it. To emulate this, we of course copy first and clear afterwards.
   case BPMEM_TRIGGER_EFB_COPY: // Copy EFB Region or Render to the XFB or Clear the screen.
   {
+    // The copy and clear go through the renderer, which has to be up to date.
+    ApplyPendingState();
+
     // The bottom right is within the rectangle
     // The values in bpmem.copyTexSrcXY and bpmem.copyTexSrcWH are updated in case 0x49 and 0x4a in this function
 
@@ -349,7 +352,7 @@ void BPWritten(const BPCmd& bp)
     if (bp.changes)
     {
       PixelShaderManager::SetAlphaTestChanged();
-      SetBlendMode();
+      SetStatePending(PENDING_BLEND_MODE);
     }
     return;
   case BPMEM_BIAS: // BIAS
@@ -439,7 +442,7 @@ void BPWritten(const BPCmd& bp)
     OnPixelFormatChange();
     if (bp.changes & 7)
     {
-      SetBlendMode(); // dual source could be activated by changing to PIXELFMT_RGBA6_Z24      
+      SetStatePending(PENDING_BLEND_MODE); // dual source could be activated by changing to PIXELFMT_RGBA6_Z24      
     }
     PixelShaderManager::SetZModeControl();
     return;
@@ -286,6 +286,7 @@ void RegisterMMIO(MMIO::Mapping* mmio, u32 base)
     IsOnThread() ? MMIO::ComplexWrite<u16>([](u32, u16 val) {
     WriteHigh(fifo.CPReadPointer, val);
     fifo.SafeCPReadPointer = fifo.CPReadPointer;
+    Fifo::ResetPreprocessedReadPointer();
   }) :
     MMIO::DirectWrite<u16>(MMIO::Utils::HighPart(&fifo.CPReadPointer)));
 }
@@ -0,0 +1,29 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include "Common/CommonTypes.h"
+
+// Display list cache.
+// Keeps the vertex data converted while running a display list, so calling the
+// same static display list again can skip the vertex loaders and the opcode
+// parsing of its draw commands.
+namespace DLCache
+{
+void Init();
+void Shutdown();
+void Clear();
+
+// Drops entries that haven't been called for a while. Called once per frame.
+void ProgressiveCleanup();
+
+// Starts a new check context. Each cached display list compares its hash against
+// memory the first time it gets called within a context.
+void IncrementCheckContextId();
+
+// Runs the display list at data through the cache, compiling it on the first call.
+// Returns false if the caller has to interpret the display list itself.
+bool HandleDisplayList(u32 address, u32 size, u8* data, u32* cycles);
+}
@@ -2,8 +2,11 @@
 // Licensed under GPLv2+
 // Refer to the license.txt file included.
 
+#include <algorithm>
 #include <atomic>
 #include <cstring>
+#include <mutex>
+#include <thread>
 
 #include "Common/Assert.h"
 #include "Common/Atomic.h"
@@ -13,6 +16,8 @@
 #include "Common/FPURoundMode.h"
 #include "Common/MemoryUtil.h"
 #include "Common/MsgHandler.h"
+#include "Common/Thread.h"
+#include "Common/Timer.h"
 
 #include "Core/ConfigManager.h"
 #include "Core/CoreTiming.h"
@@ -26,6 +31,7 @@
 #include "VideoCommon/DataReader.h"
 #include "VideoCommon/Fifo.h"
 #include "VideoCommon/OpcodeDecoding.h"
+#include "VideoCommon/Statistics.h"
 #include "VideoCommon/VertexLoaderManager.h"
 #include "VideoCommon/VertexManagerBase.h"
 #include "VideoCommon/VideoConfig.h"
@@ -36,9 +42,24 @@ namespace Fifo
 {
 static constexpr u32 FIFO_SIZE = 2 * 1024 * 1024;
 static constexpr int GPU_TIME_SLOT_SIZE = 1000;
+// Most bytes the GPU thread reads from the CP FIFO at once with batched reads
+static constexpr u32 FIFO_READ_BATCH_SIZE = 4096;
 
 static Common::BlockingLoop s_gpu_mainloop;
 
+// In dual core mode a separate thread can copy and preprocess the FIFO data, the GPU thread
+// then only decodes complete commands. Decided when the FIFO is initialized.
+static bool s_use_preprocess_thread;
+static Common::BlockingLoop s_preprocess_loop;
+static std::thread s_preprocess_thread;
+// Held by the GPU thread while it decodes preprocessed data, and by the preprocessing thread
+// while it moves unread data to the start of the buffers.
+static std::mutex s_video_buffer_lock;
+// CP read pointer behind the data the preprocessing thread has copied. Only valid once it has
+// copied something since the read pointer was last set by the CPU or the video buffer was reset.
+static std::atomic<u32> s_preprocessed_cp_read_ptr;
+static std::atomic<bool> s_preprocessed_cp_read_ptr_valid;
+
 static Common::Flag s_emu_running_state;
 
 // Most of this array is unlikely to be faulted in...
@@ -57,7 +78,7 @@ static u8* s_video_buffer;
 static u8* s_video_buffer_read_ptr;
 static std::atomic<u8*> s_video_buffer_write_ptr;
 static std::atomic<u8*> s_video_buffer_seen_ptr;
-static u8* s_video_buffer_pp_read_ptr;
+static std::atomic<u8*> s_video_buffer_pp_read_ptr;
 // The read_ptr is always owned by the GPU thread.  In normal mode, so is the
 // write_ptr, despite it being atomic.  In deterministic GPU thread mode,
 // things get a bit more complicated:
@@ -69,6 +90,9 @@ static u8* s_video_buffer_pp_read_ptr;
 // FIFO.  Maybe someday it will be under the lock.  For now, because RunGpuLoop
 // polls, it's just atomic.
 // - The pp_read_ptr is the CPU preprocessing version of the read_ptr.
+// With the preprocessing thread, that thread takes the place of the CPU thread: it
+// writes write_ptr and pp_read_ptr, and the GPU thread decodes up to pp_read_ptr. Only
+// complete commands are in front of pp_read_ptr, so the seen_ptr isn't needed.
 
 static std::atomic<int> s_sync_ticks;
 static bool s_syncing_suspended;
@@ -81,11 +105,13 @@ void DoState(PointerWrap& p)
   p.DoPointer(write_ptr, s_video_buffer);
   s_video_buffer_write_ptr = write_ptr;
   p.DoPointer(s_video_buffer_read_ptr, s_video_buffer);
-  if (p.mode == PointerWrap::MODE_READ && s_use_deterministic_gpu_thread)
+  if (p.mode == PointerWrap::MODE_READ && (s_use_deterministic_gpu_thread || UsePreprocessThread()))
   {
     // We're good and paused, right?
     s_video_buffer_seen_ptr = s_video_buffer_pp_read_ptr = s_video_buffer_read_ptr;
   }
+  if (p.mode == PointerWrap::MODE_READ)
+    ResetPreprocessedReadPointer();
 
   p.Do(s_sync_ticks);
   p.Do(s_syncing_suspended);
@@ -102,6 +128,8 @@ void PauseAndLock(bool doLock, bool unpauseOnUnlock)
     if (!param.bCPUThread || s_use_deterministic_gpu_thread)
       return;
 
+    if (s_use_preprocess_thread)
+      s_preprocess_loop.WaitYield(std::chrono::milliseconds(100), Host_YieldToUI);
     s_gpu_mainloop.WaitYield(std::chrono::milliseconds(100), Host_YieldToUI);
   }
   else
@@ -116,8 +144,13 @@ void Init()
   // Padded so that SIMD overreads in the vertex loader are safe
   s_video_buffer = static_cast<u8*>(Common::AllocateMemoryPages(FIFO_SIZE + 4));
   ResetVideoBuffer();
-  if (SConfig::GetInstance().bCPUThread)
+  const SConfig& param = SConfig::GetInstance();
+  s_use_preprocess_thread =
+      param.bCPUThread && !param.bSyncGPU && g_ActiveConfig.bFifoPreprocessThread;
+  if (param.bCPUThread)
     s_gpu_mainloop.Prepare();
+  if (s_use_preprocess_thread)
+    s_preprocess_loop.Prepare();
   s_sync_ticks.store(0);
 }
 
@@ -134,6 +167,7 @@ void Shutdown()
   s_video_buffer_seen_ptr = nullptr;
   s_fifo_aux_write_ptr = nullptr;
   s_fifo_aux_read_ptr = nullptr;
+  ResetPreprocessedReadPointer();
 }
 
 // May be executed from any thread, even the graphics thread.
@@ -146,6 +180,7 @@ void ExitGpuLoop()
 
   // Terminate GPU thread loop
   s_emu_running_state.Set();
+  s_preprocess_loop.Stop(s_preprocess_loop.kNonBlock);
   s_gpu_mainloop.Stop(s_gpu_mainloop.kNonBlock);
 }
 
@@ -153,9 +188,16 @@ void EmulatorState(bool running)
 {
   s_emu_running_state.Set(running);
   if (running)
+  {
+    if (s_use_preprocess_thread)
+      s_preprocess_loop.Wakeup();
     s_gpu_mainloop.Wakeup();
+  }
   else
+  {
+    s_preprocess_loop.AllowSleep();
     s_gpu_mainloop.AllowSleep();
+  }
 }
 
 void SyncGPU(SyncGPUReason reason, bool may_move_read_ptr)
@@ -193,11 +235,28 @@ void SyncGPU(SyncGPUReason reason, bool may_move_read_ptr)
   }
 }
 
+// Lets the GPU thread catch up with the preprocessing thread, then moves the aux data it
+// hasn't read yet to the start of the buffer.
+static void RewindFifoAuxBuffer()
+{
+  s_gpu_mainloop.Wakeup();
+  s_gpu_mainloop.Wait();
+
+  std::lock_guard<std::mutex> lk(s_video_buffer_lock);
+  const size_t size = s_fifo_aux_write_ptr - s_fifo_aux_read_ptr;
+  memmove(s_fifo_aux_data, s_fifo_aux_read_ptr, size);
+  s_fifo_aux_write_ptr = s_fifo_aux_data + size;
+  s_fifo_aux_read_ptr = s_fifo_aux_data;
+}
+
 void PushFifoAuxBuffer(const void* ptr, size_t size)
 {
   if (size > (size_t)(s_fifo_aux_data + FIFO_SIZE - s_fifo_aux_write_ptr))
   {
-    SyncGPU(SyncGPUReason::AuxSpace, /* may_move_read_ptr */ false);
+    if (UsePreprocessThread())
+      RewindFifoAuxBuffer();
+    else
+      SyncGPU(SyncGPUReason::AuxSpace, /* may_move_read_ptr */ false);
     if (!s_gpu_mainloop.IsRunning())
     {
       // GPU is shutting down
@@ -223,9 +282,8 @@ void* PopFifoAuxBuffer(size_t size)
 }
 
 // Description: RunGpuLoop() sends data through this function.
-static void ReadDataFromFifo(u32 readPtr)
+static void ReadDataFromFifo(u32 readPtr, size_t len)
 {
-  size_t len = 32;
   if (len > (size_t)(s_video_buffer + FIFO_SIZE - s_video_buffer_write_ptr))
   {
     size_t existing_len = s_video_buffer_write_ptr - s_video_buffer_read_ptr;
@@ -279,6 +337,113 @@ static void ReadDataFromFifoOnCPU(u32 readPtr)
   s_video_buffer_write_ptr = write_ptr + len;
 }
 
+// The preprocessing thread version.
+static void PreprocessDataFromFifo(u32 readPtr, size_t len)
+{
+  u8* write_ptr = s_video_buffer_write_ptr;
+  if (len > (size_t)(s_video_buffer + FIFO_SIZE - write_ptr))
+  {
+    // Let the GPU thread catch up, then move what it hasn't read yet to the start.
+    s_gpu_mainloop.Wakeup();
+    s_gpu_mainloop.Wait();
+
+    std::lock_guard<std::mutex> lk(s_video_buffer_lock);
+    size_t existing_len = write_ptr - s_video_buffer_read_ptr;
+    if (len > (size_t)(FIFO_SIZE - existing_len))
+    {
+      PanicAlert("FIFO out of bounds (existing %zu + new %zu > %u)", existing_len, len, FIFO_SIZE);
+      return;
+    }
+    const size_t offset = s_video_buffer_read_ptr - s_video_buffer;
+    memmove(s_video_buffer, s_video_buffer_read_ptr, existing_len);
+    s_video_buffer_read_ptr = s_video_buffer;
+    s_video_buffer_pp_read_ptr = s_video_buffer_pp_read_ptr - offset;
+    write_ptr = s_video_buffer + existing_len;
+    s_video_buffer_write_ptr = write_ptr;
+  }
+  Memory::CopyFromEmu(write_ptr, readPtr, len);
+  s_video_buffer_write_ptr = write_ptr + len;
+  DataReader fifo_reader(s_video_buffer_pp_read_ptr, write_ptr + len);
+  // The GPU thread may decode everything in front of the pp_read_ptr once it's stored.
+  s_video_buffer_pp_read_ptr = OpcodeDecoder::Run<true>(fifo_reader, nullptr);
+}
+
+// Decodes the complete commands the preprocessing thread has copied so far.
+static void RunPreprocessedData()
+{
+  SCPFifoStruct& fifo = CommandProcessor::fifo;
+  while (true)
+  {
+    std::unique_lock<std::mutex> lk(s_video_buffer_lock);
+    // Loaded before the write_ptr, so it can only be behind the data in the buffer. Without
+    // preprocessed data the read pointer is still where the CPU has put it.
+    const u32 cp_read_ptr = s_preprocessed_cp_read_ptr_valid.load() ?
+                                s_preprocessed_cp_read_ptr.load() :
+                                Common::AtomicLoad(fifo.CPReadPointer);
+    u8* write_ptr = s_video_buffer_write_ptr;
+    u8* end = s_video_buffer_pp_read_ptr;
+    if (s_video_buffer_read_ptr == end)
+    {
+      if (end == write_ptr)
+        Common::AtomicStore(fifo.SafeCPReadPointer, cp_read_ptr);
+      return;
+    }
+
+    // Decode in chunks so the CPU thread's requests don't wait for a long backlog.
+    u8* read_ptr = s_video_buffer_read_ptr;
+    g_VideoData.SetReadPosition(read_ptr, std::min(end, read_ptr + FIFO_READ_BATCH_SIZE));
+    s_video_buffer_read_ptr = OpcodeDecoder::Run(g_VideoData, nullptr);
+    if (s_video_buffer_read_ptr == read_ptr)
+    {
+      // A single command larger than a chunk
+      g_VideoData.SetReadPosition(read_ptr, end);
+      s_video_buffer_read_ptr = OpcodeDecoder::Run(g_VideoData, nullptr);
+    }
+    lk.unlock();
+
+    AsyncRequests::GetInstance()->PullEvents();
+  }
+}
+
+// Copies and preprocesses the FIFO data in front of the GPU thread, taking its place in
+// updating the CP registers.
+static void RunPreprocessLoop()
+{
+  Common::SetCurrentThreadName("FIFO preprocessing thread");
+
+  s_preprocess_loop.Run(
+      [] {
+        // Do nothing while paused
+        if (!s_emu_running_state.IsSet() || s_use_deterministic_gpu_thread)
+          return;
+
+        SCPFifoStruct& fifo = CommandProcessor::fifo;
+        CommandProcessor::SetCPStatusFromGPU();
+
+        while (!CommandProcessor::IsInterruptWaiting() && fifo.bFF_GPReadEnable &&
+               fifo.CPReadWriteDistance && !AtBreakpoint())
+        {
+          u32 readPtr = fifo.CPReadPointer;
+          const u32 size = GetReadBatchSize(fifo, FIFO_READ_BATCH_SIZE);
+          PreprocessDataFromFifo(readPtr, size);
+
+          if (readPtr + size - 32 == fifo.CPEnd)
+            readPtr = fifo.CPBase;
+          else
+            readPtr += size;
+
+          Common::AtomicStore(fifo.CPReadPointer, readPtr);
+          Common::AtomicAdd(fifo.CPReadWriteDistance, -static_cast<s32>(size));
+          s_preprocessed_cp_read_ptr.store(readPtr);
+          s_preprocessed_cp_read_ptr_valid.store(true);
+          s_gpu_mainloop.Wakeup();
+
+          CommandProcessor::SetCPStatusFromGPU();
+        }
+      },
+      100);
+}
+
 void ResetVideoBuffer()
 {
   s_video_buffer_read_ptr = s_video_buffer;
@@ -287,6 +452,12 @@ void ResetVideoBuffer()
   s_video_buffer_pp_read_ptr = s_video_buffer;
   s_fifo_aux_write_ptr = s_fifo_aux_data;
   s_fifo_aux_read_ptr = s_fifo_aux_data;
+  ResetPreprocessedReadPointer();
+}
+
+void ResetPreprocessedReadPointer()
+{
+  s_preprocessed_cp_read_ptr_valid.store(false);
 }
 
 // Description: Main FIFO update loop
@@ -296,6 +467,9 @@ void RunGpuLoop()
   AsyncRequests::GetInstance()->SetEnable(true);
   AsyncRequests::GetInstance()->SetPassthrough(false);
 
+  if (s_use_preprocess_thread)
+    s_preprocess_thread = std::thread(RunPreprocessLoop);
+
   s_gpu_mainloop.Run(
     [] {
     const SConfig& param = SConfig::GetInstance();
@@ -306,6 +480,10 @@ void RunGpuLoop()
     if (!s_emu_running_state.IsSet())
       return;
 
+    // Reading the thread CPU time is a syscall, only pay for it when the overlay shows it
+    const bool measure_cpu_time = g_ActiveConfig.bOverlayStats;
+    const u64 start_time = measure_cpu_time ? Common::Timer::GetThreadTimeUs() : 0;
+
     if (s_use_deterministic_gpu_thread)
     {
       AsyncRequests::GetInstance()->PullEvents();
@@ -321,6 +499,16 @@ void RunGpuLoop()
         s_video_buffer_seen_ptr = write_ptr;
       }
     }
+    else if (s_use_preprocess_thread)
+    {
+      AsyncRequests::GetInstance()->PullEvents();
+
+      // The preprocessing thread does the fifo/CP stuff.
+      RunPreprocessedData();
+
+      // Same as below, the GPU is idle until the preprocessing thread has more data.
+      g_vertex_manager->Flush();
+    }
     else
     {
       SCPFifoStruct& fifo = CommandProcessor::fifo;
@@ -338,29 +526,35 @@ void RunGpuLoop()
 
         u32 cyclesExecuted = 0;
         u32 readPtr = fifo.CPReadPointer;
-        ReadDataFromFifo(readPtr);
+        const u32 size =
+            g_ActiveConfig.bBatchedFifo ? GetReadBatchSize(fifo, FIFO_READ_BATCH_SIZE) : 32;
+        ReadDataFromFifo(readPtr, size);
+        INCSTAT(stats.thisFrame.numFifoReads);
+        ADDSTAT(stats.thisFrame.bytesFifoRead, size);
 
-        if (readPtr == fifo.CPEnd)
+        if (readPtr + size - 32 == fifo.CPEnd)
           readPtr = fifo.CPBase;
         else
-          readPtr += 32;
+          readPtr += size;
 
-        ASSERT_MSG(COMMANDPROCESSOR, (s32)fifo.CPReadWriteDistance - 32 >= 0,
+        ASSERT_MSG(COMMANDPROCESSOR, (s32)fifo.CPReadWriteDistance - (s32)size >= 0,
           "Negative fifo.CPReadWriteDistance = %i in FIFO Loop !\nThat can produce "
           "instability in the game. Please report it.",
-          fifo.CPReadWriteDistance - 32);
+          fifo.CPReadWriteDistance - size);
 
         u8* write_ptr = s_video_buffer_write_ptr;
         g_VideoData.SetReadPosition(s_video_buffer_read_ptr, write_ptr);
         s_video_buffer_read_ptr = OpcodeDecoder::Run(g_VideoData, &cyclesExecuted);
 
         Common::AtomicStore(fifo.CPReadPointer, readPtr);
-        Common::AtomicAdd(fifo.CPReadWriteDistance, -32);
+        Common::AtomicAdd(fifo.CPReadWriteDistance, -static_cast<s32>(size));
         if ((write_ptr - s_video_buffer_read_ptr) == 0)
           Common::AtomicStore(fifo.SafeCPReadPointer, fifo.CPReadPointer);
 
         CommandProcessor::SetCPStatusFromGPU();
 
+        // A batch is accounted at once, the GPU can run ahead by one batch like it could
+        // by one block of 32 bytes before.
         if (param.bSyncGPU)
         {
           cyclesExecuted = (int)(cyclesExecuted / param.fSyncGpuOverclock);
@@ -389,9 +583,21 @@ void RunGpuLoop()
       // Make sure VertexManager finishes drawing any primitives it has stored in it's buffer.
       g_vertex_manager->Flush();
     }
+
+    if (measure_cpu_time)
+    {
+      ADDSTAT(stats.thisFrame.gpuThreadCpuUs,
+              static_cast<int>(Common::Timer::GetThreadTimeUs() - start_time));
+    }
   },
     100);
 
+  if (s_use_preprocess_thread)
+  {
+    s_preprocess_loop.Stop();
+    s_preprocess_thread.join();
+  }
+
   AsyncRequests::GetInstance()->SetEnable(false);
   AsyncRequests::GetInstance()->SetPassthrough(true);
 }
@@ -403,11 +609,14 @@ void FlushGpu()
   if (!param.bCPUThread || s_use_deterministic_gpu_thread)
     return;
 
+  if (s_use_preprocess_thread)
+    s_preprocess_loop.Wait();
   s_gpu_mainloop.Wait();
 }
 
 void GpuMaySleep()
 {
+  s_preprocess_loop.AllowSleep();
   s_gpu_mainloop.AllowSleep();
 }
 
@@ -417,6 +626,28 @@ bool AtBreakpoint()
   return fifo.bFF_BPEnable && (fifo.CPReadPointer == fifo.CPBreakpoint);
 }
 
+u32 GetReadBatchSize(const SCPFifoStruct& fifo, u32 max_size)
+{
+  const u32 read_ptr = fifo.CPReadPointer;
+  const u32 distance = fifo.CPReadWriteDistance;
+  if (read_ptr > fifo.CPEnd || distance < 32)
+    return 32;
+
+  // The CPU writes whole 32 byte blocks, the block at CPEnd is the last one before wrapping.
+  u32 size = std::min(distance & ~31u, max_size & ~31u);
+  size = std::min(size, fifo.CPEnd - read_ptr + 32);
+
+  if (fifo.bFF_BPEnable && fifo.CPBreakpoint > read_ptr && fifo.CPBreakpoint - read_ptr < size)
+    size = fifo.CPBreakpoint - read_ptr;
+
+  // 32 byte reads raise the interrupt after the first block that leaves fewer bytes than
+  // the watermark.
+  if (fifo.bFF_LoWatermarkInt && distance >= fifo.CPLoWatermark)
+    size = std::min(size, ((distance - fifo.CPLoWatermark) / 32 + 1) * 32);
+
+  return std::max(size, 32u);
+}
+
 void RunGpu()
 {
   const SConfig& param = SConfig::GetInstance();
@@ -424,6 +655,8 @@ void RunGpu()
   // wake up GPU thread
   if (param.bCPUThread && !s_use_deterministic_gpu_thread)
   {
+    if (s_use_preprocess_thread)
+      s_preprocess_loop.Wakeup();
     s_gpu_mainloop.Wakeup();
   }
 
@@ -460,7 +693,7 @@ static int RunGpuOnCpu(int ticks)
         FPURoundMode::LoadDefaultSIMDState();
         reset_simd_state = true;
       }
-      ReadDataFromFifo(fifo.CPReadPointer);
+      ReadDataFromFifo(fifo.CPReadPointer, 32);
       u32 cycles = 0;
       g_VideoData.SetReadPosition(s_video_buffer_read_ptr, s_video_buffer_write_ptr);
       s_video_buffer_read_ptr = OpcodeDecoder::Run(g_VideoData, &cycles);
@@ -524,6 +757,13 @@ void UpdateWantDeterminism(bool want)
       CopyPreprocessCPStateFromMain();
       VertexLoaderManager::MarkAllDirty();
     }
+    else if (s_use_preprocess_thread)
+    {
+      // The preprocessing thread continues where the GPU thread is.
+      s_video_buffer_pp_read_ptr = s_video_buffer_read_ptr;
+      CopyPreprocessCPStateFromMain();
+      VertexLoaderManager::MarkAllDirty();
+    }
   }
 }
 
@@ -532,6 +772,16 @@ bool UseDeterministicGPUThread()
   return s_use_deterministic_gpu_thread;
 }
 
+bool UsePreprocessThread()
+{
+  return s_use_preprocess_thread && !s_use_deterministic_gpu_thread;
+}
+
+bool UseFifoAuxBuffer()
+{
+  return s_use_deterministic_gpu_thread || s_use_preprocess_thread;
+}
+
 /* This function checks the emulated CPU - GPU distance and may wake up the GPU,
 * or block the CPU if required. It should be called by the CPU thread regularly.
 * @ticks The gone emulated CPU time.
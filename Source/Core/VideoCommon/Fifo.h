@@ -9,6 +9,7 @@
 #include "Common/Common.h"
 
 class PointerWrap;
+struct SCPFifoStruct;
 
 namespace Fifo
 {
@@ -20,6 +21,11 @@ void DoState(PointerWrap &f);
 void PauseAndLock(bool doLock, bool unpauseOnUnlock);
 void UpdateWantDeterminism(bool want);
 bool UseDeterministicGPUThread();
+// Whether a separate thread copies and preprocesses the FIFO data in dual core mode.
+bool UsePreprocessThread();
+// Whether the GPU thread reads display lists and indexed XF data from the copies made while
+// preprocessing.
+bool UseFifoAuxBuffer();
 
 // Used for diagnostics.
 enum class SyncGPUReason
@@ -46,6 +52,13 @@ void RunGpuLoop();
 void ExitGpuLoop();
 void EmulatorState(bool running);
 bool AtBreakpoint();
+// Number of bytes the GPU thread can read from the CP FIFO in one go, at most max_size.
+// The read stops at the end of the FIFO, in front of a breakpoint, and where the low
+// watermark interrupt would be raised, so these are seen at the same place as with 32 byte reads.
+u32 GetReadBatchSize(const SCPFifoStruct& fifo, u32 max_size);
 void ResetVideoBuffer();
+// Called when the CPU sets the CP read pointer, the GPU thread reports it as is until the
+// preprocessing thread has copied data from the new position.
+void ResetPreprocessedReadPointer();
 
 } // namespace Fifo
@@ -1,52 +1,332 @@
-// Copyright (C) 2003-2009 Dolphin Project.
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
 
-// This program is free software: you can redistribute it and/or modify
-// it under the terms of the GNU General Public License as published by
-// the Free Software Foundation, version 2.0.
+// A display list is compiled the first time it gets called: its commands are
+// executed as usual, while the command boundaries and the output of every draw
+// are recorded. Later calls run the register loads between draws through the
+// regular opcode decoder and copy the recorded vertex data straight into the
+// vertex buffer.
+//
+// Only draws whose vertex format is fully direct are cached, indexed attributes
+// read from vertex arrays that can change without the display list changing.
+// The recorded data is only valid for the vertex loader and position matrix
+// index it was converted with, draws called with a different state are
+// converted again and recorded with the new state.
 
-// This program is distributed in the hope that it will be useful,
-// but WITHOUT ANY WARRANTY; without even the implied warranty of
-// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
-// GNU General Public License 2.0 for more details.
+#include <cstring>
+#include <unordered_map>
+#include <vector>
 
-// A copy of the GPL 2.0 should have been included with the program.
-// If not, see http://www.gnu.org/licenses/
+#include "Common/CommonTypes.h"
+#include "Common/Hash.h"
+#include "Common/Swap.h"
+#include "VideoCommon/CPMemory.h"
+#include "VideoCommon/DataReader.h"
+#include "VideoCommon/DLCache.h"
+#include "VideoCommon/OpcodeDecoding.h"
+#include "VideoCommon/Statistics.h"
+#include "VideoCommon/VertexLoaderBase.h"
+#include "VideoCommon/VertexLoaderManager.h"
+#include "VideoCommon/VertexManagerBase.h"
+#include "VideoCommon/VideoConfig.h"
 
-// Official SVN repository and contact information can be found at
-// http://code.google.com/p/dolphin-emu/
+using namespace OpcodeDecoder;
 
-// TODO: Handle cache-is-full condition :p
+namespace DLCache
+{
+// Entries that haven't been called for this many frames get dropped.
+constexpr u32 DL_CACHE_EXPIRE_FRAMES = 120;
+// Upper bound for the converted vertex data kept by the cache.
+constexpr size_t DL_CACHE_MAX_BYTES = 64 * 1024 * 1024;
 
+constexpr s32 NO_DRAW = -1;
 
-#include "Common.h"
-#include "DLCache.h"
+struct CachedDraw
+{
+  // nullptr until the draw has been converted with a cacheable state.
+  VertexLoaderBase* loader = nullptr;
+  u32 posmtx = 0;
+  s32 count = 0;
+  std::vector<u8> data;
+};
 
-namespace DLCache
+struct DLOp
 {
+  // Command range inside the display list.
+  u32 begin;
+  u32 end;
+  // Index into CachedDisplayList::draws, NO_DRAW for a run of register loads.
+  s32 draw;
+};
+
+struct CachedDisplayList
+{
+  u64 hash = 0;
+  u32 check_context = 0;
+  size_t data_size = 0;
+  // Contains commands the cache can't replay, the caller interprets it instead.
+  bool uncacheable = false;
+  // The command layout no longer matches the recorded ops.
+  bool stale = false;
+  std::vector<DLOp> ops;
+  std::vector<CachedDraw> draws;
+};
+
+static std::unordered_map<u64, CachedDisplayList> s_cache;
+static u32 s_check_context;
+static size_t s_cached_bytes;
 
 void Init()
 {
+  s_cache.clear();
+  s_check_context = 1;
+  s_cached_bytes = 0;
 }
 
 void Shutdown()
 {
+  Clear();
 }
 
-void Clear() 
+void Clear()
 {
+  s_cache.clear();
+  s_cached_bytes = 0;
 }
 
 void ProgressiveCleanup()
 {
+  for (auto iter = s_cache.begin(); iter != s_cache.end();)
+  {
+    if (s_check_context - iter->second.check_context > DL_CACHE_EXPIRE_FRAMES)
+    {
+      s_cached_bytes -= iter->second.data_size;
+      iter = s_cache.erase(iter);
+    }
+    else
+    {
+      ++iter;
+    }
+  }
+}
+
+void IncrementCheckContextId()
+{
+  s_check_context++;
 }
-}  // namespace
 
-// NOTE - outside the namespace on purpose.
-bool HandleDisplayList(u32 address, u32 size)
+static bool IsCacheableFormat(const TVtxDesc& vtx_desc)
 {
-	return false;
+  // The CPU bounding box is updated by the vertex loaders themselves.
+  if (g_ActiveConfig.iBBoxMode == BBoxCPU)
+    return false;
+  // Only arrays 0 through 11 are used by the vertex loaders.
+  for (int i = 0; i < 12; i++)
+  {
+    if (vtx_desc.GetVertexArrayStatus(i) >= 0x2)
+      return false;
+  }
+  return true;
 }
 
-void IncrementCheckContextId()
+static u32 RunCommands(u8* start, u8* end)
+{
+  u32 cycles = 0;
+  if (start < end)
+  {
+    g_VideoData.SetReadPosition(start, end);
+    OpcodeDecoder::Run<false, false>(g_VideoData, &cycles);
+  }
+  return cycles;
+}
+
+// Executes the draw command at data + pos, replaying the recorded vertices when
+// the current state matches the one they were converted with.
+// Returns false if the display list ends before the vertex data does.
+static bool ExecuteDraw(CachedDisplayList& entry, CachedDraw& draw, u8* data, u32 size, u32 pos,
+                        u32* readsize, u32* cycles)
+{
+  const u8 cmd_byte = data[pos];
+  const u32 count = Common::swap16(data + pos + 1);
+  const u32 header_size = 1 + GX_DRAW_PRIMITIVES_SIZE;
+  VertexLoaderParameters parameters;
+  SetupDrawParameters(parameters, g_main_cp_state, cmd_byte, count, data + pos + header_size,
+                      size - pos - header_size);
+
+  VertexLoaderBase* loader = VertexLoaderManager::GetActiveLoader(parameters);
+  const u32 posmtx =
+      g_main_cp_state.vtx_desc.PosMatIdx ? 0 : g_main_cp_state.matrix_index_a.PosNormalMtxIdx;
+  u32 writesize = 0;
+  if (draw.loader == loader && draw.posmtx == posmtx)
+  {
+    if (!VertexLoaderManager::ReplayVertices(parameters, loader, draw.data.data(), draw.count,
+                                             *readsize, writesize))
+      return false;
+    if (!parameters.skip_draw)
+      ADDSTAT(stats.thisFrame.bytesDListVertexSkipped, *readsize);
+  }
+  else
+  {
+    if (!VertexLoaderManager::ConvertVertices(parameters, *readsize, writesize))
+      return false;
+    if (!parameters.skip_draw && IsCacheableFormat(g_main_cp_state.vtx_desc) &&
+        s_cached_bytes - draw.data.size() + writesize <= DL_CACHE_MAX_BYTES)
+    {
+      s_cached_bytes = s_cached_bytes - draw.data.size() + writesize;
+      entry.data_size = entry.data_size - draw.data.size() + writesize;
+      draw.loader = loader;
+      draw.posmtx = posmtx;
+      draw.count = writesize / loader->m_native_stride;
+      draw.data.assign(parameters.destination, parameters.destination + writesize);
+    }
+  }
+  g_vertex_manager->IncCurrentBufferPointer(writesize);
+  *cycles += GX_NOP_CYCLES + GX_DRAW_PRIMITIVES_CYCLES * count;
+  return true;
+}
+
+// Returns the size of the non-draw command at data + pos, or 0 if the cache
+// can't handle it.
+static u32 GetCommandSize(const u8* data, u32 size, u32 pos)
+{
+  switch (data[pos])
+  {
+  case GX_NOP:
+  case GX_UNKNOWN_RESET:
+  case GX_CMD_UNKNOWN_METRICS:
+  case GX_CMD_INVL_VC:
+    return 1;
+  case GX_LOAD_CP_REG:
+    return 1 + GX_LOAD_CP_REG_SIZE;
+  case GX_LOAD_XF_REG:
+    if (size - pos < 1 + GX_LOAD_XF_REG_SIZE)
+      return 0;
+    return 1 + GX_LOAD_XF_REG_SIZE + (((Common::swap32(data + pos + 1) >> 16) & 15) + 1) * sizeof(u32);
+  case GX_LOAD_INDX_A:
+  case GX_LOAD_INDX_B:
+  case GX_LOAD_INDX_C:
+  case GX_LOAD_INDX_D:
+    return 1 + GX_LOAD_INDX_SIZE;
+  case GX_LOAD_BP_REG:
+    return 1 + GX_LOAD_BP_REG_SIZE;
+  default:
+    // Nested display list calls and unknown opcodes.
+    return 0;
+  }
+}
+
+static u32 CompileDisplayList(CachedDisplayList& entry, u8* data, u32 size)
+{
+  u32 cycles = 0;
+  u32 segment_start = 0;
+  u32 pos = 0;
+  while (pos < size)
+  {
+    const u8 cmd_byte = data[pos];
+    const bool is_draw = (cmd_byte & GX_DRAW_PRIMITIVES) == 0x80;
+    if (is_draw && size - pos >= 1u + GX_DRAW_PRIMITIVES_SIZE && Common::swap16(data + pos + 1) != 0)
+    {
+      // Flush the pending register loads so the draw sees the right vertex state.
+      if (segment_start != pos)
+      {
+        cycles += RunCommands(data + segment_start, data + pos);
+        entry.ops.push_back({segment_start, pos, NO_DRAW});
+      }
+      entry.draws.emplace_back();
+      u32 readsize = 0;
+      if (!ExecuteDraw(entry, entry.draws.back(), data, size, pos, &readsize, &cycles))
+      {
+        entry.uncacheable = true;
+        return cycles;
+      }
+      const u32 draw_end = pos + 1 + GX_DRAW_PRIMITIVES_SIZE + readsize;
+      entry.ops.push_back({pos, draw_end, static_cast<s32>(entry.draws.size() - 1)});
+      pos = segment_start = draw_end;
+      continue;
+    }
+
+    const u32 cmd_size = is_draw ? 1 + GX_DRAW_PRIMITIVES_SIZE : GetCommandSize(data, size, pos);
+    if (cmd_size == 0 || cmd_size > size - pos)
+    {
+      // Let the decoder deal with whatever is left, this display list won't be replayed.
+      entry.uncacheable = true;
+      return cycles + RunCommands(data + segment_start, data + size);
+    }
+    pos += cmd_size;
+  }
+  if (segment_start != size)
+  {
+    cycles += RunCommands(data + segment_start, data + size);
+    entry.ops.push_back({segment_start, size, NO_DRAW});
+  }
+  // Nothing to gain for display lists that only load registers.
+  if (entry.draws.empty())
+    entry.uncacheable = true;
+  return cycles;
+}
+
+static u32 ReplayDisplayList(CachedDisplayList& entry, u8* data, u32 size)
+{
+  u32 cycles = 0;
+  for (const DLOp& op : entry.ops)
+  {
+    if (op.draw == NO_DRAW)
+    {
+      cycles += RunCommands(data + op.begin, data + op.end);
+      continue;
+    }
+    u32 readsize = 0;
+    if (!ExecuteDraw(entry, entry.draws[op.draw], data, size, op.begin, &readsize, &cycles))
+      break;
+    const u32 draw_end = op.begin + 1 + GX_DRAW_PRIMITIVES_SIZE + readsize;
+    if (draw_end != op.end)
+    {
+      // The vertex size changed since the display list was compiled, so the
+      // recorded command boundaries are useless from here on.
+      entry.stale = true;
+      cycles += RunCommands(data + draw_end, data + size);
+      break;
+    }
+  }
+  return cycles;
+}
+
+bool HandleDisplayList(u32 address, u32 size, u8* data, u32* cycles)
 {
+  if (!g_ActiveConfig.bDisplayListCache || size == 0)
+    return false;
+
+  const u64 key = static_cast<u64>(address) << 32 | size;
+  auto iter = s_cache.find(key);
+  if (iter != s_cache.end())
+  {
+    CachedDisplayList& entry = iter->second;
+    if (!entry.stale && entry.check_context != s_check_context)
+    {
+      entry.stale = GetHash64(data, size, 0) != entry.hash;
+      entry.check_context = s_check_context;
+    }
+    if (!entry.stale)
+    {
+      if (entry.uncacheable)
+        return false;
+      INCSTAT(stats.thisFrame.numDListCacheHits);
+      *cycles = ReplayDisplayList(entry, data, size);
+      return true;
+    }
+    s_cached_bytes -= entry.data_size;
+    s_cache.erase(iter);
+  }
+
+  if (s_cached_bytes >= DL_CACHE_MAX_BYTES)
+    return false;
+
+  INCSTAT(stats.thisFrame.numDListCacheMisses);
+  CachedDisplayList& entry = s_cache[key];
+  entry.hash = GetHash64(data, size, 0);
+  entry.check_context = s_check_context;
+  *cycles = CompileDisplayList(entry, data, size);
+  return true;
 }
+}  // namespace DLCache
@@ -28,6 +28,9 @@ void GetGeometryShaderUid(GeometryShaderUid& out, PrimitiveType primitive_type,
 {
   out.ClearUID();
   geometry_shader_uid_data& uid_data = out.GetUidData<geometry_shader_uid_data>();
+  // Strips with primitive restart reach the geometry shader as separate triangles
+  if (primitive_type == PrimitiveType::TriangleStrip)
+    primitive_type = PrimitiveType::Triangles;
   uid_data.primitive_type = static_cast<u32>(primitive_type);
   uid_data.numTexGens = xfr.numTexGen.numTexGens;
   bool forced_lighting_enabled =
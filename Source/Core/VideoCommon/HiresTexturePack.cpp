@@ -0,0 +1,187 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "VideoCommon/HiresTexturePack.h"
+
+#include <algorithm>
+#include <cstring>
+#include <xxhash.h>
+
+#include "Common/Align.h"
+#include "Common/FileUtil.h"
+#include "Common/Logging/Log.h"
+#include "VideoCommon/TextureUtil.h"
+
+u64 HiresTexturePack::HashName(const std::string& name)
+{
+  return XXH64(name.data(), name.size(), 0);
+}
+
+u64 HiresTexturePack::GetUploadSize(const IndexEntry& entry)
+{
+  if (entry.format == PC_TEX_FMT_NONE || entry.format >= PC_TEX_NUM_FORMATS || entry.width == 0 ||
+      entry.width > MAX_DIMENSION || entry.height == 0 || entry.height > MAX_DIMENSION ||
+      entry.levels == 0 || entry.levels > MAX_LEVELS)
+  {
+    return 0;
+  }
+
+  // Same level chain TextureCacheBase::Load walks. Like TextureUtil::GetTextureSizeInBytes, which
+  // overflows for the sizes checked here, every level is rounded up to 4x4 texels.
+  const u64 block_size =
+      TextureUtil::GetTextureSizeInBytes(4, 4, static_cast<HostTextureFormat>(entry.format));
+  u64 color_size = 0;
+  for (u32 level = 0; level < entry.levels; ++level)
+  {
+    const u64 width = TextureUtil::CalculateLevelSize(entry.width, level);
+    const u64 height = TextureUtil::CalculateLevelSize(entry.height, level);
+    color_size += (width + 3) / 4 * ((height + 3) / 4) * block_size;
+  }
+  return color_size * (1 + (entry.nrm_levels ? 1 : 0) + (entry.lum_levels ? 1 : 0));
+}
+
+bool HiresTexturePack::Open(const std::string& filename)
+{
+  m_index = nullptr;
+  m_names = nullptr;
+  m_num_textures = 0;
+  if (!m_mapping.Open(filename))
+    return false;
+
+  Header header = {};
+  const u64 size = m_mapping.GetSize();
+  if (size >= sizeof(header))
+    std::memcpy(&header, m_mapping.GetData(), sizeof(header));
+  // The offsets come from the file, the checks are written so huge ones can't wrap around
+  const u64 index_size = u64(header.num_textures) * sizeof(IndexEntry);
+  if (header.magic != MAGIC || header.version != VERSION ||
+      header.index_offset % alignof(IndexEntry) != 0 || header.index_offset > size ||
+      index_size > size - header.index_offset || header.names_offset > size ||
+      header.names_size > size - header.names_offset)
+  {
+    ERROR_LOG(VIDEO, "Invalid custom texture pack %s", filename.c_str());
+    m_mapping.Close();
+    return false;
+  }
+
+  m_index = reinterpret_cast<const IndexEntry*>(m_mapping.GetData() + header.index_offset);
+  m_names = reinterpret_cast<const char*>(m_mapping.GetData() + header.names_offset);
+  m_num_textures = header.num_textures;
+  for (size_t i = 0; i < m_num_textures; ++i)
+  {
+    const IndexEntry& entry = m_index[i];
+    // The upload reads every level straight from the mapping, all of them have to be there
+    const u64 upload_size = GetUploadSize(entry);
+    if (u64(entry.name_offset) + entry.name_length > header.names_size ||
+        entry.data_offset > size || entry.data_size > size - entry.data_offset ||
+        upload_size == 0 || entry.data_size < upload_size)
+    {
+      ERROR_LOG(VIDEO, "Invalid custom texture pack %s", filename.c_str());
+      m_mapping.Close();
+      m_index = nullptr;
+      m_names = nullptr;
+      m_num_textures = 0;
+      return false;
+    }
+  }
+  return true;
+}
+
+const HiresTexturePack::IndexEntry* HiresTexturePack::FindEntry(const std::string& name) const
+{
+  const u64 hash = HashName(name);
+  const IndexEntry* end = m_index + m_num_textures;
+  const IndexEntry* iter =
+      std::lower_bound(m_index, end, hash,
+                       [](const IndexEntry& entry, u64 value) { return entry.name_hash < value; });
+  for (; iter != end && iter->name_hash == hash; ++iter)
+  {
+    if (iter->name_length == name.size() &&
+        std::memcmp(m_names + iter->name_offset, name.data(), name.size()) == 0)
+    {
+      return iter;
+    }
+  }
+  return nullptr;
+}
+
+bool HiresTexturePack::Find(const std::string& name, Texture* texture) const
+{
+  const IndexEntry* entry = FindEntry(name);
+  if (!entry)
+    return false;
+
+  texture->format = static_cast<HostTextureFormat>(entry->format);
+  texture->width = entry->width;
+  texture->height = entry->height;
+  texture->levels = entry->levels;
+  texture->nrm_levels = entry->nrm_levels;
+  texture->lum_levels = entry->lum_levels;
+  texture->has_arbitrary_mips = (entry->flags & FLAG_ARBITRARY_MIPS) != 0;
+  texture->data = m_mapping.GetData() + entry->data_offset;
+  texture->size = entry->data_size;
+  return true;
+}
+
+bool HiresTexturePack::Writer::Open(const std::string& filename)
+{
+  m_index.clear();
+  m_names.clear();
+  if (!m_file.Open(filename, "wb"))
+    return false;
+  // Filled in by Finish
+  const Header header = {};
+  m_offset = sizeof(header);
+  return m_file.WriteBytes(&header, sizeof(header));
+}
+
+bool HiresTexturePack::Writer::Add(const std::string& name, const Texture& texture)
+{
+  static const u8 padding[DATA_ALIGNMENT] = {};
+  const u64 data_offset = Common::AlignUpSizePow2(m_offset, DATA_ALIGNMENT);
+  if (!m_file.WriteBytes(padding, data_offset - m_offset) ||
+      !m_file.WriteBytes(texture.data, texture.size))
+  {
+    return false;
+  }
+  m_offset = data_offset + texture.size;
+
+  IndexEntry entry = {};
+  entry.name_hash = HashName(name);
+  entry.data_offset = data_offset;
+  entry.data_size = texture.size;
+  entry.name_offset = static_cast<u32>(m_names.size());
+  entry.name_length = static_cast<u32>(name.size());
+  entry.format = texture.format;
+  entry.width = texture.width;
+  entry.height = texture.height;
+  entry.levels = texture.levels;
+  entry.nrm_levels = texture.nrm_levels;
+  entry.lum_levels = texture.lum_levels;
+  entry.flags = texture.has_arbitrary_mips ? FLAG_ARBITRARY_MIPS : 0;
+  m_index.push_back(entry);
+  m_names += name;
+  return true;
+}
+
+bool HiresTexturePack::Writer::Finish()
+{
+  std::stable_sort(m_index.begin(), m_index.end(), [](const IndexEntry& a, const IndexEntry& b) {
+    return a.name_hash < b.name_hash;
+  });
+
+  static const u8 padding[DATA_ALIGNMENT] = {};
+  Header header = {};
+  header.magic = MAGIC;
+  header.version = VERSION;
+  header.num_textures = static_cast<u32>(m_index.size());
+  header.index_offset = Common::AlignUpSizePow2(m_offset, DATA_ALIGNMENT);
+  header.names_offset = header.index_offset + m_index.size() * sizeof(IndexEntry);
+  header.names_size = m_names.size();
+  const bool written = m_file.WriteBytes(padding, header.index_offset - m_offset) &&
+                       m_file.WriteArray(m_index.data(), m_index.size()) &&
+                       m_file.WriteBytes(m_names.data(), m_names.size()) &&
+                       m_file.Seek(0, SEEK_SET) && m_file.WriteBytes(&header, sizeof(header));
+  return m_file.Close() && written;
+}
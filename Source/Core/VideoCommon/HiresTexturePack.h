@@ -0,0 +1,128 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/File.h"
+#include "Common/MappedFile.h"
+#include "VideoCommon/TextureDecoder.h"
+
+// A custom texture pack packed into a single file, built from a texture directory by
+// ishiiruka-texpack. The file is memory mapped, so mounting a pack only touches its index
+// and texture data is handed to the upload straight from the mapping.
+//
+// The textures keep the layout HiresTexture::Load produces: the color levels followed by the
+// normal and emissive map levels, all back to back in upload order, so the offset of every
+// level follows from the size and format. DDS files are stored with their BCn blocks as they
+// are, other images as RGBA32.
+//
+// On disk format:
+// header{
+// u32 'HTPK';
+// u32 version;
+// u32 num_textures;
+// u32 reserved;
+// u64 index_offset;
+// u64 names_offset;
+// u64 names_size;
+// u64 reserved;
+// }
+// u8 data[];  // every texture aligned to DATA_ALIGNMENT
+// IndexEntry index[num_textures];  // sorted by name_hash
+// char names[names_size];
+class HiresTexturePack
+{
+public:
+  struct Texture
+  {
+    HostTextureFormat format;
+    u32 width;
+    u32 height;
+    u32 levels;
+    u32 nrm_levels;
+    u32 lum_levels;
+    bool has_arbitrary_mips;
+    const u8* data;
+    u64 size;
+  };
+
+  class Writer;
+
+  bool Open(const std::string& filename);
+  bool Find(const std::string& name, Texture* texture) const;
+  bool Contains(const std::string& name) const { return FindEntry(name) != nullptr; }
+  size_t GetTextureCount() const { return m_num_textures; }
+
+private:
+  static constexpr u32 MAGIC = 0x4B505448;  // "HTPK"
+  static constexpr u32 VERSION = 1;
+  static constexpr u64 DATA_ALIGNMENT = 64;
+  // Keeps the sizes of the level chain well inside 64 bits
+  static constexpr u32 MAX_DIMENSION = 65536;
+  static constexpr u32 MAX_LEVELS = 17;
+
+  struct Header
+  {
+    u32 magic;
+    u32 version;
+    u32 num_textures;
+    u32 reserved;
+    u64 index_offset;
+    u64 names_offset;
+    u64 names_size;
+    u64 reserved2;
+  };
+
+  struct IndexEntry
+  {
+    u64 name_hash;
+    u64 data_offset;
+    u64 data_size;
+    u32 name_offset;
+    u32 name_length;
+    u32 format;
+    u32 width;
+    u32 height;
+    u32 levels;
+    u32 nrm_levels;
+    u32 lum_levels;
+    u32 flags;
+    u32 reserved;
+  };
+
+  enum : u32
+  {
+    FLAG_ARBITRARY_MIPS = 1,
+  };
+
+  static u64 HashName(const std::string& name);
+  // The bytes the upload reads: the levels of the color map and of the normal and emissive maps
+  // if there are any. 0 if the texture can't be uploaded at all.
+  static u64 GetUploadSize(const IndexEntry& entry);
+  const IndexEntry* FindEntry(const std::string& name) const;
+
+  File::MappedFile m_mapping;
+  const IndexEntry* m_index = nullptr;
+  const char* m_names = nullptr;
+  size_t m_num_textures = 0;
+};
+
+// Streams the texture data to the file, the index is written by Finish.
+class HiresTexturePack::Writer
+{
+public:
+  bool Open(const std::string& filename);
+  bool Add(const std::string& name, const Texture& texture);
+  bool Finish();
+
+private:
+  File::IOFile m_file;
+  std::vector<IndexEntry> m_index;
+  std::string m_names;
+  u64 m_offset = 0;
+};
@@ -3,12 +3,16 @@
 // Refer to the license.txt file included.
 
 #include <algorithm>
+#include <atomic>
 #include <cinttypes>
+#include <climits>
 #include <cstring>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 #include <xxhash.h>
@@ -20,6 +24,7 @@
 #include "Common/FileSearch.h"
 #include "Common/FileUtil.h"
 #include "Common/Flag.h"
+#include "Common/Hash.h"
 #include "Common/Logging/Log.h"
 #include "Common/MemoryUtil.h"
 #include "Common/StringUtil.h"
@@ -27,12 +32,13 @@
 #include "Common/Thread.h"
 #include "Common/Timer.h"
 
-#include "Core/Config/GraphicsSettings.h"
 #include "Core/ConfigManager.h"
 #include "Core/Host.h"
 
+#include "VideoCommon/HiresTexturePack.h"
 #include "VideoCommon/HiresTextures.h"
 #include "VideoCommon/ImageLoader.h"
+#include "VideoCommon/ObjectUsageProfiler.h"
 #include "VideoCommon/OnScreenDisplay.h"
 #include "VideoCommon/TextureUtil.h"
 #include "VideoCommon/VideoConfig.h"
@@ -104,23 +110,59 @@ typedef std::unordered_map<std::string, HiresTextureCacheItem> HiresTextureCache
 typedef std::unordered_map<std::string, EnvTextureCacheItem> EnvTextureCache;
 static HiresTextureCache s_textureMap;
 static EnvTextureCache s_enviromentMap;
-typedef std::unordered_map<std::string, std::shared_ptr<HiresTexture>> TextureCache;
+struct CachedTexture
+{
+  std::shared_ptr<HiresTexture> texture;
+  // Textures are evicted in order of last use, the ones that were only prefetched (0) first
+  // and among those the ones furthest back in the prefetch order.
+  u64 last_used;
+  size_t rank;
+};
+typedef std::unordered_map<std::string, CachedTexture> TextureCache;
 static TextureCache s_textureCache;
 static TextureCache s_enviromentCache;
+static u64 s_usage_tick = 0;
+static std::vector<std::shared_ptr<HiresTexturePack>> s_texture_packs;
 
 static std::mutex s_textureCacheMutex;
 static Common::Flag s_textureCacheAbortLoading;
 
 static std::atomic<size_t> size_sum;
-static size_t max_mem = 0;
+static std::atomic<size_t> max_mem{0};
 static std::thread s_prefetcher;
 
+struct PrefetchItem
+{
+  const std::string* basename;
+  bool enviroment;
+};
+// Most used textures of earlier sessions first, the workers claim the items in order
+static std::vector<PrefetchItem> s_prefetch_queue;
+static std::atomic<size_t> s_prefetch_next;
+static size_t s_prefetch_done = 0;
+static size_t s_prefetch_notification = 0;
+static Common::Flag s_prefetch_budget_reached;
+
+// Counts which textures a game loads, keyed by the hash of the name
+struct HiresTextureUsage
+{
+};
+typedef ObjectUsageProfiler<u64, pKey_t, HiresTextureUsage, std::hash<u64>> HiresUsageProfiler;
+static constexpr pKey_t HIRES_USAGE_PROFILE_VERSION = 1;
+static std::unique_ptr<HiresUsageProfiler> s_usage_profile;
+
+static u64 HashBaseName(const std::string& basename)
+{
+  return XXH64(basename.data(), basename.size(), 0);
+}
+
 static const std::string s_format_prefix = "tex1_";
 static const std::string s_enviroment_prefix = "env_";
+static const std::string s_pack_extension = ".texpack";
 
 HiresTexture::HiresTexture()
     : m_format(PC_TEX_FMT_NONE), m_height(0), m_levels(0), m_nrm_levels(0), m_lum_levels(0),
-      m_cached_data(nullptr), m_cached_data_size(0)
+      m_cached_data(nullptr), m_cached_data_size(0), m_packed_data(nullptr)
 {
 }
 
@@ -141,9 +183,16 @@ void HiresTexture::Shutdown()
     s_textureCacheAbortLoading.Set();
     s_prefetcher.join();
   }
+  if (s_usage_profile)
+  {
+    s_usage_profile->Persist();
+    s_usage_profile.reset();
+  }
   s_textureMap.clear();
   s_enviromentMap.clear();
   s_textureCache.clear();
+  s_texture_packs.clear();
+  s_prefetch_queue.clear();
 }
 
 std::set<std::string> HiresTexture::GetTextureDirectory(const std::string& game_id)
@@ -318,6 +367,12 @@ void HiresTexture::Update()
     s_textureCacheAbortLoading.Set();
     s_prefetcher.join();
   }
+  s_prefetch_queue.clear();
+  if (s_usage_profile)
+  {
+    s_usage_profile->Persist();
+    s_usage_profile.reset();
+  }
 
   if (!g_ActiveConfig.bHiresTextures)
   {
@@ -325,6 +380,7 @@ void HiresTexture::Update()
     s_enviromentMap.clear();
     s_textureCache.clear();
     s_enviromentCache.clear();
+    s_texture_packs.clear();
     size_sum.store(0);
     return;
   }
@@ -338,7 +394,13 @@ void HiresTexture::Update()
 
   s_textureMap.clear();
   s_enviromentMap.clear();
+  s_texture_packs.clear();
   const std::string& game_id = SConfig::GetInstance().GetGameID();
+  const pKey_t game_hash = GetMurmurHash3(reinterpret_cast<const u8*>(game_id.data()),
+                                          static_cast<u32>(game_id.size()), 0);
+  s_usage_profile.reset(HiresUsageProfiler::Create(game_hash, HIRES_USAGE_PROFILE_VERSION,
+                                                   "Ishiiruka.hires",
+                                                   StringFromFormat("%s.hires", game_id.c_str())));
   const std::set<std::string> texture_directories = GetTextureDirectory(game_id);
   const std::string resource_directory = File::GetSysDirectory() + RESOURCES_DIR DIR_SEP;
   std::vector<std::string> Extensions;
@@ -348,44 +410,29 @@ void HiresTexture::Update()
     Extensions.push_back(".dds");
   }
 
-  std::vector<std::string> Resourcefilenames =
-      Common::DoFileSearch({resource_directory}, Extensions, /*recursive*/ true);
+  ProcessDirectory(resource_directory, Extensions, BuildMaterialMaps);
+  for (const auto& texture_directory : texture_directories)
+    ProcessDirectory(texture_directory, Extensions, BuildMaterialMaps);
 
-  for (const std::string& fileitem : Resourcefilenames)
+  // Packs are built from the final textures, they can't be used to build material maps
+  if (!BuildMaterialMaps)
   {
-    std::string filename;
-    std::string extension;
-    SplitPath(fileitem, nullptr, &filename, &extension);
-    if (filename.rfind(s_format_prefix, 0) == 0)
+    std::vector<std::string> pack_filenames;
+    for (const auto& texture_directory : texture_directories)
     {
-      ProccessTexture(fileitem, filename, extension, BuildMaterialMaps);
+      const std::vector<std::string> filenames =
+          Common::DoFileSearch({texture_directory}, {s_pack_extension}, /*recursive*/ true);
+      pack_filenames.insert(pack_filenames.end(), filenames.begin(), filenames.end());
     }
-    else if (filename.rfind(s_enviroment_prefix, 0) == 0)
+    std::sort(pack_filenames.begin(), pack_filenames.end());
+    for (const std::string& filename : pack_filenames)
     {
-      filename = filename.substr(s_enviroment_prefix.length());
-      ProccessEnviroment(fileitem, filename, extension);
-    }
-  }
-
-  for (const auto& texture_directory : texture_directories)
-  {
-    std::vector<std::string> filenames =
-        Common::DoFileSearch({texture_directory}, Extensions, /*recursive*/ true);
-
-    for (const std::string& fileitem : filenames)
-    {
-      std::string filename;
-      std::string extension;
-      SplitPath(fileitem, nullptr, &filename, &extension);
-      if (filename.rfind(s_format_prefix, 0) == 0)
-      {
-        ProccessTexture(fileitem, filename, extension, BuildMaterialMaps);
-      }
-      else if (filename.rfind(s_enviroment_prefix, 0) == 0)
-      {
-        filename = filename.substr(s_enviroment_prefix.length());
-        ProccessEnviroment(fileitem, filename, extension);
-      }
+      auto pack = std::make_shared<HiresTexturePack>();
+      if (!pack->Open(filename))
+        continue;
+      INFO_LOG(VIDEO, "Mounted custom texture pack %s with %zu textures", filename.c_str(),
+               pack->GetTextureCount());
+      s_texture_packs.push_back(std::move(pack));
     }
   }
 
@@ -397,7 +444,7 @@ void HiresTexture::Update()
     {
       if (s_textureMap.find(iter->first) == s_textureMap.end())
       {
-        size_sum.fetch_sub(iter->second->m_cached_data_size);
+        size_sum.fetch_sub(iter->second.texture->m_cached_data_size);
         iter = s_textureCache.erase(iter);
       }
       else
@@ -411,7 +458,7 @@ void HiresTexture::Update()
     {
       if (s_enviromentMap.find(iterenv->first) == s_enviromentMap.end())
       {
-        size_sum.fetch_sub(iterenv->second->m_cached_data_size);
+        size_sum.fetch_sub(iterenv->second.texture->m_cached_data_size);
         iterenv = s_enviromentCache.erase(iterenv);
       }
       else
@@ -419,6 +466,27 @@ void HiresTexture::Update()
         iterenv++;
       }
     }
+
+    // Prefetch the textures the game used most in earlier sessions first
+    std::unordered_map<u64, const std::string*> by_hash;
+    by_hash.reserve(s_textureMap.size());
+    for (const auto& entry : s_textureMap)
+      by_hash.emplace(HashBaseName(entry.first), &entry.first);
+    std::unordered_set<const std::string*> queued;
+    s_prefetch_queue.reserve(s_textureMap.size() + s_enviromentMap.size());
+    s_usage_profile->ForEachMostUsed([&](const u64& hash) {
+      auto texture = by_hash.find(hash);
+      if (texture != by_hash.end() && queued.insert(texture->second).second)
+        s_prefetch_queue.push_back({texture->second, false});
+    });
+    for (const auto& entry : s_textureMap)
+    {
+      if (!queued.count(&entry.first))
+        s_prefetch_queue.push_back({&entry.first, false});
+    }
+    for (const auto& entry : s_enviromentMap)
+      s_prefetch_queue.push_back({&entry.first, true});
+
     s_textureCacheAbortLoading.Clear();
     s_prefetcher = std::thread(Prefetch);
     if (g_ActiveConfig.bWaitForCacheHiresTextures && s_prefetcher.joinable())
@@ -428,130 +496,160 @@ void HiresTexture::Update()
   }
 }
 
-void HiresTexture::Prefetch()
+void HiresTexture::ProcessDirectory(const std::string& directory,
+                                    const std::vector<std::string>& extensions,
+                                    bool BuildMaterialMaps)
 {
-  Common::SetCurrentThreadName("Prefetcher");
-  const size_t total = s_textureMap.size() + s_enviromentMap.size();
-  size_t count = 0;
-  size_t notification = 10;
-  u32 starttime = Common::Timer::GetTimeMs();
-  for (const auto& entry : s_textureMap)
-  {
-    const std::string& base_filename = entry.first;
-
-    std::unique_lock<std::mutex> lk(s_textureCacheMutex);
+  std::vector<std::string> filenames =
+      Common::DoFileSearch({directory}, extensions, /*recursive*/ true);
 
-    auto iter = s_textureCache.find(base_filename);
-    if (iter == s_textureCache.end())
+  for (const std::string& fileitem : filenames)
+  {
+    std::string filename;
+    std::string extension;
+    SplitPath(fileitem, nullptr, &filename, &extension);
+    if (filename.rfind(s_format_prefix, 0) == 0)
     {
-      lk.unlock();
-      HiresTexture* ptr = Load(
-          base_filename, [](size_t requested_size) { return new u8[requested_size]; }, true);
-      lk.lock();
-      if (ptr != nullptr)
-      {
-        size_sum.fetch_add(ptr->m_cached_data_size);
-        iter = s_textureCache.insert(
-            iter, std::make_pair(base_filename, std::shared_ptr<HiresTexture>(ptr)));
-      }
+      ProccessTexture(fileitem, filename, extension, BuildMaterialMaps);
     }
-
-    if (s_textureCacheAbortLoading.IsSet())
+    else if (filename.rfind(s_enviroment_prefix, 0) == 0)
     {
-      if (g_ActiveConfig.bWaitForCacheHiresTextures)
-      {
-        Host_UpdateProgressDialog("", -1, -1);
-      }
-      return;
+      filename = filename.substr(s_enviroment_prefix.length());
+      ProccessEnviroment(fileitem, filename, extension);
     }
+  }
+}
 
-    if (size_sum.load() > max_mem)
-    {
-      Config::SetCurrent(Config::GFX_HIRES_TEXTURES, false);
+// Makes room for new textures by dropping the least recently used ones, s_textureCacheMutex
+// has to be held.
+static void EvictTextures(const std::string& keep)
+{
+  const size_t target_size = max_mem / 10 * 9;
+  std::vector<TextureCache::iterator> candidates;
+  candidates.reserve(s_textureCache.size());
+  for (auto iter = s_textureCache.begin(); iter != s_textureCache.end(); ++iter)
+  {
+    if (iter->first != keep)
+      candidates.push_back(iter);
+  }
+  std::sort(candidates.begin(), candidates.end(),
+            [](const TextureCache::iterator& a, const TextureCache::iterator& b) {
+              if (a->second.last_used != b->second.last_used)
+                return a->second.last_used < b->second.last_used;
+              return a->second.rank > b->second.rank;
+            });
+
+  size_t evicted = 0;
+  for (const auto& iter : candidates)
+  {
+    if (size_sum.load() <= target_size)
+      break;
+    size_sum.fetch_sub(iter->second.texture->m_cached_data_size);
+    s_textureCache.erase(iter);
+    evicted++;
+  }
+  INFO_LOG(VIDEO, "Evicted %zu custom textures, %.1f MB cached", evicted,
+           size_sum / (1024.0 * 1024.0));
+}
 
-      OSD::AddMessage(
-          StringFromFormat(
-              "Custom Textures prefetching after %.1f MB aborted, not enough RAM available",
-              size_sum / (1024.0 * 1024.0)),
-          10000);
-      if (g_ActiveConfig.bWaitForCacheHiresTextures)
-      {
-        Host_UpdateProgressDialog("", -1, -1);
-      }
-      return;
-    }
-    count++;
-    size_t percent = (count * 100) / total;
-    if (percent >= notification)
-    {
-      if (g_ActiveConfig.bWaitForCacheHiresTextures)
-      {
-        Host_UpdateProgressDialog(GetStringT("Prefetching Custom Textures...").c_str(),
-                                  static_cast<int>(count), static_cast<int>(total));
-      }
-      else
-      {
-        OSD::AddMessage(StringFromFormat("Custom Textures prefetching %.1f MB %zu %% finished",
-                                         size_sum / (1024.0 * 1024.0), percent),
-                        2000);
-      }
-      notification += 10;
-    }
+void HiresTexture::SetMemoryBudget(size_t bytes)
+{
+  std::lock_guard<std::mutex> lk(s_textureCacheMutex);
+  max_mem = bytes;
+  if (size_sum.load() > max_mem)
+    EvictTextures("");
+}
+
+void HiresTexture::Prefetch()
+{
+  Common::SetCurrentThreadName("Prefetcher");
+  u32 starttime = Common::Timer::GetTimeMs();
+  s_prefetch_next.store(0);
+  s_prefetch_done = 0;
+  s_prefetch_notification = 10;
+  s_prefetch_budget_reached.Clear();
+
+  // Leave some cores to the emulation unless it waits for the prefetch anyway
+  const u32 cores = std::max(std::thread::hardware_concurrency(), 1u);
+  const u32 worker_count = g_ActiveConfig.bWaitForCacheHiresTextures ? cores :
+                                                                        std::max(cores / 2, 1u);
+  std::vector<std::thread> workers;
+  for (u32 i = 1; i < worker_count; ++i)
+  {
+    workers.emplace_back([] {
+      Common::SetCurrentThreadName("Prefetch Worker");
+      PrefetchWorker();
+    });
+  }
+  PrefetchWorker();
+  for (std::thread& worker : workers)
+    worker.join();
+
+  if (g_ActiveConfig.bWaitForCacheHiresTextures)
+  {
+    Host_UpdateProgressDialog("", -1, -1);
   }
+  if (s_textureCacheAbortLoading.IsSet())
+  {
+    return;
+  }
+  if (s_prefetch_budget_reached.IsSet())
+  {
+    OSD::AddMessage(
+        StringFromFormat("Custom Textures prefetching stopped after %.1f MB, memory budget reached",
+                         size_sum / (1024.0 * 1024.0)),
+        10000);
+    return;
+  }
+  u32 stoptime = Common::Timer::GetTimeMs();
+  OSD::AddMessage(StringFromFormat("Custom Textures loaded, %.1f MB in %.1f s",
+                                   size_sum / (1024.0 * 1024.0), (stoptime - starttime) / 1000.0),
+                  10000);
+}
 
-  for (const auto& entry : s_enviromentMap)
+void HiresTexture::PrefetchWorker()
+{
+  const size_t total = s_prefetch_queue.size();
+  size_t index;
+  while (!s_textureCacheAbortLoading.IsSet() && !s_prefetch_budget_reached.IsSet() &&
+         (index = s_prefetch_next.fetch_add(1)) < total)
   {
-    const std::string& base_filename = entry.first;
+    const PrefetchItem& item = s_prefetch_queue[index];
+    const std::string& base_filename = *item.basename;
+    TextureCache& cache = item.enviroment ? s_enviromentCache : s_textureCache;
 
     std::unique_lock<std::mutex> lk(s_textureCacheMutex);
-
-    auto iter = s_enviromentCache.find(base_filename);
-    if (iter == s_enviromentCache.end())
+    if (cache.find(base_filename) == cache.end())
     {
       lk.unlock();
-      HiresTexture* ptr = LoadEnviroment(
-          base_filename, [](size_t requested_size) { return new u8[requested_size]; }, true);
+      // Everything cached so far is more important than the rest of the queue, so the
+      // prefetch stops instead of evicting textures once the budget is used up.
+      if (size_sum.load() > max_mem)
+      {
+        s_prefetch_budget_reached.Set();
+        break;
+      }
+      const auto allocate = [](size_t requested_size) { return new u8[requested_size]; };
+      HiresTexture* ptr = item.enviroment ? LoadEnviroment(base_filename, allocate, true) :
+                                            Load(base_filename, allocate, true);
       lk.lock();
       if (ptr != nullptr)
       {
-        size_sum.fetch_add(ptr->m_cached_data_size);
-        iter = s_enviromentCache.insert(
-            iter, std::make_pair(base_filename, std::shared_ptr<HiresTexture>(ptr)));
+        auto result = cache.emplace(
+            base_filename, CachedTexture{std::shared_ptr<HiresTexture>(ptr), 0, index});
+        if (result.second)
+          size_sum.fetch_add(ptr->m_cached_data_size);
       }
     }
 
-    if (s_textureCacheAbortLoading.IsSet())
-    {
-      if (g_ActiveConfig.bWaitForCacheHiresTextures)
-      {
-        Host_UpdateProgressDialog("", -1, -1);
-      }
-      return;
-    }
-
-    if (size_sum.load() > max_mem)
-    {
-      Config::SetCurrent(Config::GFX_HIRES_TEXTURES, false);
-
-      OSD::AddMessage(
-          StringFromFormat(
-              "Custom Textures prefetching after %.1f MB aborted, not enough RAM available",
-              size_sum / (1024.0 * 1024.0)),
-          10000);
-      if (g_ActiveConfig.bWaitForCacheHiresTextures)
-      {
-        Host_UpdateProgressDialog("", -1, -1);
-      }
-      return;
-    }
-    count++;
-    size_t percent = (count * 100) / total;
-    if (percent >= notification)
+    s_prefetch_done++;
+    size_t percent = (s_prefetch_done * 100) / total;
+    if (percent >= s_prefetch_notification)
     {
       if (g_ActiveConfig.bWaitForCacheHiresTextures)
       {
         Host_UpdateProgressDialog(GetStringT("Prefetching Custom Textures...").c_str(),
-                                  static_cast<int>(count), static_cast<int>(total));
+                                  static_cast<int>(s_prefetch_done), static_cast<int>(total));
       }
       else
       {
@@ -559,18 +657,9 @@ void HiresTexture::Prefetch()
                                          size_sum / (1024.0 * 1024.0), percent),
                         2000);
       }
-      notification += 10;
+      s_prefetch_notification = percent - percent % 10 + 10;
     }
   }
-
-  if (g_ActiveConfig.bWaitForCacheHiresTextures)
-  {
-    Host_UpdateProgressDialog("", -1, -1);
-  }
-  u32 stoptime = Common::Timer::GetTimeMs();
-  OSD::AddMessage(StringFromFormat("Custom Textures loaded, %.1f MB in %.1f s",
-                                   size_sum / (1024.0 * 1024.0), (stoptime - starttime) / 1000.0),
-                  10000);
 }
 
 std::string HiresTexture::GenBaseName(const u8* texture, size_t texture_size, const u8* tlut,
@@ -626,11 +715,18 @@ std::string HiresTexture::GenBaseName(const u8* texture, size_t texture_size, co
   std::string fullname = basename + tlutname + formatname;
   std::string wildcardname = basename + "_$" + formatname;
 
-  if (!dump && s_textureMap.find(wildcardname) != s_textureMap.end())
+  const auto exists = [](const std::string& texture_name) {
+    if (s_textureMap.find(texture_name) != s_textureMap.end())
+      return true;
+    return std::any_of(s_texture_packs.begin(), s_texture_packs.end(),
+                       [&texture_name](const auto& pack) { return pack->Contains(texture_name); });
+  };
+
+  if (!dump && exists(wildcardname))
     return wildcardname;
 
     // else generate the complete texture
-  if (dump || s_textureMap.find(fullname) != s_textureMap.end())
+  if (dump || exists(fullname))
     return fullname;
 
   return "";
@@ -752,6 +848,13 @@ std::shared_ptr<HiresTexture>
 HiresTexture::Search(const std::string& basename,
                      std::function<u8*(size_t)> request_buffer_delegate)
 {
+  // Loose files override the packs
+  if (s_textureMap.find(basename) == s_textureMap.end())
+    return s_texture_packs.empty() ? nullptr : SearchPacks(basename);
+
+  if (s_usage_profile)
+    s_usage_profile->GetOrAdd(HashBaseName(basename));
+
   if (g_ActiveConfig.bCacheHiresTextures)
   {
     std::unique_lock<std::mutex> lk(s_textureCacheMutex);
@@ -759,31 +862,68 @@ HiresTexture::Search(const std::string& basename,
     auto iter = s_textureCache.find(basename);
     if (iter != s_textureCache.end())
     {
-      HiresTexture* current = iter->second.get();
+      iter->second.last_used = ++s_usage_tick;
+      HiresTexture* current = iter->second.texture.get();
       u8* dst = request_buffer_delegate(current->m_cached_data_size);
       memcpy(dst, current->m_cached_data.get(), current->m_cached_data_size);
-      return iter->second;
+      return iter->second.texture;
     }
     lk.unlock();
-    if (size_sum.load() < max_mem)
+    std::shared_ptr<HiresTexture> ptr(
+        Load(basename, [](size_t requested_size) { return new u8[requested_size]; }, true));
+    lk.lock();
+    if (ptr)
     {
-      std::shared_ptr<HiresTexture> ptr(Load(
-          basename, [](size_t requested_size) { return new u8[requested_size]; }, true));
-      lk.lock();
-      if (ptr)
-      {
-        s_textureCache[basename] = ptr;
-        HiresTexture* current = ptr.get();
-        size_sum.fetch_add(current->m_cached_data_size);
-        u8* dst = request_buffer_delegate(current->m_cached_data_size);
-        memcpy(dst, current->m_cached_data.get(), current->m_cached_data_size);
-      }
-      return ptr;
+      auto result =
+          s_textureCache.emplace(basename, CachedTexture{ptr, ++s_usage_tick, SIZE_MAX});
+      if (result.second)
+        size_sum.fetch_add(ptr->m_cached_data_size);
+      else
+        result.first->second.last_used = s_usage_tick;
+      HiresTexture* current = ptr.get();
+      u8* dst = request_buffer_delegate(current->m_cached_data_size);
+      memcpy(dst, current->m_cached_data.get(), current->m_cached_data_size);
+      if (size_sum.load() > max_mem)
+        EvictTextures(basename);
     }
+    return ptr;
   }
   return std::shared_ptr<HiresTexture>(Load(basename, request_buffer_delegate, false));
 }
 
+std::shared_ptr<HiresTexture> HiresTexture::SearchPacks(const std::string& basename)
+{
+  for (const auto& pack : s_texture_packs)
+  {
+    HiresTexturePack::Texture texture;
+    if (!pack->Find(basename, &texture))
+      continue;
+    if (!g_ActiveConfig.backend_info.bSupportedFormats[texture.format])
+    {
+      ERROR_LOG(VIDEO, "Custom texture %s uses a format not supported by the backend",
+                basename.c_str());
+      return nullptr;
+    }
+
+    // No copy, the upload reads straight from the mapping
+    std::shared_ptr<HiresTexture> ret(new HiresTexture());
+    ret->m_format = texture.format;
+    ret->m_width = texture.width;
+    ret->m_height = texture.height;
+    ret->m_levels = texture.levels;
+    ret->has_arbitrary_mips = texture.has_arbitrary_mips;
+    if (g_ActiveConfig.HiresMaterialMapsEnabled())
+    {
+      ret->m_nrm_levels = texture.nrm_levels;
+      ret->m_lum_levels = texture.lum_levels;
+    }
+    ret->m_packed_data = texture.data;
+    ret->m_pack = pack;
+    return ret;
+  }
+  return nullptr;
+}
+
 bool HiresTexture::EnviromentExists(const std::string& basename)
 {
   if (s_enviromentMap.size() == 0 || !g_ActiveConfig.HiresMaterialMapsEnabled())
@@ -809,10 +949,10 @@ HiresTexture::SearchEnviroment(const std::string& basename,
     auto iter = s_enviromentCache.find(basename);
     if (iter != s_enviromentCache.end())
     {
-      HiresTexture* current = iter->second.get();
+      HiresTexture* current = iter->second.texture.get();
       u8* dst = request_buffer_delegate(current->m_cached_data_size);
       memcpy(dst, current->m_cached_data.get(), current->m_cached_data_size);
-      return iter->second;
+      return iter->second.texture;
     }
     lk.unlock();
     if (size_sum.load() < max_mem)
@@ -822,9 +962,10 @@ HiresTexture::SearchEnviroment(const std::string& basename,
       lk.lock();
       if (ptr)
       {
-        s_enviromentCache[basename] = ptr;
+        auto result = s_enviromentCache.emplace(basename, CachedTexture{ptr, 0, SIZE_MAX});
+        if (result.second)
+          size_sum.fetch_add(ptr->m_cached_data_size);
         HiresTexture* current = ptr.get();
-        size_sum.fetch_add(current->m_cached_data_size);
         u8* dst = request_buffer_delegate(current->m_cached_data_size);
         memcpy(dst, current->m_cached_data.get(), current->m_cached_data_size);
       }
@@ -1274,3 +1415,86 @@ HiresTexture* HiresTexture::LoadEnviroment(const std::string& basename,
   }
   return ret;
 }
+
+static u64 GetLevelsSize(u32 width, u32 height, u32 levels, HostTextureFormat format)
+{
+  u64 size = 0;
+  for (u32 level = 0; level < levels; ++level)
+  {
+    size += TextureUtil::GetTextureSizeInBytes(TextureUtil::CalculateLevelSize(width, level),
+                                               TextureUtil::CalculateLevelSize(height, level),
+                                               format);
+  }
+  return size;
+}
+
+bool HiresTexture::BuildPack(const std::string& directory, const std::string& output,
+                             const std::function<void(size_t, size_t)>& progress_callback)
+{
+  s_textureMap.clear();
+  s_enviromentMap.clear();
+  ProcessDirectory(directory, {".png", ".dds"}, false);
+
+  // Sorted so the same directory always gives the same file
+  std::vector<std::string> names;
+  names.reserve(s_textureMap.size());
+  for (const auto& entry : s_textureMap)
+    names.push_back(entry.first);
+  std::sort(names.begin(), names.end());
+
+  HiresTexturePack::Writer writer;
+  if (!writer.Open(output))
+  {
+    ERROR_LOG(VIDEO, "Failed to create custom texture pack %s", output.c_str());
+    s_textureMap.clear();
+    s_enviromentMap.clear();
+    return false;
+  }
+
+  bool success = true;
+  for (size_t i = 0; i < names.size() && success; ++i)
+  {
+    progress_callback(i, names.size());
+    std::unique_ptr<HiresTexture> texture(
+        Load(names[i], [](size_t requested_size) { return new u8[requested_size]; }, true));
+    if (!texture)
+    {
+      WARN_LOG(VIDEO, "Skipping custom texture %s", names[i].c_str());
+      continue;
+    }
+
+    // Same layout the upload in TextureCacheBase reads from the buffer
+    const u64 color_size = GetLevelsSize(texture->m_width, texture->m_height, texture->m_levels,
+                                         texture->m_format);
+    const u64 size = color_size * (1 + (texture->m_nrm_levels ? 1 : 0) +
+                                   (texture->m_lum_levels ? 1 : 0));
+    if (size > texture->m_cached_data_size)
+    {
+      WARN_LOG(VIDEO, "Skipping custom texture %s with incomplete levels", names[i].c_str());
+      continue;
+    }
+
+    HiresTexturePack::Texture packed = {};
+    packed.format = texture->m_format;
+    packed.width = texture->m_width;
+    packed.height = texture->m_height;
+    packed.levels = texture->m_levels;
+    packed.nrm_levels = texture->m_nrm_levels;
+    packed.lum_levels = texture->m_lum_levels;
+    packed.has_arbitrary_mips = texture->has_arbitrary_mips;
+    packed.data = texture->m_cached_data.get();
+    packed.size = size;
+    success = writer.Add(names[i], packed);
+  }
+  success = writer.Finish() && success;
+  progress_callback(names.size(), names.size());
+
+  s_textureMap.clear();
+  s_enviromentMap.clear();
+  if (!success)
+  {
+    ERROR_LOG(VIDEO, "Failed to write custom texture pack %s", output.c_str());
+    File::Delete(output);
+  }
+  return success;
+}
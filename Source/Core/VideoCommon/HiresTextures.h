@@ -14,12 +14,17 @@
 #include "VideoCommon/TextureDecoder.h"
 #include "VideoCommon/VideoCommon.h"
 
+class HiresTexturePack;
+
 class HiresTexture
 {
 public:
   static void Init();
   static void Update();
   static void Shutdown();
+  // Replaces the memory budget Init derives from the physical memory, evicts textures right away
+  // when more than the new budget is cached.
+  static void SetMemoryBudget(size_t bytes);
 
   static std::shared_ptr<HiresTexture> Search(const std::string& basename,
                                               std::function<u8*(size_t)> request_buffer_delegate);
@@ -33,18 +38,31 @@ public:
                                  size_t tlut_size, u32 width, u32 height, int format,
                                  bool has_mipmaps, bool dump = false);
 
+  // Packs every custom texture found in directory into a single file which can be memory
+  // mapped, see HiresTexturePack. Environment maps are left out.
+  static bool BuildPack(const std::string& directory, const std::string& output,
+                        const std::function<void(size_t, size_t)>& progress_callback);
+
   ~HiresTexture(){};
   HostTextureFormat m_format;
   u32 m_width, m_height, m_levels, m_nrm_levels, m_lum_levels;
   bool has_arbitrary_mips;
   std::unique_ptr<u8> m_cached_data;
   size_t m_cached_data_size;
+  // Set instead of filling the requested buffer when the texture comes from a mounted pack,
+  // points into the mapping which m_pack keeps alive.
+  const u8* m_packed_data;
+  std::shared_ptr<const HiresTexturePack> m_pack;
 
 private:
   static void ProccessTexture(const std::string& fileitem, std::string& filename,
                               const std::string& extension, const bool BuildMaterialMaps);
   static void ProccessEnviroment(const std::string& fileitem, std::string& filename,
                                  const std::string& extension);
+  static void ProcessDirectory(const std::string& directory,
+                               const std::vector<std::string>& extensions,
+                               bool BuildMaterialMaps);
+  static std::shared_ptr<HiresTexture> SearchPacks(const std::string& basename);
   static HiresTexture* Load(const std::string& base_filename,
                             std::function<u8*(size_t)> request_buffer_delegate, bool cacheresult);
   static HiresTexture* LoadEnviroment(const std::string& base_filename,
@@ -52,6 +70,7 @@ private:
                                       bool cacheresult);
 
   static void Prefetch();
+  static void PrefetchWorker();
   HiresTexture();
   static std::set<std::string> GetTextureDirectory(const std::string& game_id);
 };
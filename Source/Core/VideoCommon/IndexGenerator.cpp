@@ -3,92 +3,168 @@
 // Refer to the license.txt file included.
 
 #include <cstddef>
+#include <cstring>
 
 #include "Common/CommonTypes.h"
+#include "Common/Intrinsics.h"
 #include "Common/Logging/Log.h"
 #include "VideoCommon/IndexGenerator.h"
 #include "VideoCommon/OpcodeDecoding.h"
 #include "VideoCommon/VideoConfig.h"
 
 //Init
-u16 *IndexGenerator::index_buffer_current;
-u16 *IndexGenerator::BASEIptr;
+u8 *IndexGenerator::index_buffer_current;
+u8 *IndexGenerator::BASEIptr;
 u32 IndexGenerator::base_index;
+u32 IndexGenerator::index_shift = 1;
+bool IndexGenerator::primitive_restart;
 
-static void(*primitive_table[8])(u32);
+namespace
+{
+typedef u8* (*PrimitiveFunction)(u8* buffer, u32 numVerts, u32 index);
 
-void IndexGenerator::Init()
+// [32 bit indices][primitive restart][primitive]
+PrimitiveFunction primitive_table[2][2][8];
+PrimitiveFunction* active_table = primitive_table[0][0];
+
+template <typename T>
+constexpr T RestartIndex()
 {
-  primitive_table[OpcodeDecoder::GX_DRAW_QUADS] = IndexGenerator::AddQuads;
-#if defined(_DEBUG) || defined(DEBUGFAST)
-  primitive_table[OpcodeDecoder::GX_DRAW_QUADS_2] = IndexGenerator::AddQuads_nonstandard;
-#else
-  primitive_table[OpcodeDecoder::GX_DRAW_QUADS_2] = IndexGenerator::AddQuads;
-#endif
-  primitive_table[OpcodeDecoder::GX_DRAW_TRIANGLES] = IndexGenerator::AddList;
-  primitive_table[OpcodeDecoder::GX_DRAW_TRIANGLE_STRIP] = IndexGenerator::AddStrip;
-  primitive_table[OpcodeDecoder::GX_DRAW_TRIANGLE_FAN] = IndexGenerator::AddFan;
-  primitive_table[OpcodeDecoder::GX_DRAW_LINES] = &IndexGenerator::AddLineList;
-  primitive_table[OpcodeDecoder::GX_DRAW_LINE_STRIP] = &IndexGenerator::AddLineStrip;
-  primitive_table[OpcodeDecoder::GX_DRAW_POINTS] = &IndexGenerator::AddPoints;
+  return static_cast<T>(-1);
 }
 
-void IndexGenerator::Start(u16* Indexptr)
+/*
+ * All primitives are expanded by repeating a block of indices. Every following block adds step
+ * to the indices of the previous one, restart indices and the center of fans have a step of 0.
+ * The blocks are a multiple of 16 bytes for u16 and u32 indices, so they are written with whole
+ * vector stores.
+ */
+template <typename T, u32 N>
+T* WriteBlocks(T* ptr, const T (&first)[N], const T (&step)[N], u32 count)
 {
-  index_buffer_current = Indexptr;
-  BASEIptr = Indexptr;
-  base_index = 0;
+#if _M_SSE >= 0x200
+  constexpr u32 LANES = 16 / sizeof(T);
+  constexpr u32 VECTORS = N / LANES;
+  static_assert(N % LANES == 0, "blocks are made of whole vectors");
+
+  __m128i block[VECTORS];
+  __m128i increment[VECTORS];
+  for (u32 v = 0; v < VECTORS; ++v)
+  {
+    block[v] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + v * LANES));
+    increment[v] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(step + v * LANES));
+  }
+  for (u32 i = 0; i < count; ++i)
+  {
+    for (u32 v = 0; v < VECTORS; ++v)
+    {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(ptr) + v, block[v]);
+      block[v] = sizeof(T) == 2 ? _mm_add_epi16(block[v], increment[v]) :
+                                  _mm_add_epi32(block[v], increment[v]);
+    }
+    ptr += N;
+  }
+#else
+  T block[N];
+  std::memcpy(block, first, sizeof(block));
+  for (u32 i = 0; i < count; ++i)
+  {
+    std::memcpy(ptr, block, sizeof(block));
+    for (u32 j = 0; j < N; ++j)
+      block[j] += step[j];
+    ptr += N;
+  }
+#endif
+  return ptr;
 }
 
-void IndexGenerator::AddIndices(int primitive, u32 numVerts)
+// Writes the count indices index, index + 1, ...
+template <typename T>
+T* WriteSequence(T* ptr, u32 index, u32 count)
 {
-  primitive_table[primitive](numVerts);
-  base_index += numVerts;
+  constexpr u32 N = 16;
+  T first[N];
+  T step[N];
+  for (u32 j = 0; j < N; ++j)
+  {
+    first[j] = index + j;
+    step[j] = N;
+  }
+  ptr = WriteBlocks(ptr, first, step, count / N);
+  for (u32 i = count / N * N; i < count; ++i)
+    *ptr++ = index + i;
+  return ptr;
 }
 
-// Triangles
-__forceinline u16* IndexGenerator::WriteTriangle(u16* ptr, u32 index1, u32 index2, u32 index3)
+template <typename T, bool pr>
+__forceinline T* WriteTriangle(T* ptr, u32 index1, u32 index2, u32 index3)
 {
   *ptr++ = index1;
   *ptr++ = index2;
   *ptr++ = index3;
+  if (pr)
+    *ptr++ = RestartIndex<T>();
   return ptr;
 }
 
-void IndexGenerator::AddList(u32 const numVerts)
+// Triangles
+template <typename T, bool pr>
+u8* AddList(u8* buffer, u32 numVerts, u32 index)
 {
-  u32 i = base_index + 2;
-  u32 top = (base_index + numVerts);
-  u16* ptr = index_buffer_current;
-  while (i < top)
+  T* ptr = reinterpret_cast<T*>(buffer);
+  const u32 triangles = numVerts / 3;
+  if (!pr)
+    return reinterpret_cast<u8*>(WriteSequence(ptr, index, triangles * 3));
+
+  // 6 triangles with restart indices per block
+  T first[24];
+  T step[24];
+  for (u32 j = 0; j < 24; ++j)
   {
-    ptr = WriteTriangle(ptr, i - 2, i - 1, i);
-    i += 3;
+    const bool restart = (j & 3) == 3;
+    first[j] = restart ? RestartIndex<T>() : index + j / 4 * 3 + (j & 3);
+    step[j] = restart ? 0 : 18;
   }
-  index_buffer_current = ptr;
+  ptr = WriteBlocks(ptr, first, step, triangles / 6);
+  for (u32 i = index + triangles / 6 * 18; i < index + triangles * 3; i += 3)
+    ptr = WriteTriangle<T, true>(ptr, i, i + 1, i + 2);
+  return reinterpret_cast<u8*>(ptr);
 }
 
-void IndexGenerator::AddStrip(u32 const numVerts)
+template <typename T, bool pr>
+u8* AddStrip(u8* buffer, u32 numVerts, u32 index)
 {
-  u16* ptr = index_buffer_current;
-  u32 top = (base_index + numVerts);
-  u32 a = base_index;
-  u32 i = a + 2;
-  u32 wind = 1;
-  while (i < top)
+  T* ptr = reinterpret_cast<T*>(buffer);
+  if (numVerts < 3)
+    return buffer;
+
+  if (pr)
+  {
+    ptr = WriteSequence(ptr, index, numVerts);
+    *ptr++ = RestartIndex<T>();
+    return reinterpret_cast<u8*>(ptr);
+  }
+
+  // Every odd triangle swaps its last two vertices to keep the winding, 8 triangles per block
+  T first[24];
+  T step[24];
+  for (u32 j = 0; j < 24; ++j)
+  {
+    const u32 triangle = j / 3;
+    const u32 vertex = j % 3;
+    const u32 offset = vertex == 0 ? 0 : (vertex == 1) == !(triangle & 1) ? 1 : 2;
+    first[j] = index + triangle + offset;
+    step[j] = 8;
+  }
+  const u32 triangles = numVerts - 2;
+  ptr = WriteBlocks(ptr, first, step, triangles / 8);
+  for (u32 i = triangles / 8 * 8; i < triangles; ++i)
   {
-    u32 b = i - wind;
-    wind ^= 1;
-    u32 c = i - wind;
-    ptr = WriteTriangle(
-      ptr,
-      a,
-      b,
-      c);
-    ++i;
-    ++a;
+    const u32 a = index + i;
+    ptr = (i & 1) ? WriteTriangle<T, false>(ptr, a, a + 2, a + 1) :
+                    WriteTriangle<T, false>(ptr, a, a + 1, a + 2);
   }
-  index_buffer_current = ptr;
+  return reinterpret_cast<u8*>(ptr);
 }
 
 /**
@@ -109,19 +185,80 @@ void IndexGenerator::AddStrip(u32 const numVerts)
  *
  * so we use 6 indices for 3 triangles
  */
-
-void IndexGenerator::AddFan(u32 numVerts)
+template <typename T, bool pr>
+u8* AddFan(u8* buffer, u32 numVerts, u32 index)
 {
-  u32 i = base_index + 2;
-  u32 top = (base_index + numVerts);
-  u16* ptr = index_buffer_current;
+  T* ptr = reinterpret_cast<T*>(buffer);
+  if (numVerts < 3)
+    return buffer;
+
+  u32 i = 2;
+  if (pr)
+  {
+    // 4 strips of 3 triangles per block
+    static const u32 strip[6] = {1, 2, 0, 3, 4, 0};
+    T first[24];
+    T step[24];
+    for (u32 j = 0; j < 24; ++j)
+    {
+      const u32 vertex = j % 6;
+      if (vertex == 5)
+      {
+        first[j] = RestartIndex<T>();
+        step[j] = 0;
+      }
+      else if (vertex == 2)
+      {
+        first[j] = index;
+        step[j] = 0;
+      }
+      else
+      {
+        first[j] = index + j / 6 * 3 + strip[vertex];
+        step[j] = 12;
+      }
+    }
+    const u32 blocks = (numVerts - 2) / 12;
+    ptr = WriteBlocks(ptr, first, step, blocks);
+    i += blocks * 12;
 
-  while (i < top)
+    for (; i + 3 <= numVerts; i += 3)
+    {
+      *ptr++ = index + i - 1;
+      *ptr++ = index + i + 0;
+      *ptr++ = index;
+      *ptr++ = index + i + 1;
+      *ptr++ = index + i + 2;
+      *ptr++ = RestartIndex<T>();
+    }
+    for (; i + 2 <= numVerts; i += 2)
+    {
+      *ptr++ = index + i - 1;
+      *ptr++ = index + i + 0;
+      *ptr++ = index;
+      *ptr++ = index + i + 1;
+      *ptr++ = RestartIndex<T>();
+    }
+  }
+  else
   {
-    ptr = WriteTriangle(ptr, base_index, i - 1, i);
-    ++i;
+    // 8 triangles per block, the center vertex stays
+    T first[24];
+    T step[24];
+    for (u32 j = 0; j < 24; ++j)
+    {
+      const u32 vertex = j % 3;
+      first[j] = vertex == 0 ? index : index + j / 3 + vertex;
+      step[j] = vertex == 0 ? 0 : 8;
+    }
+    const u32 blocks = (numVerts - 2) / 8;
+    ptr = WriteBlocks(ptr, first, step, blocks);
+    i += blocks * 8;
   }
-  index_buffer_current = ptr;
+
+  for (; i < numVerts; ++i)
+    ptr = WriteTriangle<T, pr>(ptr, index, index + i - 1, index + i);
+  return reinterpret_cast<u8*>(ptr);
 }
 
 /*
@@ -141,73 +278,179 @@ void IndexGenerator::AddFan(u32 numVerts)
  * A simple triangle has to be rendered for three vertices.
  * ZWW do this for sun rays
  */
-void IndexGenerator::AddQuads(u32 numVerts)
+template <typename T, bool pr>
+u8* AddQuads(u8* buffer, u32 numVerts, u32 index)
 {
-  u32 i = base_index + 3;
-  u32 top = (base_index + numVerts);
-  u16* ptr = index_buffer_current;
-  while (i < top)
+  T* ptr = reinterpret_cast<T*>(buffer);
+  const u32 quads = numVerts / 4;
+  if (pr)
+  {
+    // 8 strips of 1203 per block
+    static const u32 strip[4] = {1, 2, 0, 3};
+    T first[40];
+    T step[40];
+    for (u32 j = 0; j < 40; ++j)
+    {
+      const bool restart = j % 5 == 4;
+      first[j] = restart ? RestartIndex<T>() : index + j / 5 * 4 + strip[j % 5];
+      step[j] = restart ? 0 : 32;
+    }
+    ptr = WriteBlocks(ptr, first, step, quads / 8);
+    for (u32 i = index + quads / 8 * 32; i < index + quads * 4; i += 4)
+    {
+      *ptr++ = i + 1;
+      *ptr++ = i + 2;
+      *ptr++ = i + 0;
+      *ptr++ = i + 3;
+      *ptr++ = RestartIndex<T>();
+    }
+  }
+  else
   {
-    ptr = WriteTriangle(ptr, i - 3, i - 2, i - 1);
-    ptr = WriteTriangle(ptr, i - 3, i - 1, i - 0);
-    i += 4;
+    // 4 quads per block
+    static const u32 triangles[6] = {0, 1, 2, 0, 2, 3};
+    T first[24];
+    T step[24];
+    for (u32 j = 0; j < 24; ++j)
+    {
+      first[j] = index + j / 6 * 4 + triangles[j % 6];
+      step[j] = 16;
+    }
+    ptr = WriteBlocks(ptr, first, step, quads / 4);
+    for (u32 i = index + quads / 4 * 16; i < index + quads * 4; i += 4)
+    {
+      ptr = WriteTriangle<T, false>(ptr, i, i + 1, i + 2);
+      ptr = WriteTriangle<T, false>(ptr, i, i + 2, i + 3);
+    }
   }
 
   // three vertices remaining, so render a triangle
-  if (i == top)
+  if (numVerts % 4 == 3)
   {
-    ptr = WriteTriangle(ptr, top - 3, top - 2, top - 1);
+    const u32 top = index + numVerts;
+    ptr = WriteTriangle<T, pr>(ptr, top - 3, top - 2, top - 1);
   }
-  index_buffer_current = ptr;
+  return reinterpret_cast<u8*>(ptr);
 }
 
-void IndexGenerator::AddQuads_nonstandard(u32 numVerts)
+template <typename T, bool pr>
+u8* AddQuads_nonstandard(u8* buffer, u32 numVerts, u32 index)
 {
   WARN_LOG(VIDEO, "Non-standard primitive drawing command GL_DRAW_QUADS_2");
-  AddQuads(numVerts);
+  return AddQuads<T, pr>(buffer, numVerts, index);
 }
 
 // Lines
-void IndexGenerator::AddLineList(u32 numVerts)
+template <typename T>
+u8* AddLineList(u8* buffer, u32 numVerts, u32 index)
 {
-  u32 i = base_index + 1;
-  u32 top = (base_index + numVerts);
-  u16* ptr = index_buffer_current;
-  while (i < top)
-  {
-    *ptr++ = i - 1;
-    *ptr++ = i;
-    i += 2;
-  }
-  index_buffer_current = ptr;
+  return reinterpret_cast<u8*>(
+      WriteSequence(reinterpret_cast<T*>(buffer), index, numVerts / 2 * 2));
 }
 
 // shouldn't be used as strips as LineLists are much more common
 // so converting them to lists
-void IndexGenerator::AddLineStrip(u32 numVerts)
+template <typename T>
+u8* AddLineStrip(u8* buffer, u32 numVerts, u32 index)
 {
-  u32 i = base_index + 1;
-  u32 top = (base_index + numVerts);
-  u16* ptr = index_buffer_current;
-  while (i < top)
+  T* ptr = reinterpret_cast<T*>(buffer);
+  if (numVerts < 2)
+    return buffer;
+
+  // 12 lines per block
+  T first[24];
+  T step[24];
+  for (u32 j = 0; j < 24; ++j)
+  {
+    first[j] = index + j / 2 + (j & 1);
+    step[j] = 12;
+  }
+  const u32 lines = numVerts - 1;
+  ptr = WriteBlocks(ptr, first, step, lines / 12);
+  for (u32 i = index + lines / 12 * 12; i < index + lines; ++i)
   {
-    *ptr++ = i - 1;
     *ptr++ = i;
-    ++i;
+    *ptr++ = i + 1;
   }
-  index_buffer_current = ptr;
+  return reinterpret_cast<u8*>(ptr);
 }
 
 // Points
-void IndexGenerator::AddPoints(u32 numVerts)
+template <typename T>
+u8* AddPoints(u8* buffer, u32 numVerts, u32 index)
 {
-  u32 i = base_index;
-  u32 top = (base_index + numVerts);
-  u16 *ptr = index_buffer_current;
-  while (i < top)
-  {
-    *ptr++ = i;
-    ++i;
-  }
-  index_buffer_current = ptr;
+  return reinterpret_cast<u8*>(WriteSequence(reinterpret_cast<T*>(buffer), index, numVerts));
+}
+
+template <typename T, bool pr>
+void InitTable(PrimitiveFunction* table)
+{
+  table[OpcodeDecoder::GX_DRAW_QUADS] = AddQuads<T, pr>;
+#if defined(_DEBUG) || defined(DEBUGFAST)
+  table[OpcodeDecoder::GX_DRAW_QUADS_2] = AddQuads_nonstandard<T, pr>;
+#else
+  table[OpcodeDecoder::GX_DRAW_QUADS_2] = AddQuads<T, pr>;
+#endif
+  table[OpcodeDecoder::GX_DRAW_TRIANGLES] = AddList<T, pr>;
+  table[OpcodeDecoder::GX_DRAW_TRIANGLE_STRIP] = AddStrip<T, pr>;
+  table[OpcodeDecoder::GX_DRAW_TRIANGLE_FAN] = AddFan<T, pr>;
+  table[OpcodeDecoder::GX_DRAW_LINES] = AddLineList<T>;
+  table[OpcodeDecoder::GX_DRAW_LINE_STRIP] = AddLineStrip<T>;
+  table[OpcodeDecoder::GX_DRAW_POINTS] = AddPoints<T>;
+}
+}  // namespace
+
+void IndexGenerator::Init()
+{
+  InitTable<u16, false>(primitive_table[0][0]);
+  InitTable<u16, true>(primitive_table[0][1]);
+  InitTable<u32, false>(primitive_table[1][0]);
+  InitTable<u32, true>(primitive_table[1][1]);
+}
+
+template <typename T>
+void IndexGenerator::Start(T* Indexptr)
+{
+  index_buffer_current = reinterpret_cast<u8*>(Indexptr);
+  BASEIptr = reinterpret_cast<u8*>(Indexptr);
+  base_index = 0;
+  index_shift = sizeof(T) == 4 ? 2 : 1;
+  primitive_restart = g_ActiveConfig.backend_info.bSupportsPrimitiveRestart;
+  active_table = primitive_table[sizeof(T) == 4][primitive_restart];
+}
+
+void IndexGenerator::Start(u16* Indexptr)
+{
+  Start<u16>(Indexptr);
+}
+
+void IndexGenerator::Start(u32* Indexptr)
+{
+  Start<u32>(Indexptr);
+}
+
+void IndexGenerator::AddIndices(int primitive, u32 numVerts)
+{
+  index_buffer_current = active_table[primitive](index_buffer_current, numVerts, base_index);
+  base_index += numVerts;
+}
+
+bool IndexGenerator::GetLastTriangle(u32* indices)
+{
+  u32 index_len = GetIndexLen();
+  const u32 restart_index = Uses32BitIndices() ? RestartIndex<u32>() : RestartIndex<u16>();
+  auto read_index = [](u32 i) -> u32 {
+    return Uses32BitIndices() ? reinterpret_cast<const u32*>(BASEIptr)[i] :
+                                reinterpret_cast<const u16*>(BASEIptr)[i];
+  };
+
+  // Any three consecutive indices of a strip form a triangle, the winding doesn't matter here
+  if (primitive_restart && index_len > 0 && read_index(index_len - 1) == restart_index)
+    index_len--;
+  if (index_len < 3)
+    return false;
+
+  for (u32 i = 0; i < 3; ++i)
+    indices[i] = read_index(index_len - 3 + i);
+  return true;
 }
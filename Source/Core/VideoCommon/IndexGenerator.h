@@ -10,7 +10,11 @@ class IndexGenerator
 public:
   // Init
   static void Init();
+  // The index size follows the type of the buffer. When the backend supports primitive restart,
+  // triangles are written as strips separated by restart indices and have to be drawn as
+  // PrimitiveType::TriangleStrip.
   static void Start(u16 *Indexptr);
+  static void Start(u32 *Indexptr);
 
   static void AddIndices(int primitive, u32 numVertices);
 
@@ -22,37 +26,36 @@ public:
 
   static inline u32 GetIndexLen()
   {
-    return (u32)(index_buffer_current - BASEIptr);
+    return (u32)(index_buffer_current - BASEIptr) >> index_shift;
   }
 
   static inline u32 GetRemainingIndices()
   {
-    const u32 max_index = 65534; // -1 is reserved for primitive restart (ogl + dx11)
+    // -1 is reserved for primitive restart (ogl + dx11)
+    const u32 max_index = index_shift == 2 ? 0xFFFFFFFE : 65534;
     return max_index - base_index;
   }
 
-  static inline u16* GetBasePointer()
+  static inline bool Uses32BitIndices()
   {
-    return BASEIptr;
+    return index_shift == 2;
   }
-private:
-  // Triangles
-  static void AddList(u32 numVerts);
-  static void AddStrip(u32 numVerts);
-  static void AddFan(u32 numVerts);
-  static void AddQuads(u32 numVerts);
-  static void AddQuads_nonstandard(u32 numVerts);
 
-  // Lines
-  static void AddLineList(u32 numVerts);
-  static void AddLineStrip(u32 numVerts);
+  static inline bool UsesPrimitiveRestart()
+  {
+    return primitive_restart;
+  }
 
-  // Points
-  static void AddPoints(u32 numVerts);
+  // Looks up the vertices of the last triangle written, returns false if there is none.
+  static bool GetLastTriangle(u32* indices);
 
-  static u16* WriteTriangle(u16 *ptr, u32 index1, u32 index2, u32 index3);
+private:
+  template <typename T>
+  static void Start(T* Indexptr);
 
-  static u16 *index_buffer_current;
-  static u16 *BASEIptr;
+  static u8 *index_buffer_current;
+  static u8 *BASEIptr;
   static u32 base_index;
+  static u32 index_shift;
+  static bool primitive_restart;
 };
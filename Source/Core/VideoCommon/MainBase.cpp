@@ -15,6 +15,7 @@
 #include "VideoCommon/BoundingBox.h"
 #include "VideoCommon/CPMemory.h"
 #include "VideoCommon/CommandProcessor.h"
+#include "VideoCommon/DLCache.h"
 #include "VideoCommon/Fifo.h"
 #include "VideoCommon/GeometryShaderManager.h"
 #include "VideoCommon/TessellationShaderManager.h"
@@ -25,6 +26,7 @@
 #include "VideoCommon/PixelShaderManager.h"
 #include "VideoCommon/RenderBase.h"
 #include "VideoCommon/TextureCacheBase.h"
+#include "VideoCommon/VertexCache.h"
 #include "VideoCommon/VertexLoaderManager.h"
 #include "VideoCommon/VertexShaderManager.h"
 #include "VideoCommon/VideoBackendBase.h"
@@ -213,6 +215,8 @@ void VideoBackendBase::InitializeShared()
   PixelEngine::Init();
   BPInit();
   VertexLoaderManager::Init();
+  DLCache::Init();
+  VertexCache::Init();
   IndexGenerator::Init();
   VertexShaderManager::Init();
   GeometryShaderManager::Init();
@@ -242,6 +246,8 @@ void VideoBackendBase::ShutdownShared()
 
 void VideoBackendBase::CleanupShared()
 {
+  DLCache::Shutdown();
+  VertexCache::Shutdown();
   VertexLoaderManager::Shutdown();
 }
 
@@ -281,5 +287,7 @@ void VideoBackendBase::CheckInvalidState()
 
     BPReload();
     g_texture_cache->Invalidate();
+    DLCache::Clear();
+    VertexCache::Clear();
   }
 }
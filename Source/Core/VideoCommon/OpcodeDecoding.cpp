@@ -12,6 +12,8 @@
 // while interpreting them, and hope that the vertex format doesn't change, though, if you do it right
 // when they are called. The reason is that the vertex format affects the sizes of the vertices.
 
+#include <array>
+
 #include "Common/CommonTypes.h"
 #include "Common/MsgHandler.h"
 #include "Common/Logging/Log.h"
@@ -21,9 +23,11 @@
 #include "VideoCommon/CommandProcessor.h"
 #include "VideoCommon/CPMemory.h"
 #include "VideoCommon/DataReader.h"
+#include "VideoCommon/DLCache.h"
 #include "VideoCommon/Fifo.h"
 #include "VideoCommon/OpcodeDecoding.h"
 #include "VideoCommon/Statistics.h"
+#include "VideoCommon/VertexCache.h"
 #include "VideoCommon/VertexLoaderManager.h"
 #include "VideoCommon/VertexManagerBase.h"
 #include "VideoCommon/VideoCommon.h"
@@ -45,7 +49,7 @@ __forceinline u32 InterpretDisplayList(u32 address, u32 size)
 {
   u8* startAddress;
 
-  if (Fifo::UseDeterministicGPUThread())
+  if (Fifo::UseFifoAuxBuffer())
     startAddress = static_cast<u8*>(Fifo::PopFifoAuxBuffer(size));
   else
     startAddress = static_cast<u8*>(Memory::GetPointer(address));
@@ -58,11 +62,13 @@ __forceinline u32 InterpretDisplayList(u32 address, u32 size)
     u8* old_pVideoData = g_VideoData.GetReadPosition();
     u8* old_pVideoDataEnd = g_VideoData.GetEnd();
 
-    g_VideoData.SetReadPosition(startAddress, startAddress + size);
-
     // temporarily swap dl and non-dl (small "hack" for the stats)
     Statistics::SwapDL();
-    OpcodeDecoder::Run<false, false>(g_VideoData, &cycles);
+    if (g_bRecordFifoData || !DLCache::HandleDisplayList(address, size, startAddress, &cycles))
+    {
+      g_VideoData.SetReadPosition(startAddress, startAddress + size);
+      OpcodeDecoder::Run<false, false>(g_VideoData, &cycles);
+    }
     INCSTAT(stats.thisFrame.numDListsCalled);
     // un-swap
     Statistics::SwapDL();
@@ -134,6 +140,50 @@ static void UnknownOpcode(u8 cmd_byte, const void *buffer, bool preprocess)
   }
 }
 
+// What the decoder does for a command byte, and the size of the fixed part of its payload.
+enum class Command : u8
+{
+  Nop,
+  UnknownReset,
+  LoadCPReg,
+  LoadXFReg,
+  LoadIndexedXF,
+  CallDL,
+  UnknownMetrics,
+  InvalidateVertexCache,
+  LoadBPReg,
+  Draw,
+  Unknown,
+};
+
+struct CommandInfo
+{
+  Command command;
+  u8 size;
+};
+
+static std::array<CommandInfo, 256> BuildCommandTable()
+{
+  std::array<CommandInfo, 256> table;
+  table.fill({Command::Unknown, 0});
+  table[GX_NOP] = {Command::Nop, GX_NOP_SIZE};
+  table[GX_UNKNOWN_RESET] = {Command::UnknownReset, GX_NOP_SIZE};
+  table[GX_LOAD_CP_REG] = {Command::LoadCPReg, GX_LOAD_CP_REG_SIZE};
+  table[GX_LOAD_XF_REG] = {Command::LoadXFReg, GX_LOAD_XF_REG_SIZE};
+  for (u8 cmd : {GX_LOAD_INDX_A, GX_LOAD_INDX_B, GX_LOAD_INDX_C, GX_LOAD_INDX_D})
+    table[cmd] = {Command::LoadIndexedXF, GX_LOAD_INDX_SIZE};
+  table[GX_CMD_CALL_DL] = {Command::CallDL, GX_CMD_CALL_DL_SIZE};
+  table[GX_CMD_UNKNOWN_METRICS] = {Command::UnknownMetrics, GX_CMD_UNKNOWN_METRICS_SIZE};
+  table[GX_CMD_INVL_VC] = {Command::InvalidateVertexCache, GX_CMD_INVL_VC_SIZE};
+  table[GX_LOAD_BP_REG] = {Command::LoadBPReg, GX_LOAD_BP_REG_SIZE};
+  for (u32 cmd = 0x80; cmd < 0xC0; cmd++)
+    table[cmd] = {Command::Draw, GX_DRAW_PRIMITIVES_SIZE};
+  return table;
+}
+
+// Looked up once per command, so Run has a dense switch and a single size check.
+static const std::array<CommandInfo, 256> s_command_table = BuildCommandTable();
+
 DataReadU32xNfunc DataReadU32xFuncs[16] = {
     ReadU32xn<1>,
     ReadU32xn<2>,
@@ -158,6 +208,24 @@ void Init()
   s_bFifoErrorSeen = false;
 }
 
+void SetupDrawParameters(VertexLoaderParameters& parameters, CPState& state, u8 cmd_byte, u32 count, u8* source, size_t buf_size)
+{
+  parameters.count = count;
+  parameters.buf_size = buf_size;
+  parameters.primitive = (cmd_byte & GX_PRIMITIVE_MASK) >> GX_PRIMITIVE_SHIFT;
+  u32 vtx_attr_group = cmd_byte & GX_VAT_MASK;
+  parameters.vtx_attr_group = vtx_attr_group;
+  parameters.needloaderrefresh = (state.attr_dirty & (1u << vtx_attr_group)) != 0;
+  parameters.skip_draw = xfmem.viewport.wd == 0.0f
+    || xfmem.viewport.ht == 0.0f
+    || (bpmem.scissorBR.x + 1 - bpmem.scissorTL.x) == 0
+    || (bpmem.scissorBR.y + 1 - bpmem.scissorTL.y) == 0;
+  parameters.VtxDesc = &state.vtx_desc;
+  parameters.VtxAttr = &state.vtx_attr[vtx_attr_group];
+  parameters.source = source;
+  state.attr_dirty &= ~(1 << vtx_attr_group);
+}
+
 template <bool is_preprocess, bool sizeCheck>
 u8* Run(DataReader& reader, u32* cycles)
 {
@@ -171,24 +239,25 @@ u8* Run(DataReader& reader, u32* cycles)
 
     u8 cmd_byte = reader.Read<u8>();
     size_t distance = reader.size();
+    const CommandInfo info = s_command_table[cmd_byte];
+    if (sizeCheck && distance < info.size)
+      goto end;
 
-    switch (cmd_byte)
+    switch (info.command)
     {
-    case GX_NOP:
+    case Command::Nop:
     {
       totalCycles += GX_NOP_CYCLES; // Hm, this means that we scan over nop streams pretty slowly...
     }
     break;
-    case GX_UNKNOWN_RESET:
+    case Command::UnknownReset:
     {
       totalCycles += GX_NOP_CYCLES; // Datel software uses this command
       DEBUG_LOG(VIDEO, "GX Reset?: %08x", cmd_byte);
     }
     break;
-    case GX_LOAD_CP_REG:
+    case Command::LoadCPReg:
     {
-      if (sizeCheck && distance < GX_LOAD_CP_REG_SIZE)
-        goto end;
       totalCycles += GX_LOAD_CP_REG_CYCLES;
       u8 sub_cmd = reader.Read<u8>();
       u32 value = reader.Read<u32>();
@@ -197,10 +266,8 @@ u8* Run(DataReader& reader, u32* cycles)
         INCSTAT(stats.thisFrame.numCPLoads);
     }
     break;
-    case GX_LOAD_XF_REG:
+    case Command::LoadXFReg:
     {
-      if (sizeCheck && distance < GX_LOAD_XF_REG_SIZE)
-        goto end;
       u32 Cmd2 = reader.Read<u32>();
       distance -= GX_LOAD_XF_REG_SIZE;
       int transfer_size = ((Cmd2 >> 16) & 15) + 1;
@@ -219,13 +286,8 @@ u8* Run(DataReader& reader, u32* cycles)
       }
     }
     break;
-    case GX_LOAD_INDX_A: //used for position matrices
-    case GX_LOAD_INDX_B: //used for normal matrices
-    case GX_LOAD_INDX_C: //used for postmatrices
-    case GX_LOAD_INDX_D: //used for lights
+    case Command::LoadIndexedXF: // A: position matrices, B: normal matrices, C: postmatrices, D: lights
     {
-      if (sizeCheck && distance < GX_LOAD_INDX_SIZE)
-        goto end;
       totalCycles += GX_LOAD_INDX_CYCLES;
       const s32 ref_array = (cmd_byte >> 3) + 8;
       if (is_preprocess)
@@ -234,10 +296,8 @@ u8* Run(DataReader& reader, u32* cycles)
         LoadIndexedXF(reader.Read<u32>(), ref_array);
     }
     break;
-    case GX_CMD_CALL_DL:
+    case Command::CallDL:
     {
-      if (sizeCheck && distance < GX_CMD_CALL_DL_SIZE)
-        goto end;
       u32 address = reader.Read<u32>();
       u32 count = reader.Read<u32>();
       if (is_preprocess)
@@ -246,22 +306,23 @@ u8* Run(DataReader& reader, u32* cycles)
         totalCycles += GX_CMD_CALL_DL_BASE_CYCLES + InterpretDisplayList(address, count);
     }
     break;
-    case GX_CMD_UNKNOWN_METRICS: // zelda 4 swords calls it and checks the metrics registers after that
+    case Command::UnknownMetrics: // zelda 4 swords calls it and checks the metrics registers after that
     {
       totalCycles += GX_CMD_UNKNOWN_METRICS_CYCLES;
       DEBUG_LOG(VIDEO, "GX 0x44: %08x", cmd_byte);
     }
     break;
-    case GX_CMD_INVL_VC: // Invalidate Vertex Cache	
+    case Command::InvalidateVertexCache:
     {
       totalCycles += GX_CMD_INVL_VC_CYCLES;
       DEBUG_LOG(VIDEO, "Invalidate (vertex cache?)");
+      // The game changed its vertex arrays, cached draws have to check them again.
+      if (!is_preprocess)
+        VertexCache::IncrementCheckContextId();
     }
     break;
-    case GX_LOAD_BP_REG:
+    case Command::LoadBPReg:
     {
-      if (sizeCheck && distance < GX_LOAD_BP_REG_SIZE)
-        goto end;
       totalCycles += GX_LOAD_BP_REG_CYCLES;
       u32 bp_cmd = reader.Read<u32>();
       if (is_preprocess)
@@ -270,84 +331,66 @@ u8* Run(DataReader& reader, u32* cycles)
       }
       else
       {
+        // The backend state these change is only generated before the next draw.
         LoadBPReg(bp_cmd);
         INCSTAT(stats.thisFrame.numBPLoads);
       }
     }
     break;
-    // draw primitives 
-    default:
-      if ((cmd_byte & GX_DRAW_PRIMITIVES) == 0x80)
+    case Command::Draw:
+    {
+      // load vertices
+      u32 count = reader.Read<u16>();
+      distance -= GX_DRAW_PRIMITIVES_SIZE;
+      if (count)
       {
-        // load vertices
-        if (sizeCheck && distance < GX_DRAW_PRIMITIVES_SIZE)
-          goto end;
-
-        u32 count = reader.Read<u16>();
-        distance -= GX_DRAW_PRIMITIVES_SIZE;
-        if (count)
+        CPState& state = is_preprocess ? g_preprocess_cp_state : g_main_cp_state;
+        VertexLoaderParameters parameters;
+        SetupDrawParameters(parameters, state, cmd_byte, count, reader.GetReadPosition(), distance);
+        u32 readsize = 0;
+        if (is_preprocess)
         {
-          CPState& state = is_preprocess ? g_preprocess_cp_state : g_main_cp_state;
-          VertexLoaderParameters parameters;
-          parameters.count = count;
-          parameters.buf_size = distance;
-          parameters.primitive = (cmd_byte & GX_PRIMITIVE_MASK) >> GX_PRIMITIVE_SHIFT;
-          u32 vtx_attr_group = cmd_byte & GX_VAT_MASK;
-          parameters.vtx_attr_group = vtx_attr_group;
-          parameters.needloaderrefresh = (state.attr_dirty & (1u << vtx_attr_group)) != 0;
-          parameters.skip_draw = xfmem.viewport.wd == 0.0f
-            || xfmem.viewport.ht == 0.0f
-            || (bpmem.scissorBR.x + 1 - bpmem.scissorTL.x) == 0
-            || (bpmem.scissorBR.y + 1 - bpmem.scissorTL.y) == 0;
-          parameters.VtxDesc = &state.vtx_desc;
-          parameters.VtxAttr = &state.vtx_attr[vtx_attr_group];
-          parameters.source = reader.GetReadPosition();
-          state.attr_dirty &= ~(1 << vtx_attr_group);
-          u32 readsize = 0;
-          if (is_preprocess)
+          readsize = VertexLoaderManager::GetPreprocessVertexSize(parameters) * count;
+          if (distance >= readsize)
           {
-            u32 components = 0;
-            VertexLoaderManager::GetVertexSizeAndComponents(parameters, readsize, components);
-            readsize *= count;
-            if (distance >= readsize)
-            {
-              totalCycles += GX_NOP_CYCLES + GX_DRAW_PRIMITIVES_CYCLES * parameters.count;
-              reader.ReadSkip(readsize);
-            }
-            else
-            {
-              goto end;
-            }
+            totalCycles += GX_NOP_CYCLES + GX_DRAW_PRIMITIVES_CYCLES * parameters.count;
+            reader.ReadSkip(readsize);
           }
           else
           {
-            u32 writesize = 0;
-            if (VertexLoaderManager::ConvertVertices(parameters, readsize, writesize))
-            {
-              totalCycles += GX_NOP_CYCLES + GX_DRAW_PRIMITIVES_CYCLES * parameters.count;
-              reader.ReadSkip(readsize);
-              g_vertex_manager->IncCurrentBufferPointer(writesize);
-            }
-            else
-            {
-              goto end;
-            }
+            goto end;
           }
         }
         else
         {
-          totalCycles += GX_NOP_CYCLES;
+          u32 writesize = 0;
+          if (VertexLoaderManager::ConvertVertices(parameters, readsize, writesize))
+          {
+            totalCycles += GX_NOP_CYCLES + GX_DRAW_PRIMITIVES_CYCLES * parameters.count;
+            reader.ReadSkip(readsize);
+            g_vertex_manager->IncCurrentBufferPointer(writesize);
+          }
+          else
+          {
+            goto end;
+          }
         }
       }
       else
       {
-        if (!s_bFifoErrorSeen)
-          UnknownOpcode(cmd_byte, opcodeStart, is_preprocess);
-        ERROR_LOG(VIDEO, "FIFO: Unknown Opcode(0x%02x @ %p, preprocessing = %s)", cmd_byte, opcodeStart, is_preprocess ? "yes" : "no");
-        s_bFifoErrorSeen = true;
-        totalCycles += 1;
+        totalCycles += GX_NOP_CYCLES;
       }
-      break;
+    }
+    break;
+    default:
+    {
+      if (!s_bFifoErrorSeen)
+        UnknownOpcode(cmd_byte, opcodeStart, is_preprocess);
+      ERROR_LOG(VIDEO, "FIFO: Unknown Opcode(0x%02x @ %p, preprocessing = %s)", cmd_byte, opcodeStart, is_preprocess ? "yes" : "no");
+      s_bFifoErrorSeen = true;
+      totalCycles += 1;
+    }
+    break;
     }
 
     // Display lists get added directly into the FIFO stream
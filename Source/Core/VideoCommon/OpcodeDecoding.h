@@ -6,6 +6,8 @@
 #include "Common/CommonTypes.h"
 
 class DataReader;
+struct CPState;
+struct VertexLoaderParameters;
 
 namespace OpcodeDecoder
 {
@@ -77,6 +79,9 @@ enum GxDrawMode : u32
 
 void Init();
 
+// Fills in the vertex loader parameters for a GX_DRAW_PRIMITIVES command using the given CP state.
+void SetupDrawParameters(VertexLoaderParameters& parameters, CPState& state, u8 cmd_byte, u32 count, u8* source, size_t buf_size);
+
 template <bool is_preprocess = false, bool sizeCheck = true>
 u8* Run(DataReader& reader, u32* cycles);
 
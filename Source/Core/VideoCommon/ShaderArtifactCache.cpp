@@ -0,0 +1,233 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "VideoCommon/ShaderArtifactCache.h"
+
+#include <cstring>
+#include <mutex>
+#include <xxhash.h>
+
+#include "Common/Align.h"
+#include "Common/FileUtil.h"
+#include "Common/Logging/Log.h"
+
+ShaderArtifactCache::~ShaderArtifactCache()
+{
+  Close();
+}
+
+bool ShaderArtifactCache::Open(const std::string& filename)
+{
+  Close();
+  std::unique_lock<std::shared_timed_mutex> lock(m_mutex);
+
+  // A missing file, a file of an older version or a broken header start an empty cache
+  FileHeader header = {};
+  {
+    File::IOFile file(filename, "rb");
+    if (!file.ReadBytes(&header, sizeof(header)) || header.magic != MAGIC ||
+        header.version != VERSION)
+    {
+      file.Close();
+      header = { MAGIC, VERSION };
+      if (!File::IOFile(filename, "wb").WriteBytes(&header, sizeof(header)))
+      {
+        ERROR_LOG(VIDEO, "Failed to create shader artifact cache %s", filename.c_str());
+        return false;
+      }
+    }
+  }
+
+  if (!m_mapping.Open(filename) || !m_file.Open(filename, "ab"))
+  {
+    ERROR_LOG(VIDEO, "Failed to open shader artifact cache %s", filename.c_str());
+    m_mapping.Close();
+    return false;
+  }
+  ForEachRecord(m_mapping.GetData() + sizeof(header), m_mapping.GetSize() - sizeof(header),
+                [this](const u8* payload) {
+                  PayloadHeader payload_header;
+                  std::memcpy(&payload_header, payload, sizeof(payload_header));
+                  m_index.emplace(payload_header.key, payload);
+                });
+  return true;
+}
+
+void ShaderArtifactCache::Close()
+{
+  std::unique_lock<std::shared_timed_mutex> lock(m_mutex);
+  m_index.clear();
+  m_added.clear();
+  m_mapping.Close();
+  m_file.Close();
+}
+
+ShaderArtifactCache::Key ShaderArtifactCache::MakeKey(Stage stage, API_TYPE api,
+                                                      u16 generator_version, const u8* uid_data,
+                                                      u32 uid_size,
+                                                      const ShaderHostConfig& host_config)
+{
+  Key key = {};
+  key.uid_hash = XXH64(uid_data, uid_size, 0);
+  key.host_config = host_config.bits;
+  key.generator_version = generator_version;
+  key.stage = stage;
+  key.api = static_cast<u8>(api);
+  return key;
+}
+
+template <typename F>
+void ShaderArtifactCache::ForEachRecord(const u8* data, u64 size, F&& func)
+{
+  u64 pos = 0;
+  while (pos + sizeof(RecordHeader) <= size)
+  {
+    RecordHeader header;
+    std::memcpy(&header, data + pos, sizeof(header));
+    const u8* payload = data + pos + sizeof(header);
+    const u64 remaining = size - pos - sizeof(header);
+    bool valid = header.magic == RECORD_MAGIC && header.payload_size <= remaining &&
+                 header.payload_size >= sizeof(PayloadHeader);
+    if (valid)
+    {
+      PayloadHeader payload_header;
+      std::memcpy(&payload_header, payload, sizeof(payload_header));
+      valid = sizeof(payload_header) + u64(payload_header.uid_size) +
+                      payload_header.source_size + u64(payload_header.spirv_size) * sizeof(u32) <=
+                  header.payload_size &&
+              XXH64(payload, header.payload_size, 0) == header.checksum;
+    }
+    if (!valid)
+    {
+      // A torn or foreign write, records are word aligned so look for the next one there
+      pos += sizeof(u32);
+      continue;
+    }
+    func(payload);
+    pos += sizeof(header) + header.payload_size;
+  }
+}
+
+bool ShaderArtifactCache::MatchesUid(const u8* payload, const u8* uid_data, u32 uid_size)
+{
+  PayloadHeader header;
+  std::memcpy(&header, payload, sizeof(header));
+  return header.uid_size == uid_size &&
+         std::memcmp(payload + sizeof(header), uid_data, uid_size) == 0;
+}
+
+const u8* ShaderArtifactCache::FindPayload(const Key& key, const u8* uid_data, u32 uid_size) const
+{
+  auto range = m_index.equal_range(key);
+  for (auto iter = range.first; iter != range.second; ++iter)
+  {
+    if (MatchesUid(iter->second, uid_data, uid_size))
+      return iter->second;
+  }
+  return nullptr;
+}
+
+bool ShaderArtifactCache::Lookup(const Key& key, const u8* uid_data, u32 uid_size,
+                                 Artifact* artifact) const
+{
+  std::shared_lock<std::shared_timed_mutex> lock(m_mutex);
+  const u8* payload = FindPayload(key, uid_data, uid_size);
+  if (!payload)
+    return false;
+
+  PayloadHeader header;
+  std::memcpy(&header, payload, sizeof(header));
+  const u8* source = payload + sizeof(header) + header.uid_size;
+  artifact->source.assign(reinterpret_cast<const char*>(source), header.source_size);
+  artifact->spirv.resize(header.spirv_size);
+  if (header.spirv_size)
+  {
+    std::memcpy(artifact->spirv.data(), source + header.source_size,
+                header.spirv_size * sizeof(u32));
+  }
+  return true;
+}
+
+bool ShaderArtifactCache::AppendRecord(const std::vector<u8>& payload)
+{
+  const RecordHeader header = { RECORD_MAGIC, static_cast<u32>(payload.size()),
+                                XXH64(payload.data(), payload.size(), 0) };
+  // One write per record, so records of concurrent writers don't interleave
+  std::vector<u8> record(sizeof(header) + payload.size());
+  std::memcpy(record.data(), &header, sizeof(header));
+  std::memcpy(record.data() + sizeof(header), payload.data(), payload.size());
+  std::unique_ptr<u8[]> copy(new u8[payload.size()]);
+  std::memcpy(copy.get(), payload.data(), payload.size());
+
+  PayloadHeader payload_header;
+  std::memcpy(&payload_header, payload.data(), sizeof(payload_header));
+  m_index.emplace(payload_header.key, copy.get());
+  m_added.push_back(std::move(copy));
+  return m_file.WriteBytes(record.data(), record.size()) && m_file.Flush();
+}
+
+void ShaderArtifactCache::Insert(const Key& key, const u8* uid_data, u32 uid_size,
+                                 const std::string& source, const u32* spirv, size_t spirv_size)
+{
+  std::unique_lock<std::shared_timed_mutex> lock(m_mutex);
+  if (!m_file.IsOpen() || FindPayload(key, uid_data, uid_size))
+    return;
+
+  PayloadHeader header = {};
+  header.key = key;
+  header.uid_size = uid_size;
+  header.source_size = static_cast<u32>(source.size());
+  header.spirv_size = static_cast<u32>(spirv_size);
+  const size_t size = sizeof(header) + uid_size + source.size() + spirv_size * sizeof(u32);
+  std::vector<u8> payload(Common::AlignUpSizePow2(size, sizeof(u32)));
+  u8* dst = payload.data();
+  std::memcpy(dst, &header, sizeof(header));
+  dst += sizeof(header);
+  std::memcpy(dst, uid_data, uid_size);
+  dst += uid_size;
+  std::memcpy(dst, source.data(), source.size());
+  dst += source.size();
+  if (spirv_size)
+    std::memcpy(dst, spirv, spirv_size * sizeof(u32));
+  if (!AppendRecord(payload))
+    ERROR_LOG(VIDEO, "Failed to write to the shader artifact cache");
+}
+
+int ShaderArtifactCache::Merge(const std::string& filename)
+{
+  File::MappedFile other;
+  FileHeader header = {};
+  if (!other.Open(filename) || other.GetSize() < sizeof(header))
+    return -1;
+  std::memcpy(&header, other.GetData(), sizeof(header));
+  if (header.magic != MAGIC || header.version != VERSION)
+    return -1;
+
+  std::unique_lock<std::shared_timed_mutex> lock(m_mutex);
+  if (!m_file.IsOpen())
+    return -1;
+  int added = 0;
+  ForEachRecord(other.GetData() + sizeof(header), other.GetSize() - sizeof(header),
+                [&](const u8* payload) {
+                  PayloadHeader payload_header;
+                  std::memcpy(&payload_header, payload, sizeof(payload_header));
+                  const u8* uid_data = payload + sizeof(payload_header);
+                  if (FindPayload(payload_header.key, uid_data, payload_header.uid_size))
+                    return;
+                  const size_t size = sizeof(payload_header) + payload_header.uid_size +
+                                      payload_header.source_size +
+                                      payload_header.spirv_size * sizeof(u32);
+                  std::vector<u8> copy(payload, payload + size);
+                  copy.resize(Common::AlignUpSizePow2(size, sizeof(u32)));
+                  if (AppendRecord(copy))
+                    added++;
+                });
+  return added;
+}
+
+size_t ShaderArtifactCache::GetEntryCount() const
+{
+  std::shared_lock<std::shared_timed_mutex> lock(m_mutex);
+  return m_index.size();
+}
@@ -0,0 +1,199 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/File.h"
+#include "Common/MappedFile.h"
+#include "VideoCommon/ShaderGenCommon.h"
+#include "VideoCommon/VideoCommon.h"
+
+// Backend neutral store of generated shader source and compiled SPIR-V, shared by all games.
+// Entries are keyed by a hash of the uid data, the host config, the generator version, the
+// stage and the API the source was generated for. The uid data itself is stored too, so hash
+// collisions can't return the wrong shader.
+//
+// The file is append only and every record is checksummed: several emulator instances can add
+// to the same file, a torn record at the end is skipped and caches from other machines can be
+// merged by appending their records. Records added by other processes are picked up by the next
+// Open. Lookups can run concurrently from any thread.
+//
+// On disk format:
+// header{
+// u32 'SART';
+// u32 version;
+// }
+// record{
+// u32 'SREC';
+// u32 payload_size;
+// u64 checksum;  // XXH64 of the payload
+// Key key;
+// u32 uid_size;
+// u32 source_size;
+// u32 spirv_size;  // in words
+// u32 reserved;
+// u8 uid[uid_size];
+// char source[source_size];
+// u32 spirv[spirv_size];
+// }
+class ShaderArtifactCache
+{
+public:
+  enum Stage : u8
+  {
+    STAGE_VERTEX,
+    STAGE_GEOMETRY,
+    STAGE_PIXEL,
+    STAGE_VERTEX_UBER,
+    STAGE_PIXEL_UBER,
+  };
+
+  struct Key
+  {
+    u64 uid_hash;
+    u32 host_config;
+    u16 generator_version;
+    u8 stage;
+    u8 api;
+
+    bool operator==(const Key& rhs) const
+    {
+      return uid_hash == rhs.uid_hash && host_config == rhs.host_config &&
+             generator_version == rhs.generator_version && stage == rhs.stage && api == rhs.api;
+    }
+  };
+
+  struct Artifact
+  {
+    std::string source;
+    std::vector<u32> spirv;
+  };
+
+  ~ShaderArtifactCache();
+
+  // Loads the index of the file and opens it for appending, the file is created if missing.
+  bool Open(const std::string& filename);
+  void Close();
+
+  template <typename UidData>
+  static Key MakeKey(Stage stage, API_TYPE api, u16 generator_version,
+                     const ShaderUid<UidData>& uid, const ShaderHostConfig& host_config)
+  {
+    return MakeKey(stage, api, generator_version, GetUidBytes(uid), GetUidSize(uid),
+                   host_config);
+  }
+  static Key MakeKey(Stage stage, API_TYPE api, u16 generator_version, const u8* uid_data,
+                     u32 uid_size, const ShaderHostConfig& host_config);
+
+  template <typename UidData>
+  static const u8* GetUidBytes(const ShaderUid<UidData>& uid)
+  {
+    return reinterpret_cast<const u8*>(&uid.GetUidData()) + uid.GetUidData().StartValue();
+  }
+  template <typename UidData>
+  static u32 GetUidSize(const ShaderUid<UidData>& uid)
+  {
+    return static_cast<u32>(uid.GetUidData().NumValues());
+  }
+
+  bool Lookup(const Key& key, const u8* uid_data, u32 uid_size, Artifact* artifact) const;
+  // Does nothing if the artifact is present already.
+  void Insert(const Key& key, const u8* uid_data, u32 uid_size, const std::string& source,
+              const u32* spirv, size_t spirv_size);
+
+  // Takes the SPIR-V of a shader from the cache, otherwise generates its source with
+  // generate(ShaderCode&, const ShaderHostConfig&), compiles it with
+  // compile(std::vector<u32>*, const char*, size_t) and adds both to the cache.
+  template <typename UidData, typename GenerateFunction, typename CompileFunction>
+  bool GetOrCompileSPIRV(Stage stage, API_TYPE api, u16 generator_version,
+                         const ShaderUid<UidData>& uid, GenerateFunction&& generate,
+                         CompileFunction&& compile, std::vector<u32>* spirv)
+  {
+    const ShaderHostConfig host_config = ShaderHostConfig::GetCurrent();
+    const u8* uid_data = GetUidBytes(uid);
+    const u32 uid_size = GetUidSize(uid);
+    const Key key = MakeKey(stage, api, generator_version, uid_data, uid_size, host_config);
+    Artifact artifact;
+    if (Lookup(key, uid_data, uid_size, &artifact) && !artifact.spirv.empty())
+    {
+      *spirv = std::move(artifact.spirv);
+      return true;
+    }
+
+    ShaderCode source_code;
+    generate(source_code, host_config);
+    if (!compile(spirv, source_code.data(), source_code.size()))
+      return false;
+    Insert(key, uid_data, uid_size, std::string(source_code.data(), source_code.size()),
+           spirv->data(), spirv->size());
+    return true;
+  }
+
+  // Adds the records of another cache file which are missing in this one, returns the number
+  // of added records or -1 if the file could not be read.
+  int Merge(const std::string& filename);
+
+  size_t GetEntryCount() const;
+
+private:
+  static constexpr u32 MAGIC = 0x54524153;         // "SART"
+  static constexpr u32 RECORD_MAGIC = 0x43455253;  // "SREC"
+  static constexpr u32 VERSION = 1;
+
+  struct FileHeader
+  {
+    u32 magic;
+    u32 version;
+  };
+
+  struct RecordHeader
+  {
+    u32 magic;
+    u32 payload_size;
+    u64 checksum;
+  };
+
+  struct PayloadHeader
+  {
+    Key key;
+    u32 uid_size;
+    u32 source_size;
+    u32 spirv_size;
+    u32 reserved;
+  };
+
+  struct KeyHasher
+  {
+    size_t operator()(const Key& key) const
+    {
+      return static_cast<size_t>(key.uid_hash ^ (u64(key.host_config) << 32) ^
+                                 (u64(key.generator_version) << 16) ^ (key.stage << 8) ^
+                                 key.api);
+    }
+  };
+
+  typedef std::unordered_multimap<Key, const u8*, KeyHasher> Index;
+
+  // Calls func(payload) for every intact record in [data, data + size).
+  template <typename F>
+  static void ForEachRecord(const u8* data, u64 size, F&& func);
+  static bool MatchesUid(const u8* payload, const u8* uid_data, u32 uid_size);
+  const u8* FindPayload(const Key& key, const u8* uid_data, u32 uid_size) const;
+  bool AppendRecord(const std::vector<u8>& payload);
+
+  mutable std::shared_timed_mutex m_mutex;
+  File::MappedFile m_mapping;
+  File::IOFile m_file;
+  // Payloads point into the mapping or into m_added
+  Index m_index;
+  std::vector<std::unique_ptr<u8[]>> m_added;
+};
@@ -35,6 +35,13 @@ ShaderHostConfig ShaderHostConfig::GetCurrent()
 
 std::string GetDiskShaderCacheFileName(API_TYPE api_type, const char* type, bool include_gameid,
   bool include_host_config, bool uid)
+{
+  return GetDiskShaderCacheFileNameForGame(api_type, type,
+    include_gameid ? SConfig::GetInstance().GetGameID() : std::string(), include_host_config, uid);
+}
+
+std::string GetDiskShaderCacheFileNameForGame(API_TYPE api_type, const char* type,
+  const std::string& game_id, bool include_host_config, bool uid)
 {
   std::string filename;
   if (uid)
@@ -72,10 +79,10 @@ std::string GetDiskShaderCacheFileName(API_TYPE api_type, const char* type, bool
   filename += '-';
   filename += type;
 
-  if (include_gameid)
+  if (!game_id.empty())
   {
     filename += '-';
-    filename += SConfig::GetInstance().GetGameID();
+    filename += game_id;
   }
 
   if (include_host_config)
@@ -181,6 +181,9 @@ union ShaderHostConfig
 // Gets the filename of the specified type of cache object (e.g. vertex shader, pipeline).
 std::string GetDiskShaderCacheFileName(API_TYPE api_type, const char* type, bool include_gameid,
   bool include_host_config, bool uid = false);
+// Same for the given game instead of the running one, used to build caches without running it.
+std::string GetDiskShaderCacheFileNameForGame(API_TYPE api_type, const char* type,
+  const std::string& game_id, bool include_host_config, bool uid = false);
 
 inline void WriteRegister(ShaderCode& object, API_TYPE api_type, const char *prefix, const u32 num)
 {
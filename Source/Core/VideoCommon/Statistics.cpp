@@ -44,6 +44,11 @@ std::string Statistics::ToString()
   }
   str += StringFromFormat("Textures created: %i\n", stats.numTexturesCreated);
   str += StringFromFormat("Textures alive: %i\n", stats.numTexturesAlive);
+  if (g_ActiveConfig.bAsyncTextureScaling)
+  {
+    str += StringFromFormat("Textures scaling: %i\n", stats.numTexturesScalingPending);
+    str += StringFromFormat("Texture scaling latency: %.2f ms\n", stats.texScalingLatencyMs);
+  }
   str += StringFromFormat("pshaders created: %i\n", stats.numPixelShadersCreated);
   str += StringFromFormat("pshaders alive: %i\n", stats.numPixelShadersAlive);
   str += StringFromFormat("vshaders created: %i\n", stats.numVertexShadersCreated);
@@ -56,6 +61,18 @@ std::string Statistics::ToString()
   str += StringFromFormat("dshaders alive: %i\n", stats.numDomainShadersAlive);
   str += StringFromFormat("shaders changes: %i\n", stats.thisFrame.numShaderChanges);
   str += StringFromFormat("dlists called: %i\n", stats.thisFrame.numDListsCalled);
+  if (g_ActiveConfig.bDisplayListCache)
+  {
+    str += StringFromFormat("dlist cache hits: %i\n", stats.thisFrame.numDListCacheHits);
+    str += StringFromFormat("dlist cache misses: %i\n", stats.thisFrame.numDListCacheMisses);
+    str += StringFromFormat("dlist vertex skipped: %i kB\n", stats.thisFrame.bytesDListVertexSkipped / 1024);
+  }
+  if (g_ActiveConfig.bVertexCache)
+  {
+    str += StringFromFormat("vertex cache hits: %i\n", stats.thisFrame.numVertexCacheHits);
+    str += StringFromFormat("vertex cache misses: %i\n", stats.thisFrame.numVertexCacheMisses);
+    str += StringFromFormat("vertex cache skipped: %i kB\n", stats.thisFrame.bytesVertexCacheSkipped / 1024);
+  }
   str += StringFromFormat("Primitive joins: %i\n", stats.thisFrame.numPrimitiveJoins);
   str += StringFromFormat("Draw calls: %i\n", stats.thisFrame.numDrawCalls);
   str += StringFromFormat("Primitives: %i\n", stats.thisFrame.numPrims);
@@ -66,10 +83,26 @@ std::string Statistics::ToString()
   str += StringFromFormat("CP loads (DL): %i\n", stats.thisFrame.numCPLoadsInDL);
   str += StringFromFormat("BP loads: %i\n", stats.thisFrame.numBPLoads);
   str += StringFromFormat("BP loads (DL): %i\n", stats.thisFrame.numBPLoadsInDL);
+  str += StringFromFormat("FIFO reads: %i (%i kB)\n", stats.thisFrame.numFifoReads,
+                          stats.thisFrame.bytesFifoRead / 1024);
+  str += StringFromFormat("GPU thread CPU time: %.2f ms\n", stats.thisFrame.gpuThreadCpuUs / 1000.0f);
   str += StringFromFormat("Vertex streamed: %i kB\n", stats.thisFrame.bytesVertexStreamed / 1024);
   str += StringFromFormat("Index streamed: %i kB\n", stats.thisFrame.bytesIndexStreamed / 1024);
   str += StringFromFormat("Uniform streamed: %i kB\n", stats.thisFrame.bytesUniformStreamed / 1024);
   str += StringFromFormat("Vertex Loaders: %i\n", stats.numVertexLoaders);
+  if (g_ActiveConfig.bParallelVertexLoading)
+  {
+    str += StringFromFormat("Parallel vertex loads: %i (%i vertices)\n",
+                            stats.thisFrame.numParallelVertexLoads,
+                            stats.thisFrame.numParallelVerticesLoaded);
+    // Thread time spent converting divided by the time the GPU thread waited for it.
+    if (stats.thisFrame.parallelVertexLoadWallUs > 0)
+    {
+      str += StringFromFormat("Parallel vertex speedup: %.2fx\n",
+                              static_cast<float>(stats.thisFrame.parallelVertexLoadBusyUs) /
+                                  stats.thisFrame.parallelVertexLoadWallUs);
+    }
+  }
 
   std::string vertex_list;
   VertexLoaderManager::AppendListToString(&vertex_list);
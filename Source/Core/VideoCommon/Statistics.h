@@ -21,6 +21,8 @@ struct Statistics
 
   int numTexturesCreated;
   int numTexturesAlive;
+  int numTexturesScalingPending;
+  float texScalingLatencyMs;
 
   int numVertexLoaders;
 
@@ -49,11 +51,21 @@ struct Statistics
     int numDrawCalls;
 
     int numDListsCalled;
+    int numDListCacheHits;
+    int numDListCacheMisses;
+    int bytesDListVertexSkipped;
+    int numVertexCacheHits;
+    int numVertexCacheMisses;
+    int bytesVertexCacheSkipped;
 
     int bytesVertexStreamed;
     int bytesIndexStreamed;
     int bytesUniformStreamed;
 
+    int numFifoReads;
+    int bytesFifoRead;
+    int gpuThreadCpuUs;
+
     int numTrianglesClipped;
     int numTrianglesIn;
     int numTrianglesRejected;
@@ -62,6 +74,10 @@ struct Statistics
     int rasterizedPixels;
     int numTrianglesDrawn;
     int numVerticesLoaded;
+    int numParallelVertexLoads;
+    int numParallelVerticesLoaded;
+    int parallelVertexLoadBusyUs;
+    int parallelVertexLoadWallUs;
     int tevPixelsIn;
     int tevPixelsOut;
   };
@@ -0,0 +1,141 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+
+// Index of the emulated memory ranges covered by the texture cache entries.
+//
+// The ranges live in a single vector sorted by start address, values with the same start
+// address are kept in insertion order. The vector is split into blocks of BLOCK_SIZE ranges
+// which remember the highest end address they contain, so an overlap query only has to
+// look at the ranges of the blocks that can actually hold a match, and the answer is exact.
+// Insertions and removals move the tail of the vector, which is cheap for the few thousand
+// textures a game keeps alive, and lookups stay on contiguous memory.
+template <typename T>
+class TextureAddressIndex
+{
+public:
+  void Insert(u32 address, u32 size, T value)
+  {
+    const auto iter = std::upper_bound(
+        m_ranges.begin(), m_ranges.end(), address,
+        [](u32 addr, const Range& range) { return addr < range.begin; });
+    const size_t pos = iter - m_ranges.begin();
+    m_ranges.insert(iter, Range{address, address + size, value});
+    UpdateBlocks(pos);
+  }
+
+  // Removes the value that was inserted with the given start address.
+  bool Erase(u32 address, T value)
+  {
+    auto iter = std::lower_bound(m_ranges.begin(), m_ranges.end(), address,
+                                 [](const Range& range, u32 addr) { return range.begin < addr; });
+    for (; iter != m_ranges.end() && iter->begin == address; ++iter)
+    {
+      if (iter->value == value)
+      {
+        const size_t pos = iter - m_ranges.begin();
+        m_ranges.erase(iter);
+        UpdateBlocks(pos);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Removes all values for which pred returns true, pred is called once for every value.
+  template <typename Pred>
+  void EraseIf(Pred pred)
+  {
+    m_ranges.erase(std::remove_if(m_ranges.begin(), m_ranges.end(),
+                                  [&pred](const Range& range) { return pred(range.value); }),
+                   m_ranges.end());
+    UpdateBlocks(0);
+  }
+
+  void Clear()
+  {
+    m_ranges.clear();
+    m_block_end.clear();
+  }
+
+  size_t Size() const { return m_ranges.size(); }
+  bool Empty() const { return m_ranges.empty(); }
+
+  // Appends the values which were inserted with this start address, oldest first.
+  void FindAt(u32 address, std::vector<T>* out) const
+  {
+    auto iter = std::lower_bound(m_ranges.begin(), m_ranges.end(), address,
+                                 [](const Range& range, u32 addr) { return range.begin < addr; });
+    for (; iter != m_ranges.end() && iter->begin == address; ++iter)
+      out->push_back(iter->value);
+  }
+
+  // Appends the values whose range overlaps [address, address + size), sorted by start address.
+  void FindOverlapping(u32 address, u32 size, std::vector<T>* out) const
+  {
+    const u32 end = address + size;
+    // Everything from here on starts at or after the end of the queried range.
+    const size_t last = std::lower_bound(m_ranges.begin(), m_ranges.end(), end,
+                                         [](const Range& range, u32 addr) {
+                                           return range.begin < addr;
+                                         }) -
+                        m_ranges.begin();
+    const size_t first_out = out->size();
+    for (size_t block = (last + BLOCK_SIZE - 1) / BLOCK_SIZE; block-- > 0;)
+    {
+      if (m_block_end[block] <= address)
+        continue;
+      const size_t block_last = std::min(last, (block + 1) * BLOCK_SIZE);
+      for (size_t i = block_last; i-- > block * BLOCK_SIZE;)
+      {
+        if (m_ranges[i].end > address)
+          out->push_back(m_ranges[i].value);
+      }
+    }
+    // The blocks were walked backwards.
+    std::reverse(out->begin() + first_out, out->end());
+  }
+
+  // Appends all values, sorted by start address.
+  void GetAll(std::vector<T>* out) const
+  {
+    for (const Range& range : m_ranges)
+      out->push_back(range.value);
+  }
+
+private:
+  static constexpr size_t BLOCK_SIZE = 32;
+
+  struct Range
+  {
+    u32 begin;
+    u32 end;
+    T value;
+  };
+
+  // Recomputes the end addresses of the blocks from the one containing pos onwards.
+  void UpdateBlocks(size_t pos)
+  {
+    const size_t num_blocks = (m_ranges.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    m_block_end.resize(num_blocks);
+    for (size_t block = pos / BLOCK_SIZE; block < num_blocks; ++block)
+    {
+      const size_t block_last = std::min(m_ranges.size(), (block + 1) * BLOCK_SIZE);
+      u32 block_end = 0;
+      for (size_t i = block * BLOCK_SIZE; i < block_last; ++i)
+        block_end = std::max(block_end, m_ranges[i].end);
+      m_block_end[block] = block_end;
+    }
+  }
+
+  std::vector<Range> m_ranges;
+  std::vector<u32> m_block_end;
+};
@@ -8,9 +8,14 @@
 #include <utility>
 
 #include "Common/Align.h"
+#include "Common/Common.h"
+#include "Common/CommonPaths.h"
 #include "Common/FileUtil.h"
 #include "Common/MemoryUtil.h"
+#include "Common/Profiler.h"
 #include "Common/StringUtil.h"
+#include "Common/ThreadPool.h"
+#include "Common/Timer.h"
 
 #include "Core/ConfigManager.h"
 #include "Core/FifoPlayer/FifoPlayer.h"
@@ -28,6 +33,7 @@
 #include "VideoCommon/TextureDecoder.h"
 #include "VideoCommon/TextureScalerCommon.h"
 #include "VideoCommon/TextureUtil.h"
+#include "VideoCommon/VertexCache.h"
 #include "VideoCommon/VideoCommon.h"
 #include "VideoCommon/VideoConfig.h"
 
@@ -73,19 +79,17 @@ TextureCacheBase::TextureCacheBase()
   texture_pool_memory_usage = 0;
   InvalidateAllBindPoints();
   m_scaler = std::make_unique<TextureScaler>();
+  UpdateDiskCache(g_ActiveConfig);
 }
 
 void TextureCacheBase::Invalidate()
 {
   InvalidateAllBindPoints();
   bound_textures.fill(nullptr);
-  auto iter = textures_by_address.begin();
-  auto end = textures_by_address.end();
-  while (iter != end)
-  {
-    iter = InvalidateTexture(iter);
-  }
-  textures_by_address.clear();
+  textures_by_address.EraseIf([this](TCacheEntry* entry) {
+    DisposeCacheEntry(entry);
+    return true;
+  });
   textures_by_hash.clear();
 }
 
@@ -101,6 +105,7 @@ TextureCacheBase::~TextureCacheBase()
     TextureCacheBase::temp = nullptr;
   }
   m_scaler.reset();
+  m_disk_cache.reset();
 }
 
 void TextureCacheBase::OnConfigChanged(VideoConfig& config)
@@ -127,6 +132,12 @@ void TextureCacheBase::OnConfigChanged(VideoConfig& config)
                                         g_ActiveConfig.bTexFmtOverlayCenter);
   }
 
+  if (config.bDiskTextureCache != backup_config.disk_texture_cache ||
+      config.iDiskTextureCacheSizeMB != backup_config.disk_texture_cache_size)
+  {
+    UpdateDiskCache(config);
+  }
+
   if ((config.iStereoMode > 0) != backup_config.stereo_3d ||
       config.bStereoEFBMonoDepth != backup_config.efb_mono_depth)
   {
@@ -151,59 +162,73 @@ void TextureCacheBase::SetBackupConfig(const VideoConfig& config)
   backup_config.scaling_mode = config.iTexScalingType;
   backup_config.scaling_deposterize = config.bTexDeposterize;
   backup_config.gpu_texture_decoding = config.bEnableGPUTextureDecoding;
+  backup_config.disk_texture_cache = config.bDiskTextureCache;
+  backup_config.disk_texture_cache_size = config.iDiskTextureCacheSizeMB;
+}
+
+void TextureCacheBase::UpdateDiskCache(const VideoConfig& config)
+{
+  m_disk_cache.reset();
+  const std::string& game_id = SConfig::GetInstance().GetGameID();
+  if (!config.bDiskTextureCache || game_id.empty())
+    return;
+
+  const std::string filename =
+      File::GetUserPath(D_CACHE_IDX) + TEXTURECACHE_DIR DIR_SEP + game_id + ".pack";
+  const u64 size_limit = static_cast<u64>(std::max(config.iDiskTextureCacheSizeMB, 1)) << 20;
+  const u32 data_version = TexDecoder::VERSION << 16 | TextureScaler::VERSION;
+  m_disk_cache = std::make_unique<TextureDiskCache>();
+  if (!m_disk_cache->Open(filename, size_limit, data_version))
+    m_disk_cache.reset();
+}
+
+void TextureCacheBase::AddDiskCacheLevel(const u8* data, u32 width, u32 height, u32 row_length,
+                                         HostTextureFormat format)
+{
+  const u32 size = TextureUtil::GetTextureSizeInBytes(row_length, height, format);
+  disk_cache_levels.push_back({width, height, row_length, size, nullptr});
+  disk_cache_data.insert(disk_cache_data.end(), data, data + size);
+}
+
+void TextureCacheBase::StoreOnDisk(const TextureDiskCache::Key& key, HostTextureFormat format)
+{
+  m_disk_cache->Store(key, format, disk_cache_levels, disk_cache_data.data());
+  disk_cache_levels.clear();
+  disk_cache_data.clear();
 }
 
 void TextureCacheBase::Cleanup(s32 _frameCount)
 {
+  ApplyFinishedTextureScaling();
+
   s32 texture_kill_threshold = TEXTURE_KILL_THRESHOLD;
   if (texture_pool_memory_usage < (TEXTURE_POOL_MEMORY_LIMIT / 2))
   {
     // if we are using less than the memory limit increase kill threshold
     texture_kill_threshold *= TEXTURE_KILL_MULTIPLIER;
   }
-  auto iter = textures_by_address.begin();
-  auto tcend = textures_by_address.end();
-  while (iter != tcend)
-  {
-    if (iter->second->tmem_only)
+  textures_by_address.EraseIf([&](TCacheEntry* entry) {
+    if (!entry->tmem_only)
     {
-      iter = InvalidateTexture(iter);
-    }
-    else if (iter->second->frameCount == FRAMECOUNT_INVALID)
-    {
-      iter->second->frameCount = _frameCount;
-    }
-    if (iter == tcend)
-    {
-      break;
-    }
-    if (_frameCount > texture_kill_threshold + iter->second->frameCount)
-    {
-      if (iter->second->IsEfbCopy())
-      {
-        // Only remove EFB copies when they wouldn't be used anymore(changed hash), because EFB
-        // copies living on the host GPU are unrecoverable. Perform this check only every
-        // TEXTURE_KILL_THRESHOLD for performance reasons
-        if ((_frameCount - iter->second->frameCount) % TEXTURE_KILL_THRESHOLD == 1 &&
-            iter->second->hash != iter->second->CalculateHash())
-        {
-          iter = InvalidateTexture(iter);
-        }
-        else
-        {
-          ++iter;
-        }
-      }
-      else
+      if (entry->frameCount == FRAMECOUNT_INVALID)
+        entry->frameCount = _frameCount;
+      if (_frameCount <= texture_kill_threshold + entry->frameCount)
+        return false;
+      // Only remove EFB copies when they wouldn't be used anymore(changed hash), because EFB
+      // copies living on the host GPU are unrecoverable. Perform this check only every
+      // TEXTURE_KILL_THRESHOLD for performance reasons
+      if (entry->IsEfbCopy() &&
+          ((_frameCount - entry->frameCount) % TEXTURE_KILL_THRESHOLD != 1 ||
+           entry->hash == entry->CalculateHash()))
       {
-        iter = InvalidateTexture(iter);
+        return false;
       }
     }
-    else
-    {
-      ++iter;
-    }
-  }
+    if (KeepForTmemCache(entry))
+      return false;
+    DisposeCacheEntry(entry);
+    return true;
+  });
   auto env_iter = enviroment_cache.begin();
   auto env_end = enviroment_cache.end();
   while (env_iter != env_end)
@@ -272,12 +297,12 @@ TextureCacheBase::TCacheEntry* TextureCacheBase::ApplyPaletteToEntry(TCacheEntry
     decoded_entry->frameCount = FRAMECOUNT_INVALID;
     decoded_entry->is_efb_copy = false;
     g_texture_cache->LoadLut(tlutfmt, &texMem[tlutaddr], palette_size);
-    auto iter = textures_by_address.emplace(entry->addr, decoded_entry);
+    textures_by_address.Insert(entry->addr, entry->size_in_bytes, decoded_entry);
     if (g_texture_cache->Palettize(decoded_entry, entry))
     {
       return decoded_entry;
     }
-    InvalidateTexture(iter);
+    InvalidateTexture(decoded_entry);
   }
   return nullptr;
 }
@@ -349,17 +374,20 @@ TextureCacheBase::DoPartialTextureUpdates(TCacheEntry* entry_to_update, u32 tlut
 
   u32 numBlocksX = (entry_to_update->native_width + block_width - 1) / block_width;
 
-  auto iter = FindOverlappingTextures(entry_to_update->addr, entry_to_update->size_in_bytes);
-  while (iter.first != iter.second)
+  overlapping_textures.clear();
+  textures_by_address.FindOverlapping(entry_to_update->addr, entry_to_update->size_in_bytes,
+                                      &overlapping_textures);
+  for (TCacheEntry* entry : overlapping_textures)
   {
-    TCacheEntry* entry = iter.first->second;
     if (entry != entry_to_update && entry->IsEfbCopy() && !entry->tmem_only &&
         entry->references.count(entry_to_update) == 0 &&
-        entry->OverlapsMemoryRange(entry_to_update->addr, entry_to_update->size_in_bytes) &&
         entry->memory_stride == numBlocksX * block_size)
     {
       if (entry->hash == entry->CalculateHash())
       {
+        // The scaled texture would be missing this update, keep the native one instead
+        CancelTextureScaling(entry_to_update);
+
         if (isPaletteTexture)
         {
           TCacheEntry* decoded_entry = ApplyPaletteToEntry(entry, tlutaddr, tlutfmt, palette_size);
@@ -374,7 +402,6 @@ TextureCacheBase::DoPartialTextureUpdates(TCacheEntry* entry_to_update, u32 tlut
           }
           else
           {
-            ++iter.first;
             continue;
           }
         }
@@ -443,7 +470,7 @@ TextureCacheBase::DoPartialTextureUpdates(TCacheEntry* entry_to_update, u32 tlut
         {
           // Remove the temporary converted texture, it won't be used anywhere else
           // TODO: It would be nice to convert and copy in one step, but this code path isn't common
-          InvalidateTexture(GetTexCacheIter(entry));
+          InvalidateTexture(entry);
         }
         else
         {
@@ -456,11 +483,9 @@ TextureCacheBase::DoPartialTextureUpdates(TCacheEntry* entry_to_update, u32 tlut
       else
       {
         // If the hash does not match, this EFB copy will not be used for anything, so remove it
-        iter.first = InvalidateTexture(iter.first);
-        continue;
+        InvalidateTexture(entry);
       }
     }
-    ++iter.first;
   }
   return entry_to_update;
 }
@@ -605,6 +630,7 @@ void TextureCacheBase::LoadEnviromentTexture(std::string basename)
 
 TextureCacheBase::TCacheEntry* TextureCacheBase::Load(const u32 stage)
 {
+  PROFILE("TextureCache::Load");
   // if this stage was not invalidated by changes to texture registers, keep the current texture
   if (IsValidBindPoint(stage) && bound_textures[stage])
   {
@@ -738,19 +764,17 @@ TextureCacheBase::TCacheEntry* TextureCacheBase::Load(const u32 stage)
   //
   // For efb copies, the entry created in CopyRenderTargetToTexture always has to be used, or else
   // it was done in vain.
-  auto iter_range = textures_by_address.equal_range(address);
-  TexAddrCache::iterator iter = iter_range.first;
-  TexAddrCache::iterator oldest_entry = iter;
+  address_matches.clear();
+  textures_by_address.FindAt(address, &address_matches);
+  TCacheEntry* oldest_entry = nullptr;
   s32 temp_frameCount = 0x7fffffff;
-  TexAddrCache::iterator unconverted_copy = textures_by_address.end();
+  TCacheEntry* unconverted_copy = nullptr;
 
-  while (iter != iter_range.second)
+  for (TCacheEntry* entry : address_matches)
   {
-    TCacheEntry* entry = iter->second;
     // Skip entries that are only left in our texture cache for the tmem cache emulation
     if (entry->tmem_only)
     {
-      ++iter;
       continue;
     }
     // Do not load strided EFB copies, they are not meant to be used directly
@@ -773,7 +797,7 @@ TextureCacheBase::TCacheEntry* TextureCacheBase::Load(const u32 stage)
         // perform the conversion later. Currently, we only convert EFB copies to
         // palette textures; we could do other conversions if it proved to be
         // beneficial.
-        unconverted_copy = iter;
+        unconverted_copy = entry;
       }
       else
       {
@@ -781,7 +805,7 @@ TextureCacheBase::TCacheEntry* TextureCacheBase::Load(const u32 stage)
         // never be useful again. It's theoretically possible for a game to do
         // something weird where the copy could become useful in the future, but in
         // practice it doesn't happen.
-        iter = InvalidateTexture(iter);
+        InvalidateTexture(entry);
         continue;
       }
     }
@@ -792,7 +816,7 @@ TextureCacheBase::TCacheEntry* TextureCacheBase::Load(const u32 stage)
           entry->native_levels >= tex_levels && entry->native_width == nativeW &&
           entry->native_height == nativeH)
       {
-        entry = DoPartialTextureUpdates(iter->second, tlutaddr, tlutfmt, palette_size);
+        entry = DoPartialTextureUpdates(entry, tlutaddr, tlutfmt, palette_size);
         return ReturnEntry(stage, entry);
       }
     }
@@ -805,17 +829,16 @@ TextureCacheBase::TCacheEntry* TextureCacheBase::Load(const u32 stage)
         !entry->IsEfbCopy() && !(isPaletteTexture && entry->base_hash == tex_hash))
     {
       temp_frameCount = entry->frameCount;
-      oldest_entry = iter;
+      oldest_entry = entry;
     }
-    ++iter;
   }
   std::string basename;
-  if (unconverted_copy != textures_by_address.end())
+  if (unconverted_copy)
   {
     g_texture_cache->LoadLut(tlutfmt, &texMem[tlutaddr], palette_size);
     // Perform palette decoding.
     TCacheEntry* decoded_entry =
-        ApplyPaletteToEntry(unconverted_copy->second, tlutaddr, tlutfmt, palette_size);
+        ApplyPaletteToEntry(unconverted_copy, tlutaddr, tlutfmt, palette_size);
 
     if (decoded_entry)
     {
@@ -832,19 +855,17 @@ TextureCacheBase::TCacheEntry* TextureCacheBase::Load(const u32 stage)
       std::max(texture_size, palette_size) <=
           (u32)g_ActiveConfig.iSafeTextureCache_ColorSamples * 8)
   {
-    auto hash_range = textures_by_hash.equal_range(full_hash);
-    TexHashCache::iterator hash_iter = hash_range.first;
-    while (hash_iter != hash_range.second)
+    auto hash_range = FindByHash(full_hash);
+    for (auto hash_iter = hash_range.first; hash_iter != hash_range.second; ++hash_iter)
     {
       TCacheEntry* entry = hash_iter->second;
       // All parameters, except the address, need to match here
       if (entry->format == full_format && entry->native_levels >= tex_levels &&
           entry->native_width == nativeW && entry->native_height == nativeH)
       {
-        entry = DoPartialTextureUpdates(hash_iter->second, tlutaddr, tlutfmt, palette_size);
+        entry = DoPartialTextureUpdates(entry, tlutaddr, tlutfmt, palette_size);
         return ReturnEntry(stage, entry);
       }
-      ++hash_iter;
     }
   }
 
@@ -914,6 +935,8 @@ TextureCacheBase::TCacheEntry* TextureCacheBase::Load(const u32 stage)
   const u32 texLevels = hires_tex ? hires_tex->m_levels : tex_levels;
   const bool use_scaling =
       (g_ActiveConfig.iTexScalingType > 0) && !hires_tex && (width < 384) && (height < 384);
+  // Upload the texture at its native resolution and swap in the scaled one once it is ready
+  const bool async_scaling = use_scaling && g_ActiveConfig.bAsyncTextureScaling;
   // We can decode on the GPU if it is a supported format and the flag is enabled.
   // Currently we don't decode RGBA8 textures from Tmem, as that would require copying from both
   // banks, and if we're doing an copy we may as well just do the whole thing on the CPU, since
@@ -924,6 +947,29 @@ TextureCacheBase::TCacheEntry* TextureCacheBase::Load(const u32 stage)
       g_texture_cache->SupportsGPUTextureDecode(static_cast<TextureFormat>(texformat),
                                                 static_cast<TlutFormat>(tlutfmt)) &&
       !(from_tmem && texformat == GX_TF_RGBA8);
+  // With a sampled hash different textures can collide, which the disk cache would make
+  // persistent, so it only takes fully hashed textures.
+  const bool full_hash_computed =
+      g_ActiveConfig.iSafeTextureCache_ColorSamples == 0 ||
+      std::max(texture_size, palette_size) <=
+          (u32)g_ActiveConfig.iSafeTextureCache_ColorSamples * 8;
+  const bool use_disk_cache = m_disk_cache && full_hash_computed && !hires_tex &&
+                              !decode_on_gpu && !from_tmem &&
+                              !g_ActiveConfig.bTexFmtOverlayEnable;
+  TextureDiskCache::Key disk_key = {};
+  TextureDiskCache::Texture disk_texture;
+  bool disk_hit = false;
+  if (use_disk_cache)
+  {
+    const u32 scaling_mode =
+        use_scaling ? TextureDiskCache::ScalingMode(g_ActiveConfig.iTexScalingType,
+                                                    g_ActiveConfig.iTexScalingFactor,
+                                                    g_ActiveConfig.bTexDeposterize) :
+                      0;
+    disk_key = {full_hash, full_format, width, height, texLevels, scaling_mode,
+                static_cast<u32>(pcfmt)};
+    disk_hit = m_disk_cache->Lookup(disk_key, &disk_texture);
+  }
 
   // create the entry/texture
   TextureConfig config;
@@ -939,34 +985,55 @@ TextureCacheBase::TCacheEntry* TextureCacheBase::Load(const u32 stage)
   config.layers += emissivematerial ? 1 : 0;
   if (use_scaling)
   {
-    config.width *= g_ActiveConfig.iTexScalingFactor;
-    config.height *= g_ActiveConfig.iTexScalingFactor;
+    if (!async_scaling)
+    {
+      config.width *= g_ActiveConfig.iTexScalingFactor;
+      config.height *= g_ActiveConfig.iTexScalingFactor;
+    }
     config.pcformat = PC_TEX_FMT_RGBA32;
   }
+  if (disk_hit)
+  {
+    // Already scaled, even with async scaling
+    config.width = disk_texture.levels[0].width;
+    config.height = disk_texture.levels[0].height;
+    config.levels = static_cast<u32>(disk_texture.levels.size());
+    config.pcformat = disk_texture.format;
+  }
   TCacheEntry* entry = AllocateCacheEntry(config, materialmap);
   GFX_DEBUGGER_PAUSE_AT(NEXT_NEW_TEXTURE, true);
 
-  iter = textures_by_address.emplace(address, entry);
-  if (g_ActiveConfig.iSafeTextureCache_ColorSamples == 0 ||
-      std::max(texture_size, palette_size) <=
-          (u32)g_ActiveConfig.iSafeTextureCache_ColorSamples * 8)
-  {
-    entry->textures_by_hash_iter = textures_by_hash.emplace(full_hash, entry);
-  }
+  textures_by_address.Insert(address, texture_size, entry);
+  if (full_hash_computed)
+    AddToHashCache(full_hash, entry);
 
   entry->SetGeneralParameters(address, texture_size, full_format);
   entry->SetDimensions(nativeW, nativeH, tex_levels);
-  entry->SetHiresParams(!!hires_tex, basename, use_scaling, emissivematerial,
-                        !!hires_tex && hires_tex->has_arbitrary_mips, false);
+  entry->SetHiresParams(!!hires_tex, basename, use_scaling && (disk_hit || !async_scaling),
+                        emissivematerial, !!hires_tex && hires_tex->has_arbitrary_mips, false);
   entry->SetHashes(full_hash, tex_hash);
   entry->is_efb_copy = false;
 
+  std::shared_ptr<TextureScalingJob> scaling_job;
+  if (async_scaling && !disk_hit)
+  {
+    scaling_job = std::make_shared<TextureScalingJob>();
+    scaling_job->entry = entry;
+    scaling_job->type = g_ActiveConfig.iTexScalingType;
+    scaling_job->factor = g_ActiveConfig.iTexScalingFactor;
+    scaling_job->deposterize = g_ActiveConfig.bTexDeposterize;
+    scaling_job->store_on_disk = use_disk_cache;
+    scaling_job->disk_key = disk_key;
+  }
+
   // load texture
   if (hires_tex)
   {
     int currentlayer = 0;
-    entry->texture->Load(TextureCacheBase::temp, width, height, expandedWidth, 0, currentlayer);
-    u8* Bufferptr = TextureCacheBase::temp;
+    // Textures from a pack are uploaded straight from the mapping
+    const u8* Bufferptr =
+        hires_tex->m_packed_data ? hires_tex->m_packed_data : TextureCacheBase::temp;
+    entry->texture->Load(Bufferptr, width, height, expandedWidth, 0, currentlayer);
     Bufferptr += TextureUtil::GetTextureSizeInBytes(width, height, pcfmt);
     for (u32 level = 1; level != texLevels; ++level)
     {
@@ -1002,6 +1069,17 @@ TextureCacheBase::TCacheEntry* TextureCacheBase::Load(const u32 stage)
       }
     }
   }
+  else if (disk_hit)
+  {
+    for (u32 level = 0; level < disk_texture.levels.size(); ++level)
+    {
+      const TextureDiskCache::Level& disk_level = disk_texture.levels[level];
+      entry->texture->Load(disk_level.data, disk_level.width, disk_level.height,
+                           disk_level.row_length, level, 0);
+      if (g_ActiveConfig.bDumpTextures)
+        DumpTexture(entry, basename, level);
+    }
+  }
   else
   {
     const u8* ptr_even = NULL;
@@ -1040,7 +1118,14 @@ TextureCacheBase::TCacheEntry* TextureCacheBase::Load(const u32 stage)
                            PC_TEX_FMT_RGBA32 == config.pcformat,
                            config.pcformat >= PC_TEX_FMT_DXT1);
       }
-      if (use_scaling)
+      if (scaling_job)
+      {
+        const u32* decoded = reinterpret_cast<u32*>(texturedata);
+        scaling_job->levels.push_back(
+            {width, height, expandedWidth,
+             std::vector<u32>(decoded, decoded + expandedWidth * height)});
+      }
+      else if (use_scaling)
       {
         texturedata =
             reinterpret_cast<u8*>(m_scaler->Scale((u32*)texturedata, expandedWidth, height));
@@ -1049,6 +1134,8 @@ TextureCacheBase::TCacheEntry* TextureCacheBase::Load(const u32 stage)
         texpandedWidth *= g_ActiveConfig.iTexScalingFactor;
       }
       entry->texture->Load(texturedata, twidth, theight, texpandedWidth, 0, 0);
+      if (use_disk_cache && !scaling_job)
+        AddDiskCacheLevel(texturedata, twidth, theight, texpandedWidth, config.pcformat);
     }
     if (g_ActiveConfig.bDumpTextures)
     {
@@ -1083,15 +1170,24 @@ TextureCacheBase::TCacheEntry* TextureCacheBase::Load(const u32 stage)
                            texformat, tlutaddr, static_cast<TlutFormat>(tlutfmt),
                            PC_TEX_FMT_RGBA32 == config.pcformat,
                            config.pcformat >= PC_TEX_FMT_DXT1);
-        if (use_scaling)
+        if (scaling_job)
+        {
+          const u32* decoded = reinterpret_cast<u32*>(texturedata);
+          scaling_job->levels.push_back(
+              {mip_width, mip_height, expanded_mip_width,
+               std::vector<u32>(decoded, decoded + expanded_mip_width * mip_height)});
+        }
+        else if (use_scaling)
         {
-          texturedata =
-              reinterpret_cast<u8*>(m_scaler->Scale((u32*)texturedata, expandedWidth, height));
+          texturedata = reinterpret_cast<u8*>(
+              m_scaler->Scale((u32*)texturedata, expanded_mip_width, mip_height));
           twidth *= g_ActiveConfig.iTexScalingFactor;
           theight *= g_ActiveConfig.iTexScalingFactor;
           texpandedWidth *= g_ActiveConfig.iTexScalingFactor;
         }
         entry->texture->Load(texturedata, twidth, theight, texpandedWidth, level, 0);
+        if (use_disk_cache && !scaling_job)
+          AddDiskCacheLevel(texturedata, twidth, theight, texpandedWidth, config.pcformat);
       }
       mip_src_data +=
           TexDecoder::GetTextureSizeInBytes(expanded_mip_width, expanded_mip_height, texformat);
@@ -1099,14 +1195,123 @@ TextureCacheBase::TCacheEntry* TextureCacheBase::Load(const u32 stage)
       if (g_ActiveConfig.bDumpTextures)
         DumpTexture(entry, basename, level);
     }
+    if (use_disk_cache && !scaling_job)
+      StoreOnDisk(disk_key, config.pcformat);
   }
 
+  if (scaling_job)
+    QueueTextureScaling(std::move(scaling_job));
+
   INCSTAT(stats.numTexturesCreated);
-  SETSTAT(stats.numTexturesAlive, textures_by_address.size());
-  entry = DoPartialTextureUpdates(iter->second, tlutaddr, tlutfmt, palette_size);
+  SETSTAT(stats.numTexturesAlive, textures_by_address.Size());
+  entry = DoPartialTextureUpdates(entry, tlutaddr, tlutfmt, palette_size);
   return ReturnEntry(stage, entry);
 }
 
+void TextureCacheBase::QueueTextureScaling(std::shared_ptr<TextureScalingJob> job)
+{
+  job->entry->scaling_pending = true;
+  job->queue_time = Common::Timer::GetTimeUs();
+  scaling_jobs[job->entry] = job;
+  SETSTAT(stats.numTexturesScalingPending, scaling_jobs.size());
+
+  Common::ThreadPool::Execute([job] {
+    // Jobs already run in parallel, so don't split the filters any further
+    TextureScaler scaler;
+    scaler.SetMultithreaded(false);
+    for (auto& level : job->levels)
+    {
+      if (job->cancelled.load())
+        break;
+      const u32* scaled = scaler.Scale(level.data.data(), level.expanded_width, level.height,
+                                       job->type, job->factor, job->deposterize);
+      level.data.assign(scaled,
+                        scaled + level.expanded_width * level.height * job->factor * job->factor);
+    }
+    job->done.store(true, std::memory_order_release);
+  });
+}
+
+void TextureCacheBase::ApplyFinishedTextureScaling()
+{
+  if (scaling_jobs.empty())
+    return;
+
+  const u64 now = Common::Timer::GetTimeUs();
+  u64 total_latency = 0;
+  u32 finished_jobs = 0;
+  auto iter = scaling_jobs.begin();
+  while (iter != scaling_jobs.end())
+  {
+    const TextureScalingJob& job = *iter->second;
+    if (!job.done.load(std::memory_order_acquire))
+    {
+      ++iter;
+      continue;
+    }
+
+    TCacheEntry* entry = job.entry;
+    TextureConfig config = entry->GetConfig();
+    config.width *= job.factor;
+    config.height *= job.factor;
+    std::unique_ptr<HostTexture> scaled_texture = AllocateTexture(config);
+    if (scaled_texture)
+    {
+      for (u32 level = 0; level < job.levels.size(); ++level)
+      {
+        const auto& scaled_level = job.levels[level];
+        scaled_texture->Load(reinterpret_cast<const u8*>(scaled_level.data.data()),
+                             scaled_level.width * job.factor, scaled_level.height * job.factor,
+                             scaled_level.expanded_width * job.factor, level, 0);
+      }
+      entry->texture.swap(scaled_texture);
+      DisposeTexture(scaled_texture);
+      entry->is_scaled = true;
+      if (job.store_on_disk && m_disk_cache)
+      {
+        for (const auto& scaled_level : job.levels)
+        {
+          AddDiskCacheLevel(reinterpret_cast<const u8*>(scaled_level.data.data()),
+                            scaled_level.width * job.factor, scaled_level.height * job.factor,
+                            scaled_level.expanded_width * job.factor, PC_TEX_FMT_RGBA32);
+        }
+        StoreOnDisk(job.disk_key, PC_TEX_FMT_RGBA32);
+      }
+    }
+    else
+    {
+      ERROR_LOG(VIDEO, "Failed to allocate the scaled texture, keeping the native one");
+    }
+    entry->scaling_pending = false;
+    total_latency += now - job.queue_time;
+    finished_jobs++;
+    iter = scaling_jobs.erase(iter);
+  }
+
+  if (finished_jobs > 0)
+  {
+    // Make sure the next draws bind the new textures
+    InvalidateAllBindPoints();
+    SETSTAT_FT(stats.texScalingLatencyMs, total_latency / 1000.0 / finished_jobs);
+  }
+  SETSTAT(stats.numTexturesScalingPending, scaling_jobs.size());
+}
+
+void TextureCacheBase::CancelTextureScaling(TCacheEntry* entry)
+{
+  if (!entry->scaling_pending)
+    return;
+
+  auto iter = scaling_jobs.find(entry);
+  if (iter != scaling_jobs.end())
+  {
+    iter->second->cancelled.store(true);
+    scaling_jobs.erase(iter);
+  }
+  entry->scaling_pending = false;
+  SETSTAT(stats.numTexturesScalingPending, scaling_jobs.size());
+}
+
 void TextureCacheBase::CopyRenderTargetToTexture(u32 dstAddr, u32 dstFormat, u32 dstStride,
                                                  bool is_depth_copy, const EFBRectangle& srcRect,
                                                  bool isIntensity, bool scaleByHalf)
@@ -1465,14 +1670,10 @@ void TextureCacheBase::CopyRenderTargetToTexture(u32 dstAddr, u32 dstFormat, u32
   }
 
   // remove all texture cache entries at dstAddr
-  {
-    auto iter_range = textures_by_address.equal_range(dstAddr);
-    TexAddrCache::iterator iter = iter_range.first;
-    while (iter != iter_range.second)
-    {
-      iter = InvalidateTexture(iter);
-    }
-  }
+  address_matches.clear();
+  textures_by_address.FindAt(dstAddr, &address_matches);
+  for (TCacheEntry* entry : address_matches)
+    InvalidateTexture(entry);
 
   // Get the base (in memory) format of this efb copy.
   u32 baseFormat = TexDecoder::GetEfbCopyBaseFormat(dstFormat);
@@ -1532,6 +1733,7 @@ void TextureCacheBase::CopyRenderTargetToTexture(u32 dstAddr, u32 dstFormat, u32
       ptr += dstStride;
     }
   }
+  VertexCache::InvalidateRange(dstAddr, covered_range);
 
   if (g_bRecordFifoData)
   {
@@ -1565,20 +1767,14 @@ void TextureCacheBase::CopyRenderTargetToTexture(u32 dstAddr, u32 dstFormat, u32
   // TODO: This also invalidates partial overlaps, which we currently don't have a better way
   //       of dealing with.
   bool invalidate_textures = dstStride == bytes_per_row || !copy_to_vram;
-  auto iter = FindOverlappingTextures(dstAddr, covered_range);
-  while (iter.first != iter.second)
+  overlapping_textures.clear();
+  textures_by_address.FindOverlapping(dstAddr, covered_range, &overlapping_textures);
+  for (TCacheEntry* entry : overlapping_textures)
   {
-    TCacheEntry* entry = iter.first->second;
-    if (entry->OverlapsMemoryRange(dstAddr, covered_range))
-    {
-      if (invalidate_textures)
-      {
-        iter.first = InvalidateTexture(iter.first);
-        continue;
-      }
+    if (invalidate_textures)
+      InvalidateTexture(entry);
+    else
       entry->may_have_overlapping_textures = true;
-    }
-    ++iter.first;
   }
 
   if (copy_to_vram)
@@ -1618,7 +1814,7 @@ void TextureCacheBase::CopyRenderTargetToTexture(u32 dstAddr, u32 dstFormat, u32
                              0);
       }
 
-      textures_by_address.emplace(dstAddr, entry);
+      textures_by_address.Insert(dstAddr, entry->size_in_bytes, entry);
     }
   }
 }
@@ -1653,9 +1849,7 @@ TextureCacheBase::TCacheEntry* TextureCacheBase::AllocateCacheEntry(const Textur
   {
     return nullptr;
   }
-  TCacheEntry* cacheEntry = new TCacheEntry(std::move(texture), materialmap, luma);
-  cacheEntry->textures_by_hash_iter = textures_by_hash.end();
-  return cacheEntry;
+  return new TCacheEntry(std::move(texture), materialmap, luma);
 }
 
 void TextureCacheBase::DisposeTexture(std::unique_ptr<HostTexture>& texture)
@@ -1666,11 +1860,10 @@ void TextureCacheBase::DisposeTexture(std::unique_ptr<HostTexture>& texture)
 
 void TextureCacheBase::DisposeCacheEntry(TCacheEntry* entry)
 {
-  if (entry->textures_by_hash_iter != textures_by_hash.end())
-  {
-    textures_by_hash.erase(entry->textures_by_hash_iter);
-    entry->textures_by_hash_iter = textures_by_hash.end();
-  }
+  CancelTextureScaling(entry);
+
+  if (entry->in_hash_cache)
+    RemoveFromHashCache(entry);
 
   auto config = entry->texture->GetConfig();
   texture_pool.emplace(config, TexPoolEntry(std::move(entry->texture)));
@@ -1692,57 +1885,66 @@ TextureCacheBase::FindMatchingTextureFromPool(const TextureConfig& config)
   return matching_iter != range.second ? matching_iter : texture_pool.end();
 }
 
-TextureCacheBase::TexAddrCache::iterator
-TextureCacheBase::GetTexCacheIter(TextureCacheBase::TCacheEntry* entry)
+bool TextureCacheBase::KeepForTmemCache(TCacheEntry* entry)
 {
-  auto iter_range = textures_by_address.equal_range(entry->addr);
-  TexAddrCache::iterator iter = iter_range.first;
-
-  while (iter != iter_range.second)
+  for (size_t i = 0; i < bound_textures.size(); ++i)
   {
-    if (iter->second == entry)
+    // If the entry is currently bound and not invalidated, keep it, but mark it as invalidated.
+    // This way it can still be used via tmem cache emulation, but nothing else.
+    // Spyro: A Hero's Tail is known for using such overwritten textures.
+    if (bound_textures[i] == entry && IsValidBindPoint(static_cast<u32>(i)))
     {
-      return iter;
+      entry->tmem_only = true;
+      return true;
     }
-    ++iter;
   }
-  return textures_by_address.end();
+  return false;
 }
 
-TextureCacheBase::TexAddrCache::iterator
-TextureCacheBase::InvalidateTexture(TexAddrCache::iterator iter)
+void TextureCacheBase::InvalidateTexture(TCacheEntry* entry)
 {
-  if (iter == textures_by_address.end())
-    return textures_by_address.end();
-  for (size_t i = 0; i < bound_textures.size(); ++i)
+  if (KeepForTmemCache(entry))
+    return;
+  textures_by_address.Erase(entry->addr, entry);
+  DisposeCacheEntry(entry);
+}
+
+static bool HashLess(const std::pair<u64, TextureCacheBase::TCacheEntry*>& entry, u64 hash)
+{
+  return entry.first < hash;
+}
+
+void TextureCacheBase::AddToHashCache(u64 hash, TCacheEntry* entry)
+{
+  auto iter = std::upper_bound(
+      textures_by_hash.begin(), textures_by_hash.end(), hash,
+      [](u64 value, const std::pair<u64, TCacheEntry*>& other) { return value < other.first; });
+  textures_by_hash.emplace(iter, hash, entry);
+  entry->in_hash_cache = true;
+}
+
+void TextureCacheBase::RemoveFromHashCache(TCacheEntry* entry)
+{
+  auto iter = std::lower_bound(textures_by_hash.begin(), textures_by_hash.end(), entry->hash,
+                               HashLess);
+  for (; iter != textures_by_hash.end() && iter->first == entry->hash; ++iter)
   {
-    // If the entry is currently bound and not invalidated, keep it, but mark it as invalidated.
-    // This way it can still be used via tmem cache emulation, but nothing else.
-    // Spyro: A Hero's Tail is known for using such overwritten textures.
-    if (bound_textures[i] == iter->second && IsValidBindPoint(static_cast<u32>(i)))
+    if (iter->second == entry)
     {
-      bound_textures[i]->tmem_only = true;
-      return ++iter;
+      textures_by_hash.erase(iter);
+      break;
     }
   }
-  DisposeCacheEntry(iter->second);
-  return textures_by_address.erase(iter);
+  entry->in_hash_cache = false;
 }
 
-std::pair<TextureCacheBase::TexAddrCache::iterator, TextureCacheBase::TexAddrCache::iterator>
-TextureCacheBase::FindOverlappingTextures(u32 addr, u32 size_in_bytes)
+std::pair<TextureCacheBase::TexHashCache::iterator, TextureCacheBase::TexHashCache::iterator>
+TextureCacheBase::FindByHash(u64 hash)
 {
-  // We index by the starting address only, so there is no way to query all textures
-  // which end after the given addr. But the GC textures have a limited size, so we
-  // look for all textures which have a start address bigger than addr minus the maximal
-  // texture size. But this yields false-positives which must be checked later on.
-
-  // 1024 x 1024 texel times 8 nibbles per texel
-  constexpr u32 max_texture_size = 1024 * 1024 * 4;
-  u32 lower_addr = addr > max_texture_size ? addr - max_texture_size : 0;
-  auto begin = textures_by_address.lower_bound(lower_addr);
-  auto end = textures_by_address.upper_bound(addr + size_in_bytes);
-
+  auto begin = std::lower_bound(textures_by_hash.begin(), textures_by_hash.end(), hash, HashLess);
+  auto end = begin;
+  while (end != textures_by_hash.end() && end->first == hash)
+    ++end;
   return std::make_pair(begin, end);
 }
 
@@ -5,8 +5,8 @@
 #pragma once
 
 #include <array>
+#include <atomic>
 #include <bitset>
-#include <map>
 #include <memory>
 #include <tuple>
 #include <unordered_map>
@@ -18,8 +18,10 @@
 
 #include "VideoCommon/BPMemory.h"
 #include "VideoCommon/HostTexture.h"
+#include "VideoCommon/TextureAddressIndex.h"
 #include "VideoCommon/TextureConfig.h"
 #include "VideoCommon/TextureDecoder.h"
+#include "VideoCommon/TextureDiskCache.h"
 #include "VideoCommon/VideoCommon.h"
 
 struct VideoConfig;
@@ -63,10 +65,11 @@ public:
     bool emissive = false;
     bool may_have_overlapping_textures = true;
     bool tmem_only = false;  // indicates that this texture only exists in the tmem cache
+    // The upscaled texture is still being generated, texture holds the native resolution one
+    bool scaling_pending = false;
 
-    // Keep an iterator to the entry in textures_by_hash, so it does not need to be searched when
-    // removing the cache entry
-    std::multimap<u64, TCacheEntry*>::iterator textures_by_hash_iter;
+    // The entry is in textures_by_hash, keyed by its hash
+    bool in_hash_cache = false;
 
     // This is used to keep track of both:
     //   * efb copies used by this partially updated texture
@@ -221,8 +224,33 @@ private:
     EnvCacheEntry(TCacheEntry* tex) : envtexture(tex) {}
   };
 
-  using TexAddrCache = std::multimap<u32, TCacheEntry*>;
-  using TexHashCache = std::multimap<u64, TCacheEntry*>;
+  // Upscales the decoded levels of a texture on the thread pool. The job works on its own copy
+  // of the data, the entry is only touched on the video thread once the job is done.
+  struct TextureScalingJob
+  {
+    struct Level
+    {
+      u32 width;
+      u32 height;
+      u32 expanded_width;
+      std::vector<u32> data;
+    };
+    TCacheEntry* entry;
+    int type;
+    int factor;
+    bool deposterize;
+    // The scaled levels are stored in the disk cache under this key, if set
+    bool store_on_disk = false;
+    TextureDiskCache::Key disk_key;
+    u64 queue_time;
+    std::vector<Level> levels;
+    std::atomic<bool> cancelled{false};
+    std::atomic<bool> done{false};
+  };
+
+  using TexAddrCache = TextureAddressIndex<TCacheEntry*>;
+  // Sorted by hash, entries with the same hash in insertion order
+  using TexHashCache = std::vector<std::pair<u64, TCacheEntry*>>;
   using EnviromentCache = std::unordered_map<std::string, EnvCacheEntry>;
   using TexPool = std::unordered_multimap<TextureConfig, TexPoolEntry, TextureConfig::Hasher>;
 
@@ -235,25 +263,42 @@ private:
   TCacheEntry* ApplyPaletteToEntry(TCacheEntry* entry, u32 tlutaddr, u32 tlutfmt, u32 palette_size);
   void DumpTexture(TCacheEntry* entry, std::string basename, u32 level);
 
+  // Opens or closes the disk cache for the running game according to the config.
+  void UpdateDiskCache(const VideoConfig& config);
+  void AddDiskCacheLevel(const u8* data, u32 width, u32 height, u32 row_length,
+                         HostTextureFormat format);
+  // Stores the levels added with AddDiskCacheLevel as one texture.
+  void StoreOnDisk(const TextureDiskCache::Key& key, HostTextureFormat format);
+
+  void QueueTextureScaling(std::shared_ptr<TextureScalingJob> job);
+  // Swaps in the textures finished since the last call. Called once per frame.
+  void ApplyFinishedTextureScaling();
+  void CancelTextureScaling(TCacheEntry* entry);
+
   TCacheEntry* AllocateCacheEntry(const TextureConfig& config, bool materialmap = false,
                                   bool luma = false);
   void DisposeCacheEntry(TCacheEntry* texture);
 
   TexPool::iterator FindMatchingTextureFromPool(const TextureConfig& config);
-  TexAddrCache::iterator GetTexCacheIter(TCacheEntry* entry);
-  TexAddrCache::iterator InvalidateTexture(TexAddrCache::iterator t_iter);
+  // Returns true if the entry is still bound, it's kept for the tmem cache emulation then.
+  bool KeepForTmemCache(TCacheEntry* entry);
+  // Removes the entry from the cache, unless it is kept for the tmem cache emulation.
+  void InvalidateTexture(TCacheEntry* entry);
   TCacheEntry* ReturnEntry(u32 stage, TCacheEntry* entry);
 
-  // Return all possible overlapping textures. As addr+size of the textures is not
-  // indexed, this may return false positives.
-  std::pair<TexAddrCache::iterator, TexAddrCache::iterator>
-  FindOverlappingTextures(u32 addr, u32 size_in_bytes);
+  void AddToHashCache(u64 hash, TCacheEntry* entry);
+  void RemoveFromHashCache(TCacheEntry* entry);
+  std::pair<TexHashCache::iterator, TexHashCache::iterator> FindByHash(u64 hash);
 
   TexAddrCache textures_by_address;
   TexHashCache textures_by_hash;
+  // Scratch buffers for the results of the textures_by_address queries
+  std::vector<TCacheEntry*> address_matches;
+  std::vector<TCacheEntry*> overlapping_textures;
   EnviromentCache enviroment_cache;
   TexPool texture_pool;
   size_t texture_pool_memory_usage = {};
+  std::unordered_map<TCacheEntry*, std::shared_ptr<TextureScalingJob>> scaling_jobs;
 
   // Backup configuration values
   struct BackupConfig
@@ -269,9 +314,15 @@ private:
     s32 scaling_factor;
     bool scaling_deposterize;
     bool gpu_texture_decoding;
+    bool disk_texture_cache;
+    s32 disk_texture_cache_size;
   };
   BackupConfig backup_config = {};
   std::unique_ptr<TextureScaler> m_scaler;
+  std::unique_ptr<TextureDiskCache> m_disk_cache;
+  // Scratch buffers for the textures written to the disk cache
+  std::vector<TextureDiskCache::Level> disk_cache_levels;
+  std::vector<u8> disk_cache_data;
 };
 
 extern std::unique_ptr<TextureCacheBase> g_texture_cache;
@@ -114,6 +114,9 @@ enum HostTextureFormat
 
 namespace TexDecoder
 {
+// Bump this when the output of a decoder changes, it invalidates the textures cached on disk.
+constexpr u32 VERSION = 1;
+
 static inline bool IsCompressed(HostTextureFormat format)
 {
   return format >= PC_TEX_FMT_DXT1 && format <= PC_TEX_FMT_BPTC;
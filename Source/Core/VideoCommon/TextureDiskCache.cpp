@@ -0,0 +1,298 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include "VideoCommon/TextureDiskCache.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstddef>
+#include <cstring>
+
+#include "Common/Align.h"
+#include "Common/File.h"
+#include "Common/FileUtil.h"
+#include "Common/Logging/Log.h"
+
+TextureDiskCache::~TextureDiskCache()
+{
+  Close();
+}
+
+u64 TextureDiskCache::GetRecordSize(u32 num_levels, u64 data_size)
+{
+  return sizeof(RecordHeader) + u64(num_levels) * sizeof(LevelHeader) +
+         Common::AlignUpSizePow2(data_size, 16);
+}
+
+bool TextureDiskCache::Open(const std::string& filename, u64 size_limit, u32 data_version)
+{
+  Close();
+  m_filename = filename;
+  m_size_limit = size_limit;
+  m_data_version = data_version;
+
+  Header header = {};
+  bool valid = m_mapping.Open(filename) && m_mapping.GetSize() >= sizeof(Header);
+  if (valid)
+  {
+    std::memcpy(&header, m_mapping.GetData(), sizeof(Header));
+    valid = header.magic == MAGIC && header.format_version == FORMAT_VERSION &&
+            header.data_version == data_version;
+    if (!valid)
+      INFO_LOG(VIDEO, "Discarding outdated texture cache %s", filename.c_str());
+  }
+  if (!valid)
+  {
+    m_mapping.Close();
+    header.session = 0;
+    if (!CreateEmptyFile() || !m_mapping.Open(filename))
+    {
+      ERROR_LOG(VIDEO, "Failed to create texture cache %s", filename.c_str());
+      return false;
+    }
+  }
+  m_session = header.session + 1;
+
+  u64 end = ReadIndex();
+  if (end > m_size_limit * EVICTION_THRESHOLD_PERCENT / 100 &&
+      Evict(m_size_limit * EVICTION_TARGET_PERCENT / 100))
+    end = ReadIndex();
+  if (!m_mapping.IsOpen())
+  {
+    ERROR_LOG(VIDEO, "Failed to map texture cache %s", filename.c_str());
+    m_entries.clear();
+    return false;
+  }
+  if (end != m_mapping.GetSize())
+  {
+    // Cut off the record that was being written when the emulator went down
+    m_mapping.Close();
+    File::IOFile file(filename, "r+b");
+    file.Resize(end);
+    file.Close();
+    m_mapping.Open(filename);
+  }
+
+  File::OpenFStream(m_file, filename, std::ios_base::in | std::ios_base::out |
+                                          std::ios_base::binary);
+  if (!m_file.is_open())
+  {
+    ERROR_LOG(VIDEO, "Failed to open texture cache %s", filename.c_str());
+    m_mapping.Close();
+    m_entries.clear();
+    return false;
+  }
+  header = {MAGIC, FORMAT_VERSION, data_version, m_session};
+  m_file.seekp(0);
+  m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  m_file_size = end;
+
+  INFO_LOG(VIDEO, "Opened texture cache %s with %zu textures (%" PRIu64 " KiB)", filename.c_str(),
+           m_entries.size(), m_file_size / 1024);
+  return true;
+}
+
+void TextureDiskCache::Close()
+{
+  if (!IsOpen())
+    return;
+
+  for (const Entry* entry : m_touched_entries)
+  {
+    m_file.seekp(entry->offset + offsetof(RecordHeader, last_used));
+    m_file.write(reinterpret_cast<const char*>(&entry->last_used), sizeof(entry->last_used));
+  }
+  m_file.close();
+  m_mapping.Close();
+  m_entries.clear();
+  m_touched_entries.clear();
+  m_read_buffer = {};
+  m_file_size = 0;
+  m_full = false;
+}
+
+bool TextureDiskCache::CreateEmptyFile()
+{
+  File::CreateFullPath(m_filename);
+  File::IOFile file(m_filename, "wb");
+  const Header header = {MAGIC, FORMAT_VERSION, m_data_version, 0};
+  return file.WriteBytes(&header, sizeof(header));
+}
+
+u64 TextureDiskCache::ReadIndex()
+{
+  m_entries.clear();
+  const u8* data = m_mapping.GetData();
+  const u64 size = m_mapping.GetSize();
+  u64 offset = sizeof(Header);
+  while (offset + sizeof(RecordHeader) <= size)
+  {
+    RecordHeader header;
+    std::memcpy(&header, data + offset, sizeof(header));
+    if (header.num_levels == 0 || header.num_levels > MAX_LEVELS)
+      break;
+    // data_size comes from the file, a corrupt one must not make the record wrap around
+    const u64 record_size = GetRecordSize(header.num_levels, header.data_size);
+    if (record_size > size - offset)
+      break;
+
+    u64 level_sizes = 0;
+    for (u32 i = 0; i < header.num_levels; ++i)
+    {
+      LevelHeader level;
+      std::memcpy(&level, data + offset + sizeof(RecordHeader) + i * sizeof(LevelHeader),
+                  sizeof(level));
+      level_sizes += level.size;
+    }
+    if (level_sizes != header.data_size)
+      break;
+
+    m_entries[header.key] = {offset, record_size, header.last_used};
+    offset += record_size;
+  }
+  return offset;
+}
+
+bool TextureDiskCache::Evict(u64 target_size)
+{
+  std::vector<const Entry*> entries;
+  entries.reserve(m_entries.size());
+  for (const auto& entry : m_entries)
+    entries.push_back(&entry.second);
+  // Most recently used first, in file order within a session
+  std::sort(entries.begin(), entries.end(), [](const Entry* a, const Entry* b) {
+    return a->last_used != b->last_used ? a->last_used > b->last_used : a->offset < b->offset;
+  });
+
+  const std::string temp_filename = m_filename + ".tmp";
+  std::ofstream file;
+  File::OpenFStream(file, temp_filename, std::ios_base::out | std::ios_base::binary);
+  const Header header = {MAGIC, FORMAT_VERSION, m_data_version, m_session - 1};
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  u64 size = sizeof(header);
+  size_t kept = 0;
+  for (const Entry* entry : entries)
+  {
+    if (size + entry->size > target_size)
+      break;
+    file.write(reinterpret_cast<const char*>(m_mapping.GetData() + entry->offset), entry->size);
+    size += entry->size;
+    kept++;
+  }
+  file.close();
+  if (file.fail())
+  {
+    ERROR_LOG(VIDEO, "Failed to write %s", temp_filename.c_str());
+    File::Delete(temp_filename);
+    return false;
+  }
+
+  m_mapping.Close();
+  const bool renamed = File::Rename(temp_filename, m_filename);
+  if (!m_mapping.Open(m_filename))
+    return false;
+  if (renamed)
+  {
+    INFO_LOG(VIDEO, "Evicted %zu least recently used textures from %s",
+             entries.size() - kept, m_filename.c_str());
+  }
+  return renamed;
+}
+
+bool TextureDiskCache::Lookup(const Key& key, Texture* texture)
+{
+  const auto iter = m_entries.find(key);
+  if (iter == m_entries.end())
+    return false;
+
+  Entry& entry = iter->second;
+  const u8* record;
+  if (entry.offset + entry.size <= m_mapping.GetSize())
+  {
+    record = m_mapping.GetData() + entry.offset;
+  }
+  else
+  {
+    m_read_buffer.resize(entry.size);
+    m_file.flush();
+    m_file.seekg(entry.offset);
+    if (!m_file.read(reinterpret_cast<char*>(m_read_buffer.data()), entry.size))
+    {
+      m_file.clear();
+      return false;
+    }
+    record = m_read_buffer.data();
+  }
+
+  RecordHeader header;
+  std::memcpy(&header, record, sizeof(header));
+  texture->format = static_cast<HostTextureFormat>(header.format);
+  texture->levels.resize(header.num_levels);
+  const u8* level_data = record + sizeof(RecordHeader) + header.num_levels * sizeof(LevelHeader);
+  for (u32 i = 0; i < header.num_levels; ++i)
+  {
+    LevelHeader level;
+    std::memcpy(&level, record + sizeof(RecordHeader) + i * sizeof(LevelHeader), sizeof(level));
+    texture->levels[i] = {level.width, level.height, level.row_length, level.size, level_data};
+    level_data += level.size;
+  }
+
+  if (entry.last_used != m_session)
+  {
+    entry.last_used = m_session;
+    m_touched_entries.push_back(&entry);
+  }
+  return true;
+}
+
+void TextureDiskCache::Store(const Key& key, HostTextureFormat format,
+                             const std::vector<Level>& levels, const u8* data)
+{
+  if (!IsOpen() || m_full || levels.empty() || levels.size() > MAX_LEVELS ||
+      m_entries.count(key))
+  {
+    return;
+  }
+
+  RecordHeader header = {};
+  header.key = key;
+  header.format = format;
+  header.num_levels = static_cast<u32>(levels.size());
+  u64 data_size = 0;
+  for (const Level& level : levels)
+    data_size += level.size;
+  if (data_size > UINT32_MAX)
+    return;
+  header.data_size = static_cast<u32>(data_size);
+  header.last_used = m_session;
+  const u64 record_size = GetRecordSize(header.num_levels, header.data_size);
+  if (m_file_size + record_size > m_size_limit)
+  {
+    INFO_LOG(VIDEO, "Texture cache %s is full, evicting old textures on the next start",
+             m_filename.c_str());
+    m_full = true;
+    return;
+  }
+
+  m_file.seekp(m_file_size);
+  m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  for (const Level& level : levels)
+  {
+    const LevelHeader level_header = {level.width, level.height, level.row_length, level.size};
+    m_file.write(reinterpret_cast<const char*>(&level_header), sizeof(level_header));
+  }
+  m_file.write(reinterpret_cast<const char*>(data), header.data_size);
+  static const char padding[16] = {};
+  m_file.write(padding, Common::AlignUpSizePow2(header.data_size, 16) - header.data_size);
+  if (m_file.fail())
+  {
+    ERROR_LOG(VIDEO, "Failed to write to texture cache %s", m_filename.c_str());
+    m_file.clear();
+    m_full = true;
+    return;
+  }
+
+  m_entries[header.key] = {m_file_size, record_size, m_session};
+  m_file_size += record_size;
+}
@@ -0,0 +1,177 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/MappedFile.h"
+#include "VideoCommon/TextureDecoder.h"
+
+// Persistent cache of the final level data of decoded (and possibly upscaled) textures, so a
+// warm start can skip both the decoder and the scaler.
+//
+// All textures of a game live in one pack file which is memory mapped on open, cache hits are
+// read straight from the mapping. New textures are appended to the end of the file. Every
+// entry remembers the session it was last used in; when the file has (almost) reached its size
+// limit the least recently used entries are dropped by rewriting the file the next time it is
+// opened.
+//
+// On disk format:
+// header{
+// u32 'DTXC';
+// u32 format_version;
+// u32 data_version;  // decoder and scaler versions, see Open
+// u32 session;       // incremented every time the file is opened
+// }
+// record{
+// Key key;
+// u32 format;  // HostTextureFormat
+// u32 num_levels;
+// u32 data_size;
+// u32 last_used;  // session
+// LevelHeader levels[num_levels];
+// u8 data[data_size];  // the levels back to back, padded to 16 bytes
+// }
+class TextureDiskCache
+{
+public:
+  struct Key
+  {
+    u64 hash;  // texture hash combined with the TLUT hash
+    u32 format;  // texture format | TLUT format << 16
+    u32 width;
+    u32 height;
+    u32 levels;
+    u32 scaling;  // see ScalingMode
+    // The HostTextureFormat the backend asked for, which depends on the formats it supports
+    u32 host_format;
+
+    bool operator==(const Key& other) const
+    {
+      return hash == other.hash && format == other.format && width == other.width &&
+             height == other.height && levels == other.levels && scaling == other.scaling &&
+             host_format == other.host_format;
+    }
+  };
+
+  struct Level
+  {
+    u32 width;
+    u32 height;
+    u32 row_length;  // in texels, as passed to HostTexture::Load
+    u32 size;        // in bytes
+    const u8* data;  // only set by Lookup
+  };
+
+  struct Texture
+  {
+    HostTextureFormat format;
+    std::vector<Level> levels;
+  };
+
+  static u32 ScalingMode(int type, int factor, bool deposterize)
+  {
+    return type > 0 ? (type | factor << 8 | deposterize << 16) : 0;
+  }
+
+  ~TextureDiskCache();
+
+  // Entries written with a different data_version are discarded, bump the versions whenever
+  // the output of the decoders or scalers changes.
+  bool Open(const std::string& filename, u64 size_limit, u32 data_version);
+  void Close();
+  bool IsOpen() const { return m_file.is_open(); }
+
+  // The level data stays valid until the next call to Lookup, Store or Close.
+  bool Lookup(const Key& key, Texture* texture);
+  // levels describe data, which holds the levels back to back.
+  // Does nothing if the texture is cached already or the cache is full.
+  void Store(const Key& key, HostTextureFormat format, const std::vector<Level>& levels,
+             const u8* data);
+
+  size_t GetEntryCount() const { return m_entries.size(); }
+  u64 GetFileSize() const { return m_file_size; }
+
+private:
+  static constexpr u32 MAGIC = 0x43585444;  // "DTXC"
+  static constexpr u32 FORMAT_VERSION = 2;
+  static constexpr u32 MAX_LEVELS = 16;
+  // Once the file is almost full, it is shrunk to the target when it is opened, so there is
+  // room for new textures and it doesn't have to be rewritten again on the next start.
+  static constexpr u64 EVICTION_THRESHOLD_PERCENT = 90;
+  static constexpr u64 EVICTION_TARGET_PERCENT = 75;
+
+  struct Header
+  {
+    u32 magic;
+    u32 format_version;
+    u32 data_version;
+    u32 session;
+  };
+
+  struct RecordHeader
+  {
+    Key key;
+    u32 format;
+    u32 num_levels;
+    u32 data_size;
+    u32 last_used;
+  };
+
+  struct LevelHeader
+  {
+    u32 width;
+    u32 height;
+    u32 row_length;
+    u32 size;
+  };
+
+  struct Entry
+  {
+    u64 offset;
+    u64 size;  // the whole record
+    u32 last_used;
+  };
+
+  struct KeyHasher
+  {
+    size_t operator()(const Key& key) const
+    {
+      return static_cast<size_t>(key.hash ^ (u64(key.format) << 32) ^ key.width ^
+                                 (key.height << 16) ^ key.levels ^ key.scaling ^
+                                 (key.host_format << 24));
+    }
+  };
+
+  static u64 GetRecordSize(u32 num_levels, u64 data_size);
+
+  bool CreateEmptyFile();
+  // Builds the index from the mapped file, returns the end of the last valid record.
+  u64 ReadIndex();
+  // Rewrites the file with the most recently used entries which fit into target_size.
+  bool Evict(u64 target_size);
+
+  std::string m_filename;
+  u64 m_size_limit = 0;
+  u32 m_data_version = 0;
+  u32 m_session = 0;
+
+  File::MappedFile m_mapping;
+  // Appends new records, a std::fstream like LinearDiskCache so the mapping can share the file
+  std::fstream m_file;
+  u64 m_file_size = 0;
+  bool m_full = false;
+
+  std::unordered_map<Key, Entry, KeyHasher> m_entries;
+  // Entries whose last_used has to be written back
+  std::vector<const Entry*> m_touched_entries;
+  // Holds records that were appended after the file was mapped
+  std::vector<u8> m_read_buffer;
+};
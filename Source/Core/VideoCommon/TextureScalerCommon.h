@@ -20,6 +20,7 @@
 #include "Common/CommonTypes.h"
 #include "Common/MemoryUtil.h"
 
+#include <functional>
 #include <vector>
 
 class TextureScaler
@@ -29,13 +30,27 @@ public:
   ~TextureScaler();
 
   u32* Scale(u32* data, int width, int height);
+  // Same as above, with the filter settings passed in instead of read from g_ActiveConfig,
+  // so it can be used off the video thread.
+  u32* Scale(u32* data, int width, int height, int type, int factor, bool deposterize);
+
+  // Splits every filter pass into row bands that run on the thread pool.
+  // The output is identical to the single threaded one.
+  void SetMultithreaded(bool enabled) { m_multithreaded = enabled; }
 
   enum
   {
     NONE = 0, XBRZ = 1, HYBRID = 2, BICUBIC = 3, HYBRID_BICUBIC = 4, JINC = 5, JINC_SHARPER = 6, SMOOTHSTEP = 7, THREE_POINT = 8, DDT = 9, DDT_SHARP = 10
   };
 
+  // Bump this when the output of a filter changes, it invalidates the textures cached on disk.
+  static constexpr u32 VERSION = 1;
+
 private:
+  // Smallest band of rows worth handing to another thread.
+  static constexpr int MIN_BAND_ROWS = 16;
+
+  void ForEachRowBand(int rows, const std::function<void(int, int)>& func);
 
   void ScaleXBRZ(int factor, u32* source, u32* dest, int width, int height);
   void ScaleBilinear(int factor, u32* source, u32* dest, int width, int height);
@@ -57,4 +72,6 @@ private:
   // maximum is (100 MB total for a 512 by 512 texture with scaling factor 5 and hybrid scaling)
   // of course, scaling factor 5 is totally silly anyway
   Common::SimpleBuf<u32> bufInput, bufDeposter, bufOutput, bufTmp1, bufTmp2, bufTmp3;
+
+  bool m_multithreaded = true;
 };
@@ -0,0 +1,303 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+// A draw is identified by its raw vertex data, its vertex loader, the position
+// matrix the loader falls back to and the base and stride of every vertex array
+// it indexes. When a draw is recorded, the part of every array it reads is
+// hashed. These hashes are compared against memory the first time the entry is
+// used in a new check context, which starts every frame and whenever the game
+// invalidates the GPU vertex cache after changing its arrays. Memory written by
+// DMA or EFB copies drops the entries reading it right away.
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/Hash.h"
+#include "Common/Swap.h"
+#include "Core/HW/Memmap.h"
+#include "VideoCommon/CPMemory.h"
+#include "VideoCommon/Statistics.h"
+#include "VideoCommon/VertexCache.h"
+#include "VideoCommon/VertexLoaderBase.h"
+#include "VideoCommon/VideoConfig.h"
+
+namespace VertexCache
+{
+// Entries that haven't been used for this many frames get dropped.
+constexpr u32 EXPIRE_FRAMES = 120;
+// Upper bound for the raw and converted vertex data kept by the cache.
+constexpr size_t MAX_BYTES = 64 * 1024 * 1024;
+// Largest attribute read from a single array element, a normal, binormal and tangent in floats.
+constexpr u32 MAX_ELEMENT_SIZE = 36;
+// Arrays read by the vertex loaders: position, normal, two colors and eight texture coordinates.
+constexpr int NUM_ARRAYS = 12;
+
+struct DrawState
+{
+  VertexLoaderBase* loader;
+  u32 posmtx;
+  u32 count;
+  u32 array_bases[NUM_ARRAYS];
+  u32 array_strides[NUM_ARRAYS];
+};
+
+struct ArrayRange
+{
+  u32 begin;
+  u32 end;
+  u64 hash;
+};
+
+struct CachedDraw
+{
+  DrawState state;
+  std::vector<ArrayRange> arrays;
+  u32 check_context = 0;
+  u32 last_frame = 0;
+  s32 count = 0;
+  // The raw vertex data, the key is only a hash of it
+  std::vector<u8> source;
+  std::vector<u8> data;
+
+  size_t GetSize() const { return source.size() + data.size(); }
+};
+
+static std::unordered_map<u64, CachedDraw> s_cache;
+static size_t s_cached_bytes;
+static u32 s_check_context;
+static u32 s_frame;
+// Array ranges hashed in the current check context, most of them are shared by several draws.
+static std::unordered_map<u64, u64> s_range_hashes;
+
+static std::mutex s_invalidation_lock;
+static std::vector<std::pair<u32, u32>> s_pending_invalidations;
+static std::atomic<bool> s_has_pending_invalidations{ false };
+
+void Init()
+{
+  Clear();
+  s_check_context = 1;
+  s_frame = 0;
+}
+
+void Shutdown()
+{
+  Clear();
+}
+
+void Clear()
+{
+  s_cache.clear();
+  s_range_hashes.clear();
+  s_cached_bytes = 0;
+  std::lock_guard<std::mutex> guard(s_invalidation_lock);
+  s_pending_invalidations.clear();
+  s_has_pending_invalidations.store(false);
+}
+
+void ProgressiveCleanup()
+{
+  s_frame++;
+  for (auto iter = s_cache.begin(); iter != s_cache.end();)
+  {
+    if (s_frame - iter->second.last_frame > EXPIRE_FRAMES)
+    {
+      s_cached_bytes -= iter->second.GetSize();
+      iter = s_cache.erase(iter);
+    }
+    else
+    {
+      ++iter;
+    }
+  }
+}
+
+void IncrementCheckContextId()
+{
+  s_check_context++;
+  s_range_hashes.clear();
+}
+
+void InvalidateRange(u32 address, u32 size)
+{
+  if (size == 0)
+    return;
+  std::lock_guard<std::mutex> guard(s_invalidation_lock);
+  s_pending_invalidations.emplace_back(address, address + size);
+  s_has_pending_invalidations.store(true);
+}
+
+static void ProcessPendingInvalidations()
+{
+  if (!s_has_pending_invalidations.load())
+    return;
+  std::vector<std::pair<u32, u32>> ranges;
+  {
+    std::lock_guard<std::mutex> guard(s_invalidation_lock);
+    ranges.swap(s_pending_invalidations);
+    s_has_pending_invalidations.store(false);
+  }
+  s_range_hashes.clear();
+  for (auto iter = s_cache.begin(); iter != s_cache.end();)
+  {
+    bool overlaps = false;
+    for (const ArrayRange& array : iter->second.arrays)
+    {
+      for (const auto& range : ranges)
+        overlaps |= array.begin < range.second && range.first < array.end;
+    }
+    if (overlaps)
+    {
+      s_cached_bytes -= iter->second.GetSize();
+      iter = s_cache.erase(iter);
+    }
+    else
+    {
+      ++iter;
+    }
+  }
+}
+
+static void GetDrawState(VertexLoaderBase* loader, const VertexLoaderParameters& parameters,
+                         DrawState* state)
+{
+  memset(state, 0, sizeof(DrawState));
+  state->loader = loader;
+  state->posmtx =
+      parameters.VtxDesc->PosMatIdx ? 0 : g_main_cp_state.matrix_index_a.PosNormalMtxIdx;
+  state->count = parameters.count;
+  for (int i = 0; i < NUM_ARRAYS; i++)
+  {
+    if (parameters.VtxDesc->GetVertexArrayStatus(i) >= INDEX8)
+    {
+      state->array_bases[i] = g_main_cp_state.array_bases[i];
+      state->array_strides[i] = g_main_cp_state.array_strides[i];
+    }
+  }
+}
+
+// Returns false if the range isn't backed by contiguous memory.
+static bool HashRange(u32 begin, u32 end, u64* hash)
+{
+  const u64 key = static_cast<u64>(begin) << 32 | end;
+  auto iter = s_range_hashes.find(key);
+  if (iter != s_range_hashes.end())
+  {
+    *hash = iter->second;
+    return true;
+  }
+  const u8* first = Memory::GetPointer(begin);
+  const u8* last = Memory::GetPointer(end - 1);
+  if (first == nullptr || last == nullptr || last - first != static_cast<ptrdiff_t>(end - 1 - begin))
+    return false;
+  *hash = GetHash64(first, end - begin, 0);
+  s_range_hashes[key] = *hash;
+  return true;
+}
+
+// Finds the part of every indexed array the draw reads from its largest index.
+static bool GetArrayRanges(VertexLoaderBase* loader, const VertexLoaderParameters& parameters,
+                           const DrawState& state, std::vector<ArrayRange>* ranges)
+{
+  s32 offsets[NUM_ARRAYS];
+  loader->GetArrayIndexOffsets(offsets);
+  const VAT& vat = *parameters.VtxAttr;
+  for (int i = 0; i < NUM_ARRAYS; i++)
+  {
+    if (offsets[i] < 0)
+      continue;
+    const bool index16 = parameters.VtxDesc->GetVertexArrayStatus(i) == INDEX16;
+    const int num_indices = i == ARRAY_NORMAL && vat.g0.NormalIndex3 && vat.g0.NormalElements ? 3 : 1;
+    const u8* src = parameters.source + offsets[i];
+    u32 max_index = 0;
+    for (int v = 0; v < parameters.count; v++)
+    {
+      for (int j = 0; j < num_indices; j++)
+      {
+        const u32 index = index16 ? Common::swap16(src + j * 2) : src[j];
+        // Vertices with the largest position index are skipped.
+        if (i != ARRAY_POSITION || index != (index16 ? 0xFFFFu : 0xFFu))
+          max_index = std::max(max_index, index);
+      }
+      src += loader->m_VertexSize;
+    }
+
+    ArrayRange range;
+    range.begin = state.array_bases[i];
+    range.end = range.begin + max_index * state.array_strides[i] + MAX_ELEMENT_SIZE;
+    if (range.end < range.begin || !HashRange(range.begin, range.end, &range.hash))
+      return false;
+    ranges->push_back(range);
+  }
+  return true;
+}
+
+s32 ConvertVertices(VertexLoaderBase* loader, const VertexLoaderParameters& parameters,
+                    u32 readsize, const std::function<s32()>& convert)
+{
+  // The CPU bounding box is updated by the vertex loaders themselves.
+  if (g_ActiveConfig.iBBoxMode == BBoxCPU)
+    return convert();
+  ProcessPendingInvalidations();
+
+  DrawState state;
+  GetDrawState(loader, parameters, &state);
+  const u64 key = GetHash64(parameters.source, readsize, 0) ^
+                  GetHash64(reinterpret_cast<const u8*>(&state), sizeof(state), 0) * 31;
+  auto iter = s_cache.find(key);
+  if (iter != s_cache.end())
+  {
+    CachedDraw& draw = iter->second;
+    bool valid = memcmp(&draw.state, &state, sizeof(state)) == 0 &&
+                 draw.source.size() == readsize &&
+                 memcmp(draw.source.data(), parameters.source, readsize) == 0;
+    if (valid && draw.check_context != s_check_context)
+    {
+      for (const ArrayRange& range : draw.arrays)
+      {
+        u64 hash;
+        valid &= HashRange(range.begin, range.end, &hash) && hash == range.hash;
+      }
+      draw.check_context = s_check_context;
+    }
+    if (valid)
+    {
+      memcpy(parameters.destination, draw.data.data(), draw.data.size());
+      draw.last_frame = s_frame;
+      loader->m_numLoadedVertices += parameters.count;
+      INCSTAT(stats.thisFrame.numVertexCacheHits);
+      ADDSTAT(stats.thisFrame.bytesVertexCacheSkipped, static_cast<int>(draw.data.size()));
+      return draw.count;
+    }
+    s_cached_bytes -= draw.GetSize();
+    s_cache.erase(iter);
+  }
+
+  INCSTAT(stats.thisFrame.numVertexCacheMisses);
+  const s32 count = convert();
+  const size_t size = count * loader->m_native_stride;
+  if (s_cached_bytes + readsize + size > MAX_BYTES)
+    return count;
+
+  CachedDraw draw;
+  draw.state = state;
+  if (!GetArrayRanges(loader, parameters, state, &draw.arrays))
+    return count;
+  draw.check_context = s_check_context;
+  draw.last_frame = s_frame;
+  draw.count = count;
+  draw.source.assign(parameters.source, parameters.source + readsize);
+  draw.data.assign(parameters.destination, parameters.destination + size);
+  s_cached_bytes += draw.GetSize();
+  s_cache.emplace(key, std::move(draw));
+  return count;
+}
+}  // namespace VertexCache
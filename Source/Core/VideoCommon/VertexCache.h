@@ -0,0 +1,42 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <functional>
+
+#include "Common/CommonTypes.h"
+
+class VertexLoaderBase;
+struct VertexLoaderParameters;
+
+// Converted vertex cache.
+// Keeps the output of draws that get submitted again with the same vertex data,
+// vertex format and vertex arrays, so repeated draws are copied into the vertex
+// buffer instead of running the vertex loader again.
+namespace VertexCache
+{
+// Draws with fewer vertices cost more to look up than to convert.
+constexpr int MIN_VERTICES = 32;
+
+void Init();
+void Shutdown();
+void Clear();
+
+// Drops entries that haven't been used for a while. Called once per frame.
+void ProgressiveCleanup();
+
+// Makes every entry compare its vertex arrays against memory the next time it
+// gets used. Called once per frame and when the game invalidates the GPU vertex cache.
+void IncrementCheckContextId();
+
+// Drops the entries reading vertex arrays from [address, address + size).
+// Can be called from any thread, for memory written by DMA or EFB copies.
+void InvalidateRange(u32 address, u32 size);
+
+// Writes the vertices of the draw to parameters.destination and returns their count.
+// Repeated draws are copied from the cache, others are converted with convert and recorded.
+s32 ConvertVertices(VertexLoaderBase* loader, const VertexLoaderParameters& parameters,
+                    u32 readsize, const std::function<s32()>& convert);
+}
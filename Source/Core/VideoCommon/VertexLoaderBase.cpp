@@ -13,6 +13,9 @@
 #include "VideoCommon/VertexLoader.h"
 #include "VideoCommon/VertexLoaderCompiled.h"
 #include "VideoCommon/VertexLoaderBase.h"
+#include "VideoCommon/VertexLoader_Normal.h"
+#include "VideoCommon/VertexLoader_Position.h"
+#include "VideoCommon/VertexLoader_TextCoord.h"
 #include "VideoCommon/VideoConfig.h"
 
 #ifdef _M_X86_64
@@ -138,44 +141,96 @@ VertexLoaderBase::VertexLoaderBase(const TVtxDesc &vtx_desc, const VAT &vtx_attr
 
 void VertexLoaderBase::SetVAT(const VAT& vat)
 {
-  m_VtxAttr.PosElements = vat.g0.PosElements;
-  m_VtxAttr.PosFormat = vat.g0.PosFormat;
-  m_VtxAttr.PosFrac = vat.g0.PosFrac;
-  m_VtxAttr.NormalElements = vat.g0.NormalElements;
-  m_VtxAttr.NormalFormat = vat.g0.NormalFormat;
-  m_VtxAttr.color[0].Elements = vat.g0.Color0Elements;
-  m_VtxAttr.color[0].Comp = vat.g0.Color0Comp;
-  m_VtxAttr.color[1].Elements = vat.g0.Color1Elements;
-  m_VtxAttr.color[1].Comp = vat.g0.Color1Comp;
-  m_VtxAttr.texCoord[0].Elements = vat.g0.Tex0CoordElements;
-  m_VtxAttr.texCoord[0].Format = vat.g0.Tex0CoordFormat;
-  m_VtxAttr.texCoord[0].Frac = vat.g0.Tex0Frac;
-  m_VtxAttr.ByteDequant = vat.g0.ByteDequant;
-  m_VtxAttr.NormalIndex3 = vat.g0.NormalIndex3;
-
-  m_VtxAttr.texCoord[1].Elements = vat.g1.Tex1CoordElements;
-  m_VtxAttr.texCoord[1].Format = vat.g1.Tex1CoordFormat;
-  m_VtxAttr.texCoord[1].Frac = vat.g1.Tex1Frac;
-  m_VtxAttr.texCoord[2].Elements = vat.g1.Tex2CoordElements;
-  m_VtxAttr.texCoord[2].Format = vat.g1.Tex2CoordFormat;
-  m_VtxAttr.texCoord[2].Frac = vat.g1.Tex2Frac;
-  m_VtxAttr.texCoord[3].Elements = vat.g1.Tex3CoordElements;
-  m_VtxAttr.texCoord[3].Format = vat.g1.Tex3CoordFormat;
-  m_VtxAttr.texCoord[3].Frac = vat.g1.Tex3Frac;
-  m_VtxAttr.texCoord[4].Elements = vat.g1.Tex4CoordElements;
-  m_VtxAttr.texCoord[4].Format = vat.g1.Tex4CoordFormat;
-
-  m_VtxAttr.texCoord[4].Frac = vat.g2.Tex4Frac;
-  m_VtxAttr.texCoord[5].Elements = vat.g2.Tex5CoordElements;
-  m_VtxAttr.texCoord[5].Format = vat.g2.Tex5CoordFormat;
-  m_VtxAttr.texCoord[5].Frac = vat.g2.Tex5Frac;
-  m_VtxAttr.texCoord[6].Elements = vat.g2.Tex6CoordElements;
-  m_VtxAttr.texCoord[6].Format = vat.g2.Tex6CoordFormat;
-  m_VtxAttr.texCoord[6].Frac = vat.g2.Tex6Frac;
-  m_VtxAttr.texCoord[7].Elements = vat.g2.Tex7CoordElements;
-  m_VtxAttr.texCoord[7].Format = vat.g2.Tex7CoordFormat;
-  m_VtxAttr.texCoord[7].Frac = vat.g2.Tex7Frac;
-};
+  m_VtxAttr = DecodeVAT(vat);
+}
+
+TVtxAttr VertexLoaderBase::DecodeVAT(const VAT& vat)
+{
+  TVtxAttr attr;
+  attr.PosElements = vat.g0.PosElements;
+  attr.PosFormat = vat.g0.PosFormat;
+  attr.PosFrac = vat.g0.PosFrac;
+  attr.NormalElements = vat.g0.NormalElements;
+  attr.NormalFormat = vat.g0.NormalFormat;
+  attr.color[0].Elements = vat.g0.Color0Elements;
+  attr.color[0].Comp = vat.g0.Color0Comp;
+  attr.color[1].Elements = vat.g0.Color1Elements;
+  attr.color[1].Comp = vat.g0.Color1Comp;
+  attr.texCoord[0].Elements = vat.g0.Tex0CoordElements;
+  attr.texCoord[0].Format = vat.g0.Tex0CoordFormat;
+  attr.texCoord[0].Frac = vat.g0.Tex0Frac;
+  attr.ByteDequant = vat.g0.ByteDequant;
+  attr.NormalIndex3 = vat.g0.NormalIndex3;
+
+  attr.texCoord[1].Elements = vat.g1.Tex1CoordElements;
+  attr.texCoord[1].Format = vat.g1.Tex1CoordFormat;
+  attr.texCoord[1].Frac = vat.g1.Tex1Frac;
+  attr.texCoord[2].Elements = vat.g1.Tex2CoordElements;
+  attr.texCoord[2].Format = vat.g1.Tex2CoordFormat;
+  attr.texCoord[2].Frac = vat.g1.Tex2Frac;
+  attr.texCoord[3].Elements = vat.g1.Tex3CoordElements;
+  attr.texCoord[3].Format = vat.g1.Tex3CoordFormat;
+  attr.texCoord[3].Frac = vat.g1.Tex3Frac;
+  attr.texCoord[4].Elements = vat.g1.Tex4CoordElements;
+  attr.texCoord[4].Format = vat.g1.Tex4CoordFormat;
+
+  attr.texCoord[4].Frac = vat.g2.Tex4Frac;
+  attr.texCoord[5].Elements = vat.g2.Tex5CoordElements;
+  attr.texCoord[5].Format = vat.g2.Tex5CoordFormat;
+  attr.texCoord[5].Frac = vat.g2.Tex5Frac;
+  attr.texCoord[6].Elements = vat.g2.Tex6CoordElements;
+  attr.texCoord[6].Format = vat.g2.Tex6CoordFormat;
+  attr.texCoord[6].Frac = vat.g2.Tex6Frac;
+  attr.texCoord[7].Elements = vat.g2.Tex7CoordElements;
+  attr.texCoord[7].Format = vat.g2.Tex7CoordFormat;
+  attr.texCoord[7].Frac = vat.g2.Tex7Frac;
+  return attr;
+}
+
+void VertexLoaderBase::GetArrayIndexOffsets(s32 offsets[12]) const
+{
+  GetArrayIndexOffsets(m_VtxDesc, m_VtxAttr, offsets);
+}
+
+u32 VertexLoaderBase::GetVertexSize(const TVtxDesc& vtx_desc, const VAT& vtx_attr)
+{
+  s32 offsets[12];
+  return GetArrayIndexOffsets(vtx_desc, DecodeVAT(vtx_attr), offsets);
+}
+
+u32 VertexLoaderBase::GetArrayIndexOffsets(const TVtxDesc& vtx_desc, const TVtxAttr& vtx_attr,
+                                           s32 offsets[12])
+{
+  static const u32 color_size[8] = {2, 3, 4, 2, 3, 4, 0, 0};
+  const u32 attribute[12] = {
+      static_cast<u32>(vtx_desc.Position), static_cast<u32>(vtx_desc.Normal),
+      static_cast<u32>(vtx_desc.Color0),   static_cast<u32>(vtx_desc.Color1),
+      static_cast<u32>(vtx_desc.Tex0Coord), static_cast<u32>(vtx_desc.Tex1Coord),
+      static_cast<u32>(vtx_desc.Tex2Coord), static_cast<u32>(vtx_desc.Tex3Coord),
+      static_cast<u32>(vtx_desc.Tex4Coord), static_cast<u32>(vtx_desc.Tex5Coord),
+      static_cast<u32>(vtx_desc.Tex6Coord), static_cast<u32>(vtx_desc.Tex7Coord)};
+
+  // The matrix indices come first, one byte each.
+  u32 offset = 0;
+  for (u32 i = 0; i < 9; i++)
+    offset += (vtx_desc.Hex >> i) & 1;
+
+  for (int i = 0; i < 12; i++)
+  {
+    offsets[i] = attribute[i] >= INDEX8 ? static_cast<s32>(offset) : -1;
+    if (attribute[i] == NOT_PRESENT)
+      continue;
+    if (i == 0)
+      offset += VertexLoader_Position::GetSize(attribute[i], vtx_attr.PosFormat, vtx_attr.PosElements);
+    else if (i == 1)
+      offset += VertexLoader_Normal::GetSize(attribute[i], vtx_attr.NormalFormat, vtx_attr.NormalElements, vtx_attr.NormalIndex3);
+    else if (i < 4)
+      offset += attribute[i] == DIRECT ? color_size[vtx_attr.color[i - 2].Comp] : attribute[i] - 1;
+    else
+      offset += VertexLoader_TextCoord::GetSize(attribute[i], vtx_attr.texCoord[i - 4].Format, vtx_attr.texCoord[i - 4].Elements);
+  }
+  return offset;
+}
 
 std::string VertexLoaderBase::GetName() const
 {
@@ -241,7 +296,26 @@ void VertexLoaderBase::AppendToString(std::string *dest) const
   dest->reserve(250);
 
   dest->append(GetName());
-  dest->append(StringFromFormat(" - %zu v\n", m_numLoadedVertices));
+  dest->append(StringFromFormat(" - %zu v %s", m_numLoadedVertices, GetKindName(GetKind())));
+  if (m_fallback && m_fallback->m_numLoadedVertices)
+  {
+    dest->append(StringFromFormat(", %zu v %s", m_fallback->m_numLoadedVertices,
+      GetKindName(m_fallback->GetKind())));
+  }
+  dest->append("\n");
+}
+
+const char* VertexLoaderBase::GetKindName(VertexLoaderKind kind)
+{
+  switch (kind)
+  {
+  case VertexLoaderKind::Compiled:
+    return "compiled";
+  case VertexLoaderKind::JIT:
+    return "jit";
+  default:
+    return "generic";
+  }
 }
 
 // a hacky implementation to compare two vertex loaders
@@ -312,6 +386,10 @@ public:
   {
     return m_initialized;
   }
+  VertexLoaderKind GetKind() const override
+  {
+    return b->GetKind();
+  }
 
 private:
   std::unique_ptr<VertexLoaderBase> a;
@@ -52,6 +52,14 @@ struct hash<VertexLoaderUID>
 
 }
 
+// Which implementation converts the vertices of a format, reported in the loader profiles.
+enum class VertexLoaderKind
+{
+  Generic,
+  Compiled,
+  JIT,
+};
+
 class VertexLoaderBase
 {
 public:
@@ -76,10 +84,38 @@ public:
   {
     return false;
   }
+  virtual VertexLoaderKind GetKind() const
+  {
+    return VertexLoaderKind::Generic;
+  }
+  static const char* GetKindName(VertexLoaderKind kind);
   virtual s32 RunVertices(const VertexLoaderParameters &parameters) = 0;
 
+  // Loaders that convert every vertex independently of the others can split a draw into
+  // ranges converted concurrently. BeginParallelRun is called once per draw on the GPU thread,
+  // then RunVerticesRange from any thread. It returns the number of vertices written, which is
+  // less than count when indexed positions are skipped, and never writes past count vertices.
+  virtual bool SupportsParallelRun() const
+  {
+    return false;
+  }
+  virtual void BeginParallelRun(const VertexLoaderParameters &parameters)
+  {
+  }
+  virtual s32 RunVerticesRange(const u8* src, u8* dst, int count)
+  {
+    return 0;
+  }
+
   virtual bool IsInitialized() = 0;
 
+  // Byte offset of the array index of every vertex array (position, normal, colors, texture
+  // coordinates) in a raw vertex, -1 for attributes that aren't indexed.
+  void GetArrayIndexOffsets(s32 offsets[12]) const;
+
+  // Number of bytes of a raw vertex, without creating a loader. Safe to call from any thread.
+  static u32 GetVertexSize(const TVtxDesc& vtx_desc, const VAT& vtx_attr);
+
   // For debugging / profiling
   void AppendToString(std::string *dest) const;
   std::string GetName() const;
@@ -98,6 +134,10 @@ protected:
   VertexLoaderBase(const TVtxDesc &vtx_desc, const VAT &vtx_attr);
   void InitializeVertexData();
   void SetVAT(const VAT &vtx_attr);
+  static TVtxAttr DecodeVAT(const VAT& vtx_attr);
+  // Returns the vertex size
+  static u32 GetArrayIndexOffsets(const TVtxDesc& vtx_desc, const TVtxAttr& vtx_attr,
+                                  s32 offsets[12]);
 
   // GC vertex format
   TVtxAttr m_VtxAttr;  // VAT decoded into easy format
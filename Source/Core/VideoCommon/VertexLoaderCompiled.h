@@ -16,6 +16,10 @@ public:
   {
     return true;
   }
+  VertexLoaderKind GetKind() const override
+  {
+    return VertexLoaderKind::Compiled;
+  }
   s32 RunVertices(const VertexLoaderParameters &parameters) override;
 
   bool IsInitialized() override
@@ -3,27 +3,39 @@
 // Refer to the license.txt file included.
 // Modified for Ishiiruka by Tino
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <map>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 
 #include "Core/ConfigManager.h"
 #include "Core/HW/Memmap.h"
 
+#include "Common/Profiler.h"
 #include "Common/ThreadPool.h"
 #include "Common/StringUtil.h"
+#include "Common/Timer.h"
 
 #include "VideoCommon/IndexGenerator.h"
 #include "VideoCommon/Statistics.h"
+#include "VideoCommon/VertexCache.h"
 #include "VideoCommon/VertexLoaderManager.h"
+#include "VideoCommon/VertexLoaderProfile.h"
 #include "VideoCommon/VertexManagerBase.h"
 #include "VideoCommon/VertexShaderManager.h"
 #include "VideoCommon/VideoConfig.h"
 
 
 
+// Smaller ranges cost more to hand to a worker than converting them takes.
+static const int PARALLEL_MIN_RANGE_VERTICES = 1024;
+
 static VertexLoaderBase *s_cpu_loaders[8];
+static u32 s_preprocess_vertex_sizes[8];
 static std::string last_game_code;
 
 typedef std::unordered_map<VertexLoaderUID, std::unique_ptr<VertexLoaderBase>> VertexLoaderMap;
@@ -94,8 +106,55 @@ void Init()
   last_game_code = SConfig::GetInstance().GetGameID();
 }
 
+// Adds the vertex counts of this session to the loader profile of the game.
+static void SaveLoaderProfile()
+{
+  if (last_game_code.empty())
+    return;
+  VertexLoaderProfile::Profile session;
+  size_t loaders_by_kind[3] = {};
+  for (const auto& iter : s_vertex_loader_map)
+  {
+    const VertexLoaderBase* loader = iter.second.get();
+    u64 num_verts = loader->m_numLoadedVertices;
+    VertexLoaderKind kind = loader->GetKind();
+    const VertexLoaderBase* fallback = iter.second->GetFallback();
+    if (fallback && fallback->m_numLoadedVertices)
+    {
+      num_verts += fallback->m_numLoadedVertices;
+      // Report the loader that did most of the work
+      if (fallback->m_numLoadedVertices > loader->m_numLoadedVertices)
+        kind = fallback->GetKind();
+    }
+    if (num_verts == 0)
+      continue;
+    loaders_by_kind[static_cast<int>(kind)]++;
+    VertexLoaderProfile::Entry& entry = session[iter.first.GetHash()];
+    for (u32 i = 0; i < 4; i++)
+      entry.uid[i] = iter.first.GetElement(i);
+    entry.num_verts = num_verts;
+    entry.kind = VertexLoaderBase::GetKindName(kind);
+    entry.name = loader->GetName();
+  }
+  if (session.empty())
+    return;
+  INFO_LOG(VIDEO, "Vertex formats of %s: %zu jit, %zu compiled, %zu generic",
+    last_game_code.c_str(), loaders_by_kind[static_cast<int>(VertexLoaderKind::JIT)],
+    loaders_by_kind[static_cast<int>(VertexLoaderKind::Compiled)],
+    loaders_by_kind[static_cast<int>(VertexLoaderKind::Generic)]);
+
+  const std::string path = VertexLoaderProfile::GetProfilePath(last_game_code);
+  VertexLoaderProfile::Profile profile;
+  if (!VertexLoaderProfile::Load(path, &profile))
+    profile.clear();
+  VertexLoaderProfile::Merge(&profile, session);
+  if (!VertexLoaderProfile::Save(path, profile))
+    WARN_LOG(VIDEO, "Failed to write the vertex loader profile %s", path.c_str());
+}
+
 void Shutdown()
 {
+  SaveLoaderProfile();
   s_vertex_loader_map.clear();
   s_native_vertex_map.clear();
 }
@@ -235,30 +294,39 @@ void GetVertexSizeAndComponents(const VertexLoaderParameters &parameters, u32 &v
   components = s_cpu_loaders[parameters.vtx_attr_group]->m_native_components;
 }
 
+u32 GetPreprocessVertexSize(const VertexLoaderParameters &parameters)
+{
+  if (parameters.needloaderrefresh)
+  {
+    s_preprocess_vertex_sizes[parameters.vtx_attr_group] =
+        VertexLoaderBase::GetVertexSize(*parameters.VtxDesc, *parameters.VtxAttr);
+  }
+  return s_preprocess_vertex_sizes[parameters.vtx_attr_group];
+}
+
 inline void UpdateLoader(const VertexLoaderParameters &parameters)
 {
   g_main_cp_state.vertex_loaders[parameters.vtx_attr_group] = GetOrAddLoader(*parameters.VtxDesc, *parameters.VtxAttr);
   g_main_cp_state.last_id = parameters.vtx_attr_group;
 }
 
-bool ConvertVertices(VertexLoaderParameters &parameters, u32 &readsize, u32 &writesize)
+VertexLoaderBase* GetActiveLoader(VertexLoaderParameters &parameters)
 {
   if (parameters.needloaderrefresh)
   {
     UpdateLoader(parameters);
+    parameters.needloaderrefresh = false;
   }
   auto loader = g_main_cp_state.vertex_loaders[parameters.vtx_attr_group];
   if (!loader->EnvironmentIsSupported())
   {
     loader = loader->GetFallback();
   }
-  readsize = parameters.count * loader->m_VertexSize;
-  if (parameters.buf_size < readsize)
-    return false;
-  if (parameters.skip_draw)
-  {
-    return true;
-  }
+  return loader;
+}
+
+inline void PrepareVertexBuffer(VertexLoaderBase* loader, VertexLoaderParameters &parameters)
+{
   // Lookup pointers for any vertex arrays.
   UpdateVertexArrayPointers();
   NativeVertexFormat *nativefmt = loader->m_native_vertex_format;
@@ -272,11 +340,116 @@ bool ConvertVertices(VertexLoaderParameters &parameters, u32 &readsize, u32 &wri
   VertexShaderManager::SetVertexFormat(loader->m_native_components);
   g_vertex_manager->PrepareForAdditionalData(parameters.primitive, parameters.count, loader->m_native_stride);
   parameters.destination = g_vertex_manager->GetCurrentBufferPointer();
-  s32 finalcount = loader->RunVertices(parameters);
+}
+
+inline void CommitVertices(VertexLoaderBase* loader, const VertexLoaderParameters &parameters, s32 finalcount, u32 &writesize)
+{
   writesize = loader->m_native_stride * finalcount;
   IndexGenerator::AddIndices(parameters.primitive, finalcount);
   ADDSTAT(stats.thisFrame.numPrims, finalcount);
   INCSTAT(stats.thisFrame.numPrimitiveJoins);
+}
+
+inline s32 RunLoader(VertexLoaderBase* loader, const VertexLoaderParameters &parameters)
+{
+  int num_ranges = 1;
+  if (g_ActiveConfig.bParallelVertexLoading &&
+      parameters.count >= g_ActiveConfig.iParallelVertexLoadingThreshold &&
+      loader->SupportsParallelRun())
+  {
+    num_ranges = std::min(static_cast<int>(Common::ThreadPool::GetThreadCount()) + 1,
+                          parameters.count / PARALLEL_MIN_RANGE_VERTICES);
+  }
+  return num_ranges > 1 ? RunVerticesParallel(loader, parameters, num_ranges) :
+                          loader->RunVertices(parameters);
+}
+
+bool ConvertVertices(VertexLoaderParameters &parameters, u32 &readsize, u32 &writesize)
+{
+  PROFILE("VertexLoaderManager::ConvertVertices");
+  VertexLoaderBase* loader = GetActiveLoader(parameters);
+  readsize = parameters.count * loader->m_VertexSize;
+  if (parameters.buf_size < readsize)
+    return false;
+  if (parameters.skip_draw)
+  {
+    return true;
+  }
+  PrepareVertexBuffer(loader, parameters);
+  s32 finalcount;
+  if (g_ActiveConfig.bVertexCache && parameters.count >= VertexCache::MIN_VERTICES)
+  {
+    finalcount = VertexCache::ConvertVertices(loader, parameters, readsize,
+                                              [&] { return RunLoader(loader, parameters); });
+  }
+  else
+  {
+    finalcount = RunLoader(loader, parameters);
+  }
+  CommitVertices(loader, parameters, finalcount, writesize);
+  return true;
+}
+
+s32 RunVerticesParallel(VertexLoaderBase* loader, const VertexLoaderParameters &parameters, int num_ranges)
+{
+  const u64 start_time = Common::Timer::GetTimeUs();
+  const s64 count = parameters.count;
+  const s32 vertex_size = loader->m_VertexSize;
+  const s32 stride = loader->m_native_stride;
+  auto range_begin = [count, num_ranges](int range) {
+    return static_cast<s32>(count * range / num_ranges);
+  };
+
+  // Every range writes at the offset its vertices would have without skipped positions.
+  std::vector<s32> loaded(num_ranges);
+  std::atomic<u64> busy_time{ 0 };
+  loader->BeginParallelRun(parameters);
+  Common::ThreadPool::ParallelFor(0, num_ranges, 1, [&](int first, int last) {
+    const u64 range_start_time = Common::Timer::GetTimeUs();
+    for (int i = first; i < last; i++)
+    {
+      const s32 begin = range_begin(i);
+      loaded[i] = loader->RunVerticesRange(parameters.source + begin * vertex_size,
+                                           parameters.destination + begin * stride,
+                                           range_begin(i + 1) - begin);
+    }
+    busy_time.fetch_add(Common::Timer::GetTimeUs() - range_start_time);
+  });
+
+  // Close the gaps left by skipped vertices.
+  s32 total = 0;
+  for (int i = 0; i < num_ranges; i++)
+  {
+    const s32 begin = range_begin(i);
+    if (begin != total && loaded[i] > 0)
+    {
+      memmove(parameters.destination + total * stride, parameters.destination + begin * stride,
+              loaded[i] * stride);
+    }
+    total += loaded[i];
+  }
+
+  INCSTAT(stats.thisFrame.numParallelVertexLoads);
+  ADDSTAT(stats.thisFrame.numParallelVerticesLoaded, parameters.count);
+  ADDSTAT(stats.thisFrame.parallelVertexLoadBusyUs, static_cast<int>(busy_time.load()));
+  ADDSTAT(stats.thisFrame.parallelVertexLoadWallUs,
+          static_cast<int>(Common::Timer::GetTimeUs() - start_time));
+  return total;
+}
+
+bool ReplayVertices(VertexLoaderParameters &parameters, VertexLoaderBase* loader, const u8* data, s32 count, u32 &readsize, u32 &writesize)
+{
+  readsize = parameters.count * loader->m_VertexSize;
+  if (parameters.buf_size < readsize)
+    return false;
+  if (parameters.skip_draw)
+  {
+    return true;
+  }
+  PrepareVertexBuffer(loader, parameters);
+  memcpy(parameters.destination, data, count * loader->m_native_stride);
+  loader->m_numLoadedVertices += parameters.count;
+  CommitVertices(loader, parameters, count, writesize);
   return true;
 }
 
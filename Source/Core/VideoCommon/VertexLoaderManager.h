@@ -32,8 +32,24 @@ int GetVertexSize(const VertexLoaderParameters &parameters);
 
 bool ConvertVertices(VertexLoaderParameters &parameters, u32 &readsize, u32 &writesize);
 
+// Returns the loader ConvertVertices would run for the given parameters.
+VertexLoaderBase* GetActiveLoader(VertexLoaderParameters &parameters);
+
+// Same as ConvertVertices, but copies count vertices previously produced by loader
+// into the vertex buffer instead of running the loader again.
+bool ReplayVertices(VertexLoaderParameters &parameters, VertexLoaderBase* loader, const u8* data, s32 count, u32 &readsize, u32 &writesize);
+
+// Converts the draw with a loader supporting parallel runs, split into num_ranges ranges
+// converted on the thread pool. Returns the number of vertices written to
+// parameters.destination, packed the same way RunVertices packs them.
+s32 RunVerticesParallel(VertexLoaderBase* loader, const VertexLoaderParameters &parameters, int num_ranges);
+
 void GetVertexSizeAndComponents(const VertexLoaderParameters &parameters, u32 &vertexsize, u32 &components);
 
+// Raw vertex size for the preprocessing pass. Doesn't create vertex loaders, so it can run
+// on the CPU or the FIFO preprocessing thread while the GPU thread converts vertices.
+u32 GetPreprocessVertexSize(const VertexLoaderParameters &parameters);
+
 // For debugging
 void AppendListToString(std::string *dest);
 
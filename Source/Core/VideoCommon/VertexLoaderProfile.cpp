@@ -0,0 +1,80 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <cinttypes>
+#include <sstream>
+
+#include "Common/CommonPaths.h"
+#include "Common/FileUtil.h"
+#include "Common/StringUtil.h"
+
+#include "VideoCommon/VertexLoaderProfile.h"
+
+namespace VertexLoaderProfile
+{
+// One format per line:
+// <uid hash> <uid0> <uid1> <uid2> <uid3> <vertex count> <loader kind> <format name>
+static const char PROFILE_HEADER[] = "# hash uid0 uid1 uid2 uid3 num_verts loader name\n";
+
+std::string GetProfilePath(const std::string& game_id)
+{
+  return File::GetUserPath(D_CACHE_IDX) + "VertexLoaders" DIR_SEP + game_id + ".txt";
+}
+
+bool Load(const std::string& path, Profile* profile)
+{
+  std::string contents;
+  if (!File::ReadFileToString(path, contents))
+    return false;
+
+  std::istringstream in(contents);
+  std::string line;
+  while (std::getline(in, line))
+  {
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    std::istringstream fields(line);
+    u64 hash;
+    Entry entry;
+    fields >> std::hex >> hash >> entry.uid[0] >> entry.uid[1] >> entry.uid[2] >> entry.uid[3] >>
+        std::dec >> entry.num_verts >> entry.kind >> entry.name;
+    if (fields.fail())
+      return false;
+
+    Profile::iterator iter = profile->find(hash);
+    if (iter == profile->end())
+      profile->emplace(hash, std::move(entry));
+    else
+      iter->second.num_verts += entry.num_verts;
+  }
+  return true;
+}
+
+bool Save(const std::string& path, const Profile& profile)
+{
+  std::string contents = PROFILE_HEADER;
+  for (const auto& item : profile)
+  {
+    const Entry& entry = item.second;
+    contents += StringFromFormat("%016" PRIx64 " %08x %08x %08x %08x %" PRIu64 " %s %s\n",
+                                 item.first, entry.uid[0], entry.uid[1], entry.uid[2],
+                                 entry.uid[3], entry.num_verts, entry.kind.c_str(),
+                                 entry.name.c_str());
+  }
+  File::CreateFullPath(path);
+  return File::WriteStringToFile(contents, path);
+}
+
+void Merge(Profile* dest, const Profile& src)
+{
+  for (const auto& item : src)
+  {
+    Entry& entry = (*dest)[item.first];
+    const u64 num_verts = entry.num_verts + item.second.num_verts;
+    entry = item.second;
+    entry.num_verts = num_verts;
+  }
+}
+}
@@ -0,0 +1,39 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <map>
+#include <string>
+
+#include "Common/CommonTypes.h"
+
+// Per game record of the vertex formats a game used and how many vertices each of them loaded.
+// The profiles are accumulated over every run of the game and are the input of
+// Tools/generate-vertex-loaders.py, which turns the hottest formats into the precompiled
+// G_<game id>_pvt.cpp loaders used by VertexLoaderCompiled.
+namespace VertexLoaderProfile
+{
+struct Entry
+{
+  // VertexLoaderUID elements, the template arguments of TemplatedLoader
+  u32 uid[4];
+  u64 num_verts;
+  // Loader that served the format in the last run
+  std::string kind;
+  std::string name;
+};
+
+// Keyed by VertexLoaderUID::GetHash(), the key of the precompiled loader map
+using Profile = std::map<u64, Entry>;
+
+std::string GetProfilePath(const std::string& game_id);
+
+// Adds the entries of the file to profile, returns false if the file could not be parsed.
+bool Load(const std::string& path, Profile* profile);
+bool Save(const std::string& path, const Profile& profile);
+
+// Adds the vertex counts of src to dest, the kind and name of src win.
+void Merge(Profile* dest, const Profile& src);
+}
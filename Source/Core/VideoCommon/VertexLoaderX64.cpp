@@ -2,6 +2,7 @@
 // Licensed under GPLv2+
 // Refer to the license.txt file included.
 
+#include "Common/Assert.h"
 #include "Common/BitSet.h"
 #include "Common/Common.h"
 #include "Common/CPUDetect.h"
@@ -25,6 +26,13 @@ static const X64Reg count_reg = R10;
 static const X64Reg skipped_reg = R11;
 static const u32 MASKINDEXED = INDEX8 & INDEX16;
 static const X64Reg base_reg = RBX;
+// Tex0MatIdx to Tex7MatIdx of TVtxDesc
+static const u64 TEXMTXIDX_MASK = 0x1FE;
+// Scale factors of the texture coordinates
+static const X64Reg treg[8] = {
+    XMM4, XMM5, XMM6, XMM7,
+    XMM8, XMM9, XMM10, XMM11,
+};
 
 static const u8* memory_base_ptr = (u8*)&g_main_cp_state.array_strides;
 
@@ -49,12 +57,40 @@ static __m128 scale_factors[13] = {
     _mm_set_ps1(0.0f)
 };
 
-VertexLoaderX64::VertexLoaderX64(const TVtxDesc& vtx_desc, const VAT& vtx_att) : VertexLoaderBase(vtx_desc, vtx_att)
+// PSHUFB masks by format and element count. The mask is repeated for both 128-bit lanes of the
+// AVX2 loop, the SSE loop only uses the first one.
+#define LANES(x) { x, x }
+static const __m128i shuffle_lut[5][3][2] = {
+    { LANES(_mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFFFF00L)),  // 1x u8
+    LANES(_mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFFFF01L, 0xFFFFFF00L)),  // 2x u8
+    LANES(_mm_set_epi32(0xFFFFFFFFL, 0xFFFFFF02L, 0xFFFFFF01L, 0xFFFFFF00L)) }, // 3x u8
+    { LANES(_mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFFFFFFL, 0x00FFFFFFL)),  // 1x s8
+    LANES(_mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0x01FFFFFFL, 0x00FFFFFFL)),  // 2x s8
+    LANES(_mm_set_epi32(0xFFFFFFFFL, 0x02FFFFFFL, 0x01FFFFFFL, 0x00FFFFFFL)) }, // 3x s8
+    { LANES(_mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFF0001L)),  // 1x u16
+    LANES(_mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFF0203L, 0xFFFF0001L)),  // 2x u16
+    LANES(_mm_set_epi32(0xFFFFFFFFL, 0xFFFF0405L, 0xFFFF0203L, 0xFFFF0001L)) }, // 3x u16
+    { LANES(_mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFFFFFFL, 0x0001FFFFL)),  // 1x s16
+    LANES(_mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0x0203FFFFL, 0x0001FFFFL)),  // 2x s16
+    LANES(_mm_set_epi32(0xFFFFFFFFL, 0x0405FFFFL, 0x0203FFFFL, 0x0001FFFFL)) }, // 3x s16
+    { LANES(_mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFFFFFFL, 0x00010203L)),  // 1x float
+    LANES(_mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0x04050607L, 0x00010203L)),  // 2x float
+    LANES(_mm_set_epi32(0xFFFFFFFFL, 0x08090A0BL, 0x04050607L, 0x00010203L)) }, // 3x float
+};
+#undef LANES
+
+VertexLoaderX64::VertexLoaderX64(const TVtxDesc& vtx_desc, const VAT& vtx_att, bool allow_avx2)
+  : VertexLoaderBase(vtx_desc, vtx_att)
 {
   if (!IsInitialized())
     return;
 
-  AllocCodeSpace(1024);
+  // Colors and texture matrix indices are converted with general purpose registers, one vertex
+  // at a time, and are measurably slower in the batch loop than in the single vertex loop.
+  m_batched = allow_avx2 && cpu_info.bAVX2 && !vtx_desc.Color0 && !vtx_desc.Color1 &&
+              !(vtx_desc.Hex & TEXMTXIDX_MASK);
+  // The batch loop is emitted next to the single vertex loop
+  AllocCodeSpace(m_batched ? 4096 : 1024);
   ClearCodeSpace();
   GenerateVertexLoader();
   WriteProtect();
@@ -87,26 +123,33 @@ OpArg VertexLoaderX64::GetVertexAddr(int array, u64 attribute)
   }
 }
 
-int VertexLoaderX64::ReadVertex(OpArg data, u64 attribute, int format, int count_in, int count_out, bool dequantize, AttributeFormat* native_format, X64Reg scaling_register)
+// Address of an attribute of the lane-th vertex of the AVX2 loop. src_ofs is the offset of the
+// attribute, or of its index, within the vertex.
+OpArg VertexLoaderX64::GetLaneVertexAddr(int array, u64 attribute, u32 src_ofs, int lane)
 {
-  static const __m128i shuffle_lut[5][3] = {
-      { _mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFFFF00L),  // 1x u8
-      _mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFFFF01L, 0xFFFFFF00L),  // 2x u8
-      _mm_set_epi32(0xFFFFFFFFL, 0xFFFFFF02L, 0xFFFFFF01L, 0xFFFFFF00L) }, // 3x u8
-      { _mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFFFFFFL, 0x00FFFFFFL),  // 1x s8
-      _mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0x01FFFFFFL, 0x00FFFFFFL),  // 2x s8
-      _mm_set_epi32(0xFFFFFFFFL, 0x02FFFFFFL, 0x01FFFFFFL, 0x00FFFFFFL) }, // 3x s8
-      { _mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFF0001L),  // 1x u16
-      _mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFF0203L, 0xFFFF0001L),  // 2x u16
-      _mm_set_epi32(0xFFFFFFFFL, 0xFFFF0405L, 0xFFFF0203L, 0xFFFF0001L) }, // 3x u16
-      { _mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFFFFFFL, 0x0001FFFFL),  // 1x s16
-      _mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0x0203FFFFL, 0x0001FFFFL),  // 2x s16
-      _mm_set_epi32(0xFFFFFFFFL, 0x0405FFFFL, 0x0203FFFFL, 0x0001FFFFL) }, // 3x s16
-      { _mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0xFFFFFFFFL, 0x00010203L),  // 1x float
-      _mm_set_epi32(0xFFFFFFFFL, 0xFFFFFFFFL, 0x04050607L, 0x00010203L),  // 2x float
-      _mm_set_epi32(0xFFFFFFFFL, 0x08090A0BL, 0x04050607L, 0x00010203L) }, // 3x float
-  };
+  OpArg data = MDisp(src_reg, src_ofs + lane * m_VertexSize);
+  if (attribute & MASKINDEXED)
+  {
+    int bits = attribute == INDEX8 ? 8 : 16;
+    LoadAndSwap(bits, scratch1, data);
+    if (array == ARRAY_POSITION)
+    {
+      // Skipped vertices are left to the single vertex loop
+      CMP(bits, R(scratch1), Imm8(-1));
+      J_CC(CC_E, m_single_entry);
+    }
+    IMUL(32, scratch1, MPIC(&g_main_cp_state.array_strides[array]));
+    MOV(64, R(scratch2), MPIC(&cached_arraybases[array]));
+    return MRegSum(scratch1, scratch2);
+  }
+  else
+  {
+    return data;
+  }
+}
 
+int VertexLoaderX64::ReadVertex(OpArg data, u64 attribute, int format, int count_in, int count_out, bool dequantize, AttributeFormat* native_format, X64Reg scaling_register)
+{
   X64Reg coords = XMM0;
   int elem_size = 1 << (format / 2);
   int load_bytes = elem_size * count_in;
@@ -131,7 +174,7 @@ int VertexLoaderX64::ReadVertex(OpArg data, u64 attribute, int format, int count
     else
       MOVD_xmm(coords, data);
 
-    PSHUFB(coords, MPIC(&shuffle_lut[format][count_in - 1]));
+    PSHUFB(coords, MPIC(&shuffle_lut[format][count_in - 1][0]));
 
     // Sign-extend.
     if (format == FORMAT_BYTE)
@@ -245,6 +288,71 @@ int VertexLoaderX64::ReadVertex(OpArg data, u64 attribute, int format, int count
   return load_bytes;
 }
 
+// Converts an attribute of two vertices at once, one per 128-bit lane of YMM0.
+int VertexLoaderX64::ReadVertexBatch(int array, u64 attribute, u32 src_ofs, u32 data_ofs, int format, int count_in, int count_out, bool dequantize, u32 dst_ofs, X64Reg scaling_register)
+{
+  int elem_size = 1 << (format / 2);
+  int load_bytes = elem_size * count_in;
+
+  for (int lane = 0; lane < 2; lane++)
+  {
+    OpArg data = GetLaneVertexAddr(array, attribute, src_ofs, lane);
+    data.AddMemOffset(data_ofs);
+    X64Reg coords = lane ? XMM1 : XMM0;
+    if (lane && load_bytes > 8)
+    {
+      VINSERTF128(YMM0, YMM0, data, 1);
+      continue;
+    }
+    if (load_bytes > 8)
+      VMOVDQU(128, coords, data);
+    else if (load_bytes > 4)
+      VMOVQ_xmm(coords, data);
+    else
+      VMOVD_xmm(coords, data);
+    if (lane)
+      VINSERTF128(YMM0, YMM0, R(XMM1), 1);
+  }
+
+  VPSHUFB(256, YMM0, YMM0, MPIC(&shuffle_lut[format][count_in - 1]));
+
+  // Sign-extend.
+  if (format == FORMAT_BYTE)
+    VPSRAD(256, YMM0, YMM0, 24);
+  if (format == FORMAT_SHORT)
+    VPSRAD(256, YMM0, YMM0, 16);
+
+  if (format != FORMAT_FLOAT)
+  {
+    VCVTDQ2PS(256, YMM0, R(YMM0));
+
+    if (dequantize)
+      VMULPS(256, YMM0, YMM0, R(scaling_register));
+  }
+
+  OpArg dest = MDisp(dst_reg, dst_ofs);
+  OpArg dest_hi = MDisp(dst_reg, dst_ofs + m_native_stride);
+  switch (count_out)
+  {
+  case 1:
+    VEXTRACTF128(R(XMM1), YMM0, 1);
+    VMOVSS(dest, XMM0);
+    VMOVSS(dest_hi, XMM1);
+    break;
+  case 2:
+    VEXTRACTF128(R(XMM1), YMM0, 1);
+    VMOVLPS(dest, XMM0);
+    VMOVLPS(dest_hi, XMM1);
+    break;
+  case 3:
+    VMOVUPS(128, dest, XMM0);
+    VEXTRACTF128(dest_hi, YMM0, 1);
+    break;
+  }
+
+  return load_bytes;
+}
+
 void VertexLoaderX64::ReadColor(OpArg data, u64 attribute, int format)
 {
   int load_bytes = 0;
@@ -380,38 +488,30 @@ void VertexLoaderX64::GenerateVertexLoader()
   MOV(32, R(count_reg), R(ABI_PARAM3));
 
   MOV(64, R(base_reg), R(ABI_PARAM4));
-  // Load Contants into registers outside the main loop to reduce memory overhead
-  if (m_VtxAttr.PosFormat != FORMAT_FLOAT && m_VtxAttr.ByteDequant)
-  {
-    MOVAPD(XMM2, MPIC(&scale_factors[0]));
-  }
-  if (m_VtxDesc.Normal)
+
+  if (m_VtxDesc.Position & MASKINDEXED)
+    XOR(32, R(skipped_reg), R(skipped_reg));
+
+  // The single vertex loop returns here after each vertex to give the batch loop another try,
+  // the scale factors have to be broadcast again after the VZEROUPPER.
+  const u8* setup = GetCodePtr();
+  LoadScaleFactors();
+
+  FixupBranch batch_loop;
+  FixupBranch done;
+  if (m_batched)
   {
-    MOVAPD(XMM3, MPIC(&scale_factors[m_VtxAttr.NormalFormat + 1]));
+    batch_loop = J(true);
+    m_single_entry = GetCodePtr();
+    VZEROUPPER();
+    TEST(32, R(count_reg), R(count_reg));
+    done = J_CC(CC_Z, true);
   }
 
   const u64 tc[8] = {
       m_VtxDesc.Tex0Coord, m_VtxDesc.Tex1Coord, m_VtxDesc.Tex2Coord, m_VtxDesc.Tex3Coord,
       m_VtxDesc.Tex4Coord, m_VtxDesc.Tex5Coord, m_VtxDesc.Tex6Coord, m_VtxDesc.Tex7Coord,
   };
-  const X64Reg treg[8] = {
-      XMM4, XMM5, XMM6, XMM7,
-      XMM8, XMM9, XMM10, XMM11,
-  };
-
-  if (m_VtxAttr.ByteDequant)
-  {
-    for (int i = 0; i < 8; i++)
-    {
-      if (tc[i] && m_VtxAttr.texCoord[i].Format != FORMAT_FLOAT)
-      {
-        MOVAPD(treg[i], MPIC(&scale_factors[5 + i]));
-      }
-    }
-  }
-
-  if (m_VtxDesc.Position & MASKINDEXED)
-    XOR(32, R(skipped_reg), R(skipped_reg));
 
   const u8* loop_start = GetCodePtr();
 
@@ -487,6 +587,7 @@ void VertexLoaderX64::GenerateVertexLoader()
       m_native_vtx_decl.texcoords[i].enable = true;
       m_native_vtx_decl.texcoords[i].type = FORMAT_FLOAT;
       MOVZX(64, 8, scratch1, MDisp(src_reg, texmatidx_ofs[i]));
+      AND(32, R(scratch1), Imm8(0x3F));
       if (tc[i])
       {
         CVTSI2SS(XMM0, R(scratch1));
@@ -527,7 +628,10 @@ void VertexLoaderX64::GenerateVertexLoader()
   ADD(64, R(src_reg), Imm32(m_src_ofs));
 
   SUB(32, R(count_reg), Imm8(1));
-  J_CC(CC_NZ, loop_start);
+  J_CC(CC_NZ, m_batched ? setup : loop_start);
+
+  if (m_batched)
+    SetJumpTarget(done);
 
   // Get the original count.
   POP(32, R(ABI_RETURN));
@@ -550,6 +654,136 @@ void VertexLoaderX64::GenerateVertexLoader()
   m_native_stride = m_dst_ofs;
   m_VertexSize = m_src_ofs;
   m_native_vtx_decl.stride = m_native_stride;
+
+  // The batch loop needs the strides, so it is emitted last.
+  if (m_batched)
+  {
+    SetJumpTarget(batch_loop);
+    GenerateBatchLoop();
+  }
+}
+
+void VertexLoaderX64::LoadScaleFactors()
+{
+  // Load Contants into registers outside the main loop to reduce memory overhead.
+  // The batch loop needs them in both halves of the YMM registers.
+  auto load = [this](X64Reg reg, const __m128* factor) {
+    if (m_batched)
+      VBROADCASTSS(256, reg, MPIC(factor));
+    else
+      MOVAPD(reg, MPIC(factor));
+  };
+  if (m_VtxAttr.PosFormat != FORMAT_FLOAT && m_VtxAttr.ByteDequant)
+  {
+    load(XMM2, &scale_factors[0]);
+  }
+  if (m_VtxDesc.Normal)
+  {
+    load(XMM3, &scale_factors[m_VtxAttr.NormalFormat + 1]);
+  }
+
+  const u64 tc[8] = {
+      m_VtxDesc.Tex0Coord, m_VtxDesc.Tex1Coord, m_VtxDesc.Tex2Coord, m_VtxDesc.Tex3Coord,
+      m_VtxDesc.Tex4Coord, m_VtxDesc.Tex5Coord, m_VtxDesc.Tex6Coord, m_VtxDesc.Tex7Coord,
+  };
+  if (m_VtxAttr.ByteDequant)
+  {
+    for (int i = 0; i < 8; i++)
+    {
+      if (tc[i] && m_VtxAttr.texCoord[i].Format != FORMAT_FLOAT)
+      {
+        load(treg[i], &scale_factors[5 + i]);
+      }
+    }
+  }
+}
+
+// AVX2 loop converting two vertices per iteration, one in each 128-bit lane. It mirrors the
+// single vertex loop of GenerateVertexLoader for formats made of positions, normals and texture
+// coordinates. The single vertex loop takes over for the last vertex and for the vertices with a
+// skipped position index.
+void VertexLoaderX64::GenerateBatchLoop()
+{
+  CMP(32, R(count_reg), Imm8(2));
+  J_CC(CC_B, m_single_entry);
+
+  const u8* loop_start = GetCodePtr();
+
+  u32 src_ofs = m_VtxDesc.PosMatIdx ? 1 : 0;
+
+  auto next_attribute = [&src_ofs](u64 attribute, int load_bytes) {
+    if (attribute == DIRECT)
+      src_ofs += load_bytes;
+    else
+      src_ofs += attribute == INDEX8 ? 1 : 2;
+  };
+
+  int load_bytes = ReadVertexBatch(ARRAY_POSITION, m_VtxDesc.Position, src_ofs, 0,
+    m_VtxAttr.PosFormat, m_VtxAttr.PosElements + 2, 3, m_VtxAttr.ByteDequant,
+    m_native_vtx_decl.position.offset, XMM2);
+  next_attribute(m_VtxDesc.Position, load_bytes);
+
+  if (m_VtxDesc.Normal)
+  {
+    u32 index_ofs = 0;
+    u32 data_ofs = 0;
+    for (int i = 0; i < (m_VtxAttr.NormalElements ? 3 : 1); i++)
+    {
+      if (!i || m_VtxAttr.NormalIndex3)
+      {
+        index_ofs = src_ofs;
+        if (m_VtxDesc.Normal & MASKINDEXED)
+          src_ofs += m_VtxDesc.Normal == INDEX8 ? 1 : 2;
+        int elem_size = 1 << (m_VtxAttr.NormalFormat / 2);
+        data_ofs = i * elem_size * 3;
+      }
+      load_bytes = ReadVertexBatch(ARRAY_NORMAL, m_VtxDesc.Normal, index_ofs, data_ofs,
+        m_VtxAttr.NormalFormat, 3, 3, true, m_native_vtx_decl.normals[i].offset, XMM3);
+      data_ofs += load_bytes;
+      if (m_VtxDesc.Normal == DIRECT)
+        src_ofs += load_bytes;
+    }
+  }
+
+  const u64 tc[8] = {
+      m_VtxDesc.Tex0Coord, m_VtxDesc.Tex1Coord, m_VtxDesc.Tex2Coord, m_VtxDesc.Tex3Coord,
+      m_VtxDesc.Tex4Coord, m_VtxDesc.Tex5Coord, m_VtxDesc.Tex6Coord, m_VtxDesc.Tex7Coord,
+  };
+  for (int i = 0; i < 8; i++)
+  {
+    if (tc[i])
+    {
+      int elements = m_VtxAttr.texCoord[i].Elements + 1;
+      load_bytes = ReadVertexBatch(ARRAY_TEXCOORD0 + i, tc[i], src_ofs, 0,
+        m_VtxAttr.texCoord[i].Format, elements, elements, m_VtxAttr.ByteDequant,
+        m_native_vtx_decl.texcoords[i].offset, treg[i]);
+      next_attribute(tc[i], load_bytes);
+    }
+  }
+
+  for (int lane = 0; lane < 2; lane++)
+  {
+    if (m_VtxDesc.PosMatIdx)
+    {
+      MOVZX(32, 8, scratch1, MDisp(src_reg, lane * m_VertexSize));
+    }
+    else
+    {
+      MOV(32, R(scratch1), MPIC(&g_main_cp_state.matrix_index_a));
+    }
+    AND(32, R(scratch1), Imm8(0x3F));
+    MOV(32, MDisp(dst_reg, m_native_vtx_decl.posmtx.offset + lane * m_native_stride), R(scratch1));
+  }
+
+  DEBUG_ASSERT(src_ofs == (u32)m_VertexSize);
+
+  ADD(64, R(dst_reg), Imm32(2 * m_native_stride));
+  ADD(64, R(src_reg), Imm32(2 * m_VertexSize));
+
+  SUB(32, R(count_reg), Imm8(2));
+  CMP(32, R(count_reg), Imm8(2));
+  J_CC(CC_AE, loop_start);
+  JMP(m_single_entry, true);
 }
 
 bool VertexLoaderX64::EnvironmentIsSupported()
@@ -557,7 +791,7 @@ bool VertexLoaderX64::EnvironmentIsSupported()
   return g_ActiveConfig.iBBoxMode == BBoxGPU || !BoundingBox::active;
 }
 
-int VertexLoaderX64::RunVertices(const VertexLoaderParameters &parameters)
+void VertexLoaderX64::BeginParallelRun(const VertexLoaderParameters &parameters)
 {
   const VAT &vat = *parameters.VtxAttr;
   scale_factors[0] = _mm_set_ps1(fractionTable[vat.g0.PosFrac]);
@@ -573,5 +807,17 @@ int VertexLoaderX64::RunVertices(const VertexLoaderParameters &parameters)
     scale_factors[12] = _mm_set_ps1(fractionTable[vat.g2.Tex7Frac]);
   }
   m_numLoadedVertices += parameters.count;
-  return ((int(*)(const u8* src, u8* dst, int count, const void*))region)(parameters.source, parameters.destination, parameters.count, memory_base_ptr);
+}
+
+// The generated code only reads the scale factors and the CP state, and every attribute store
+// stays inside its vertex since the position matrix index is always written last.
+s32 VertexLoaderX64::RunVerticesRange(const u8* src, u8* dst, int count)
+{
+  return ((int(*)(const u8* src, u8* dst, int count, const void*))region)(src, dst, count, memory_base_ptr);
+}
+
+int VertexLoaderX64::RunVertices(const VertexLoaderParameters &parameters)
+{
+  BeginParallelRun(parameters);
+  return RunVerticesRange(parameters.source, parameters.destination, parameters.count);
 }
@@ -4,21 +4,38 @@
 class VertexLoaderX64 : public VertexLoaderBase, public Gen::X64CodeBlock
 {
 public:
-  VertexLoaderX64(const TVtxDesc& vtx_desc, const VAT& vtx_att);
+  // allow_avx2 enables the loop converting two vertices per iteration when the host has AVX2.
+  VertexLoaderX64(const TVtxDesc& vtx_desc, const VAT& vtx_att, bool allow_avx2 = true);
 
 protected:
   bool IsInitialized() override
   {
     return true;
   }
+  VertexLoaderKind GetKind() const override
+  {
+    return VertexLoaderKind::JIT;
+  }
   int RunVertices(const VertexLoaderParameters &parameters) override;
+  bool SupportsParallelRun() const override
+  {
+    return true;
+  }
+  void BeginParallelRun(const VertexLoaderParameters &parameters) override;
+  s32 RunVerticesRange(const u8* src, u8* dst, int count) override;
   bool EnvironmentIsSupported() override;
 private:
   u32 m_src_ofs = 0;
   u32 m_dst_ofs = 0;
+  bool m_batched = false;
   Gen::FixupBranch m_skip_vertex;
+  const u8* m_single_entry = nullptr;
   Gen::OpArg GetVertexAddr(int array, u64 attribute);
+  Gen::OpArg GetLaneVertexAddr(int array, u64 attribute, u32 src_ofs, int lane);
   int ReadVertex(Gen::OpArg data, u64 attribute, int format, int count_in, int count_out, bool dequantize, AttributeFormat* native_format, Gen::X64Reg scaling_register);
+  int ReadVertexBatch(int array, u64 attribute, u32 src_ofs, u32 data_ofs, int format, int count_in, int count_out, bool dequantize, u32 dst_ofs, Gen::X64Reg scaling_register);
   void ReadColor(Gen::OpArg data, u64 attribute, int format);
+  void LoadScaleFactors();
   void GenerateVertexLoader();
+  void GenerateBatchLoop();
 };
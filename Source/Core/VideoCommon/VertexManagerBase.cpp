@@ -7,8 +7,10 @@
 #include <memory>
 
 #include "Common/CommonTypes.h"
+#include "Common/Profiler.h"
 #include "Core/ConfigManager.h"
 
+#include "VideoCommon/BPFunctions.h"
 #include "VideoCommon/BPStructs.h"
 #include "VideoCommon/Debugger.h"
 #include "VideoCommon/GeometryShaderManager.h"
@@ -41,6 +43,18 @@ static const PrimitiveType primitive_from_gx[8] = {
   PrimitiveType::Points,    // GX_DRAW_POINTS
 };
 
+// Triangles are generated as strips with restart indices
+static const PrimitiveType primitive_from_gx_pr[8] = {
+  PrimitiveType::TriangleStrip, // GX_DRAW_QUADS
+  PrimitiveType::TriangleStrip, // GX_DRAW_QUADS_2
+  PrimitiveType::TriangleStrip, // GX_DRAW_TRIANGLES
+  PrimitiveType::TriangleStrip, // GX_DRAW_TRIANGLE_STRIP
+  PrimitiveType::TriangleStrip, // GX_DRAW_TRIANGLE_FAN
+  PrimitiveType::Lines,         // GX_DRAW_LINES
+  PrimitiveType::Lines,         // GX_DRAW_LINE_STRIP
+  PrimitiveType::Points,        // GX_DRAW_POINTS
+};
+
 // Due to the BT.601 standard which the GameCube is based on being a compromise
 // between PAL and NTSC, neither standard gets square pixels. They are each off
 // by ~9% in opposite directions.
@@ -60,6 +74,8 @@ static bool AspectIs16_9(float width, float height)
 
 PrimitiveType VertexManagerBase::GetPrimitiveType(int primitive)
 {
+  if (g_ActiveConfig.backend_info.bSupportsPrimitiveRestart)
+    return primitive_from_gx_pr[primitive & 7];
   return primitive_from_gx[primitive & 7];
 }
 
@@ -75,7 +91,12 @@ inline u32 GetRemainingIndices(int prim)
   u32 index_len = VertexManagerBase::MAXIBUFFERSIZE - IndexGenerator::GetIndexLen();
   if (primitive == OpcodeDecoder::GX_DRAW_TRIANGLE_STRIP || primitive == OpcodeDecoder::GX_DRAW_TRIANGLE_FAN)
   {
-    return index_len / 3 + 2;
+    // With primitive restart every triangle takes up to 4 indices
+    return IndexGenerator::UsesPrimitiveRestart() ? index_len / 4 + 2 : index_len / 3 + 2;
+  }
+  if (primitive == OpcodeDecoder::GX_DRAW_TRIANGLES && IndexGenerator::UsesPrimitiveRestart())
+  {
+    return index_len / 4 * 3;
   }
   if (primitive < OpcodeDecoder::GX_DRAW_TRIANGLES)
   {
@@ -100,7 +121,7 @@ void VertexManagerBase::PrepareForAdditionalData(int primitive, u32 count, u32 s
 
   // We can't merge different kinds of primitives, so we have to flush here
   // Check for size in buffer, if the buffer gets full, call Flush()
-  PrimitiveType new_primitive_type = primitive_from_gx[primitive];
+  PrimitiveType new_primitive_type = GetPrimitiveType(primitive);
   if (m_current_primitive_type != new_primitive_type)
   {
     RasterizationState raster_state = {};
@@ -109,7 +130,7 @@ void VertexManagerBase::PrepareForAdditionalData(int primitive, u32 count, u32 s
   }
   if (count > max_index_size
     || needed_vertex_bytes > GetRemainingSize()
-    || m_current_primitive_type != primitive_from_gx[primitive])
+    || m_current_primitive_type != new_primitive_type)
   {
 #if defined(_DEBUG) || defined(DEBUGFAST)
     if (count > IndexGenerator::GetRemainingIndices())
@@ -123,7 +144,7 @@ void VertexManagerBase::PrepareForAdditionalData(int primitive, u32 count, u32 s
 #endif
     Flush();
   }
-  m_current_primitive_type = primitive_from_gx[primitive];
+  m_current_primitive_type = new_primitive_type;
   m_cull_all = bpmem.genMode.cullmode == GenMode::CULL_ALL && primitive < 5;
   // need to alloc new buffer
   if (m_is_flushed)
@@ -210,10 +231,15 @@ static void SetSamplerState(u32 index, bool custom_tex, bool has_arbitrary_mips,
 
 void VertexManagerBase::DoFlush()
 {
+  PROFILE("VertexManager::Flush");
   // loading a state will invalidate BP, so check for it
   NativeVertexFormat* current_vertex_format = VertexLoaderManager::GetCurrentVertexFormat();
   g_video_backend->CheckInvalidState();
-  g_vertex_manager->PrepareShaders(m_current_primitive_type, VertexLoaderManager::g_current_components, xfmem, bpmem);
+  BPFunctions::ApplyPendingState();
+  {
+    PROFILE("VertexManager::PrepareShaders");
+    g_vertex_manager->PrepareShaders(m_current_primitive_type, VertexLoaderManager::g_current_components, xfmem, bpmem);
+  }
 #if defined(_DEBUG) || defined(DEBUGFAST)
   PRIM_LOG("frame%d:\n texgen=%d, numchan=%d, dualtex=%d, ztex=%d, cole=%d, alpe=%d, ze=%d", g_ActiveConfig.iSaveTargetId, xfmem.numTexGen.numTexGens,
     xfmem.numChan.numColorChans, xfmem.dualTexTrans.enabled, bpmem.ztex2.op,
@@ -327,9 +353,11 @@ void VertexManagerBase::DoFlush()
     }
   }
 
-  if (m_current_primitive_type == PrimitiveType::Triangles)
+  if (m_current_primitive_type == PrimitiveType::Triangles ||
+      m_current_primitive_type == PrimitiveType::TriangleStrip)
   {
     const PortableVertexDeclaration &vtx_dcl = current_vertex_format->GetVertexDeclaration();
+    u32 last_triangle[3];
     if (bpmem.genMode.zfreeze)
     {
       if (m_zslope_refresh_required)
@@ -338,9 +366,9 @@ void VertexManagerBase::DoFlush()
         m_zslope_refresh_required = false;
       }
     }
-    else if (IndexGenerator::GetIndexLen() >= 3)
+    else if (IndexGenerator::GetLastTriangle(last_triangle))
     {
-      CalculateZSlope(vtx_dcl, g_vertex_manager->GetIndexBuffer() + IndexGenerator::GetIndexLen() - 3);
+      CalculateZSlope(vtx_dcl, last_triangle);
     }
 
     // if cull mode is CULL_ALL, ignore triangles and quads
@@ -360,7 +388,10 @@ void VertexManagerBase::DoFlush()
 
   if (PerfQueryBase::ShouldEmulate())
     g_perf_query->EnableQuery(bpmem.zcontrol.early_ztest ? PQG_ZCOMP_ZCOMPLOC : PQG_ZCOMP);
-  g_vertex_manager->vFlush(useDstAlpha);
+  {
+    PROFILE("VertexManager::Draw");
+    g_vertex_manager->vFlush(useDstAlpha);
+  }
   if (PerfQueryBase::ShouldEmulate())
     g_perf_query->DisableQuery(bpmem.zcontrol.early_ztest ? PQG_ZCOMP_ZCOMPLOC : PQG_ZCOMP);
 
@@ -378,7 +409,7 @@ void VertexManagerBase::DoState(PointerWrap& p)
   g_vertex_manager->vDoState(p);
 }
 
-void VertexManagerBase::CalculateZSlope(const PortableVertexDeclaration &vert_decl, const u16* indices)
+void VertexManagerBase::CalculateZSlope(const PortableVertexDeclaration &vert_decl, const u32* indices)
 {
   float out[12];
   float viewOffset[2] = {
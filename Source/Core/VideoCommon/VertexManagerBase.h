@@ -42,7 +42,7 @@ public:
   // needs to be virtual for DX11's dtor
   virtual ~VertexManagerBase();
 
-  PrimitiveType GetPrimitiveType(int primitive);
+  static PrimitiveType GetPrimitiveType(int primitive);
   PrimitiveType GetCurrentPrimitiveType() const { return m_current_primitive_type; }
   void PrepareForAdditionalData(int primitive, u32 count, u32 stride);
 
@@ -85,7 +85,7 @@ protected:
 
   bool m_cull_all = false;
 
-  void CalculateZSlope(const PortableVertexDeclaration &vert_decl, const u16* indices);
+  void CalculateZSlope(const PortableVertexDeclaration &vert_decl, const u32* indices);
   virtual void vDoState(PointerWrap& p) {}
   virtual void ResetBuffer(u32 stride) = 0;
 
@@ -96,7 +96,6 @@ private:
   void DoFlush();
 
   virtual void vFlush(bool useDstAlpha) = 0;
-  virtual u16* GetIndexBuffer() = 0;
 };
 
 extern std::unique_ptr<VertexManagerBase> g_vertex_manager;
@@ -18,6 +18,8 @@
 std::vector<std::unique_ptr<VideoBackendBase>> g_available_video_backends;
 VideoBackendBase* g_video_backend = nullptr;
 static VideoBackendBase* s_default_backend = nullptr;
+// Kept out of g_available_video_backends, the list the user picks the backend from
+static std::unique_ptr<VideoBackendBase> s_headless_backend;
 
 #ifdef _WIN32
 #include <windows.h>
@@ -75,3 +77,13 @@ void VideoBackendBase::ActivateBackend(const std::string& name)
     if (name == backend->GetName())
       g_video_backend = backend.get();
 }
+
+void VideoBackendBase::ActivateHeadlessBackend()
+{
+  if (!s_headless_backend)
+  {
+    s_headless_backend = std::make_unique<SW::VideoSoftware>();
+    s_headless_backend->SetHeadless(true);
+  }
+  g_video_backend = s_headless_backend.get();
+}
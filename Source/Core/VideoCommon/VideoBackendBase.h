@@ -90,6 +90,11 @@ public:
 
   void ShowConfig(void*);
 
+  // Renders without a window and doesn't present the frames, e.g. for benchmarks. Has to be set
+  // before Initialize, only the software renderer supports it.
+  void SetHeadless(bool headless) { m_headless = headless; }
+  bool IsHeadless() const { return m_headless; }
+
   virtual void Video_Prepare() = 0;
   void Video_ExitLoop();
   virtual void Video_Cleanup() = 0; // called from gl/d3d thread
@@ -103,6 +108,9 @@ public:
   static void PopulateList();
   static void ClearList();
   static void ActivateBackend(const std::string& name);
+  // Activates the software renderer without a window. It isn't added to the list of available
+  // backends and the same instance is reused by every call.
+  static void ActivateHeadlessBackend();
 
   // the implementation needs not do synchronization logic, because calls to it are surrounded by PauseAndLock now
   void DoState(PointerWrap &p);
@@ -116,6 +124,7 @@ protected:
 
   bool m_initialized = false;
   bool m_invalid = false;
+  bool m_headless = false;
   u32 m_EFB_PCache_Width;
   u32 m_EFB_PCache_Height;
   u32 m_EFB_PCache_Size;
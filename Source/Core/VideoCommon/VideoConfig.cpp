@@ -54,6 +54,7 @@ VideoConfig::VideoConfig()
   iStereoConvergence = 20;
   bUseScalingFilter = false;
   bTexDeposterize = false;
+  bAsyncTextureScaling = false;
   iTexScalingType = 0;
   iTexScalingFactor = 2;
   backend_info.bSupportsMultithreading = false;
@@ -61,6 +62,8 @@ VideoConfig::VideoConfig()
   bEnableValidationLayer = false;
   bEnableShaderDebug = false;
   bBackendMultithreading = true;
+  bParallelVertexLoading = false;
+  iParallelVertexLoadingThreshold = 8192;
   backend_info.MaxTextureSize = 4096;
 }
 
@@ -101,6 +104,8 @@ void VideoConfig::Refresh()
   bHiresMaterialMapsBuild = Config::Get(Config::GFX_HIRES_MATERIAL_MAPS_BUILD);  
   bCacheHiresTextures = Config::Get(Config::GFX_CACHE_HIRES_TEXTURES);
   bWaitForCacheHiresTextures = Config::Get(Config::GFX_WAIT_CACHE_HIRES_TEXTURES);
+  bDiskTextureCache = Config::Get(Config::GFX_DISK_TEXTURE_CACHE);
+  iDiskTextureCacheSizeMB = Config::Get(Config::GFX_DISK_TEXTURE_CACHE_SIZE);
   bDumpEFBTarget = Config::Get(Config::GFX_DUMP_EFB_TARGET);
   bDumpFramesAsImages = Config::Get(Config::GFX_DUMP_FRAMES_AS_IMAGES);
   bFreeLook = Config::Get(Config::GFX_FREE_LOOK);
@@ -143,6 +148,7 @@ void VideoConfig::Refresh()
 
   bZComploc = Config::Get(Config::GFX_SW_ZCOMPLOC);
   bZFreeze = Config::Get(Config::GFX_SW_ZFREEZE);
+  bTiledRasterizer = Config::Get(Config::GFX_SW_TILED_RASTERIZER);
   bDumpObjects = Config::Get(Config::GFX_SW_DUMP_OBJECTS);
   bDumpTevStages = Config::Get(Config::GFX_SW_DUMP_TEV_STAGES);
   bDumpTevTextureFetches = Config::Get(Config::GFX_SW_DUMP_TEV_TEX_FETCHES);
@@ -176,6 +182,7 @@ void VideoConfig::Refresh()
   iTexScalingType = Config::Get(Config::GFX_ENHANCE_TEXTURE_SCALING_TYPE);
   iTexScalingFactor = Config::Get(Config::GFX_ENHANCE_TEXTURE_SCALING_FACTOR);
   bTexDeposterize = Config::Get(Config::GFX_ENHANCE_USE_DEPOSTERIZE);
+  bAsyncTextureScaling = Config::Get(Config::GFX_ENHANCE_ASYNC_TEXTURE_SCALING);
 
   bTessellation = Config::Get(Config::GFX_ENHANCE_TESSELLATION);
   bTessellationEarlyCulling = Config::Get(Config::GFX_ENHANCE_TESSELLATION_EARLY_CULLING);
@@ -208,6 +215,13 @@ void VideoConfig::Refresh()
   bFullAsyncShaderCompilation = Config::Get(Config::GFX_HACK_FULL_ASYNC_SHADER_COMPILATION);
   bLastStoryEFBToRam = Config::Get(Config::GFX_HACK_LAST_HISTORY_EFBTORAM);
   bForceLogicOpBlend = Config::Get(Config::GFX_HACK_FORCE_LOGICOP_BLEND);
+  bDisplayListCache = Config::Get(Config::GFX_HACK_DISPLAY_LIST_CACHE);
+  bVertexCache = Config::Get(Config::GFX_HACK_VERTEX_CACHE);
+  bParallelVertexLoading = Config::Get(Config::GFX_HACK_PARALLEL_VERTEX_LOADING);
+  iParallelVertexLoadingThreshold =
+      Config::Get(Config::GFX_HACK_PARALLEL_VERTEX_LOADING_THRESHOLD);
+  bBatchedFifo = Config::Get(Config::GFX_HACK_BATCHED_FIFO);
+  bFifoPreprocessThread = Config::Get(Config::GFX_HACK_FIFO_PREPROCESS_THREAD);
 
   bBackgroundShaderCompiling = Config::Get(Config::GFX_BACKGROUND_SHADER_COMPILING);
   bDisableSpecializedShaders = Config::Get(Config::GFX_DISABLE_SPECIALIZED_SHADERS);
@@ -141,6 +141,7 @@ struct VideoConfig final
   std::string sStereoShader;
   bool bUseScalingFilter;
   bool bTexDeposterize;
+  bool bAsyncTextureScaling;
   int iTexScalingType;
   int iTexScalingFactor;
   bool bTessellation;
@@ -174,6 +175,8 @@ struct VideoConfig final
   bool bHiresMaterialMapsBuild;
   bool bCacheHiresTextures;
   bool bWaitForCacheHiresTextures;
+  bool bDiskTextureCache;
+  int iDiskTextureCacheSizeMB;
   bool bDumpEFBTarget;
   bool bDumpFramesAsImages;
   bool bUseFFV1;
@@ -212,6 +215,15 @@ struct VideoConfig final
   int iSpecularMultiplier;
   bool bLastStoryEFBToRam;
   bool bForceLogicOpBlend;
+  bool bDisplayListCache;
+  bool bVertexCache;
+  // Converts draws of at least iParallelVertexLoadingThreshold vertices on the thread pool.
+  bool bParallelVertexLoading;
+  int iParallelVertexLoadingThreshold;
+  // Reads all available FIFO data up to a limit at once in dual core mode instead of 32 bytes.
+  bool bBatchedFifo;
+  // Copies and preprocesses the FIFO data on its own thread in dual core mode.
+  bool bFifoPreprocessThread;
   bool bForcedDithering;
   bool bSimBumpEnabled;
   int iSimBumpDetailBlend;
@@ -244,6 +256,7 @@ struct VideoConfig final
   int drawEnd;
   bool bZComploc;
   bool bZFreeze;
+  bool bTiledRasterizer;
   bool bDumpObjects;
   bool bDumpTevStages;
   bool bDumpTevTextureFetches;
@@ -323,6 +336,7 @@ struct VideoConfig final
     bool bSupportsDynamicSamplerIndexing;  // Needed by UberShaders, so must stay in VideoCommon
     bool bSupportsUberShaders;
     bool bSupportsHighPrecisionFrameBuffer;
+    bool bSupportsPrimitiveRestart;  // Needed by IndexGenerator, so must stay in VideoCommon
   } backend_info;
 
   // Utility
@@ -25,6 +25,19 @@ inline void XFMemWritten(u32 transferSize, u32 baseAddress)
   PixelShaderManager::InvalidateXFRange(baseAddress, baseAddress + transferSize);
 }
 
+// Matrices and lights are often loaded again with the values they already have, which
+// doesn't need to end the current batch.
+static bool XFMemChanged(u32 transferSize, u32 baseAddress)
+{
+  const u32* current = &((u32*)&xfmem)[baseAddress];
+  for (u32 i = 0; i < transferSize; i++)
+  {
+    if (current[i] != g_VideoData.Peek<u32>(i * sizeof(u32)))
+      return true;
+  }
+  return false;
+}
+
 inline void XFRegWritten(int transferSize, u32 baseAddress)
 {
   u32 address = baseAddress;
@@ -238,8 +251,15 @@ void LoadXFReg(u32 transferSize, u32 baseAddress)
       transferSize = 0;
     }
 
-    XFMemWritten(xfMemTransferSize, xfMemBase);
-    OpcodeDecoder::DataReadU32xFuncs[xfMemTransferSize - 1](&((u32*)&xfmem)[xfMemBase]);
+    if (XFMemChanged(xfMemTransferSize, xfMemBase))
+    {
+      XFMemWritten(xfMemTransferSize, xfMemBase);
+      OpcodeDecoder::DataReadU32xFuncs[xfMemTransferSize - 1](&((u32*)&xfmem)[xfMemBase]);
+    }
+    else
+    {
+      g_VideoData.ReadSkip(xfMemTransferSize * sizeof(u32));
+    }
   }
 
   // write to XF regs
@@ -260,7 +280,7 @@ void LoadIndexedXF(u32 val, int refarray)
 
   u32* currData = (u32*)(&xfmem) + address;
   u32* newData;
-  if (Fifo::UseDeterministicGPUThread())
+  if (Fifo::UseFifoAuxBuffer())
   {
     newData = (u32*)Fifo::PopFifoAuxBuffer(size * sizeof(u32));
   }
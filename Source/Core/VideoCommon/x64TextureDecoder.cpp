@@ -13,6 +13,7 @@
 
 #include "VideoCommon/TextureDecoder.h"
 #include "VideoCommon/VideoConfig.h"
+#include "VideoCommon/x64TextureDecoderAVX2.h"
 
 #include "VideoCommon/LookUpTables.h"
 
@@ -1518,6 +1519,9 @@ HostTextureFormat GetHostTextureFormat(u32 texformat, TlutFormat tlutfmt, bool c
 //switch endianness, unswizzle
 static HostTextureFormat Decode_real(u8 *dst, const u8 *src, u32 width, u32 height, u32 texformat, u32 tlutaddr, TlutFormat tlutfmt, bool compressed_supported)
 {
+  if (cpu_info.bAVX2 && DecodeAVX2((u32*)dst, src, width, height, texformat, tlutaddr, tlutfmt, true))
+    return PC_TEX_FMT_BGRA32;
+
   const u32 Wsteps4 = (width + 3) / 4;
   const u32 Wsteps8 = (width + 7) / 8;
 
@@ -1781,6 +1785,9 @@ static HostTextureFormat Decode_real(u8 *dst, const u8 *src, u32 width, u32 heig
 
 static HostTextureFormat Decode_RGBA(u32 * dst, const u8 * src, u32 width, u32 height, u32 texformat, u32 tlutaddr, TlutFormat tlutfmt)
 {
+  if (cpu_info.bAVX2 && DecodeAVX2(dst, src, width, height, texformat, tlutaddr, tlutfmt, false))
+    return PC_TEX_FMT_RGBA32;
+
   const u32 Wsteps4 = (width + 3) / 4;
   const u32 Wsteps8 = (width + 7) / 8;
 
@@ -2151,7 +2158,7 @@ static HostTextureFormat Decode_RGBA(u32 * dst, const u8 * src, u32 width, u32 h
       for (u32 y = 0; y < height; y += 4)
         for (u32 x = 0, yStep = (y / 4) * Wsteps4; x < width; x += 4, yStep++)
           for (u32 iy = 0, xStep = 4 * yStep; iy < 4; iy++, xStep++)
-            decodebytesC14X2_5A3_To_BGRA32(dst + (y + iy) * width + x, (u16*)(src + 8 * xStep), tlutaddr);
+            decodebytesC14X2_5A3_To_RGBA(dst + (y + iy) * width + x, (u16*)(src + 8 * xStep), tlutaddr);
     }
     else if (tlutfmt == GX_TL_IA8)
     {
@@ -0,0 +1,510 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+// AVX2 texture decoders. Every kernel produces a full 256-bit register of texels
+// at once: one row of the 8 texel wide block formats, or two rows of the 4 texel
+// wide ones (the low lane holds the first row, the high lane the next one).
+// The output matches the SSE2/SSSE3 decoders in x64TextureDecoder.cpp bit for bit.
+
+#include <cstring>
+
+#include "Common/CommonTypes.h"
+#include "Common/Intrinsics.h"
+
+#include "VideoCommon/TextureDecoder.h"
+#include "VideoCommon/x64TextureDecoderAVX2.h"
+
+namespace TexDecoder
+{
+FUNCTION_TARGET_AVX2
+static inline __m256i Set1(u32 value)
+{
+  return _mm256_set1_epi32(static_cast<int>(value));
+}
+
+FUNCTION_TARGET_AVX2
+static inline __m256i Expand3(__m256i v)
+{
+  return _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi32(v, 5), _mm256_slli_epi32(v, 2)),
+                         _mm256_srli_epi32(v, 1));
+}
+
+FUNCTION_TARGET_AVX2
+static inline __m256i Expand4(__m256i v)
+{
+  return _mm256_or_si256(_mm256_slli_epi32(v, 4), v);
+}
+
+FUNCTION_TARGET_AVX2
+static inline __m256i Expand5(__m256i v)
+{
+  return _mm256_or_si256(_mm256_slli_epi32(v, 3), _mm256_srli_epi32(v, 2));
+}
+
+FUNCTION_TARGET_AVX2
+static inline __m256i Expand6(__m256i v)
+{
+  return _mm256_or_si256(_mm256_slli_epi32(v, 2), _mm256_srli_epi32(v, 4));
+}
+
+// Extracts the bits [shift, shift + width) of every lane.
+FUNCTION_TARGET_AVX2
+static inline __m256i Bits(__m256i v, int shift, u32 width)
+{
+  return _mm256_and_si256(_mm256_srli_epi32(v, shift), Set1((1u << width) - 1));
+}
+
+// Combines four 8-bit channels into RGBA32 (or BGRA32) texels.
+template <bool bgra>
+FUNCTION_TARGET_AVX2 static inline __m256i Pack(__m256i r, __m256i g, __m256i b, __m256i a)
+{
+  const __m256i ga = _mm256_or_si256(_mm256_slli_epi32(g, 8), _mm256_slli_epi32(a, 24));
+  if (bgra)
+    return _mm256_or_si256(_mm256_or_si256(b, _mm256_slli_epi32(r, 16)), ga);
+  return _mm256_or_si256(_mm256_or_si256(r, _mm256_slli_epi32(b, 16)), ga);
+}
+
+// Copies the low byte of every lane to the other three.
+FUNCTION_TARGET_AVX2
+static inline __m256i Splat8(__m256i v)
+{
+  const __m256i mask = _mm256_setr_epi8(0, 0, 0, 0, 4, 4, 4, 4, 8, 8, 8, 8, 12, 12, 12, 12, 0, 0, 0,
+                                        0, 4, 4, 4, 4, 8, 8, 8, 8, 12, 12, 12, 12);
+  return _mm256_shuffle_epi8(v, mask);
+}
+
+// The converters below take one host endian 16-bit value per lane, except for
+// IA8 which takes the value as read from memory (alpha in the low byte).
+FUNCTION_TARGET_AVX2
+static inline __m256i DecodeIA8(__m256i v)
+{
+  const __m256i i = Splat8(_mm256_srli_epi32(v, 8));
+  return _mm256_or_si256(_mm256_and_si256(i, Set1(0x00FFFFFF)), _mm256_slli_epi32(v, 24));
+}
+
+template <bool bgra>
+FUNCTION_TARGET_AVX2 static inline __m256i Decode565(__m256i v)
+{
+  return Pack<bgra>(Expand5(Bits(v, 11, 5)), Expand6(Bits(v, 5, 6)), Expand5(Bits(v, 0, 5)),
+                    Set1(0xFF));
+}
+
+template <bool bgra>
+FUNCTION_TARGET_AVX2 static inline __m256i Decode5A3(__m256i v)
+{
+  const __m256i opaque = Pack<bgra>(Expand5(Bits(v, 10, 5)), Expand5(Bits(v, 5, 5)),
+                                    Expand5(Bits(v, 0, 5)), Set1(0xFF));
+  const __m256i translucent = Pack<bgra>(Expand4(Bits(v, 8, 4)), Expand4(Bits(v, 4, 4)),
+                                         Expand4(Bits(v, 0, 4)), Expand3(Bits(v, 12, 3)));
+  // All ones in the lanes that have the top bit set.
+  const __m256i is_opaque = _mm256_srai_epi32(_mm256_slli_epi32(v, 16), 31);
+  return _mm256_blendv_epi8(translucent, opaque, is_opaque);
+}
+
+template <bool bgra>
+FUNCTION_TARGET_AVX2 static inline __m256i DecodeTlutEntry(__m256i v, TlutFormat tlutfmt)
+{
+  switch (tlutfmt)
+  {
+  case GX_TL_IA8:
+    return DecodeIA8(v);
+  case GX_TL_RGB565:
+    return Decode565<bgra>(v);
+  default:
+    return Decode5A3<bgra>(v);
+  }
+}
+
+// Loads eight 16-bit values, swapping them to host endianness if needed.
+FUNCTION_TARGET_AVX2
+static inline __m256i Load16x8(const u8* src, bool swap)
+{
+  __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+  if (swap)
+    v = _mm_shuffle_epi8(v, _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14));
+  return _mm256_cvtepu16_epi32(v);
+}
+
+FUNCTION_TARGET_AVX2
+static inline __m256i Load8x8(const u8* src)
+{
+  return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src)));
+}
+
+// Looks up the 16-bit TLUT entries of the indices in idx, swapped to host
+// endianness unless the TLUT holds IA8 values. The gather reads a whole u32 per
+// entry, so the last entry is read together with the one in front of it and
+// shifted down, which keeps the reads inside the palette.
+FUNCTION_TARGET_AVX2
+static inline __m256i GatherTlut(const u8* tlut, __m256i idx, u32 last_entry, TlutFormat tlutfmt)
+{
+  const __m256i clamped = _mm256_min_epi32(idx, Set1(last_entry - 1));
+  const __m256i shift = _mm256_slli_epi32(_mm256_sub_epi32(idx, clamped), 4);
+  const __m256i v = _mm256_srlv_epi32(
+      _mm256_i32gather_epi32(reinterpret_cast<const int*>(tlut), clamped, 2), shift);
+  if (tlutfmt == GX_TL_IA8)
+    return _mm256_and_si256(v, Set1(0xFFFF));
+  const __m256i mask = _mm256_setr_epi8(1, 0, -1, -1, 5, 4, -1, -1, 9, 8, -1, -1, 13, 12, -1, -1, 1,
+                                        0, -1, -1, 5, 4, -1, -1, 9, 8, -1, -1, 13, 12, -1, -1);
+  return _mm256_shuffle_epi8(v, mask);
+}
+
+FUNCTION_TARGET_AVX2
+static inline void Store8(u32* dst, __m256i v)
+{
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), v);
+}
+
+// Stores the low lane to the first row and the high lane to the second one.
+FUNCTION_TARGET_AVX2
+static inline void Store4x2(u32* dst, u32 width, __m256i v)
+{
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm256_castsi256_si128(v));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + width), _mm256_extracti128_si256(v, 1));
+}
+
+// Splits the 4 bytes of two 4-bit texel rows (starting at src) into one nibble per lane,
+// high nibble first. Returns the first row, the second one goes to *second_row.
+FUNCTION_TARGET_AVX2
+static inline __m256i SplitNibbles(const u8* src, __m256i* second_row)
+{
+  const __m128i raw = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src));
+  const __m128i doubled = _mm_unpacklo_epi8(raw, raw);
+  const __m256i shifts = _mm256_setr_epi32(4, 0, 4, 0, 4, 0, 4, 0);
+  const __m256i low_nibbles = Set1(0xF);
+  *second_row = _mm256_and_si256(
+      _mm256_srlv_epi32(_mm256_cvtepu8_epi32(_mm_srli_si128(doubled, 8)), shifts), low_nibbles);
+  return _mm256_and_si256(_mm256_srlv_epi32(_mm256_cvtepu8_epi32(doubled), shifts), low_nibbles);
+}
+
+// Expands 16 bytes of 8-bit intensities (two rows of 8 texels) to RGBA32.
+FUNCTION_TARGET_AVX2
+static inline void StoreIntensityRows(u32* dst, u32 width, __m128i intensities)
+{
+  const __m256i both = _mm256_broadcastsi128_si256(intensities);
+  const __m256i row0 = _mm256_setr_epi8(0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4,
+                                        4, 5, 5, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7);
+  const __m256i row1 = _mm256_add_epi8(row0, _mm256_set1_epi8(8));
+  Store8(dst, _mm256_shuffle_epi8(both, row0));
+  Store8(dst + width, _mm256_shuffle_epi8(both, row1));
+}
+
+FUNCTION_TARGET_AVX2
+static void DecodeI4(u32* dst, const u8* src, u32 width, u32 height)
+{
+  const u32 Wsteps8 = (width + 7) / 8;
+  const __m128i low_nibbles = _mm_set1_epi8(0xF);
+  for (u32 y = 0; y < height; y += 8)
+    for (u32 x = 0, yStep = (y / 8) * Wsteps8; x < width; x += 8, yStep++)
+      for (u32 iy = 0; iy < 8; iy += 2)
+      {
+        // Two rows of 4 bytes each, split into one nibble per byte, high nibble first.
+        const __m128i raw =
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + 32 * yStep + 4 * iy));
+        const __m128i nibbles = _mm_unpacklo_epi8(
+            _mm_and_si128(_mm_srli_epi16(raw, 4), low_nibbles), _mm_and_si128(raw, low_nibbles));
+        StoreIntensityRows(dst + (y + iy) * width + x, width,
+                           _mm_or_si128(_mm_slli_epi16(nibbles, 4), nibbles));
+      }
+}
+
+FUNCTION_TARGET_AVX2
+static void DecodeI8(u32* dst, const u8* src, u32 width, u32 height)
+{
+  const u32 Wsteps8 = (width + 7) / 8;
+  for (u32 y = 0; y < height; y += 4)
+    for (u32 x = 0, yStep = (y / 4) * Wsteps8; x < width; x += 8, yStep++)
+      for (u32 iy = 0; iy < 4; iy += 2)
+      {
+        StoreIntensityRows(
+            dst + (y + iy) * width + x, width,
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 32 * yStep + 8 * iy)));
+      }
+}
+
+FUNCTION_TARGET_AVX2
+static void DecodeIA4(u32* dst, const u8* src, u32 width, u32 height)
+{
+  const u32 Wsteps8 = (width + 7) / 8;
+  for (u32 y = 0; y < height; y += 4)
+    for (u32 x = 0, yStep = (y / 4) * Wsteps8; x < width; x += 8, yStep++)
+      for (u32 iy = 0; iy < 4; iy++)
+      {
+        const __m256i v = Load8x8(src + 32 * yStep + 8 * iy);
+        const __m256i i = Splat8(Expand4(Bits(v, 0, 4)));
+        const __m256i a = _mm256_slli_epi32(Expand4(Bits(v, 4, 4)), 24);
+        Store8(dst + (y + iy) * width + x,
+               _mm256_or_si256(_mm256_and_si256(i, Set1(0x00FFFFFF)), a));
+      }
+}
+
+// Formats with 4x4 blocks of 16-bit texels: IA8, RGB565 and RGB5A3.
+template <__m256i (*convert)(__m256i)>
+FUNCTION_TARGET_AVX2 static void Decode16BitTexels(u32* dst, const u8* src, u32 width,
+                                                   u32 height, bool swap)
+{
+  const u32 Wsteps4 = (width + 3) / 4;
+  for (u32 y = 0; y < height; y += 4)
+    for (u32 x = 0, yStep = (y / 4) * Wsteps4; x < width; x += 4, yStep++)
+      for (u32 iy = 0; iy < 4; iy += 2)
+        Store4x2(dst + (y + iy) * width + x, width,
+                 convert(Load16x8(src + 32 * yStep + 8 * iy, swap)));
+}
+
+template <bool bgra>
+FUNCTION_TARGET_AVX2 static void DecodeRGBA8(u32* dst, const u8* src, u32 width, u32 height)
+{
+  // Interleaving the AR and GB pairs gives A, R, G, B bytes, which only need to be reordered.
+  const __m256i order = bgra ? _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13,
+                                                12, 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14,
+                                                13, 12) :
+                               _mm256_setr_epi8(1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15,
+                                                12, 1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14,
+                                                15, 12);
+  const u32 Wsteps4 = (width + 3) / 4;
+  for (u32 y = 0; y < height; y += 4)
+    for (u32 x = 0, yStep = (y / 4) * Wsteps4; x < width; x += 4, yStep++)
+    {
+      // The block stores the AR pairs of all 16 texels, followed by the GB pairs.
+      const u8* block = src + 64 * yStep;
+      const __m256i ar = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+      const __m256i gb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+      // Rows 0 and 2, then rows 1 and 3.
+      const __m256i rows02 = _mm256_shuffle_epi8(_mm256_unpacklo_epi16(ar, gb), order);
+      const __m256i rows13 = _mm256_shuffle_epi8(_mm256_unpackhi_epi16(ar, gb), order);
+      u32* row = dst + y * width + x;
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(row), _mm256_castsi256_si128(rows02));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(row + width), _mm256_castsi256_si128(rows13));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(row + 2 * width),
+                       _mm256_extracti128_si256(rows02, 1));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(row + 3 * width),
+                       _mm256_extracti128_si256(rows13, 1));
+    }
+}
+
+FUNCTION_TARGET_AVX2
+static inline __m256i LookupC4(__m256i palette_low, __m256i palette_high, __m256i idx)
+{
+  // permutevar only looks at the low 3 bits of the index, bit 3 picks the register.
+  const __m256i high = _mm256_srai_epi32(_mm256_slli_epi32(idx, 28), 31);
+  return _mm256_blendv_epi8(_mm256_permutevar8x32_epi32(palette_low, idx),
+                            _mm256_permutevar8x32_epi32(palette_high, idx), high);
+}
+
+template <bool bgra>
+FUNCTION_TARGET_AVX2 static void DecodeC4(u32* dst, const u8* src, u32 width, u32 height,
+                                          const u8* tlut, TlutFormat tlutfmt)
+{
+  // The whole palette fits in two registers, so the lookup is done with permutes.
+  const bool swap = tlutfmt != GX_TL_IA8;
+  const __m256i palette_low = DecodeTlutEntry<bgra>(Load16x8(tlut, swap), tlutfmt);
+  const __m256i palette_high = DecodeTlutEntry<bgra>(Load16x8(tlut + 16, swap), tlutfmt);
+
+  const u32 Wsteps8 = (width + 7) / 8;
+  for (u32 y = 0; y < height; y += 8)
+    for (u32 x = 0, yStep = (y / 8) * Wsteps8; x < width; x += 8, yStep++)
+      for (u32 iy = 0; iy < 8; iy += 2)
+      {
+        __m256i row1;
+        const __m256i row0 = SplitNibbles(src + 32 * yStep + 4 * iy, &row1);
+        Store8(dst + (y + iy) * width + x, LookupC4(palette_low, palette_high, row0));
+        Store8(dst + (y + iy + 1) * width + x, LookupC4(palette_low, palette_high, row1));
+      }
+}
+
+template <bool bgra>
+FUNCTION_TARGET_AVX2 static void DecodeC8(u32* dst, const u8* src, u32 width, u32 height,
+                                          const u8* tlut, TlutFormat tlutfmt)
+{
+  const u32 Wsteps8 = (width + 7) / 8;
+  for (u32 y = 0; y < height; y += 4)
+    for (u32 x = 0, yStep = (y / 4) * Wsteps8; x < width; x += 8, yStep++)
+      for (u32 iy = 0; iy < 4; iy++)
+      {
+        const __m256i idx = Load8x8(src + 32 * yStep + 8 * iy);
+        Store8(dst + (y + iy) * width + x,
+               DecodeTlutEntry<bgra>(GatherTlut(tlut, idx, 0xFF, tlutfmt), tlutfmt));
+      }
+}
+
+template <bool bgra>
+FUNCTION_TARGET_AVX2 static void DecodeC14X2(u32* dst, const u8* src, u32 width, u32 height,
+                                             const u8* tlut, TlutFormat tlutfmt)
+{
+  const u32 Wsteps4 = (width + 3) / 4;
+  for (u32 y = 0; y < height; y += 4)
+    for (u32 x = 0, yStep = (y / 4) * Wsteps4; x < width; x += 4, yStep++)
+      for (u32 iy = 0; iy < 4; iy += 2)
+      {
+        const __m256i idx =
+            _mm256_and_si256(Load16x8(src + 32 * yStep + 8 * iy, true), Set1(0x3FFF));
+        Store4x2(dst + (y + iy) * width + x, width,
+                 DecodeTlutEntry<bgra>(GatherTlut(tlut, idx, 0x3FFF, tlutfmt), tlutfmt));
+      }
+}
+
+// Takes one 8-bit channel of the colors of two DXT1 blocks (first block in the low two lanes)
+// and computes the channel of the third (even lanes) and fourth (odd lanes) palette entries,
+// both for four color blocks and for three color blocks.
+FUNCTION_TARGET_AVX2
+static inline void InterpolateDXTChannel(__m128i ch, __m128i* four_color, __m128i* three_color)
+{
+  const __m128i odd = _mm_setr_epi32(0, -1, 0, -1);
+  const __m128i ch0 = _mm_shuffle_epi32(ch, _MM_SHUFFLE(2, 2, 0, 0));
+  const __m128i ch1 = _mm_shuffle_epi32(ch, _MM_SHUFFLE(3, 3, 1, 1));
+  const __m128i diff = _mm_sub_epi32(ch1, ch0);
+  const __m128i delta = _mm_sub_epi32(_mm_srai_epi32(diff, 1), _mm_srai_epi32(diff, 3));
+  *four_color = _mm_blendv_epi8(_mm_add_epi32(ch0, delta), _mm_sub_epi32(ch1, delta), odd);
+  const __m128i average =
+      _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(ch0, ch1), _mm_set1_epi32(1)), 1);
+  *three_color = _mm_blendv_epi8(average, ch1, odd);
+}
+
+// Computes the palettes of the two DXT1 blocks at src, the same way the SSE2 CMPR decoder
+// does. The low lane holds the four RGBA32 colors of the first block, the high lane those
+// of the second one.
+FUNCTION_TARGET_AVX2
+static inline __m256i DecodeDXTPalettes(const u8* src)
+{
+  // Lanes: first color of block 0, second color of block 0, then the same for block 1.
+  const __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+  const __m128i colors = _mm_cvtepu16_epi32(_mm_shuffle_epi8(
+      raw, _mm_setr_epi8(1, 0, 3, 2, 9, 8, 11, 10, -1, -1, -1, -1, -1, -1, -1, -1)));
+  const __m128i five = _mm_set1_epi32(0x1F);
+  const __m128i r5 = _mm_and_si128(_mm_srli_epi32(colors, 11), five);
+  const __m128i g6 = _mm_and_si128(_mm_srli_epi32(colors, 5), _mm_set1_epi32(0x3F));
+  const __m128i b5 = _mm_and_si128(colors, five);
+  const __m128i r = _mm_or_si128(_mm_slli_epi32(r5, 3), _mm_srli_epi32(r5, 2));
+  const __m128i g = _mm_or_si128(_mm_slli_epi32(g6, 2), _mm_srli_epi32(g6, 4));
+  const __m128i b = _mm_or_si128(_mm_slli_epi32(b5, 3), _mm_srli_epi32(b5, 2));
+  const __m128i opaque = _mm_set1_epi32(0xFF000000);
+  const __m128i base = _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 8)),
+                                    _mm_or_si128(_mm_slli_epi32(b, 16), opaque));
+
+  // Interpolated colors, the third palette entry in even lanes and the fourth in odd ones.
+  __m128i r4, r3, g4, g3, b4, b3;
+  InterpolateDXTChannel(r, &r4, &r3);
+  InterpolateDXTChannel(g, &g4, &g3);
+  InterpolateDXTChannel(b, &b4, &b3);
+  const __m128i byte = _mm_set1_epi32(0xFF);
+  const __m128i four_color = _mm_or_si128(
+      _mm_or_si128(_mm_and_si128(r4, byte), _mm_slli_epi32(_mm_and_si128(g4, byte), 8)),
+      _mm_or_si128(_mm_slli_epi32(_mm_and_si128(b4, byte), 16), opaque));
+  const __m128i three_color = _mm_or_si128(
+      _mm_or_si128(r3, _mm_slli_epi32(g3, 8)),
+      _mm_or_si128(_mm_slli_epi32(b3, 16), _mm_andnot_si128(_mm_setr_epi32(0, -1, 0, -1), opaque)));
+  const __m128i is_four_color =
+      _mm_cmpgt_epi32(_mm_shuffle_epi32(colors, _MM_SHUFFLE(2, 2, 0, 0)),
+                      _mm_shuffle_epi32(colors, _MM_SHUFFLE(3, 3, 1, 1)));
+  const __m128i extra = _mm_blendv_epi8(three_color, four_color, is_four_color);
+
+  return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi64(base, extra)),
+                                 _mm_unpackhi_epi64(base, extra), 1);
+}
+
+FUNCTION_TARGET_AVX2
+static void DecodeCMPR(u32* dst, const u8* src, u32 width, u32 height)
+{
+  // Each 8x8 block holds 2x2 DXT1 blocks. Every row of a DXT1 block is one byte
+  // of 2-bit palette indices, the leftmost texel in the top bits.
+  const __m256i shifts = _mm256_setr_epi32(6, 4, 2, 0, 6, 4, 2, 0);
+  const __m256i right_block = _mm256_setr_epi32(0, 0, 0, 0, 4, 4, 4, 4);
+  const u32 Wsteps8 = (width + 7) / 8;
+  for (u32 y = 0; y < height; y += 8)
+    for (u32 x = 0, yStep = (y / 8) * Wsteps8; x < width; x += 8, yStep++)
+      for (u32 z = 0; z < 2; z++)
+      {
+        const u8* blocks = src + 32 * yStep + 16 * z;
+        const __m256i palette = DecodeDXTPalettes(blocks);
+
+        u32 lines[2];
+        std::memcpy(&lines[0], blocks + 4, sizeof(u32));
+        std::memcpy(&lines[1], blocks + 12, sizeof(u32));
+        __m256i sel = _mm256_setr_epi32(lines[0], lines[0], lines[0], lines[0], lines[1],
+                                        lines[1], lines[1], lines[1]);
+        for (u32 iy = 0; iy < 4; iy++)
+        {
+          const __m256i idx = _mm256_add_epi32(
+              _mm256_and_si256(_mm256_srlv_epi32(sel, shifts), Set1(3)), right_block);
+          Store8(dst + (y + 4 * z + iy) * width + x, _mm256_permutevar8x32_epi32(palette, idx));
+          sel = _mm256_srli_epi32(sel, 8);
+        }
+      }
+}
+
+template <bool bgra>
+static bool DecodeAVX2(u32* dst, const u8* src, u32 width, u32 height, u32 texformat,
+                       u32 tlutaddr, TlutFormat tlutfmt)
+{
+  // The BGRA32 output of the regular decoder is limited to these formats.
+  if (bgra && texformat != GX_TF_RGB5A3 && texformat != GX_TF_RGBA8 && tlutfmt != GX_TL_RGB5A3)
+    return false;
+
+  const u8* tlut = texMem + tlutaddr;
+  switch (texformat)
+  {
+  case GX_TF_C4:
+    if (tlutaddr + 16 * sizeof(u16) > TMEM_SIZE)
+      return false;
+    DecodeC4<bgra>(dst, src, width, height, tlut, tlutfmt);
+    return true;
+  case GX_TF_C8:
+    if (tlutaddr + 256 * sizeof(u16) > TMEM_SIZE)
+      return false;
+    DecodeC8<bgra>(dst, src, width, height, tlut, tlutfmt);
+    return true;
+  case GX_TF_C14X2:
+    if (tlutaddr + 0x4000 * sizeof(u16) > TMEM_SIZE)
+      return false;
+    DecodeC14X2<bgra>(dst, src, width, height, tlut, tlutfmt);
+    return true;
+  case GX_TF_I4:
+    if (bgra)
+      return false;
+    DecodeI4(dst, src, width, height);
+    return true;
+  case GX_TF_I8:
+    if (bgra)
+      return false;
+    DecodeI8(dst, src, width, height);
+    return true;
+  case GX_TF_IA4:
+    if (bgra)
+      return false;
+    DecodeIA4(dst, src, width, height);
+    return true;
+  case GX_TF_IA8:
+    if (bgra)
+      return false;
+    Decode16BitTexels<DecodeIA8>(dst, src, width, height, false);
+    return true;
+  case GX_TF_RGB565:
+    if (bgra)
+      return false;
+    Decode16BitTexels<Decode565<false>>(dst, src, width, height, true);
+    return true;
+  case GX_TF_RGB5A3:
+    Decode16BitTexels<Decode5A3<bgra>>(dst, src, width, height, true);
+    return true;
+  case GX_TF_RGBA8:
+    DecodeRGBA8<bgra>(dst, src, width, height);
+    return true;
+  case GX_TF_CMPR:
+    if (bgra)
+      return false;
+    DecodeCMPR(dst, src, width, height);
+    return true;
+  default:
+    return false;
+  }
+}
+
+bool DecodeAVX2(u32* dst, const u8* src, u32 width, u32 height, u32 texformat, u32 tlutaddr,
+                TlutFormat tlutfmt, bool bgra)
+{
+  if (bgra)
+    return DecodeAVX2<true>(dst, src, width, height, texformat, tlutaddr, tlutfmt);
+  return DecodeAVX2<false>(dst, src, width, height, texformat, tlutaddr, tlutfmt);
+}
+}
@@ -0,0 +1,19 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include "Common/CommonTypes.h"
+#include "VideoCommon/TextureDecoder.h"
+
+namespace TexDecoder
+{
+// AVX2 versions of the texture decoders, only call these if cpu_info.bAVX2 is set.
+// Decodes to RGBA32, or to BGRA32 when bgra is set. Returns false if the format
+// isn't handled, in which case dst is untouched and the caller has to decode the
+// texture itself. In BGRA mode only the formats the regular decoder outputs as
+// BGRA32 are handled (RGB5A3, RGBA8 and the paletted formats with a RGB5A3 TLUT).
+bool DecodeAVX2(u32* dst, const u8* src, u32 width, u32 height, u32 texformat, u32 tlutaddr,
+                TlutFormat tlutfmt, bool bgra);
+}
@@ -0,0 +1,100 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <cstring>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "VideoCommon/CPMemory.h"
+#include "VideoCommon/OpcodeDecoding.h"
+
+// Builds a command stream in FIFO byte order, for the tests that feed commands to the decoders.
+// The vertex data of a draw is written by the caller after BeginDraw.
+class CommandWriter
+{
+public:
+  void Write8(u8 value) { m_data.push_back(value); }
+  void Write16(u16 value)
+  {
+    Write8(static_cast<u8>(value >> 8));
+    Write8(static_cast<u8>(value));
+  }
+  void Write32(u32 value)
+  {
+    Write16(static_cast<u16>(value >> 16));
+    Write16(static_cast<u16>(value));
+  }
+  void WriteFloat(float value)
+  {
+    u32 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    Write32(bits);
+  }
+
+  void Nop()
+  {
+    Write8(OpcodeDecoder::GX_NOP);
+    m_commands++;
+  }
+  void LoadCPReg(u8 sub_cmd, u32 value)
+  {
+    Write8(OpcodeDecoder::GX_LOAD_CP_REG);
+    Write8(sub_cmd);
+    Write32(value);
+    m_commands++;
+  }
+  void SetVertexFormat(const TVtxDesc& vtx_desc, const VAT& vtx_attr, u8 vat)
+  {
+    LoadCPReg(0x50, static_cast<u32>(vtx_desc.Hex & 0x1FFFF));
+    LoadCPReg(0x60, static_cast<u32>(vtx_desc.Hex >> 17));
+    LoadCPReg(0x70 + vat, vtx_attr.g0.Hex);
+    LoadCPReg(0x80 + vat, vtx_attr.g1.Hex);
+    LoadCPReg(0x90 + vat, vtx_attr.g2.Hex);
+  }
+  void LoadBPReg(u8 address, u32 value)
+  {
+    Write8(OpcodeDecoder::GX_LOAD_BP_REG);
+    Write32((u32(address) << 24) | (value & 0xFFFFFF));
+    m_commands++;
+  }
+  void LoadXFRegs(u16 address, const std::vector<u32>& values)
+  {
+    Write8(OpcodeDecoder::GX_LOAD_XF_REG);
+    Write32((static_cast<u32>(values.size() - 1) << 16) | address);
+    for (u32 value : values)
+      Write32(value);
+    m_commands++;
+  }
+  void LoadXFReg(u16 address, u32 value) { LoadXFRegs(address, {value}); }
+  void BeginDraw(u8 primitive, u8 vat, u16 vertex_count)
+  {
+    Write8(static_cast<u8>(0x80 | (primitive << OpcodeDecoder::GX_PRIMITIVE_SHIFT) | vat));
+    Write16(vertex_count);
+    m_commands++;
+  }
+  void CallDisplayList(u32 address, u32 size)
+  {
+    Write8(OpcodeDecoder::GX_CMD_CALL_DL);
+    Write32(address);
+    Write32(size);
+    m_commands++;
+  }
+  // Display lists are a multiple of 32 bytes
+  void AlignWithNops()
+  {
+    while (m_data.size() % 32)
+      Nop();
+  }
+
+  std::vector<u8>& GetData() { return m_data; }
+  const std::vector<u8>& GetData() const { return m_data; }
+  u32 GetSize() const { return static_cast<u32>(m_data.size()); }
+  u64 GetCommandCount() const { return m_commands; }
+
+private:
+  std::vector<u8> m_data;
+  u64 m_commands = 0;
+};
@@ -0,0 +1,272 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <gtest/gtest.h>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Common/Common.h"
+#include "Common/ThreadPool.h"
+
+using Common::BoundedQueue;
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+// Pushes items [0, producers * items_per_producer) from several threads and checks that the
+// consumers pop every item exactly once. Consumers stop at a negative item.
+void StressTest(size_t capacity, int producers, int consumers, int items_per_producer,
+                bool blocking)
+{
+  BoundedQueue<int> queue(capacity);
+  const int total = producers * items_per_producer;
+  std::vector<std::atomic<int>> hits(total);
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; p++)
+  {
+    threads.emplace_back([&, p] {
+      for (int i = 0; i < items_per_producer; i++)
+      {
+        const int item = p * items_per_producer + i;
+        if (blocking)
+        {
+          queue.wait_push(item);
+        }
+        else
+        {
+          while (!queue.push(item))
+            std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  std::vector<std::thread> consumer_threads;
+  for (int c = 0; c < consumers; c++)
+  {
+    consumer_threads.emplace_back([&] {
+      int last_from_producer[64];
+      std::fill(std::begin(last_from_producer), std::end(last_from_producer), -1);
+      while (true)
+      {
+        int item;
+        if (blocking)
+        {
+          queue.wait_pop(item);
+        }
+        else if (!queue.try_pop(item))
+        {
+          std::this_thread::yield();
+          continue;
+        }
+        if (item < 0)
+          return;
+        hits[item].fetch_add(1);
+        // Items of one producer leave the queue in the order they were pushed
+        const int producer = item / items_per_producer;
+        EXPECT_LT(last_from_producer[producer], item);
+        last_from_producer[producer] = item;
+      }
+    });
+  }
+
+  for (std::thread& thread : threads)
+    thread.join();
+  for (int c = 0; c < consumers; c++)
+    queue.wait_push(-1);
+  for (std::thread& thread : consumer_threads)
+    thread.join();
+
+  EXPECT_TRUE(queue.empty());
+  for (int i = 0; i < total; i++)
+    ASSERT_EQ(1, hits[i].load()) << "item " << i;
+}
+
+// The queue design the lock free ring replaced, kept as the benchmark baseline
+class LockedQueue
+{
+public:
+  bool push(int item)
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_items.push_back(item);
+    return true;
+  }
+  bool try_pop(int& item)
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    if (m_items.empty())
+      return false;
+    item = m_items.front();
+    m_items.pop_front();
+    return true;
+  }
+
+private:
+  std::mutex m_mutex;
+  std::deque<int> m_items;
+};
+
+template <typename Queue>
+double MeasureContention(Queue& queue, int threads, int items_per_thread)
+{
+  std::atomic<bool> start{false};
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++)
+  {
+    // Every thread is producer and consumer, which is the worst case for both designs
+    workers.emplace_back([&] {
+      while (!start.load())
+        std::this_thread::yield();
+      int item;
+      for (int i = 0; i < items_per_thread; i++)
+      {
+        while (!queue.push(i))
+          std::this_thread::yield();
+        while (!queue.try_pop(item))
+          std::this_thread::yield();
+      }
+    });
+  }
+  const Clock::time_point begin = Clock::now();
+  start.store(true);
+  for (std::thread& worker : workers)
+    worker.join();
+  const double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+  return threads * items_per_thread / seconds;
+}
+}  // namespace
+
+TEST(CircularQueue, Resize)
+{
+  Common::CircularQueue<int> queue(2);
+  EXPECT_TRUE(queue.push(1));
+  EXPECT_FALSE(queue.push(2));
+
+  queue.resize(8);
+  EXPECT_TRUE(queue.empty());
+  for (int i = 0; i < 7; i++)
+    EXPECT_TRUE(queue.push(i));
+  EXPECT_TRUE(queue.Full());
+  int item;
+  for (int i = 0; i < 7; i++)
+  {
+    ASSERT_TRUE(queue.try_pop(item));
+    EXPECT_EQ(i, item);
+  }
+  EXPECT_FALSE(queue.try_pop(item));
+}
+
+TEST(BoundedQueue, CapacityIsPowerOfTwo)
+{
+  EXPECT_EQ(2u, BoundedQueue<int>(1).capacity());
+  EXPECT_EQ(256u, BoundedQueue<int>(256).capacity());
+  EXPECT_EQ(512u, BoundedQueue<int>(257).capacity());
+}
+
+TEST(BoundedQueue, SingleThreaded)
+{
+  BoundedQueue<int> queue(4);
+  int item;
+  EXPECT_TRUE(queue.empty());
+  EXPECT_FALSE(queue.try_pop(item));
+  // Several laps around the ring
+  for (int lap = 0; lap < 10; lap++)
+  {
+    for (int i = 0; i < 4; i++)
+      EXPECT_TRUE(queue.push(lap * 4 + i));
+    EXPECT_TRUE(queue.full());
+    EXPECT_FALSE(queue.push(-1));
+    for (int i = 0; i < 4; i++)
+    {
+      ASSERT_TRUE(queue.try_pop(item));
+      EXPECT_EQ(lap * 4 + i, item);
+    }
+    EXPECT_TRUE(queue.empty());
+  }
+}
+
+TEST(BoundedQueue, MoveOnlyItems)
+{
+  BoundedQueue<std::unique_ptr<int>> queue(8);
+  EXPECT_TRUE(queue.push(std::make_unique<int>(42)));
+  std::unique_ptr<int> item;
+  ASSERT_TRUE(queue.try_pop(item));
+  ASSERT_NE(nullptr, item);
+  EXPECT_EQ(42, *item);
+}
+
+TEST(BoundedQueue, WaitPopWakesUp)
+{
+  BoundedQueue<int> queue(4);
+  int item = 0;
+  std::thread consumer([&] { queue.wait_pop(item); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  queue.push(7);
+  consumer.join();
+  EXPECT_EQ(7, item);
+}
+
+TEST(BoundedQueue, WaitPushWakesUp)
+{
+  BoundedQueue<int> queue(2);
+  queue.push(1);
+  queue.push(2);
+  std::thread producer([&] { queue.wait_push(3); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  int item;
+  for (int expected = 1; expected <= 3; expected++)
+  {
+    queue.wait_pop(item);
+    EXPECT_EQ(expected, item);
+  }
+  producer.join();
+}
+
+TEST(BoundedQueue, StressManyToOne)
+{
+  StressTest(16, 4, 1, 50000, false);
+}
+
+TEST(BoundedQueue, StressOneToMany)
+{
+  StressTest(16, 1, 4, 200000, false);
+}
+
+TEST(BoundedQueue, StressManyToMany)
+{
+  StressTest(64, 4, 4, 50000, false);
+}
+
+TEST(BoundedQueue, StressBlocking)
+{
+  // A tiny ring keeps both sides blocking on each other most of the time
+  StressTest(2, 4, 4, 20000, true);
+}
+
+// Not a correctness test, prints the numbers to compare queue changes with.
+TEST(BoundedQueue, DISABLED_Benchmark)
+{
+  constexpr int ITEMS_PER_THREAD = 200000;
+  const int max_threads =
+      static_cast<int>(std::max(std::thread::hardware_concurrency(), 2u));
+  for (int threads = 1; threads <= max_threads; threads *= 2)
+  {
+    BoundedQueue<int> ring(1024);
+    LockedQueue locked;
+    const double ring_rate = MeasureContention(ring, threads, ITEMS_PER_THREAD);
+    const double locked_rate = MeasureContention(locked, threads, ITEMS_PER_THREAD);
+    printf("[ BENCH    ] %2d threads: lock free %.0f ops/ms, mutex %.0f ops/ms\n", threads,
+           ring_rate / 1000, locked_rate / 1000);
+    EXPECT_TRUE(ring.empty());
+  }
+}
@@ -0,0 +1,408 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>  // NOLINT
+
+#include "Common/CommonTypes.h"
+#include "Common/File.h"
+#include "Common/FileUtil.h"
+#include "Common/LinearDiskCache.h"
+
+namespace
+{
+// Shaped like a shader uid
+struct TestKey
+{
+  u32 id;
+  u32 data[7];
+};
+
+TestKey MakeKey(u32 id)
+{
+  TestKey key;
+  key.id = id;
+  for (u32 i = 0; i < 7; ++i)
+    key.data[i] = id * 31 + i;
+  return key;
+}
+
+std::vector<u32> MakeValue(u32 id, u32 generation = 0)
+{
+  std::vector<u32> value(1 + (id + generation) % 19);
+  for (size_t i = 0; i < value.size(); ++i)
+    value[i] = id * 1000 + generation * 100 + static_cast<u32>(i);
+  return value;
+}
+
+typedef LinearDiskCache<TestKey, u32> TestCache;
+
+class Collector : public LinearDiskCacheReader<TestKey, u32>
+{
+public:
+  void Read(const TestKey& key, const u32* value, u32 value_size) override
+  {
+    EXPECT_EQ(0u, entries.count(key.id)) << "key " << key.id << " read twice";
+    entries[key.id].assign(value, value + value_size);
+  }
+  std::map<u32, std::vector<u32>> entries;
+};
+
+void Append(TestCache& cache, u32 id, u32 generation = 0)
+{
+  const std::vector<u32> value = MakeValue(id, generation);
+  cache.Append(MakeKey(id), value.data(), static_cast<u32>(value.size()));
+}
+
+class LinearDiskCacheTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    m_directory = File::CreateTempDir();
+    m_filename = m_directory + "/test.cache";
+  }
+  void TearDown() override { File::DeleteDirRecursively(m_directory); }
+
+  void ExpectEntries(u32 begin, u32 end, u32 generation = 0)
+  {
+    TestCache cache;
+    Collector collector;
+    EXPECT_EQ(end - begin, cache.OpenAndRead(m_filename, collector));
+    ASSERT_EQ(end - begin, collector.entries.size());
+    for (u32 id = begin; id < end; ++id)
+      EXPECT_EQ(MakeValue(id, generation), collector.entries[id]) << "key " << id;
+  }
+
+  std::string m_directory;
+  std::string m_filename;
+};
+}  // namespace
+
+TEST_F(LinearDiskCacheTest, AppendAndRead)
+{
+  {
+    TestCache cache;
+    Collector collector;
+    EXPECT_EQ(0u, cache.OpenAndRead(m_filename, collector));
+    for (u32 id = 0; id < 100; ++id)
+      Append(cache, id);
+    EXPECT_EQ(100u, cache.GetEntryCount());
+  }
+  EXPECT_TRUE(File::Exists(m_filename + ".idx"));
+  ExpectEntries(0, 100);
+}
+
+TEST_F(LinearDiskCacheTest, Lookup)
+{
+  {
+    TestCache cache;
+    cache.Open(m_filename);
+    for (u32 id = 0; id < 50; ++id)
+      Append(cache, id);
+    // Found before they are written
+    EXPECT_TRUE(cache.Contains(MakeKey(10)));
+  }
+
+  TestCache cache;
+  EXPECT_EQ(50u, cache.Open(m_filename));
+  std::vector<u32> value;
+  for (u32 id = 0; id < 50; ++id)
+  {
+    ASSERT_TRUE(cache.Lookup(MakeKey(id), &value));
+    EXPECT_EQ(MakeValue(id), value);
+  }
+  EXPECT_FALSE(cache.Contains(MakeKey(50)));
+  // Keys are compared as a whole
+  TestKey key = MakeKey(3);
+  key.data[6]++;
+  EXPECT_FALSE(cache.Contains(key));
+
+  // Appended records are found next to the indexed ones
+  Append(cache, 50);
+  ASSERT_TRUE(cache.Lookup(MakeKey(50), &value));
+  EXPECT_EQ(MakeValue(50), value);
+}
+
+TEST_F(LinearDiskCacheTest, NewestValueWins)
+{
+  {
+    TestCache cache;
+    cache.Open(m_filename);
+    for (u32 id = 0; id < 100; ++id)
+      Append(cache, id);
+    Append(cache, 7, 1);
+  }
+  {
+    // Replaced before and after the index was written
+    TestCache cache;
+    cache.Open(m_filename);
+    Append(cache, 8, 1);
+    EXPECT_EQ(100u, cache.GetEntryCount());
+    std::vector<u32> value;
+    ASSERT_TRUE(cache.Lookup(MakeKey(7), &value));
+    EXPECT_EQ(MakeValue(7, 1), value);
+  }
+
+  TestCache cache;
+  Collector collector;
+  EXPECT_EQ(100u, cache.OpenAndRead(m_filename, collector));
+  EXPECT_EQ(MakeValue(7, 1), collector.entries[7]);
+  EXPECT_EQ(MakeValue(8, 1), collector.entries[8]);
+  EXPECT_EQ(MakeValue(9), collector.entries[9]);
+  cache.Close();
+
+  // Also when the index is rebuilt
+  File::Delete(m_filename + ".idx");
+  Collector rebuilt;
+  EXPECT_EQ(100u, cache.OpenAndRead(m_filename, rebuilt));
+  EXPECT_EQ(collector.entries, rebuilt.entries);
+}
+
+TEST_F(LinearDiskCacheTest, Compaction)
+{
+  {
+    TestCache cache;
+    cache.Open(m_filename);
+    for (u32 id = 0; id < 100; ++id)
+      Append(cache, id);
+  }
+  const u64 size = File::GetSize(m_filename);
+
+  // Few replaced records are kept
+  {
+    TestCache cache;
+    cache.Open(m_filename);
+    for (u32 id = 0; id < 10; ++id)
+      Append(cache, id, 1);
+  }
+  EXPECT_GT(File::GetSize(m_filename), size);
+
+  // Many are compacted away at close
+  {
+    TestCache cache;
+    cache.Open(m_filename);
+    for (u32 id = 0; id < 100; ++id)
+      Append(cache, id, 2);
+  }
+  u64 compacted_size = 48;
+  for (u32 id = 0; id < 100; ++id)
+    compacted_size += sizeof(u32) + sizeof(TestKey) + sizeof(u32) * (MakeValue(id, 2).size() + 1);
+  EXPECT_EQ(compacted_size, File::GetSize(m_filename));
+  ExpectEntries(0, 100, 2);
+
+  // Compact keeps the cache usable
+  TestCache cache;
+  cache.Open(m_filename);
+  Append(cache, 5, 3);
+  EXPECT_TRUE(cache.Compact());
+  EXPECT_EQ(100u, cache.GetEntryCount());
+  std::vector<u32> value;
+  ASSERT_TRUE(cache.Lookup(MakeKey(5), &value));
+  EXPECT_EQ(MakeValue(5, 3), value);
+  Append(cache, 100);
+  EXPECT_TRUE(cache.Contains(MakeKey(100)));
+}
+
+TEST_F(LinearDiskCacheTest, TornRecord)
+{
+  {
+    TestCache cache;
+    cache.Open(m_filename);
+    for (u32 id = 0; id < 10; ++id)
+      Append(cache, id);
+  }
+  // Cut the last record, like a crash in the middle of a write
+  const u64 size = File::GetSize(m_filename);
+  {
+    File::IOFile file(m_filename, "r+b");
+    ASSERT_TRUE(file.Resize(size - 3));
+  }
+  ExpectEntries(0, 9);
+
+  {
+    TestCache cache;
+    EXPECT_EQ(9u, cache.Open(m_filename));
+    Append(cache, 9);
+    Append(cache, 10);
+  }
+  ExpectEntries(0, 11);
+}
+
+TEST_F(LinearDiskCacheTest, MissingOrStaleIndex)
+{
+  {
+    TestCache cache;
+    cache.Open(m_filename);
+    for (u32 id = 0; id < 20; ++id)
+      Append(cache, id);
+  }
+  // Caches written before the index existed are read completely, and get an index
+  File::Delete(m_filename + ".idx");
+  ExpectEntries(0, 20);
+  EXPECT_TRUE(File::Exists(m_filename + ".idx"));
+
+  // The same number of records with other keys, the old index must not be used for them
+  const std::string other = m_directory + "/other.cache";
+  {
+    TestCache cache;
+    cache.Open(other);
+    for (u32 id = 100; id < 120; ++id)
+      Append(cache, id);
+  }
+  ASSERT_TRUE(File::Copy(other, m_filename));
+  TestCache cache;
+  EXPECT_EQ(20u, cache.Open(m_filename));
+  EXPECT_TRUE(cache.Contains(MakeKey(100)));
+  EXPECT_FALSE(cache.Contains(MakeKey(0)));
+}
+
+TEST_F(LinearDiskCacheTest, VersionMismatchRecreates)
+{
+  {
+    TestCache cache;
+    cache.Open(m_filename, "a");
+    Append(cache, 1);
+  }
+  TestCache cache;
+  EXPECT_EQ(1u, cache.Open(m_filename, "a"));
+  EXPECT_EQ(0u, cache.Open(m_filename, "b"));
+  EXPECT_FALSE(cache.Contains(MakeKey(1)));
+}
+
+TEST_F(LinearDiskCacheTest, ConcurrentAppendAndLookup)
+{
+  constexpr u32 THREADS = 4;
+  constexpr u32 PER_THREAD = 500;
+  {
+    TestCache cache;
+    cache.Open(m_filename);
+    std::atomic<u32> misses{0};
+    std::vector<std::thread> threads;
+    for (u32 t = 0; t < THREADS; ++t)
+    {
+      threads.emplace_back([&, t] {
+        std::vector<u32> value;
+        for (u32 i = 0; i < PER_THREAD; ++i)
+        {
+          const u32 id = t * PER_THREAD + i;
+          Append(cache, id);
+          if (!cache.Lookup(MakeKey(id), &value) || value != MakeValue(id))
+            misses++;
+        }
+      });
+    }
+    for (std::thread& thread : threads)
+      thread.join();
+    EXPECT_EQ(0u, misses.load());
+    EXPECT_EQ(THREADS * PER_THREAD, cache.GetEntryCount());
+  }
+  ExpectEntries(0, THREADS * PER_THREAD);
+}
+
+namespace
+{
+// The fstream reader the mapped format replaced, kept as the benchmark baseline
+u32 ReadWithFStream(const std::string& filename, LinearDiskCacheReader<TestKey, u32>& reader)
+{
+  std::ifstream file(filename, std::ios::binary);
+  file.seekg(48);
+  u32 count = 0;
+  u32 value_size;
+  while (file.read(reinterpret_cast<char*>(&value_size), sizeof(value_size)))
+  {
+    TestKey key;
+    u32* value = new u32[value_size];
+    u32 entry_number;
+    if (!file.read(reinterpret_cast<char*>(&key), sizeof(key)) ||
+        !file.read(reinterpret_cast<char*>(value), value_size * sizeof(u32)) ||
+        !file.read(reinterpret_cast<char*>(&entry_number), sizeof(entry_number)))
+    {
+      delete[] value;
+      break;
+    }
+    reader.Read(key, value, value_size);
+    delete[] value;
+    count++;
+  }
+  return count;
+}
+
+class CountingReader : public LinearDiskCacheReader<TestKey, u32>
+{
+public:
+  void Read(const TestKey& key, const u32* value, u32 value_size) override
+  {
+    sum += key.id + value_size + value[0];
+  }
+  u64 sum = 0;
+};
+
+template <typename F>
+double MeasureMs(F&& func)
+{
+  const auto start = std::chrono::steady_clock::now();
+  func();
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+      .count();
+}
+}  // namespace
+
+// Not a correctness test, prints the startup times to compare cache changes with. The file is
+// in the page cache for all of them. Run it with --gtest_also_run_disabled_tests.
+TEST_F(LinearDiskCacheTest, DISABLED_StartupBenchmark)
+{
+  constexpr u32 ENTRIES = 500000;
+  constexpr u32 LOOKUPS = 10000;
+  {
+    TestCache cache;
+    cache.Open(m_filename);
+    for (u32 id = 0; id < ENTRIES; ++id)
+      Append(cache, id);
+  }
+
+  u32 count = 0;
+  CountingReader legacy;
+  const double fstream_ms = MeasureMs([&] { count = ReadWithFStream(m_filename, legacy); });
+  EXPECT_EQ(ENTRIES, count);
+
+  CountingReader indexed;
+  const double indexed_ms = MeasureMs([&] {
+    TestCache cache;
+    count = cache.OpenAndRead(m_filename, indexed);
+  });
+  EXPECT_EQ(ENTRIES, count);
+  EXPECT_EQ(legacy.sum, indexed.sum);
+
+  std::vector<u32> value;
+  const double lazy_ms = MeasureMs([&] {
+    TestCache cache;
+    count = cache.Open(m_filename);
+    for (u32 i = 0; i < LOOKUPS; ++i)
+      EXPECT_TRUE(cache.Lookup(MakeKey(i * (ENTRIES / LOOKUPS)), &value));
+  });
+  EXPECT_EQ(ENTRIES, count);
+
+  // A cache written before the index existed
+  File::Delete(m_filename + ".idx");
+  CountingReader unindexed;
+  const double unindexed_ms = MeasureMs([&] {
+    TestCache cache;
+    count = cache.OpenAndRead(m_filename, unindexed);
+  });
+  EXPECT_EQ(ENTRIES, count);
+  EXPECT_EQ(legacy.sum, unindexed.sum);
+
+  printf("[ BENCH    ] %u entries: fstream read %.1f ms, indexed read %.1f ms, "
+         "open and %u lookups %.1f ms, unindexed read %.1f ms\n",
+         ENTRIES, fstream_ms, indexed_ms, LOOKUPS, lazy_ms, unindexed_ms);
+}
@@ -0,0 +1,204 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "Common/Common.h"
+#include "Common/Event.h"
+#include "Common/ThreadPool.h"
+
+using Common::TaskGroup;
+using Common::ThreadPool;
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+double ElapsedUs(Clock::time_point start, Clock::time_point end)
+{
+  return std::chrono::duration<double, std::micro>(end - start).count();
+}
+}  // namespace
+
+TEST(ThreadPool, HasWorkers)
+{
+  EXPECT_GE(ThreadPool::GetThreadCount(), 1u);
+}
+
+TEST(ThreadPool, ExecuteRunsEveryTask)
+{
+  constexpr int TASK_COUNT = 10000;
+  std::atomic<int> counter{0};
+  Common::Event done;
+  for (int i = 0; i < TASK_COUNT; i++)
+  {
+    ThreadPool::Execute([&] {
+      if (counter.fetch_add(1) == TASK_COUNT - 1)
+        done.Set();
+    });
+  }
+  done.Wait();
+  EXPECT_EQ(TASK_COUNT, counter.load());
+}
+
+TEST(ThreadPool, AsyncReturnsResult)
+{
+  std::vector<std::future<int>> results;
+  for (int i = 0; i < 100; i++)
+    results.push_back(ThreadPool::Async([i] { return i * i; }));
+  for (int i = 0; i < 100; i++)
+    EXPECT_EQ(i * i, results[i].get());
+}
+
+TEST(ThreadPool, ParallelForCoversRange)
+{
+  std::vector<std::atomic<int>> hits(10000);
+  ThreadPool::ParallelFor(0, static_cast<int>(hits.size()), 16, [&](int lower, int upper) {
+    for (int i = lower; i < upper; i++)
+      hits[i].fetch_add(1);
+  });
+  for (const auto& hit : hits)
+    ASSERT_EQ(1, hit.load());
+}
+
+TEST(TaskGroup, WaitsForAllTasks)
+{
+  std::atomic<int> counter{0};
+  TaskGroup group;
+  for (int i = 0; i < 1000; i++)
+    group.Run([&] { counter.fetch_add(1); });
+  group.Wait();
+  EXPECT_EQ(1000, counter.load());
+
+  // Reusable after a wait
+  group.Run([&] { counter.fetch_add(1); });
+  group.Wait();
+  EXPECT_EQ(1001, counter.load());
+}
+
+TEST(TaskGroup, Nested)
+{
+  // More waiting tasks than workers, only works if waiting threads run the tasks of their group
+  std::atomic<int> counter{0};
+  TaskGroup outer;
+  for (size_t i = 0; i < ThreadPool::GetThreadCount() * 4; i++)
+  {
+    outer.Run([&] {
+      TaskGroup inner;
+      for (int j = 0; j < 64; j++)
+      {
+        inner.Run([&] {
+          TaskGroup innermost;
+          innermost.Run([&] { counter.fetch_add(1); });
+        });
+      }
+      inner.Wait();
+    });
+  }
+  outer.Wait();
+  EXPECT_EQ(static_cast<int>(ThreadPool::GetThreadCount() * 4 * 64), counter.load());
+}
+
+TEST(TaskGroup, WaitDoesNotRunOtherTasks)
+{
+  // Keep every worker busy, so the tasks below can only run on the waiting thread
+  const size_t worker_count = ThreadPool::GetThreadCount();
+  std::atomic<size_t> blocked{0};
+  std::atomic<bool> release{false};
+  Common::Event workers_done;
+  for (size_t i = 0; i < worker_count; i++)
+  {
+    ThreadPool::Execute([&] {
+      blocked.fetch_add(1);
+      while (!release.load())
+        Common::YieldCPU();
+      if (blocked.fetch_sub(1) == 1)
+        workers_done.Set();
+    });
+  }
+  while (blocked.load() != worker_count)
+    Common::YieldCPU();
+
+  std::atomic<bool> other_ran{false};
+  Common::Event other_done;
+  ThreadPool::Execute([&] {
+    other_ran.store(true);
+    other_done.Set();
+  });
+  std::atomic<int> counter{0};
+  TaskGroup group;
+  for (int i = 0; i < 10; i++)
+    group.Run([&] { counter.fetch_add(1); });
+  group.Wait();
+  EXPECT_EQ(10, counter.load());
+  EXPECT_FALSE(other_ran.load());
+
+  release.store(true);
+  workers_done.Wait();
+  other_done.Wait();
+  EXPECT_TRUE(other_ran.load());
+}
+
+// Not a correctness test, prints the numbers to compare scheduler changes with.
+TEST(ThreadPool, DISABLED_Benchmark)
+{
+  constexpr int TASK_COUNT = 200000;
+  std::atomic<int> counter{0};
+
+  // Throughput of tiny tasks spawned from outside the pool
+  Clock::time_point start = Clock::now();
+  {
+    TaskGroup group;
+    for (int i = 0; i < TASK_COUNT; i++)
+      group.Run([&] { counter.fetch_add(1, std::memory_order_relaxed); });
+  }
+  const double external_us = ElapsedUs(start, Clock::now());
+
+  // Throughput of tasks spawned by tasks, which go to the deques of the workers
+  start = Clock::now();
+  {
+    TaskGroup group;
+    const int spawner_count = static_cast<int>(ThreadPool::GetThreadCount());
+    for (int i = 0; i < spawner_count; i++)
+    {
+      group.Run([&] {
+        TaskGroup inner;
+        for (int j = 0; j < TASK_COUNT / spawner_count; j++)
+          inner.Run([&] { counter.fetch_add(1, std::memory_order_relaxed); });
+      });
+    }
+  }
+  const double nested_us = ElapsedUs(start, Clock::now());
+
+  // Latency from Execute until a worker starts the task, the pool is idle in between
+  constexpr int LATENCY_SAMPLES = 500;
+  std::vector<double> latencies;
+  for (int i = 0; i < LATENCY_SAMPLES; i++)
+  {
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+    Clock::time_point started;
+    Common::Event done;
+    const Clock::time_point submitted = Clock::now();
+    ThreadPool::Execute([&] {
+      started = Clock::now();
+      done.Set();
+    });
+    done.Wait();
+    latencies.push_back(ElapsedUs(submitted, started));
+  }
+  std::sort(latencies.begin(), latencies.end());
+
+  printf("[ BENCH    ] %zu workers\n", ThreadPool::GetThreadCount());
+  printf("[ BENCH    ] external spawn: %.0f tasks/ms\n", TASK_COUNT / (external_us / 1000));
+  printf("[ BENCH    ] nested spawn:   %.0f tasks/ms\n", TASK_COUNT / (nested_us / 1000));
+  printf("[ BENCH    ] wake-up latency: median %.1f us, p99 %.1f us\n",
+         latencies[LATENCY_SAMPLES / 2], latencies[LATENCY_SAMPLES * 99 / 100]);
+  EXPECT_GE(counter.load(), TASK_COUNT);
+}
@@ -1079,4 +1079,53 @@ FMA4_TEST(VFNMSUB, S, false)
 FMA4_TEST(VFMADDSUB, P, true)
 FMA4_TEST(VFMSUBADD, P, true)
 
+TEST_F(x64EmitterTest, AVXVectorSize)
+{
+  emitter->VMOVD_xmm(XMM9, MatR(R12));
+  emitter->VMOVQ_xmm(XMM1, MatR(RAX));
+  emitter->VMOVDQU(128, XMM1, MatR(R12));
+  emitter->VMOVDQU(256, YMM1, MatR(RAX));
+  emitter->VMOVUPS(128, MatR(RAX), XMM2);
+  emitter->VMOVUPS(256, MatR(R12), YMM10);
+  emitter->VMOVSS(MatR(RAX), XMM3);
+  emitter->VMOVLPS(MatR(RAX), XMM11);
+  emitter->VCVTSI2SS(32, XMM0, XMM0, R(RAX));
+  emitter->VCVTDQ2PS(128, XMM0, R(XMM1));
+  emitter->VCVTDQ2PS(256, YMM0, R(YMM9));
+  emitter->VMULPS(256, YMM0, YMM0, R(YMM11));
+  emitter->VPSHUFB(128, XMM0, XMM0, MatR(RAX));
+  emitter->VPSHUFB(256, YMM8, YMM0, MatR(R12));
+  emitter->VPSRAD(256, YMM0, YMM0, 24);
+  emitter->VPSRAD(128, XMM1, XMM9, 16);
+  emitter->VBROADCASTSS(256, YMM2, MatR(RAX));
+  emitter->VINSERTF128(YMM0, YMM0, R(XMM1), 1);
+  emitter->VINSERTF128(YMM0, YMM0, MatR(RAX), 1);
+  emitter->VEXTRACTF128(R(XMM1), YMM0, 1);
+  emitter->VEXTRACTF128(MatR(R12), YMM9, 1);
+  emitter->VZEROUPPER();
+  // The disassembler names the 128-bit operand of vinsertf128/vextractf128 after the full register
+  ExpectDisassembly("vmovd xmm9, dword ptr ds:[r12] "
+                    "vmovq xmm1, qword ptr ds:[rax] "
+                    "vmovdqu xmm1, dqword ptr ds:[r12] "
+                    "vmovdqu ymm1, qqword ptr ds:[rax] "
+                    "vmovups dqword ptr ds:[rax], xmm2 "
+                    "vmovups qqword ptr ds:[r12], ymm10 "
+                    "vmovss dword ptr ds:[rax], xmm3 "
+                    "vmovlps qword ptr ds:[rax], xmm11 "
+                    "vcvtsi2ss xmm0, xmm0, eax "
+                    "vcvtdq2ps xmm0, xmm1 "
+                    "vcvtdq2ps ymm0, ymm9 "
+                    "vmulps ymm0, ymm0, ymm11 "
+                    "vpshufb xmm0, xmm0, dqword ptr ds:[rax] "
+                    "vpshufb ymm8, ymm0, qqword ptr ds:[r12] "
+                    "vpsrad ymm0, ymm0, 0x18 "
+                    "vpsrad xmm1, xmm9, 0x10 "
+                    "vbroadcastss ymm2, dword ptr ds:[rax] "
+                    "vinsertf128 ymm0, ymm0, ymm1, 0x01 "
+                    "vinsertf128 ymm0, ymm0, qqword ptr ds:[rax], 0x01 "
+                    "vextractf128 ymm1, ymm0, 0x01 "
+                    "vextractf128 qqword ptr ds:[r12], ymm9, 0x01 "
+                    "vzeroupper");
+}
+
 }  // namespace Gen
@@ -0,0 +1,241 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>  // NOLINT
+
+#include "Common/CommonTypes.h"
+#include "Common/FileUtil.h"
+#include "Core/ConfigManager.h"
+#include "Core/CoreTiming.h"
+#include "Core/FifoPlayer/FifoBenchmark.h"
+#include "Core/FifoPlayer/FifoDataFile.h"
+#include "Core/HW/Memmap.h"
+#include "UICommon/UICommon.h"
+#include "UnitTests/CommandWriter.h"
+#include "VideoCommon/BPMemory.h"
+#include "VideoCommon/CPMemory.h"
+#include "VideoCommon/OpcodeDecoding.h"
+#include "VideoCommon/VideoBackendBase.h"
+#include "VideoCommon/VideoCommon.h"
+#include "VideoCommon/XFMemory.h"
+
+namespace
+{
+constexpr u32 DISPLAY_LIST_ADDRESS = 0x10000;
+
+// Float XYZ positions, the vertex format of the log
+void DrawTriangles(CommandWriter& writer, std::mt19937& rng, u16 count)
+{
+  std::uniform_real_distribution<float> center(-1.0f, 1.0f);
+  std::uniform_real_distribution<float> offset(-0.15f, 0.15f);
+  writer.BeginDraw(OpcodeDecoder::GX_DRAW_TRIANGLES, 0, static_cast<u16>(count * 3));
+  for (u16 i = 0; i < count; i++)
+  {
+    const float x = center(rng);
+    const float y = center(rng);
+    for (int j = 0; j < 3; j++)
+    {
+      writer.WriteFloat(x + offset(rng));
+      writer.WriteFloat(y + offset(rng));
+      writer.WriteFloat(0.5f);
+    }
+  }
+}
+
+void CopyToXFB(CommandWriter& writer)
+{
+  UPE_Copy copy;
+  copy.Hex = 0;
+  copy.clear = 1;
+  copy.copy_to_xfb = 1;
+  writer.LoadBPReg(BPMEM_TRIGGER_EFB_COPY, copy.Hex);
+}
+
+// Untextured triangles in the material color, without depth test, and a copy to the XFB at the end
+// of each frame
+std::unique_ptr<FifoDataFile> MakeLog(u32 frame_count, u16 triangles_per_draw)
+{
+  auto file = std::make_unique<FifoDataFile>();
+
+  u32* bp = file->GetBPMem();
+  bp[BPMEM_GENMODE] = 1 << 4;  // one color channel
+  bp[BPMEM_SCISSORTL] = 342 | 342 << 12;
+  bp[BPMEM_SCISSORBR] = (342 + EFB_WIDTH - 1) | (342 + EFB_HEIGHT - 1) << 12;
+  bp[BPMEM_SCISSOROFFSET] = 171 | 171 << 10;
+  bp[BPMEM_TEV_COLOR_ENV] = 0x8FFFA;  // clamp(rasterized color)
+  bp[BPMEM_TEV_ALPHA_ENV] = 0x8FFD0;  // clamp(rasterized alpha)
+  bp[BPMEM_ALPHACOMPARE] = AlphaTest::ALWAYS << 16 | AlphaTest::ALWAYS << 19;
+  bp[BPMEM_BLENDMODE] = 0x18;  // color and alpha update
+  bp[BPMEM_EFB_BR] = (EFB_WIDTH - 1) | (EFB_HEIGHT - 1) << 10;
+  bp[BPMEM_MIPMAP_STRIDE] = EFB_WIDTH * 2 >> 5;
+  bp[BPMEM_COPYYSCALE] = 256;
+
+  u32* cp = file->GetCPMem();
+  cp[0x50] = DIRECT << 9;            // VCD_LO: direct position
+  cp[0x70] = 1 | FORMAT_FLOAT << 1;  // VAT A 0: XYZ float
+
+  u32* xf = file->GetXFMem();
+  xf[0] = xf[5] = xf[10] = 0x3F800000;  // identity position matrix
+  u32* xf_regs = file->GetXFRegs();
+  xf_regs[XFMEM_SETNUMCHAN - 0x1000] = 1;
+  xf_regs[XFMEM_SETCHAN0_AMBCOLOR - 0x1000] = 0x404040FF;
+  xf_regs[XFMEM_SETCHAN0_MATCOLOR - 0x1000] = 0xC08040FF;
+  const float half_width = EFB_WIDTH / 2.0f;
+  const float half_height = EFB_HEIGHT / 2.0f;
+  const float viewport[6] = {half_width,        -half_height,       16777215.0f,
+                             342 + half_width, 342 + half_height, 16777215.0f};
+  std::memcpy(&xf_regs[XFMEM_SETVIEWPORT - 0x1000], viewport, sizeof(viewport));
+  // Orthographic projection, z is moved into the clip volume
+  const float projection[6] = {1.0f, 0.0f, 1.0f, 0.0f, 0.0f, -0.5f};
+  std::memcpy(&xf_regs[XFMEM_SETPROJECTION - 0x1000], projection, sizeof(projection));
+  xf_regs[XFMEM_SETPROJECTION + 6 - 0x1000] = GX_ORTHOGRAPHIC;
+
+  std::mt19937 rng(frame_count);
+  for (u32 i = 0; i < frame_count; i++)
+  {
+    CommandWriter display_list;
+    DrawTriangles(display_list, rng, triangles_per_draw);
+    display_list.AlignWithNops();
+
+    // A draw from the FIFO, then a draw from a display list that is uploaded in the middle of the
+    // frame, right before it is called
+    CommandWriter writer;
+    DrawTriangles(writer, rng, triangles_per_draw);
+    MemoryUpdate update;
+    update.fifoPosition = static_cast<u32>(writer.GetData().size());
+    update.address = DISPLAY_LIST_ADDRESS;
+    update.data = display_list.GetData();
+    update.type = MemoryUpdate::VERTEX_STREAM;
+    writer.CallDisplayList(DISPLAY_LIST_ADDRESS, static_cast<u32>(update.data.size()));
+    CopyToXFB(writer);
+
+    FifoFrameInfo frame;
+    frame.fifoData = writer.GetData();
+    frame.fifoStart = 0;
+    frame.fifoEnd = 0;
+    frame.memoryUpdates.push_back(std::move(update));
+    file->AddFrame(frame);
+  }
+  return file;
+}
+
+const Common::Profiler::Result* FindStage(const FifoBenchmark::Result& result,
+                                          const std::string& name)
+{
+  for (const Common::Profiler::Result& stage : result.stages)
+  {
+    if (stage.name == name)
+      return &stage;
+  }
+  return nullptr;
+}
+
+// Replays the logs through the headless software renderer
+class FifoBenchmarkTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    m_profile_path = File::CreateTempDir();
+    UICommon::SetUserDirectory(m_profile_path);
+    UICommon::Init();
+    // The commands are decoded on this thread
+    SConfig::GetInstance().bCPUThread = false;
+
+    m_ram.assign(Memory::RAM_SIZE, 0);
+    Memory::m_pRAM = m_ram.data();
+
+    VideoBackendBase::ActivateHeadlessBackend();
+    ASSERT_TRUE(g_video_backend->Initialize(nullptr));
+    g_video_backend->Video_Prepare();
+  }
+
+  void TearDown() override
+  {
+    if (g_video_backend)
+    {
+      g_video_backend->Video_Cleanup();
+      g_video_backend->Shutdown();
+    }
+    Memory::m_pRAM = nullptr;
+
+    CoreTiming::Shutdown();
+    UICommon::Shutdown();
+    g_video_backend = nullptr;
+    File::DeleteDirRecursively(m_profile_path);
+  }
+
+  std::string m_profile_path;
+  std::vector<u8> m_ram;
+};
+}  // namespace
+
+TEST_F(FifoBenchmarkTest, ReplaysAllFrames)
+{
+  std::unique_ptr<FifoDataFile> file = MakeLog(3, 20);
+  const FifoBenchmark::Result result = FifoBenchmark::Run(file.get(), 2);
+
+  EXPECT_EQ("Software Renderer", result.backend);
+  EXPECT_EQ(2u, result.loops);
+  EXPECT_EQ(6u, result.frames);
+  EXPECT_EQ(6u, result.swaps);
+  EXPECT_EQ(2 * (file->GetFrame(0).fifoData.size() + file->GetFrame(1).fifoData.size() +
+                 file->GetFrame(2).fifoData.size()),
+            result.fifo_bytes);
+  EXPECT_GT(result.seconds, 0.0);
+
+  const Common::Profiler::Result* frames = FindStage(result, "FifoBenchmark::Frame");
+  ASSERT_NE(nullptr, frames);
+  EXPECT_EQ(6u, frames->calls);
+  EXPECT_LE(frames->usecs_min, frames->usecs_max);
+  // Both draws of every frame, the display list is in memory before it is called
+  const Common::Profiler::Result* vertices =
+      FindStage(result, "VertexLoaderManager::ConvertVertices");
+  ASSERT_NE(nullptr, vertices);
+  EXPECT_EQ(12u, vertices->calls);
+  EXPECT_NE(nullptr, FindStage(result, "VertexManager::Flush"));
+  EXPECT_NE(nullptr, FindStage(result, "Renderer::Swap"));
+
+  // The profiler is only on during the replay
+  EXPECT_FALSE(Common::Profiler::IsEnabled());
+}
+
+TEST_F(FifoBenchmarkTest, WritesJSON)
+{
+  std::unique_ptr<FifoDataFile> file = MakeLog(1, 10);
+  FifoBenchmark::Result result = FifoBenchmark::Run(file.get(), 1);
+  result.log = "synthetic.dff";
+  const std::string json = FifoBenchmark::ToJSON({result});
+
+  EXPECT_EQ('[', json.front());
+  EXPECT_NE(std::string::npos, json.find("\"log\": \"synthetic.dff\""));
+  EXPECT_NE(std::string::npos, json.find("\"backend\": \"Software Renderer\""));
+  EXPECT_NE(std::string::npos, json.find("\"frames\": 1"));
+  EXPECT_NE(std::string::npos, json.find("\"fps\": "));
+  EXPECT_NE(std::string::npos, json.find("\"name\": \"FifoBenchmark::Frame\""));
+  EXPECT_NE(std::string::npos, json.find("\"per_frame_us\": "));
+}
+
+// Frames per second of the whole pipeline of the software renderer, ReplaysAllFrames covers the
+// replay itself
+TEST_F(FifoBenchmarkTest, DISABLED_Benchmark)
+{
+  std::unique_ptr<FifoDataFile> file = MakeLog(10, 500);
+  const FifoBenchmark::Result result = FifoBenchmark::Run(file.get(), 3);
+  printf("[ BENCH    ] Software renderer replay, 1000 triangles per frame: %.2f fps\n",
+         result.GetFramesPerSecond());
+  for (const Common::Profiler::Result& stage : result.stages)
+  {
+    printf("[ BENCH    ]   %-40s %10.3f ms/frame\n", stage.name.c_str(),
+           stage.usecs / 1e3 / result.frames);
+  }
+}
@@ -0,0 +1,189 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>  // NOLINT
+
+#include "Common/CommonTypes.h"
+#include "Common/FileUtil.h"
+#include "Core/FifoPlayer/FifoDataFile.h"
+
+namespace
+{
+constexpr u32 FRAME_COUNT = 4;
+constexpr u32 TEXTURE_SIZE = 64 * 1024;
+
+std::vector<u8> MakeData(size_t size, u32 seed)
+{
+  std::vector<u8> data(size);
+  for (size_t i = 0; i < size; i++)
+    data[i] = static_cast<u8>((i * 7 + seed) ^ (i >> 8));
+  return data;
+}
+
+// Every frame uploads the same texture, unless they are distinct, and a display list of its own
+std::unique_ptr<FifoDataFile> MakeFile(bool distinct_textures = false)
+{
+  auto file = std::make_unique<FifoDataFile>();
+  file->SetIsWii(true);
+  for (u32 i = 0; i < FifoDataFile::BP_MEM_SIZE; i++)
+    file->GetBPMem()[i] = i * 3;
+  file->GetXFRegs()[5] = 0x12345678;
+  file->GetTexMem()[1000] = 0x42;
+
+  for (u32 i = 0; i < FRAME_COUNT; i++)
+  {
+    FifoFrameInfo frame;
+    frame.fifoData = MakeData(1000 + i * 100, i);
+    frame.fifoStart = 0x100000;
+    frame.fifoEnd = 0x200000 + i;
+
+    MemoryUpdate update;
+    update.fifoPosition = 10;
+    update.address = 0x80000;
+    update.data = MakeData(TEXTURE_SIZE, distinct_textures ? 1 + i : 1);
+    update.type = MemoryUpdate::TEXTURE_MAP;
+    frame.memoryUpdates.push_back(update);
+
+    update.fifoPosition = 500;
+    update.address = 0x10000 + i * 0x100;
+    update.data = MakeData(256, 100 + i);
+    update.type = MemoryUpdate::VERTEX_STREAM;
+    frame.memoryUpdates.push_back(update);
+
+    file->AddFrame(frame);
+  }
+  return file;
+}
+
+void ExpectSameFrames(const FifoDataFile& expected, const FifoDataFile& actual)
+{
+  ASSERT_EQ(expected.GetFrameCount(), actual.GetFrameCount());
+  for (u32 i = 0; i < expected.GetFrameCount(); i++)
+  {
+    const FifoFrameInfo expected_frame = expected.GetFrame(i);
+    const FifoFrameInfo actual_frame = actual.GetFrame(i);
+    EXPECT_EQ(expected_frame.fifoData.ToVector(), actual_frame.fifoData.ToVector());
+    EXPECT_EQ(expected_frame.fifoStart, actual_frame.fifoStart);
+    EXPECT_EQ(expected_frame.fifoEnd, actual_frame.fifoEnd);
+    ASSERT_EQ(expected_frame.memoryUpdates.size(), actual_frame.memoryUpdates.size());
+    for (size_t j = 0; j < expected_frame.memoryUpdates.size(); j++)
+    {
+      const MemoryUpdate& expected_update = expected_frame.memoryUpdates[j];
+      const MemoryUpdate& actual_update = actual_frame.memoryUpdates[j];
+      EXPECT_EQ(expected_update.fifoPosition, actual_update.fifoPosition);
+      EXPECT_EQ(expected_update.address, actual_update.address);
+      EXPECT_EQ(expected_update.type, actual_update.type);
+      EXPECT_EQ(expected_update.data.ToVector(), actual_update.data.ToVector());
+    }
+  }
+}
+
+class FifoDataFileTest : public testing::Test
+{
+protected:
+  void SetUp() override { m_dir = File::CreateTempDir(); }
+  void TearDown() override { File::DeleteDirRecursively(m_dir); }
+
+  std::string m_dir;
+};
+}  // namespace
+
+TEST_F(FifoDataFileTest, RoundTrip)
+{
+  const std::unique_ptr<FifoDataFile> file = MakeFile();
+  const std::string path = m_dir + "/log.dff";
+  ASSERT_TRUE(file->Save(path));
+
+  const std::unique_ptr<FifoDataFile> loaded = FifoDataFile::Load(path, false);
+  ASSERT_NE(nullptr, loaded);
+  EXPECT_TRUE(loaded->GetIsWii());
+  EXPECT_EQ(3u * 7, loaded->GetBPMem()[7]);
+  EXPECT_EQ(0x12345678u, loaded->GetXFRegs()[5]);
+  EXPECT_EQ(0x42, loaded->GetTexMem()[1000]);
+  ExpectSameFrames(*file, *loaded);
+
+  // Saving a loaded file writes the same file
+  const std::string copy_path = m_dir + "/copy.dff";
+  ASSERT_TRUE(loaded->Save(copy_path));
+  std::string original, copy;
+  ASSERT_TRUE(File::ReadFileToString(path, original));
+  ASSERT_TRUE(File::ReadFileToString(copy_path, copy));
+  EXPECT_EQ(original, copy);
+}
+
+TEST_F(FifoDataFileTest, CompressedRoundTrip)
+{
+  const std::unique_ptr<FifoDataFile> file = MakeFile();
+  const std::string path = m_dir + "/log.dff";
+  const std::string compressed_path = m_dir + "/compressed.dff";
+  ASSERT_TRUE(file->Save(path));
+  ASSERT_TRUE(file->Save(compressed_path, true));
+  EXPECT_LT(File::GetSize(compressed_path), File::GetSize(path));
+
+  const std::unique_ptr<FifoDataFile> loaded = FifoDataFile::Load(compressed_path, false);
+  ASSERT_NE(nullptr, loaded);
+  EXPECT_EQ(0x42, loaded->GetTexMem()[1000]);
+  ExpectSameFrames(*file, *loaded);
+}
+
+TEST_F(FifoDataFileTest, IdenticalMemoryUpdatesAreStoredOnce)
+{
+  const std::string path = m_dir + "/log.dff";
+  const std::string distinct_path = m_dir + "/distinct.dff";
+  ASSERT_TRUE(MakeFile()->Save(path));
+  ASSERT_TRUE(MakeFile(true)->Save(distinct_path));
+  EXPECT_EQ((FRAME_COUNT - 1) * TEXTURE_SIZE, File::GetSize(distinct_path) - File::GetSize(path));
+
+  // The updates of the loaded file are views of the same bytes in the file
+  const std::unique_ptr<FifoDataFile> loaded = FifoDataFile::Load(path, false);
+  ASSERT_NE(nullptr, loaded);
+  const u8* texture = loaded->GetFrame(0).memoryUpdates[0].data.data();
+  for (u32 i = 1; i < loaded->GetFrameCount(); i++)
+    EXPECT_EQ(texture, loaded->GetFrame(i).memoryUpdates[0].data.data());
+  // Data that differs between the frames isn't shared
+  for (u32 i = 1; i < loaded->GetFrameCount(); i++)
+  {
+    EXPECT_NE(loaded->GetFrame(0).fifoData.data(), loaded->GetFrame(i).fifoData.data());
+    EXPECT_NE(loaded->GetFrame(0).memoryUpdates[1].data.data(),
+              loaded->GetFrame(i).memoryUpdates[1].data.data());
+  }
+}
+
+TEST_F(FifoDataFileTest, AddFrameToLoadedFile)
+{
+  const std::string path = m_dir + "/log.dff";
+  ASSERT_TRUE(MakeFile()->Save(path));
+  const std::unique_ptr<FifoDataFile> loaded = FifoDataFile::Load(path, false);
+  ASSERT_NE(nullptr, loaded);
+
+  FifoFrameInfo frame;
+  frame.fifoData = MakeData(16, 5);
+  frame.fifoStart = 1;
+  frame.fifoEnd = 2;
+  loaded->AddFrame(frame);
+
+  ASSERT_EQ(FRAME_COUNT + 1, loaded->GetFrameCount());
+  const FifoFrameInfo last = loaded->GetFrame(FRAME_COUNT);
+  EXPECT_EQ(MakeData(16, 5), last.fifoData.ToVector());
+  EXPECT_EQ(1u, last.fifoStart);
+  EXPECT_EQ(MakeData(1300, 3), loaded->GetFrame(FRAME_COUNT - 1).fifoData.ToVector());
+}
+
+TEST_F(FifoDataFileTest, RejectsTruncatedFiles)
+{
+  const std::string path = m_dir + "/log.dff";
+  ASSERT_TRUE(MakeFile()->Save(path));
+  std::string data;
+  ASSERT_TRUE(File::ReadFileToString(path, data));
+
+  const std::string truncated_path = m_dir + "/truncated.dff";
+  ASSERT_TRUE(File::WriteStringToFile(data.substr(0, data.size() - 100), truncated_path));
+  EXPECT_EQ(nullptr, FifoDataFile::Load(truncated_path, false));
+  ASSERT_TRUE(File::WriteStringToFile(data.substr(0, 64), truncated_path));
+  EXPECT_EQ(nullptr, FifoDataFile::Load(truncated_path, false));
+}
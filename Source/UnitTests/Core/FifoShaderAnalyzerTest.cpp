@@ -0,0 +1,172 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>  // NOLINT
+
+#include "Common/CommonTypes.h"
+#include "Core/FifoPlayer/FifoShaderAnalyzer.h"
+#include "UnitTests/CommandWriter.h"
+#include "VideoCommon/BPMemory.h"
+#include "VideoCommon/CPMemory.h"
+#include "VideoCommon/OpcodeDecoding.h"
+#include "VideoCommon/VertexLoaderBase.h"
+#include "VideoCommon/XFMemory.h"
+
+namespace
+{
+// The vertex data is zeros, only its size matters to the analyzer
+void Draw(CommandWriter& writer, u8 vat, u16 vertex_count, u32 vertex_size)
+{
+  writer.BeginDraw(OpcodeDecoder::GX_DRAW_TRIANGLES, vat, vertex_count);
+  for (u32 i = 0; i < vertex_count * vertex_size; ++i)
+    writer.Write8(0);
+}
+
+class FifoShaderAnalyzerTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    std::memset(&m_vtx_desc, 0, sizeof(m_vtx_desc));
+    std::memset(&m_vtx_attr, 0, sizeof(m_vtx_attr));
+    // Three float position coordinates, 12 bytes per vertex
+    m_vtx_desc.Position = DIRECT;
+    m_vtx_attr.g0.PosElements = 1;
+    m_vtx_attr.g0.PosFormat = FORMAT_FLOAT;
+  }
+
+  TVtxDesc m_vtx_desc;
+  VAT m_vtx_attr;
+};
+}  // namespace
+
+TEST_F(FifoShaderAnalyzerTest, CollectsShadersOfDraws)
+{
+  CommandWriter writer;
+  writer.SetVertexFormat(m_vtx_desc, m_vtx_attr, 0);
+  Draw(writer, 0, 3, 12);
+  // Same state, no new shaders
+  writer.Nop();
+  Draw(writer, 0, 6, 12);
+  // Draws without vertices are ignored
+  Draw(writer, 0, 0, 12);
+  writer.LoadXFReg(XFMEM_SETNUMTEXGENS, 1);
+  Draw(writer, 0, 3, 12);
+
+  FifoShaderAnalyzer analyzer(true);
+  ASSERT_TRUE(analyzer.AnalyzeCommands(writer.GetData().data(), writer.GetSize()));
+  EXPECT_EQ(3u, analyzer.GetDrawCount());
+  EXPECT_EQ(2u, analyzer.GetVertexShaderUids().size());
+  // The pixel shaders take the texgen count from BP, not XF
+  EXPECT_EQ(1u, analyzer.GetPixelShaderUids().size());
+  // Triangles need no geometry shader
+  EXPECT_TRUE(analyzer.GetGeometryShaderUids().empty());
+}
+
+TEST_F(FifoShaderAnalyzerTest, ComponentsMatchVertexLoader)
+{
+  m_vtx_desc.PosMatIdx = 1;
+  m_vtx_desc.Tex1MatIdx = 1;
+  m_vtx_desc.Normal = INDEX8;
+  m_vtx_desc.Color0 = DIRECT;
+  m_vtx_desc.Tex0Coord = INDEX16;
+  m_vtx_attr.g0.NormalElements = 1;
+  m_vtx_attr.g0.NormalFormat = FORMAT_BYTE;
+  m_vtx_attr.g0.Color0Comp = FORMAT_32B_8888;
+  m_vtx_attr.g0.Tex0CoordElements = 1;
+  m_vtx_attr.g0.Tex0CoordFormat = FORMAT_SHORT;
+
+  std::unique_ptr<VertexLoaderBase> loader =
+      VertexLoaderBase::CreateVertexLoader(m_vtx_desc, m_vtx_attr);
+
+  CommandWriter writer;
+  writer.SetVertexFormat(m_vtx_desc, m_vtx_attr, 3);
+  Draw(writer, 3, 3, loader->m_VertexSize);
+
+  FifoShaderAnalyzer analyzer(true);
+  ASSERT_TRUE(analyzer.AnalyzeCommands(writer.GetData().data(), writer.GetSize()));
+  EXPECT_EQ(1u, analyzer.GetDrawCount());
+  ASSERT_EQ(1u, analyzer.GetVertexShaderUids().size());
+  EXPECT_EQ(loader->m_native_components,
+            analyzer.GetVertexShaderUids().begin()->GetUidData().components);
+}
+
+TEST_F(FifoShaderAnalyzerTest, DestinationAlpha)
+{
+  BlendMode blend_mode;
+  blend_mode.hex = 0;
+  blend_mode.alphaupdate = 1;
+  ConstantAlpha dst_alpha;
+  dst_alpha.hex = 0;
+  dst_alpha.enable = 1;
+  PEControl pe_control;
+  pe_control.hex = 0;
+  pe_control.pixel_format = PEControl::RGBA6_Z24;
+
+  CommandWriter writer;
+  writer.SetVertexFormat(m_vtx_desc, m_vtx_attr, 0);
+  writer.LoadBPReg(BPMEM_BLENDMODE, blend_mode.hex);
+  writer.LoadBPReg(BPMEM_CONSTANTALPHA, dst_alpha.hex);
+  writer.LoadBPReg(BPMEM_ZCOMPARE, pe_control.hex);
+  Draw(writer, 0, 3, 12);
+
+  // A single pass with dual source blending
+  FifoShaderAnalyzer dual_source(true);
+  ASSERT_TRUE(dual_source.AnalyzeCommands(writer.GetData().data(), writer.GetSize()));
+  EXPECT_EQ(1u, dual_source.GetPixelShaderUids().size());
+
+  // Otherwise the alpha is written in a second pass
+  FifoShaderAnalyzer alpha_pass(false);
+  ASSERT_TRUE(alpha_pass.AnalyzeCommands(writer.GetData().data(), writer.GetSize()));
+  EXPECT_EQ(2u, alpha_pass.GetPixelShaderUids().size());
+}
+
+TEST_F(FifoShaderAnalyzerTest, MaskedBPWrite)
+{
+  ConstantAlpha dst_alpha;
+  dst_alpha.hex = 0;
+  dst_alpha.enable = 1;
+  BlendMode blend_mode;
+  blend_mode.hex = 0;
+  blend_mode.alphaupdate = 1;
+  PEControl pe_control;
+  pe_control.hex = 0;
+  pe_control.pixel_format = PEControl::RGBA6_Z24;
+
+  CommandWriter writer;
+  writer.SetVertexFormat(m_vtx_desc, m_vtx_attr, 0);
+  writer.LoadBPReg(BPMEM_BLENDMODE, blend_mode.hex);
+  writer.LoadBPReg(BPMEM_ZCOMPARE, pe_control.hex);
+  // The mask only lets the alpha value through, destination alpha stays disabled
+  writer.LoadBPReg(BPMEM_BP_MASK, 0xFF);
+  writer.LoadBPReg(BPMEM_CONSTANTALPHA, dst_alpha.hex);
+  Draw(writer, 0, 3, 12);
+
+  FifoShaderAnalyzer analyzer(false);
+  ASSERT_TRUE(analyzer.AnalyzeCommands(writer.GetData().data(), writer.GetSize()));
+  EXPECT_EQ(1u, analyzer.GetPixelShaderUids().size());
+}
+
+TEST_F(FifoShaderAnalyzerTest, InvalidCommands)
+{
+  CommandWriter writer;
+  writer.SetVertexFormat(m_vtx_desc, m_vtx_attr, 0);
+  Draw(writer, 0, 3, 12);
+
+  // The vertex data of the draw is cut off
+  FifoShaderAnalyzer truncated(true);
+  EXPECT_FALSE(truncated.AnalyzeCommands(writer.GetData().data(), writer.GetSize() - 1));
+
+  // A CP write without its value
+  FifoShaderAnalyzer truncated_cp(true);
+  EXPECT_FALSE(truncated_cp.AnalyzeCommands(writer.GetData().data(), 3));
+
+  const u8 unknown[] = {0x01};
+  FifoShaderAnalyzer unknown_opcode(true);
+  EXPECT_FALSE(unknown_opcode.AnalyzeCommands(unknown, sizeof(unknown)));
+}
@@ -43,6 +43,10 @@ bool Host_UIHasFocus()
 {
   return false;
 }
+bool Host_UINeedsControllerState()
+{
+  return false;
+}
 bool Host_RendererHasFocus()
 {
   return false;
@@ -63,6 +67,9 @@ void Host_ShowVideoConfig(void*, const std::string&)
 void Host_YieldToUI()
 {
 }
+void Host_UpdateProgressDialog(const char*, int, int)
+{
+}
 std::unique_ptr<cInterfaceBase> HostGL_CreateGLInterface()
 {
   return nullptr;
@@ -0,0 +1,197 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>  // NOLINT
+
+#include "Common/Config/Config.h"
+#include "Common/CommonTypes.h"
+#include "Common/FileUtil.h"
+#include "Core/Config/GraphicsSettings.h"
+#include "Core/ConfigManager.h"
+#include "Core/CoreTiming.h"
+#include "Core/HW/Memmap.h"
+#include "UICommon/UICommon.h"
+#include "VideoCommon/CommandProcessor.h"
+#include "VideoCommon/Fifo.h"
+#include "VideoCommon/VideoBackendBase.h"
+
+namespace
+{
+constexpr u32 FIFO_BASE = 0x00100000;
+constexpr u32 FIFO_END = FIFO_BASE + 0x10000 - 32;
+
+SCPFifoStruct MakeFifo(u32 read_offset, u32 distance)
+{
+  SCPFifoStruct fifo;
+  memset(&fifo, 0, sizeof(fifo));
+  fifo.CPBase = FIFO_BASE;
+  fifo.CPEnd = FIFO_END;
+  fifo.CPReadPointer = FIFO_BASE + read_offset;
+  fifo.CPReadWriteDistance = distance;
+  fifo.CPWritePointer = FIFO_BASE + (read_offset + distance) % 0x10000;
+  return fifo;
+}
+
+// Runs the dual core GPU loop with the preprocessing thread on the headless software renderer
+class FifoGpuLoopTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    m_user_directory = File::CreateTempDir();
+    UICommon::SetUserDirectory(m_user_directory);
+    UICommon::Init();
+    SConfig::GetInstance().bCPUThread = true;
+    SConfig::GetInstance().bSyncGPU = false;
+    Config::SetCurrent(Config::GFX_HACK_FIFO_PREPROCESS_THREAD, true);
+
+    // Only NOPs in the FIFO
+    m_ram.assign(Memory::RAM_SIZE, 0);
+    Memory::m_pRAM = m_ram.data();
+
+    VideoBackendBase::ActivateHeadlessBackend();
+    ASSERT_TRUE(g_video_backend->Initialize(nullptr));
+    g_video_backend->Video_Prepare();
+    ASSERT_TRUE(Fifo::UsePreprocessThread());
+
+    SCPFifoStruct& fifo = CommandProcessor::fifo;
+    fifo.CPBase = FIFO_BASE;
+    fifo.CPEnd = FIFO_END;
+    SetReadPointer(FIFO_BASE);
+    fifo.bFF_GPReadEnable = 1;
+
+    Fifo::EmulatorState(true);
+    m_gpu_thread = std::thread(Fifo::RunGpuLoop);
+  }
+
+  void TearDown() override
+  {
+    if (m_gpu_thread.joinable())
+    {
+      Fifo::ExitGpuLoop();
+      m_gpu_thread.join();
+    }
+    if (g_video_backend)
+    {
+      g_video_backend->Video_Cleanup();
+      g_video_backend->Shutdown();
+    }
+    Memory::m_pRAM = nullptr;
+    CoreTiming::Shutdown();
+    UICommon::Shutdown();
+    g_video_backend = nullptr;
+    File::DeleteDirRecursively(m_user_directory);
+  }
+
+  // What the FIFO_READ_POINTER write of the CommandProcessor does
+  static void SetReadPointer(u32 address)
+  {
+    SCPFifoStruct& fifo = CommandProcessor::fifo;
+    fifo.CPReadPointer = address;
+    fifo.SafeCPReadPointer = address;
+    fifo.CPWritePointer = address;
+    fifo.CPReadWriteDistance = 0;
+    Fifo::ResetPreprocessedReadPointer();
+  }
+
+  static void Write(u32 size)
+  {
+    SCPFifoStruct& fifo = CommandProcessor::fifo;
+    fifo.CPWritePointer += size;
+    fifo.CPReadWriteDistance += size;
+  }
+
+  // Lets the threads read what there is and then idle
+  static void RunGpu()
+  {
+    Fifo::RunGpu();
+    Fifo::FlushGpu();
+  }
+
+  std::string m_user_directory;
+  std::vector<u8> m_ram;
+  std::thread m_gpu_thread;
+};
+}  // namespace
+
+TEST(FifoReadBatch, ReadsAvailableDataUpToLimit)
+{
+  EXPECT_EQ(32u, Fifo::GetReadBatchSize(MakeFifo(0, 32), 4096));
+  EXPECT_EQ(1024u, Fifo::GetReadBatchSize(MakeFifo(0x200, 1024), 4096));
+  EXPECT_EQ(4096u, Fifo::GetReadBatchSize(MakeFifo(0x200, 0x8000), 4096));
+  // Partial blocks are left for later, but the GPU always reads at least one block.
+  EXPECT_EQ(96u, Fifo::GetReadBatchSize(MakeFifo(0, 100), 4096));
+  EXPECT_EQ(32u, Fifo::GetReadBatchSize(MakeFifo(0, 16), 4096));
+}
+
+TEST(FifoReadBatch, StopsAtEndOfFifo)
+{
+  // The block at CPEnd is still read, the next one is at CPBase.
+  EXPECT_EQ(64u, Fifo::GetReadBatchSize(MakeFifo(0x10000 - 64, 1024), 4096));
+  EXPECT_EQ(32u, Fifo::GetReadBatchSize(MakeFifo(0x10000 - 32, 1024), 4096));
+
+  // A read pointer outside of the FIFO keeps the old behavior.
+  SCPFifoStruct fifo = MakeFifo(0, 1024);
+  fifo.CPReadPointer = FIFO_END + 64;
+  EXPECT_EQ(32u, Fifo::GetReadBatchSize(fifo, 4096));
+}
+
+TEST(FifoReadBatch, StopsInFrontOfBreakpoint)
+{
+  SCPFifoStruct fifo = MakeFifo(0x100, 2048);
+  fifo.CPBreakpoint = FIFO_BASE + 0x300;
+  EXPECT_EQ(2048u, Fifo::GetReadBatchSize(fifo, 4096));
+
+  fifo.bFF_BPEnable = 1;
+  EXPECT_EQ(0x200u, Fifo::GetReadBatchSize(fifo, 4096));
+
+  // Breakpoints behind the read pointer or past the batch don't matter.
+  fifo.CPBreakpoint = FIFO_BASE + 0x80;
+  EXPECT_EQ(2048u, Fifo::GetReadBatchSize(fifo, 4096));
+  fifo.CPBreakpoint = FIFO_BASE + 0x100 + 2048;
+  EXPECT_EQ(2048u, Fifo::GetReadBatchSize(fifo, 4096));
+}
+
+TEST(FifoReadBatch, StopsWhereLowWatermarkIsCrossed)
+{
+  SCPFifoStruct fifo = MakeFifo(0, 2048);
+  fifo.CPLoWatermark = 1000;
+  EXPECT_EQ(2048u, Fifo::GetReadBatchSize(fifo, 4096));
+
+  // 2048 - 33 * 32 = 992 is the first distance below the watermark.
+  fifo.bFF_LoWatermarkInt = 1;
+  EXPECT_EQ(33u * 32, Fifo::GetReadBatchSize(fifo, 4096));
+
+  fifo.CPLoWatermark = 2048;
+  EXPECT_EQ(32u, Fifo::GetReadBatchSize(fifo, 4096));
+
+  // Already below the watermark, the interrupt has been raised before.
+  fifo.CPLoWatermark = 4096;
+  EXPECT_EQ(2048u, Fifo::GetReadBatchSize(fifo, 4096));
+}
+
+TEST_F(FifoGpuLoopTest, IdleLoopKeepsReadPointer)
+{
+  RunGpu();
+  EXPECT_EQ(FIFO_BASE, CommandProcessor::fifo.SafeCPReadPointer);
+
+  Write(256);
+  RunGpu();
+  EXPECT_EQ(0u, CommandProcessor::fifo.CPReadWriteDistance);
+  EXPECT_EQ(FIFO_BASE + 256, CommandProcessor::fifo.SafeCPReadPointer);
+
+  // The read pointer of the data preprocessed before doesn't apply any more
+  SetReadPointer(FIFO_BASE + 0x1000);
+  RunGpu();
+  EXPECT_EQ(FIFO_BASE + 0x1000, CommandProcessor::fifo.SafeCPReadPointer);
+
+  Write(64);
+  RunGpu();
+  EXPECT_EQ(FIFO_BASE + 0x1040, CommandProcessor::fifo.SafeCPReadPointer);
+}
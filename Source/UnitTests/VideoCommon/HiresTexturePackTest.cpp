@@ -0,0 +1,193 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>  // NOLINT
+
+#include "Common/CommonTypes.h"
+#include "Common/File.h"
+#include "Common/FileUtil.h"
+#include "Common/StringUtil.h"
+#include "VideoCommon/HiresTexturePack.h"
+#include "VideoCommon/TextureUtil.h"
+
+namespace
+{
+std::vector<u8> MakeData(u32 seed, u32 size)
+{
+  std::vector<u8> data(size);
+  for (u32 i = 0; i < size; ++i)
+    data[i] = static_cast<u8>(seed * 31 + i);
+  return data;
+}
+
+// The levels of all maps back to back, like TextureCacheBase::Load reads them
+u32 GetUploadSize(const HiresTexturePack::Texture& texture)
+{
+  u32 size = 0;
+  for (u32 level = 0; level < texture.levels; ++level)
+  {
+    size += TextureUtil::GetTextureSizeInBytes(
+        TextureUtil::CalculateLevelSize(texture.width, level),
+        TextureUtil::CalculateLevelSize(texture.height, level), texture.format);
+  }
+  return size * (1 + (texture.nrm_levels ? 1 : 0) + (texture.lum_levels ? 1 : 0));
+}
+
+std::string MakeName(u32 i)
+{
+  return StringFromFormat("tex1_64x64_%016x_$_14", i * 0x9E3779B9u);
+}
+
+class HiresTexturePackTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    m_directory = File::CreateTempDir();
+    m_filename = m_directory + "/GAME01.texpack";
+  }
+  void TearDown() override { File::DeleteDirRecursively(m_directory); }
+
+  std::string m_directory;
+  std::string m_filename;
+};
+}  // namespace
+
+TEST_F(HiresTexturePackTest, RoundTrip)
+{
+  constexpr u32 NUM_TEXTURES = 100;
+  std::vector<std::vector<u8>> data;
+  {
+    HiresTexturePack::Writer writer;
+    ASSERT_TRUE(writer.Open(m_filename));
+    for (u32 i = 0; i < NUM_TEXTURES; ++i)
+    {
+      HiresTexturePack::Texture texture = {};
+      texture.format = i % 2 ? PC_TEX_FMT_DXT5 : PC_TEX_FMT_RGBA32;
+      texture.width = 64 + i;
+      texture.height = 32;
+      texture.levels = 1 + i % 4;
+      texture.nrm_levels = i % 3 ? texture.levels : 0;
+      texture.lum_levels = i % 5 ? texture.levels : 0;
+      texture.has_arbitrary_mips = i % 7 == 0;
+      // Odd sizes, so the alignment of the following textures is exercised
+      data.push_back(MakeData(i, GetUploadSize(texture) + i % 13));
+      texture.data = data.back().data();
+      texture.size = data.back().size();
+      ASSERT_TRUE(writer.Add(MakeName(i), texture));
+    }
+    ASSERT_TRUE(writer.Finish());
+  }
+
+  HiresTexturePack pack;
+  ASSERT_TRUE(pack.Open(m_filename));
+  EXPECT_EQ(NUM_TEXTURES, pack.GetTextureCount());
+  for (u32 i = 0; i < NUM_TEXTURES; ++i)
+  {
+    HiresTexturePack::Texture texture;
+    ASSERT_TRUE(pack.Find(MakeName(i), &texture));
+    EXPECT_EQ(i % 2 ? PC_TEX_FMT_DXT5 : PC_TEX_FMT_RGBA32, texture.format);
+    EXPECT_EQ(64 + i, texture.width);
+    EXPECT_EQ(32u, texture.height);
+    EXPECT_EQ(1 + i % 4, texture.levels);
+    EXPECT_EQ(i % 3 ? texture.levels : 0, texture.nrm_levels);
+    EXPECT_EQ(i % 5 ? texture.levels : 0, texture.lum_levels);
+    EXPECT_EQ(i % 7 == 0, texture.has_arbitrary_mips);
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(texture.data) % 64);
+    EXPECT_EQ(data[i], std::vector<u8>(texture.data, texture.data + texture.size));
+  }
+}
+
+TEST_F(HiresTexturePackTest, MissingNames)
+{
+  const std::vector<u8> data = MakeData(1, 256);
+  HiresTexturePack::Writer writer;
+  ASSERT_TRUE(writer.Open(m_filename));
+  HiresTexturePack::Texture texture = {PC_TEX_FMT_RGBA32, 8, 8, 1, 0, 0, false, data.data(), 256};
+  ASSERT_TRUE(writer.Add(MakeName(1), texture));
+  ASSERT_TRUE(writer.Finish());
+
+  HiresTexturePack pack;
+  ASSERT_TRUE(pack.Open(m_filename));
+  EXPECT_TRUE(pack.Contains(MakeName(1)));
+  EXPECT_FALSE(pack.Contains(MakeName(2)));
+  EXPECT_FALSE(pack.Contains(MakeName(1).substr(1)));
+  EXPECT_FALSE(pack.Contains(""));
+}
+
+TEST_F(HiresTexturePackTest, EmptyPack)
+{
+  HiresTexturePack::Writer writer;
+  ASSERT_TRUE(writer.Open(m_filename));
+  ASSERT_TRUE(writer.Finish());
+
+  HiresTexturePack pack;
+  ASSERT_TRUE(pack.Open(m_filename));
+  EXPECT_EQ(0u, pack.GetTextureCount());
+  EXPECT_FALSE(pack.Contains(MakeName(0)));
+}
+
+TEST_F(HiresTexturePackTest, RejectsInvalidFiles)
+{
+  HiresTexturePack pack;
+  EXPECT_FALSE(pack.Open(m_filename));
+
+  const std::vector<u8> data = MakeData(1, 256);
+  HiresTexturePack::Writer writer;
+  ASSERT_TRUE(writer.Open(m_filename));
+  HiresTexturePack::Texture texture = {PC_TEX_FMT_RGBA32, 8, 8, 1, 0, 0, false, data.data(), 256};
+  ASSERT_TRUE(writer.Add(MakeName(1), texture));
+  ASSERT_TRUE(writer.Finish());
+
+  // Cut off the names
+  const u64 size = File::GetSize(m_filename);
+  {
+    File::IOFile file(m_filename, "r+b");
+    ASSERT_TRUE(file.Resize(size - 4));
+  }
+  EXPECT_FALSE(pack.Open(m_filename));
+  EXPECT_FALSE(pack.Contains(MakeName(1)));
+
+  File::WriteStringToFile(std::string(64, 'x'), m_filename);
+  EXPECT_FALSE(pack.Open(m_filename));
+}
+
+TEST_F(HiresTexturePackTest, RejectsTruncatedTextures)
+{
+  // Two levels of 8x8 and 4x4 RGBA32 texels, the second one is missing
+  const std::vector<u8> data = MakeData(1, 256);
+  HiresTexturePack::Writer writer;
+  ASSERT_TRUE(writer.Open(m_filename));
+  HiresTexturePack::Texture texture = {PC_TEX_FMT_RGBA32, 8, 8, 2, 0, 0, false, data.data(), 256};
+  ASSERT_TRUE(writer.Add(MakeName(1), texture));
+  ASSERT_TRUE(writer.Finish());
+
+  HiresTexturePack pack;
+  EXPECT_FALSE(pack.Open(m_filename));
+  EXPECT_FALSE(pack.Contains(MakeName(1)));
+}
+
+TEST_F(HiresTexturePackTest, RejectsWrappingOffsets)
+{
+  const std::vector<u8> data = MakeData(1, 256);
+  HiresTexturePack::Writer writer;
+  ASSERT_TRUE(writer.Open(m_filename));
+  HiresTexturePack::Texture texture = {PC_TEX_FMT_RGBA32, 8, 8, 1, 0, 0, false, data.data(), 256};
+  ASSERT_TRUE(writer.Add(MakeName(1), texture));
+  ASSERT_TRUE(writer.Finish());
+
+  // names_offset, the name is the last thing in the file
+  const u64 offset = ~u64(0) - 16;
+  {
+    File::IOFile file(m_filename, "r+b");
+    ASSERT_TRUE(file.Seek(24, SEEK_SET));
+    ASSERT_TRUE(file.WriteBytes(&offset, sizeof(offset)));
+  }
+  HiresTexturePack pack;
+  EXPECT_FALSE(pack.Open(m_filename));
+  EXPECT_FALSE(pack.Contains(MakeName(1)));
+}
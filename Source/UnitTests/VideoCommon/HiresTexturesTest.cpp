@@ -0,0 +1,130 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>  // NOLINT
+
+#include "Common/CommonPaths.h"
+#include "Common/CommonTypes.h"
+#include "Common/FileUtil.h"
+#include "Common/StringUtil.h"
+#include "Core/ConfigManager.h"
+#include "UICommon/UICommon.h"
+#include "VideoCommon/HiresTextures.h"
+#include "VideoCommon/ImageWrite.h"
+#include "VideoCommon/VideoConfig.h"
+
+namespace
+{
+constexpr u32 NUM_TEXTURES = 5;
+constexpr u32 TEXTURE_SIZE = 8;
+constexpr size_t TEXTURE_BYTES = TEXTURE_SIZE * TEXTURE_SIZE * 4;
+
+std::string MakeName(u32 i)
+{
+  return StringFromFormat("tex1_%ux%u_%016x_14", TEXTURE_SIZE, TEXTURE_SIZE, i * 0x9E3779B9u);
+}
+
+std::vector<u8> MakePixels(u32 i)
+{
+  std::vector<u8> pixels(TEXTURE_BYTES);
+  for (size_t j = 0; j < pixels.size(); ++j)
+    pixels[j] = j % 4 == 3 ? 0xff : static_cast<u8>(i * 31 + j);
+  return pixels;
+}
+
+class HiresTexturesTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    m_user_directory = File::CreateTempDir();
+    UICommon::SetUserDirectory(m_user_directory);
+    UICommon::Init();
+
+    File::CreateFullPath(GetDirectory());
+    for (u32 i = 0; i < NUM_TEXTURES; ++i)
+    {
+      ASSERT_TRUE(TextureToPng(MakePixels(i).data(), TEXTURE_SIZE * 4, GetPath(i), TEXTURE_SIZE,
+                               TEXTURE_SIZE, true));
+    }
+
+    g_ActiveConfig.bHiresTextures = true;
+    g_ActiveConfig.bCacheHiresTextures = true;
+    g_ActiveConfig.bWaitForCacheHiresTextures = true;
+    g_ActiveConfig.bHiresMaterialMaps = false;
+    HiresTexture::Init();
+  }
+
+  void TearDown() override
+  {
+    HiresTexture::Shutdown();
+    UICommon::Shutdown();
+    File::DeleteDirRecursively(m_user_directory);
+  }
+
+  // Without a running game the textures of the default game ID are used
+  static std::string GetDirectory()
+  {
+    return File::GetUserPath(D_HIRESTEXTURES_IDX) + SConfig::GetInstance().GetGameID() + DIR_SEP;
+  }
+
+  static std::string GetPath(u32 i) { return GetDirectory() + MakeName(i) + ".png"; }
+
+  // Once the files are gone, only textures held in memory can be found
+  void DeleteFiles()
+  {
+    for (u32 i = 0; i < NUM_TEXTURES; ++i)
+      ASSERT_TRUE(File::Delete(GetPath(i)));
+  }
+
+  static bool IsCached(u32 i)
+  {
+    std::vector<u8> buffer;
+    const std::shared_ptr<HiresTexture> texture =
+        HiresTexture::Search(MakeName(i), [&buffer](size_t size) {
+          buffer.resize(size);
+          return buffer.data();
+        });
+    if (!texture)
+      return false;
+    EXPECT_EQ(TEXTURE_SIZE, texture->m_width);
+    EXPECT_EQ(PC_TEX_FMT_RGBA32, texture->m_format);
+    EXPECT_EQ(MakePixels(i), buffer);
+    return true;
+  }
+
+  std::string m_user_directory;
+};
+}  // namespace
+
+TEST_F(HiresTexturesTest, PrefetchedTexturesAreServedFromMemory)
+{
+  DeleteFiles();
+  for (u32 i = 0; i < NUM_TEXTURES; ++i)
+    EXPECT_TRUE(IsCached(i)) << "texture " << i;
+}
+
+TEST_F(HiresTexturesTest, EvictsLeastRecentlyUsed)
+{
+  DeleteFiles();
+  EXPECT_TRUE(IsCached(3));
+  EXPECT_TRUE(IsCached(1));
+
+  // Room for two textures, the ones that were only prefetched go first
+  HiresTexture::SetMemoryBudget(TEXTURE_BYTES * 2 + TEXTURE_BYTES / 4);
+  EXPECT_FALSE(IsCached(0));
+  EXPECT_FALSE(IsCached(2));
+  EXPECT_FALSE(IsCached(4));
+  EXPECT_TRUE(IsCached(3));
+  EXPECT_TRUE(IsCached(1));
+
+  // Then the least recently used one
+  HiresTexture::SetMemoryBudget(TEXTURE_BYTES + TEXTURE_BYTES / 4);
+  EXPECT_FALSE(IsCached(3));
+  EXPECT_TRUE(IsCached(1));
+}
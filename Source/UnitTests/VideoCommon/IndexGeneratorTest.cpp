@@ -0,0 +1,340 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include <gtest/gtest.h>  // NOLINT
+
+#include "Common/CommonTypes.h"
+#include "VideoCommon/IndexGenerator.h"
+#include "VideoCommon/OpcodeDecoding.h"
+#include "VideoCommon/VideoConfig.h"
+
+namespace
+{
+typedef std::array<u32, 3> Triangle;
+
+constexpr std::array<int, 8> ALL_PRIMITIVES = {{
+    OpcodeDecoder::GX_DRAW_QUADS, OpcodeDecoder::GX_DRAW_QUADS_2, OpcodeDecoder::GX_DRAW_TRIANGLES,
+    OpcodeDecoder::GX_DRAW_TRIANGLE_STRIP, OpcodeDecoder::GX_DRAW_TRIANGLE_FAN,
+    OpcodeDecoder::GX_DRAW_LINES, OpcodeDecoder::GX_DRAW_LINE_STRIP, OpcodeDecoder::GX_DRAW_POINTS,
+}};
+
+bool IsTriangles(int primitive)
+{
+  return primitive < static_cast<int>(OpcodeDecoder::GX_DRAW_LINES);
+}
+
+// The scalar expansion done by the generator before it was vectorized
+void AddReferenceIndices(std::vector<u32>* out, int primitive, u32 index, u32 count)
+{
+  auto triangle = [out](u32 a, u32 b, u32 c) {
+    out->push_back(a);
+    out->push_back(b);
+    out->push_back(c);
+  };
+  const u32 top = index + count;
+  switch (primitive)
+  {
+  case OpcodeDecoder::GX_DRAW_QUADS:
+  case OpcodeDecoder::GX_DRAW_QUADS_2:
+  {
+    u32 i = index + 3;
+    for (; i < top; i += 4)
+    {
+      triangle(i - 3, i - 2, i - 1);
+      triangle(i - 3, i - 1, i);
+    }
+    if (i == top)
+      triangle(top - 3, top - 2, top - 1);
+    break;
+  }
+  case OpcodeDecoder::GX_DRAW_TRIANGLES:
+    for (u32 i = index + 2; i < top; i += 3)
+      triangle(i - 2, i - 1, i);
+    break;
+  case OpcodeDecoder::GX_DRAW_TRIANGLE_STRIP:
+  {
+    u32 wind = 1;
+    for (u32 a = index, i = index + 2; i < top; ++i, ++a)
+    {
+      const u32 b = i - wind;
+      wind ^= 1;
+      triangle(a, b, i - wind);
+    }
+    break;
+  }
+  case OpcodeDecoder::GX_DRAW_TRIANGLE_FAN:
+    for (u32 i = index + 2; i < top; ++i)
+      triangle(index, i - 1, i);
+    break;
+  case OpcodeDecoder::GX_DRAW_LINES:
+    for (u32 i = index + 1; i < top; i += 2)
+    {
+      out->push_back(i - 1);
+      out->push_back(i);
+    }
+    break;
+  case OpcodeDecoder::GX_DRAW_LINE_STRIP:
+    for (u32 i = index + 1; i < top; ++i)
+    {
+      out->push_back(i - 1);
+      out->push_back(i);
+    }
+    break;
+  case OpcodeDecoder::GX_DRAW_POINTS:
+    for (u32 i = index; i < top; ++i)
+      out->push_back(i);
+    break;
+  }
+}
+
+// Rotates the smallest index to the front, this keeps the winding
+Triangle Normalize(Triangle triangle)
+{
+  std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()),
+              triangle.end());
+  return triangle;
+}
+
+std::vector<Triangle> TrianglesFromList(const std::vector<u32>& indices)
+{
+  std::vector<Triangle> triangles;
+  for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    triangles.push_back(Normalize({{indices[i], indices[i + 1], indices[i + 2]}}));
+  return triangles;
+}
+
+// Assembles triangles like the GPU does for strips with primitive restart
+std::vector<Triangle> TrianglesFromStrips(const std::vector<u32>& indices, u32 restart_index)
+{
+  std::vector<Triangle> triangles;
+  size_t start = 0;
+  for (size_t i = 0; i <= indices.size(); ++i)
+  {
+    if (i < indices.size() && indices[i] != restart_index)
+      continue;
+    for (size_t k = start; k + 2 < i; ++k)
+    {
+      if ((k - start) & 1)
+        triangles.push_back(Normalize({{indices[k + 1], indices[k], indices[k + 2]}}));
+      else
+        triangles.push_back(Normalize({{indices[k], indices[k + 1], indices[k + 2]}}));
+    }
+    start = i + 1;
+  }
+  return triangles;
+}
+
+class IndexGeneratorTest : public testing::TestWithParam<std::tuple<bool, bool>>
+{
+protected:
+  void SetUp() override
+  {
+    std::tie(m_use_32bit, m_primitive_restart) = GetParam();
+    m_saved_primitive_restart = g_ActiveConfig.backend_info.bSupportsPrimitiveRestart;
+    g_ActiveConfig.backend_info.bSupportsPrimitiveRestart = m_primitive_restart;
+    // Poison the buffers to catch indices which are not written
+    m_buffer16.assign(BUFFER_SIZE, 0xCDCD);
+    m_buffer32.assign(BUFFER_SIZE, 0xCDCDCDCD);
+    IndexGenerator::Init();
+    Start();
+  }
+
+  void TearDown() override
+  {
+    g_ActiveConfig.backend_info.bSupportsPrimitiveRestart = m_saved_primitive_restart;
+  }
+
+  void Start()
+  {
+    // The small draws only use the start of the buffer
+    std::fill_n(m_buffer16.begin(), 4096, 0xCDCD);
+    std::fill_n(m_buffer32.begin(), 4096, 0xCDCDCDCD);
+    if (m_use_32bit)
+      IndexGenerator::Start(m_buffer32.data());
+    else
+      IndexGenerator::Start(m_buffer16.data());
+  }
+
+  std::vector<u32> GetIndices() const
+  {
+    const u32 len = IndexGenerator::GetIndexLen();
+    if (m_use_32bit)
+      return std::vector<u32>(m_buffer32.begin(), m_buffer32.begin() + len);
+    return std::vector<u32>(m_buffer16.begin(), m_buffer16.begin() + len);
+  }
+
+  u32 RestartIndex() const { return m_use_32bit ? 0xFFFFFFFF : 0xFFFF; }
+
+  // Compares the generated indices with the reference, for triangles only the assembled
+  // triangles have to match when they are written as strips.
+  void ExpectMatchesReference(int primitive, const std::vector<u32>& reference)
+  {
+    const std::vector<u32> indices = GetIndices();
+    if (!m_primitive_restart || !IsTriangles(primitive))
+    {
+      EXPECT_EQ(reference, indices);
+      return;
+    }
+    EXPECT_EQ(TrianglesFromList(reference), TrianglesFromStrips(indices, RestartIndex()));
+  }
+
+  static constexpr size_t BUFFER_SIZE = 1 << 18;
+
+  bool m_use_32bit = false;
+  bool m_primitive_restart = false;
+  bool m_saved_primitive_restart = false;
+  std::vector<u16> m_buffer16;
+  std::vector<u32> m_buffer32;
+};
+}  // namespace
+
+TEST_P(IndexGeneratorTest, MatchesScalarExpansion)
+{
+  for (int primitive : ALL_PRIMITIVES)
+  {
+    // All remainders of the vector blocks, starting at different base indices
+    for (u32 count = 0; count < 100; ++count)
+    {
+      for (u32 offset : {0u, 1u, 7u})
+      {
+        Start();
+        std::vector<u32> reference;
+        IndexGenerator::AddIndices(OpcodeDecoder::GX_DRAW_POINTS, offset);
+        AddReferenceIndices(&reference, OpcodeDecoder::GX_DRAW_POINTS, 0, offset);
+        if (m_primitive_restart && IsTriangles(primitive))
+        {
+          // Points and strips are never batched together
+          Start();
+          reference.clear();
+          IndexGenerator::AddIndices(primitive, offset);
+          AddReferenceIndices(&reference, primitive, 0, offset);
+        }
+
+        IndexGenerator::AddIndices(primitive, count);
+        AddReferenceIndices(&reference, primitive, offset, count);
+        SCOPED_TRACE(testing::Message() << "primitive " << primitive << ", " << count
+                                        << " vertices at " << offset);
+        EXPECT_EQ(offset + count, IndexGenerator::GetNumVerts());
+        ExpectMatchesReference(primitive, reference);
+      }
+    }
+  }
+}
+
+TEST_P(IndexGeneratorTest, LargeBatches)
+{
+  for (int primitive : ALL_PRIMITIVES)
+  {
+    Start();
+    std::vector<u32> reference;
+    u32 index = 0;
+    // Up to the highest index of 16-bit buffers
+    for (u32 count : {65535u / 4, 12345u, 65535u / 4, 7u})
+    {
+      IndexGenerator::AddIndices(primitive, count);
+      AddReferenceIndices(&reference, primitive, index, count);
+      index += count;
+    }
+    SCOPED_TRACE(testing::Message() << "primitive " << primitive);
+    ExpectMatchesReference(primitive, reference);
+    if (!m_use_32bit)
+    {
+      EXPECT_EQ(65534u - index, IndexGenerator::GetRemainingIndices());
+    }
+  }
+}
+
+TEST_P(IndexGeneratorTest, LastTriangle)
+{
+  u32 triangle[3];
+  EXPECT_FALSE(IndexGenerator::GetLastTriangle(triangle));
+
+  for (int primitive : {OpcodeDecoder::GX_DRAW_QUADS, OpcodeDecoder::GX_DRAW_TRIANGLES,
+                        OpcodeDecoder::GX_DRAW_TRIANGLE_STRIP, OpcodeDecoder::GX_DRAW_TRIANGLE_FAN})
+  {
+    for (u32 count : {3u, 4u, 25u, 36u})
+    {
+      Start();
+      std::vector<u32> reference;
+      IndexGenerator::AddIndices(primitive, 5);
+      IndexGenerator::AddIndices(primitive, count);
+      AddReferenceIndices(&reference, primitive, 5, count);
+
+      // The winding of the triangle may differ
+      ASSERT_TRUE(IndexGenerator::GetLastTriangle(triangle));
+      std::sort(triangle, triangle + 3);
+      std::sort(reference.end() - 3, reference.end());
+      EXPECT_TRUE(std::equal(triangle, triangle + 3, reference.end() - 3));
+    }
+  }
+}
+
+TEST_P(IndexGeneratorTest, IndexSize)
+{
+  EXPECT_EQ(m_use_32bit, IndexGenerator::Uses32BitIndices());
+  EXPECT_EQ(m_primitive_restart, IndexGenerator::UsesPrimitiveRestart());
+  IndexGenerator::AddIndices(OpcodeDecoder::GX_DRAW_POINTS, 1000);
+  // The restart index can't be used by a vertex
+  if (m_use_32bit)
+    EXPECT_EQ(0xFFFFFFFEu - 1000, IndexGenerator::GetRemainingIndices());
+  else
+    EXPECT_EQ(0xFFFEu - 1000, IndexGenerator::GetRemainingIndices());
+}
+
+INSTANTIATE_TEST_CASE_P(IndexModes, IndexGeneratorTest,
+                        testing::Combine(testing::Bool(), testing::Bool()));
+
+// Only prints the numbers, run it with --gtest_also_run_disabled_tests.
+TEST(IndexGeneratorBenchmark, DISABLED_Throughput)
+{
+  constexpr u32 VERTICES_PER_DRAW = 60000;
+  constexpr int ITERATIONS = 200;
+  std::vector<u16> buffer16(VERTICES_PER_DRAW * 3);
+  std::vector<u32> buffer32(buffer16.size());
+  std::vector<u32> reference;
+  reference.reserve(buffer16.size());
+  IndexGenerator::Init();
+
+  const bool saved_primitive_restart = g_ActiveConfig.backend_info.bSupportsPrimitiveRestart;
+  for (int primitive : {OpcodeDecoder::GX_DRAW_QUADS, OpcodeDecoder::GX_DRAW_TRIANGLES,
+                        OpcodeDecoder::GX_DRAW_TRIANGLE_STRIP, OpcodeDecoder::GX_DRAW_TRIANGLE_FAN})
+  {
+    auto measure = [&](auto&& generate) {
+      const auto start = std::chrono::high_resolution_clock::now();
+      for (int i = 0; i < ITERATIONS; ++i)
+        generate();
+      const auto end = std::chrono::high_resolution_clock::now();
+      return std::chrono::duration<double>(end - start).count();
+    };
+
+    const double scalar = measure([&] {
+      reference.clear();
+      AddReferenceIndices(&reference, primitive, 0, VERTICES_PER_DRAW);
+    });
+    double generated[3];
+    for (int mode = 0; mode < 3; ++mode)
+    {
+      g_ActiveConfig.backend_info.bSupportsPrimitiveRestart = mode == 2;
+      generated[mode] = measure([&] {
+        if (mode == 0)
+          IndexGenerator::Start(buffer16.data());
+        else
+          IndexGenerator::Start(buffer32.data());
+        IndexGenerator::AddIndices(primitive, VERTICES_PER_DRAW);
+      });
+    }
+    const double vertices = double(VERTICES_PER_DRAW) * ITERATIONS / 1000000;
+    printf("[ BENCH    ] primitive %d: scalar %.0f, u16 %.0f, u32 %.0f, u32 restart %.0f "
+           "Mverts/s\n",
+           primitive, vertices / scalar, vertices / generated[0], vertices / generated[1],
+           vertices / generated[2]);
+  }
+  g_ActiveConfig.backend_info.bSupportsPrimitiveRestart = saved_primitive_restart;
+}
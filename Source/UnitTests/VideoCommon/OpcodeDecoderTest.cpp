@@ -0,0 +1,222 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>  // NOLINT
+
+#include "Common/CommonTypes.h"
+#include "Core/FifoPlayer/FifoAnalyzer.h"
+#include "Core/FifoPlayer/FifoDataFile.h"
+#include "Core/HW/Memmap.h"
+#include "UnitTests/CommandWriter.h"
+#include "VideoCommon/BPMemory.h"
+#include "VideoCommon/CPMemory.h"
+#include "VideoCommon/DataReader.h"
+#include "VideoCommon/OpcodeDecoding.h"
+
+namespace
+{
+void SetupPositionFormat(CommandWriter& writer)
+{
+  writer.LoadCPReg(0x50, DIRECT << 9);            // VCD_LO: direct position
+  writer.LoadCPReg(0x60, 0);                      // VCD_HI
+  writer.LoadCPReg(0x70, 1 | FORMAT_FLOAT << 1);  // VAT A 0: XYZ float
+}
+
+// Float XYZ positions with VAT 0 as set up by SetupPositionFormat.
+void Draw(CommandWriter& writer, u8 primitive, u16 vertices)
+{
+  writer.BeginDraw(primitive, 0, vertices);
+  for (int i = 0; i < vertices * 3; i++)
+    writer.WriteFloat(static_cast<float>(i));
+}
+
+// The commands of a typical object: material state, matrices, then the geometry.
+void WriteObject(CommandWriter& writer, int index)
+{
+  writer.LoadBPReg(BPMEM_GENMODE, 0x010010);
+  writer.LoadBPReg(BPMEM_BLENDMODE, 0x0004D3 + (index & 1));
+  writer.LoadBPReg(BPMEM_ZMODE, 0x17);
+  writer.LoadBPReg(BPMEM_SCISSORTL, 0x154154);
+  writer.LoadBPReg(BPMEM_SCISSORBR, 0x3BB3D3);
+  writer.LoadBPReg(BPMEM_SCISSOROFFSET, 0x0AA0AA);
+  writer.LoadBPReg(BPMEM_TEV_COLOR_ENV, 0x08FAFF);
+  writer.LoadBPReg(BPMEM_TEV_ALPHA_ENV, 0x08FFF0);
+  std::vector<u32> matrix(12);
+  for (int i = 0; i < 12; i++)
+    matrix[i] = static_cast<u32>(index * 12 + i);
+  writer.LoadXFRegs(0, matrix);
+  writer.LoadCPReg(0x30, 0);  // matrix index A
+  Draw(writer, OpcodeDecoder::GX_DRAW_TRIANGLES, 36);
+}
+}  // namespace
+
+TEST(OpcodeDecoder, StopsBeforeIncompleteCommands)
+{
+  CommandWriter writer;
+  SetupPositionFormat(writer);
+  const size_t setup_size = writer.GetData().size();
+  std::vector<size_t> boundaries = {setup_size};
+  for (int i = 0; i < 3; i++)
+  {
+    writer.Nop();
+    boundaries.push_back(writer.GetData().size());
+    writer.LoadBPReg(BPMEM_ZMODE, 0x17);
+    boundaries.push_back(writer.GetData().size());
+    writer.LoadXFRegs(0x1009, {1, 2, 3});
+    boundaries.push_back(writer.GetData().size());
+    Draw(writer, OpcodeDecoder::GX_DRAW_QUADS, 4);
+    boundaries.push_back(writer.GetData().size());
+  }
+
+  u8* data = writer.GetData().data();
+  for (size_t size = setup_size; size <= writer.GetData().size(); size++)
+  {
+    DataReader reader(data, data + size);
+    const u8* end = OpcodeDecoder::Run<true, true>(reader, nullptr);
+    // The decoder stops at the last command that is completely in the buffer.
+    size_t expected = setup_size;
+    for (size_t boundary : boundaries)
+    {
+      if (boundary <= size)
+        expected = boundary;
+    }
+    ASSERT_EQ(expected, static_cast<size_t>(end - data)) << "buffer size " << size;
+  }
+}
+
+TEST(OpcodeDecoder, CyclesOfCommands)
+{
+  CommandWriter writer;
+  SetupPositionFormat(writer);
+  writer.Nop();
+  writer.LoadBPReg(BPMEM_ZMODE, 0x17);
+  writer.LoadXFRegs(0x1009, {1, 2, 3});
+  Draw(writer, OpcodeDecoder::GX_DRAW_QUADS, 4);
+
+  u8* data = writer.GetData().data();
+  DataReader reader(data, data + writer.GetData().size());
+  u32 cycles = 0;
+  const u8* end = OpcodeDecoder::Run<true, true>(reader, &cycles);
+  EXPECT_EQ(data + writer.GetData().size(), end);
+  const u32 expected = 3 * OpcodeDecoder::GX_LOAD_CP_REG_CYCLES + OpcodeDecoder::GX_NOP_CYCLES +
+                       OpcodeDecoder::GX_LOAD_BP_REG_CYCLES +
+                       OpcodeDecoder::GX_LOAD_XF_REG_BASE_CYCLES +
+                       3 * OpcodeDecoder::GX_LOAD_XF_REG_TRANSFER_CYCLES +
+                       OpcodeDecoder::GX_NOP_CYCLES + 4 * OpcodeDecoder::GX_DRAW_PRIMITIVES_CYCLES;
+  EXPECT_EQ(expected, cycles);
+}
+
+// Commands per second of the decode pass alone, which parses the commands without running
+// them. Uses a synthetic stream, or the FIFO log in DOLPHIN_FIFO_LOG if it is set. Disabled by
+// default, it only prints the numbers.
+TEST(OpcodeDecoder, DISABLED_DecodeBenchmark)
+{
+  struct Stream
+  {
+    std::vector<u8> data;
+    u64 commands;
+  };
+  std::vector<Stream> streams;
+  std::vector<u8> ram(Memory::RAM_SIZE);
+  std::vector<u8> exram;
+  Memory::m_pRAM = ram.data();
+
+  const char* log_path = std::getenv("DOLPHIN_FIFO_LOG");
+  std::string source = "synthetic stream";
+  if (log_path)
+  {
+    std::unique_ptr<FifoDataFile> file = FifoDataFile::Load(log_path, false);
+    ASSERT_NE(nullptr, file) << log_path;
+    source = log_path;
+    if (file->GetIsWii())
+    {
+      exram.resize(Memory::EXRAM_SIZE);
+      Memory::m_pEXRAM = exram.data();
+    }
+
+    const u32* cp_mem = file->GetCPMem();
+    for (u32 reg : {0x50u, 0x60u})
+    {
+      LoadCPReg<true>(reg, cp_mem[reg]);
+      FifoAnalyzer::LoadCPReg(reg, cp_mem[reg], FifoAnalyzer::s_CpMem);
+    }
+    for (u32 i = 0; i < 8; i++)
+    {
+      for (u32 reg : {0x70 + i, 0x80 + i, 0x90 + i})
+      {
+        LoadCPReg<true>(reg, cp_mem[reg]);
+        FifoAnalyzer::LoadCPReg(reg, cp_mem[reg], FifoAnalyzer::s_CpMem);
+      }
+    }
+
+    for (u32 frame_index = 0; frame_index < file->GetFrameCount(); frame_index++)
+    {
+      const FifoFrameInfo& frame = file->GetFrame(frame_index);
+      // Display lists and arrays have to be in memory, the last version of them is good enough.
+      for (const MemoryUpdate& update : frame.memoryUpdates)
+      {
+        u8* dest = Memory::GetPointer(update.address);
+        if (dest && Memory::GetPointer(update.address + u32(update.data.size()) - 1))
+          std::memcpy(dest, update.data.data(), update.data.size());
+      }
+
+      Stream stream{frame.fifoData.ToVector(), 0};
+      for (u32 offset = 0; offset < stream.data.size();)
+      {
+        const u32 size =
+            FifoAnalyzer::AnalyzeCommand(&stream.data[offset], FifoAnalyzer::DECODE_PLAYBACK);
+        if (size == 0)
+          break;
+        offset += size;
+        stream.commands++;
+      }
+      streams.push_back(std::move(stream));
+    }
+  }
+  else
+  {
+    CommandWriter writer;
+    SetupPositionFormat(writer);
+    for (int i = 0; i < 2000; i++)
+      WriteObject(writer, i);
+    streams.push_back({writer.GetData(), writer.GetCommandCount()});
+  }
+
+  u64 bytes = 0;
+  u64 commands = 0;
+  for (const Stream& stream : streams)
+  {
+    bytes += stream.data.size();
+    commands += stream.commands;
+  }
+  ASSERT_GT(commands, 0u);
+
+  constexpr int RUNS = 20;
+  const auto start = std::chrono::steady_clock::now();
+  for (int run = 0; run < RUNS; run++)
+  {
+    for (Stream& stream : streams)
+    {
+      DataReader reader(stream.data.data(), stream.data.data() + stream.data.size());
+      OpcodeDecoder::Run<true, true>(reader, nullptr);
+    }
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  printf("[ BENCH    ] Decode pass, %s: %llu commands in %llu bytes, %.2f M commands/s, "
+         "%.1f MB/s\n",
+         source.c_str(), static_cast<unsigned long long>(commands),
+         static_cast<unsigned long long>(bytes), commands * RUNS / elapsed.count() / 1e6,
+         bytes * RUNS / elapsed.count() / 1e6);
+
+  Memory::m_pRAM = nullptr;
+  Memory::m_pEXRAM = nullptr;
+}
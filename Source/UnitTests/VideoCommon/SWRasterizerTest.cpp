@@ -0,0 +1,261 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>  // NOLINT
+
+#include "Common/CommonTypes.h"
+#include "Common/ThreadPool.h"
+#include "Core/HW/Memmap.h"
+#include "VideoBackends/Software/EfbInterface.h"
+#include "VideoBackends/Software/NativeVertexFormat.h"
+#include "VideoBackends/Software/Rasterizer.h"
+#include "VideoCommon/BPMemory.h"
+#include "VideoCommon/BoundingBox.h"
+#include "VideoCommon/Statistics.h"
+#include "VideoCommon/TextureDecoder.h"
+#include "VideoCommon/VideoCommon.h"
+#include "VideoCommon/VideoConfig.h"
+#include "VideoCommon/XFMemory.h"
+
+namespace
+{
+constexpr u32 TEXTURE_ADDRESS = 0x10000;
+constexpr int TEXTURE_SIZE = 64;
+constexpr size_t EFB_BYTES = EFB_WIDTH * EFB_HEIGHT * 6;
+
+enum class Scene
+{
+  Blended,
+  Textured,
+  EarlyDepth,
+};
+
+struct Frame
+{
+  std::vector<u8> efb;
+  int rasterized_pixels;
+  int tev_pixels_out;
+  u16 bbox[4];
+};
+
+// Draws triangles with the render state of the scene through the software rasterizer
+class SWRasterizerTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    m_ram.assign(Memory::RAM_SIZE, 0);
+    Memory::m_pRAM = m_ram.data();
+    std::mt19937 rng(42);
+    for (int i = 0; i < TEXTURE_SIZE * TEXTURE_SIZE; i++)
+      m_ram[TEXTURE_ADDRESS + i] = static_cast<u8>(rng());
+    m_tiled = g_ActiveConfig.bTiledRasterizer;
+  }
+
+  void TearDown() override
+  {
+    g_ActiveConfig.bTiledRasterizer = m_tiled;
+    Memory::m_pRAM = nullptr;
+  }
+
+  static void SetState(Scene scene)
+  {
+    memset(static_cast<void*>(&bpmem), 0, sizeof(bpmem));
+    memset(static_cast<void*>(&xfmem), 0, sizeof(xfmem));
+
+    // one TEV stage, color = ras * tex or ras, alpha = ras
+    const bool textured = scene == Scene::Textured;
+    bpmem.genMode.numcolchans = 1;
+    bpmem.genMode.numtexgens = textured ? 1 : 0;
+    bpmem.tevorders[0].enable0 = textured;
+    TevStageCombiner::ColorCombiner& cc = bpmem.combiners[0].colorC;
+    cc.a = TEVCOLORARG_ZERO;
+    cc.b = textured ? TEVCOLORARG_RASC : TEVCOLORARG_ZERO;
+    cc.c = textured ? TEVCOLORARG_TEXC : TEVCOLORARG_ZERO;
+    cc.d = textured ? TEVCOLORARG_ZERO : TEVCOLORARG_RASC;
+    cc.clamp = 1;
+    TevStageCombiner::AlphaCombiner& ac = bpmem.combiners[0].alphaC;
+    ac.a = TEVALPHAARG_ZERO;
+    ac.b = TEVALPHAARG_ZERO;
+    ac.c = TEVALPHAARG_ZERO;
+    ac.d = TEVALPHAARG_RASA;
+    ac.clamp = 1;
+
+    if (textured)
+    {
+      FourTexUnits& tex = bpmem.tex[0];
+      tex.texImage0[0].width = TEXTURE_SIZE - 1;
+      tex.texImage0[0].height = TEXTURE_SIZE - 1;
+      tex.texImage0[0].format = GX_TF_I8;
+      tex.texImage3[0].image_base = TEXTURE_ADDRESS >> 5;
+      tex.texMode0[0].mag_filter = 1;
+      tex.texMode0[0].min_filter = 4;
+      tex.texMode1[0].max_lod = 0xFF;
+    }
+
+    bpmem.alpha_test.comp0 = AlphaTest::ALWAYS;
+    bpmem.alpha_test.comp1 = AlphaTest::ALWAYS;
+    bpmem.zcontrol.pixel_format = PEControl::RGB8_Z24;
+    bpmem.zcontrol.early_ztest = scene == Scene::EarlyDepth;
+    bpmem.zmode.testenable = 1;
+    bpmem.zmode.func = ZMode::LEQUAL;
+    bpmem.zmode.updateenable = 1;
+    bpmem.blendmode.blendenable = scene != Scene::EarlyDepth;
+    bpmem.blendmode.srcfactor = BlendMode::SRCALPHA;
+    bpmem.blendmode.dstfactor = BlendMode::INVSRCALPHA;
+    bpmem.blendmode.colorupdate = 1;
+    bpmem.blendmode.alphaupdate = 1;
+
+    // scissor covering the EFB
+    bpmem.scissorOffset.x = 342 / 2;
+    bpmem.scissorOffset.y = 342 / 2;
+    bpmem.scissorTL.x = 342;
+    bpmem.scissorTL.y = 342;
+    bpmem.scissorBR.x = 342 + EFB_WIDTH - 1;
+    bpmem.scissorBR.y = 342 + EFB_HEIGHT - 1;
+
+    Rasterizer::Init();
+    Rasterizer::SetScissor();
+    for (int reg = 0; reg < 4; reg++)
+    {
+      for (int comp = 0; comp < 4; comp++)
+      {
+        Rasterizer::SetTevReg(reg, comp, false, static_cast<s16>(reg * 40 + comp));
+        Rasterizer::SetTevReg(reg, comp, true, 255);
+      }
+    }
+  }
+
+  // Random triangles covering the EFB and a bit around it, all facing the viewer
+  static std::vector<OutputVertexData> MakeTriangles(int count, float max_size)
+  {
+    std::mt19937 rng(count);
+    std::uniform_real_distribution<float> center_x(-20.0f, EFB_WIDTH + 20.0f);
+    std::uniform_real_distribution<float> center_y(-20.0f, EFB_HEIGHT + 20.0f);
+    std::uniform_real_distribution<float> offset(-max_size / 2, max_size / 2);
+    std::uniform_real_distribution<float> depth(0.0f, 16777215.0f);
+    std::uniform_real_distribution<float> texcoord(0.0f, TEXTURE_SIZE * 2.0f);
+    std::vector<OutputVertexData> vertices(count * 3);
+    for (int i = 0; i < count; i++)
+    {
+      const float x = center_x(rng);
+      const float y = center_y(rng);
+      for (int j = 0; j < 3; j++)
+      {
+        OutputVertexData& v = vertices[i * 3 + j];
+        v.screenPosition = Vec3(x + offset(rng), y + offset(rng), depth(rng));
+        v.projectedPosition.w = 1.0f + (rng() % 8) / 4.0f;
+        for (u8& comp : v.color[0])
+          comp = static_cast<u8>(rng());
+        v.texCoords[0] = Vec3(texcoord(rng), texcoord(rng), 1.0f);
+      }
+      OutputVertexData* v = &vertices[i * 3];
+      const float cross = (v[1].screenPosition.x - v[0].screenPosition.x) *
+                              (v[2].screenPosition.y - v[0].screenPosition.y) -
+                          (v[1].screenPosition.y - v[0].screenPosition.y) *
+                              (v[2].screenPosition.x - v[0].screenPosition.x);
+      if (cross > 0)
+        std::swap(v[1], v[2]);
+    }
+    return vertices;
+  }
+
+  static void Draw(std::vector<OutputVertexData>& vertices, int batch_size)
+  {
+    for (size_t i = 0; i < vertices.size(); i += 3)
+    {
+      Rasterizer::DrawTriangleFrontFace(&vertices[i], &vertices[i + 1], &vertices[i + 2]);
+      if ((i / 3 + 1) % batch_size == 0)
+        Rasterizer::Flush();
+    }
+    Rasterizer::Flush();
+  }
+
+  static Frame Render(Scene scene, bool tiled, std::vector<OutputVertexData>& vertices)
+  {
+    g_ActiveConfig.bTiledRasterizer = tiled;
+    SetState(scene);
+    memset(EfbInterface::GetPixelPointer(0, 0, false), 0, EFB_BYTES);
+    memset(&stats.thisFrame, 0, sizeof(stats.thisFrame));
+    BoundingBox::coords[BoundingBox::LEFT] = 0xFFFF;
+    BoundingBox::coords[BoundingBox::RIGHT] = 0;
+    BoundingBox::coords[BoundingBox::TOP] = 0xFFFF;
+    BoundingBox::coords[BoundingBox::BOTTOM] = 0;
+
+    Draw(vertices, 100);
+
+    Frame frame;
+    const u8* efb = EfbInterface::GetPixelPointer(0, 0, false);
+    frame.efb.assign(efb, efb + EFB_BYTES);
+    frame.rasterized_pixels = stats.thisFrame.rasterizedPixels;
+    frame.tev_pixels_out = stats.thisFrame.tevPixelsOut;
+    memcpy(frame.bbox, BoundingBox::coords, sizeof(frame.bbox));
+    return frame;
+  }
+
+  std::vector<u8> m_ram;
+  bool m_tiled;
+};
+}  // namespace
+
+TEST_F(SWRasterizerTest, TilesMatchSerialRasterizer)
+{
+  for (Scene scene : {Scene::Blended, Scene::Textured, Scene::EarlyDepth})
+  {
+    std::vector<OutputVertexData> vertices = MakeTriangles(400, 160.0f);
+    const Frame serial = Render(scene, false, vertices);
+    const Frame tiled = Render(scene, true, vertices);
+
+    EXPECT_GT(serial.rasterized_pixels, 100000);
+    EXPECT_EQ(serial.rasterized_pixels, tiled.rasterized_pixels);
+    EXPECT_EQ(serial.tev_pixels_out, tiled.tev_pixels_out);
+    for (int i = 0; i < 4; i++)
+      EXPECT_EQ(serial.bbox[i], tiled.bbox[i]);
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < EFB_BYTES; i++)
+      mismatches += serial.efb[i] != tiled.efb[i];
+    EXPECT_EQ(0u, mismatches) << "scene " << static_cast<int>(scene);
+  }
+}
+
+TEST_F(SWRasterizerTest, SmallTrianglesOnTileEdges)
+{
+  // Triangles of a few pixels, many of them straddle the tile borders
+  std::vector<OutputVertexData> vertices = MakeTriangles(20000, 6.0f);
+  const Frame serial = Render(Scene::Blended, false, vertices);
+  const Frame tiled = Render(Scene::Blended, true, vertices);
+  EXPECT_EQ(serial.rasterized_pixels, tiled.rasterized_pixels);
+  EXPECT_TRUE(serial.efb == tiled.efb);
+}
+
+// Frames per second of a textured scene, drawn in batches like the vertex manager flushes them.
+// Disabled, it only prints the numbers.
+TEST_F(SWRasterizerTest, DISABLED_Benchmark)
+{
+  constexpr int FRAMES = 5;
+  std::vector<OutputVertexData> vertices = MakeTriangles(3000, 120.0f);
+  double fps[2];
+  for (int tiled = 0; tiled < 2; tiled++)
+  {
+    g_ActiveConfig.bTiledRasterizer = tiled != 0;
+    SetState(Scene::Textured);
+    const auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < FRAMES; frame++)
+      Draw(vertices, 200);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    fps[tiled] = FRAMES / elapsed.count();
+  }
+  printf("[ BENCH    ] SW rasterizer, %d triangles per frame, %zu threads: serial %.2f fps, "
+         "tiled %.2f fps\n",
+         static_cast<int>(vertices.size() / 3), Common::ThreadPool::GetThreadCount(), fps[0],
+         fps[1]);
+}
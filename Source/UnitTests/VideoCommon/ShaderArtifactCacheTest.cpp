@@ -0,0 +1,221 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>  // NOLINT
+
+#include "Common/CommonTypes.h"
+#include "Common/File.h"
+#include "Common/FileUtil.h"
+#include "VideoCommon/ShaderArtifactCache.h"
+
+namespace
+{
+constexpr u16 GENERATOR_VERSION = 3;
+
+std::vector<u8> MakeUid(u32 id)
+{
+  std::vector<u8> uid(40);
+  for (size_t i = 0; i < uid.size(); ++i)
+    uid[i] = static_cast<u8>(id * 17 + i);
+  std::memcpy(uid.data(), &id, sizeof(id));
+  return uid;
+}
+
+ShaderArtifactCache::Key MakeKey(const std::vector<u8>& uid, u32 host_bits = 0x1234,
+                                 ShaderArtifactCache::Stage stage = ShaderArtifactCache::STAGE_PIXEL)
+{
+  ShaderHostConfig host_config;
+  host_config.bits = host_bits;
+  return ShaderArtifactCache::MakeKey(stage, API_VULKAN, GENERATOR_VERSION, uid.data(),
+                                      static_cast<u32>(uid.size()), host_config);
+}
+
+std::string MakeSource(u32 id)
+{
+  return "void main() { /* shader " + std::to_string(id) + " */ }";
+}
+
+std::vector<u32> MakeSPIRV(u32 id)
+{
+  std::vector<u32> spirv(16 + id % 7);
+  for (size_t i = 0; i < spirv.size(); ++i)
+    spirv[i] = id * 1000 + static_cast<u32>(i);
+  return spirv;
+}
+
+void Insert(ShaderArtifactCache& cache, u32 id)
+{
+  const std::vector<u8> uid = MakeUid(id);
+  const std::vector<u32> spirv = MakeSPIRV(id);
+  cache.Insert(MakeKey(uid), uid.data(), static_cast<u32>(uid.size()), MakeSource(id),
+               spirv.data(), spirv.size());
+}
+
+bool Contains(const ShaderArtifactCache& cache, u32 id)
+{
+  const std::vector<u8> uid = MakeUid(id);
+  ShaderArtifactCache::Artifact artifact;
+  if (!cache.Lookup(MakeKey(uid), uid.data(), static_cast<u32>(uid.size()), &artifact))
+    return false;
+  EXPECT_EQ(MakeSource(id), artifact.source);
+  EXPECT_EQ(MakeSPIRV(id), artifact.spirv);
+  return true;
+}
+
+class ShaderArtifactCacheTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    m_directory = File::CreateTempDir();
+    m_filename = m_directory + "/artifacts.cache";
+  }
+  void TearDown() override { File::DeleteDirRecursively(m_directory); }
+
+  std::string m_directory;
+  std::string m_filename;
+};
+}  // namespace
+
+TEST_F(ShaderArtifactCacheTest, InsertAndLookup)
+{
+  ShaderArtifactCache cache;
+  ASSERT_TRUE(cache.Open(m_filename));
+  EXPECT_FALSE(Contains(cache, 1));
+  Insert(cache, 1);
+  Insert(cache, 2);
+  // Inserting again does not add a second record
+  Insert(cache, 1);
+  EXPECT_EQ(2u, cache.GetEntryCount());
+  EXPECT_TRUE(Contains(cache, 1));
+  EXPECT_TRUE(Contains(cache, 2));
+  EXPECT_FALSE(Contains(cache, 3));
+
+  // Records persist and are read back from the mapping
+  cache.Close();
+  ASSERT_TRUE(cache.Open(m_filename));
+  EXPECT_EQ(2u, cache.GetEntryCount());
+  EXPECT_TRUE(Contains(cache, 1));
+  EXPECT_TRUE(Contains(cache, 2));
+}
+
+TEST_F(ShaderArtifactCacheTest, KeyIncludesHostConfigAndStage)
+{
+  ShaderArtifactCache cache;
+  ASSERT_TRUE(cache.Open(m_filename));
+  Insert(cache, 1);
+  const std::vector<u8> uid = MakeUid(1);
+  ShaderArtifactCache::Artifact artifact;
+  EXPECT_FALSE(cache.Lookup(MakeKey(uid, 0x4321), uid.data(), static_cast<u32>(uid.size()),
+                            &artifact));
+  EXPECT_FALSE(cache.Lookup(MakeKey(uid, 0x1234, ShaderArtifactCache::STAGE_VERTEX), uid.data(),
+                            static_cast<u32>(uid.size()), &artifact));
+}
+
+TEST_F(ShaderArtifactCacheTest, HashCollisionDoesNotMatch)
+{
+  ShaderArtifactCache cache;
+  ASSERT_TRUE(cache.Open(m_filename));
+  Insert(cache, 1);
+  // Same key, different uid bytes
+  const std::vector<u8> uid = MakeUid(1);
+  const std::vector<u8> other = MakeUid(2);
+  ShaderArtifactCache::Artifact artifact;
+  EXPECT_FALSE(cache.Lookup(MakeKey(uid), other.data(), static_cast<u32>(other.size()),
+                            &artifact));
+}
+
+TEST_F(ShaderArtifactCacheTest, TornRecordIsSkipped)
+{
+  {
+    ShaderArtifactCache cache;
+    ASSERT_TRUE(cache.Open(m_filename));
+    for (u32 id = 0; id < 4; ++id)
+      Insert(cache, id);
+  }
+
+  // Cut the last record in half, like a crash in the middle of a write
+  const u64 size = File::GetSize(m_filename);
+  {
+    File::IOFile file(m_filename, "r+b");
+    ASSERT_TRUE(file.Resize(size - 40));
+  }
+
+  ShaderArtifactCache cache;
+  ASSERT_TRUE(cache.Open(m_filename));
+  EXPECT_EQ(3u, cache.GetEntryCount());
+  for (u32 id = 0; id < 3; ++id)
+    EXPECT_TRUE(Contains(cache, id));
+  EXPECT_FALSE(Contains(cache, 3));
+
+  // Records appended after the torn one are found again
+  Insert(cache, 3);
+  Insert(cache, 4);
+  cache.Close();
+  ASSERT_TRUE(cache.Open(m_filename));
+  EXPECT_EQ(5u, cache.GetEntryCount());
+  for (u32 id = 0; id < 5; ++id)
+    EXPECT_TRUE(Contains(cache, id));
+}
+
+TEST_F(ShaderArtifactCacheTest, Merge)
+{
+  const std::string other_filename = m_directory + "/other.cache";
+  {
+    ShaderArtifactCache other;
+    ASSERT_TRUE(other.Open(other_filename));
+    for (u32 id = 2; id < 6; ++id)
+      Insert(other, id);
+  }
+
+  ShaderArtifactCache cache;
+  ASSERT_TRUE(cache.Open(m_filename));
+  Insert(cache, 1);
+  Insert(cache, 2);
+  EXPECT_EQ(3, cache.Merge(other_filename));
+  EXPECT_EQ(0, cache.Merge(other_filename));
+  EXPECT_EQ(-1, cache.Merge(m_directory + "/missing.cache"));
+  EXPECT_EQ(5u, cache.GetEntryCount());
+
+  cache.Close();
+  ASSERT_TRUE(cache.Open(m_filename));
+  EXPECT_EQ(5u, cache.GetEntryCount());
+  for (u32 id = 1; id < 6; ++id)
+    EXPECT_TRUE(Contains(cache, id));
+}
+
+TEST_F(ShaderArtifactCacheTest, ConcurrentAccess)
+{
+  ShaderArtifactCache cache;
+  ASSERT_TRUE(cache.Open(m_filename));
+  for (u32 id = 0; id < 64; ++id)
+    Insert(cache, id);
+
+  // Readers of the existing entries race with writers adding new ones
+  constexpr u32 THREADS = 4;
+  std::atomic<u32> misses{0};
+  std::vector<std::thread> threads;
+  for (u32 t = 0; t < THREADS; ++t)
+  {
+    threads.emplace_back([&, t] {
+      for (u32 i = 0; i < 64; ++i)
+      {
+        Insert(cache, 64 + t * 64 + i);
+        if (!Contains(cache, (i * 7 + t) % 64))
+          misses++;
+      }
+    });
+  }
+  for (std::thread& thread : threads)
+    thread.join();
+
+  EXPECT_EQ(0u, misses.load());
+  EXPECT_EQ(64u + THREADS * 64, cache.GetEntryCount());
+}
@@ -0,0 +1,283 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <vector>
+
+#include <gtest/gtest.h>  // NOLINT
+
+#include "Common/CommonTypes.h"
+#include "Common/Timer.h"
+#include "VideoCommon/TextureAddressIndex.h"
+
+namespace
+{
+struct Texture
+{
+  u32 addr;
+  u32 size;
+};
+
+class Random
+{
+public:
+  u32 Next()
+  {
+    m_seed = m_seed * 1664525 + 1013904223;
+    return m_seed >> 8;
+  }
+  u32 Next(u32 max) { return Next() % max; }
+
+private:
+  u32 m_seed = 0x12345678;
+};
+
+// The reference: the node based multimap the texture cache used before, which can only look
+// up textures by their start address.
+class MultimapIndex
+{
+public:
+  void Insert(Texture* texture) { m_map.emplace(texture->addr, texture); }
+  void Erase(Texture* texture)
+  {
+    auto range = m_map.equal_range(texture->addr);
+    for (auto iter = range.first; iter != range.second; ++iter)
+    {
+      if (iter->second == texture)
+      {
+        m_map.erase(iter);
+        return;
+      }
+    }
+  }
+  void FindAt(u32 addr, std::vector<Texture*>* out) const
+  {
+    auto range = m_map.equal_range(addr);
+    for (auto iter = range.first; iter != range.second; ++iter)
+      out->push_back(iter->second);
+  }
+  void FindOverlapping(u32 addr, u32 size, std::vector<Texture*>* out) const
+  {
+    constexpr u32 max_texture_size = 1024 * 1024 * 4;
+    const u32 lower_addr = addr > max_texture_size ? addr - max_texture_size : 0;
+    auto end = m_map.upper_bound(addr + size);
+    for (auto iter = m_map.lower_bound(lower_addr); iter != end; ++iter)
+    {
+      Texture* texture = iter->second;
+      if (texture->addr < addr + size && texture->addr + texture->size > addr)
+        out->push_back(texture);
+    }
+  }
+
+private:
+  std::multimap<u32, Texture*> m_map;
+};
+
+// What the texture cache does with the index: loads look up their address and insert on a
+// miss, EFB copies drop whatever is stored at their address and invalidate all overlapping
+// textures, partial texture updates search for overlapping copies.
+enum class Op : u8
+{
+  Load,
+  Copy,
+  PartialUpdate,
+};
+
+struct TraceEntry
+{
+  Op op;
+  u32 addr;
+  u32 size;
+};
+
+// Traces can be captured from games as text files, one "load|copy|partial <address> <size>"
+// line per operation, and passed in through TEXTURE_ADDRESS_TRACE.
+std::vector<TraceEntry> LoadTrace(const char* path)
+{
+  std::vector<TraceEntry> trace;
+  FILE* file = std::fopen(path, "r");
+  if (!file)
+    return trace;
+  char op[16];
+  u32 addr, size;
+  while (std::fscanf(file, "%15s %x %u", op, &addr, &size) == 3)
+  {
+    const Op type = op[0] == 'c' ? Op::Copy : op[0] == 'p' ? Op::PartialUpdate : Op::Load;
+    trace.push_back({type, addr, size});
+  }
+  std::fclose(file);
+  return trace;
+}
+
+// Without a captured trace, generate one with the usual shape: a working set of a few thousand
+// textures in MEM1 that is mostly hit, some textures streamed in every frame, and a handful of
+// EFB copies per frame to a few fixed addresses.
+std::vector<TraceEntry> GenerateTrace()
+{
+  Random random;
+  std::vector<Texture> working_set(3000);
+  for (Texture& texture : working_set)
+  {
+    texture.addr = random.Next(0x1800000) & ~31u;
+    texture.size = 32u << random.Next(14);
+  }
+  const u32 copy_addresses[] = {0x1000000, 0x1080000, 0x1100000, 0x1200000};
+
+  std::vector<TraceEntry> trace;
+  for (int frame = 0; frame < 300; ++frame)
+  {
+    for (int i = 0; i < 600; ++i)
+    {
+      Texture texture = working_set[random.Next(static_cast<u32>(working_set.size()))];
+      if (random.Next(100) < 3)
+      {
+        texture.addr = random.Next(0x1800000) & ~31u;
+        working_set[random.Next(static_cast<u32>(working_set.size()))] = texture;
+      }
+      trace.push_back({Op::Load, texture.addr, texture.size});
+      if (random.Next(10) == 0)
+        trace.push_back({Op::PartialUpdate, texture.addr, texture.size});
+    }
+    for (u32 addr : copy_addresses)
+      trace.push_back({Op::Copy, addr, 640 * 528 * 2});
+  }
+  return trace;
+}
+
+// Replays the trace and returns a checksum of the query results.
+template <typename Index>
+u64 Replay(Index& index, const std::vector<TraceEntry>& trace, std::vector<Texture>* storage)
+{
+  storage->clear();
+  storage->reserve(trace.size());
+  std::vector<Texture*> results;
+  u64 checksum = 0;
+  for (const TraceEntry& entry : trace)
+  {
+    results.clear();
+    switch (entry.op)
+    {
+    case Op::Load:
+      index.FindAt(entry.addr, &results);
+      if (std::none_of(results.begin(), results.end(),
+                       [&](const Texture* texture) { return texture->size == entry.size; }))
+      {
+        storage->push_back({entry.addr, entry.size});
+        index.Insert(&storage->back());
+      }
+      break;
+    case Op::Copy:
+      index.FindOverlapping(entry.addr, entry.size, &results);
+      for (Texture* texture : results)
+        index.Erase(texture);
+      storage->push_back({entry.addr, entry.size});
+      index.Insert(&storage->back());
+      break;
+    case Op::PartialUpdate:
+      index.FindOverlapping(entry.addr, entry.size, &results);
+      break;
+    }
+    checksum = checksum * 31 + results.size();
+  }
+  return checksum;
+}
+
+class FlatIndex
+{
+public:
+  void Insert(Texture* texture) { m_index.Insert(texture->addr, texture->size, texture); }
+  void Erase(Texture* texture) { m_index.Erase(texture->addr, texture); }
+  void FindAt(u32 addr, std::vector<Texture*>* out) const { m_index.FindAt(addr, out); }
+  void FindOverlapping(u32 addr, u32 size, std::vector<Texture*>* out) const
+  {
+    m_index.FindOverlapping(addr, size, out);
+  }
+
+private:
+  TextureAddressIndex<Texture*> m_index;
+};
+}  // namespace
+
+TEST(TextureAddressIndex, MatchesReference)
+{
+  Random random;
+  std::vector<Texture> textures(2000);
+  for (Texture& texture : textures)
+  {
+    // Narrow address range, so there are plenty of duplicate addresses and overlaps.
+    texture.addr = random.Next(0x40000) & ~31u;
+    texture.size = random.Next(4) == 0 ? random.Next(0x20000) : random.Next(0x800);
+  }
+
+  TextureAddressIndex<Texture*> index;
+  MultimapIndex reference;
+  std::vector<bool> inserted(textures.size());
+  for (int i = 0; i < 20000; ++i)
+  {
+    const u32 n = random.Next(static_cast<u32>(textures.size()));
+    Texture* texture = &textures[n];
+    if (inserted[n])
+    {
+      EXPECT_TRUE(index.Erase(texture->addr, texture));
+      reference.Erase(texture);
+    }
+    else
+    {
+      index.Insert(texture->addr, texture->size, texture);
+      reference.Insert(texture);
+    }
+    inserted[n] = !inserted[n];
+
+    const u32 addr = random.Next(0x48000);
+    const u32 size = random.Next(8) == 0 ? 0 : random.Next(0x4000);
+    std::vector<Texture*> result, expected;
+    index.FindOverlapping(addr, size, &result);
+    reference.FindOverlapping(addr, size, &expected);
+    ASSERT_EQ(expected, result) << "overlapping " << addr << " " << size;
+
+    result.clear();
+    expected.clear();
+    index.FindAt(texture->addr, &result);
+    reference.FindAt(texture->addr, &expected);
+    ASSERT_EQ(expected, result) << "at " << texture->addr;
+  }
+
+  size_t count = std::count(inserted.begin(), inserted.end(), true);
+  EXPECT_EQ(count, index.Size());
+  index.EraseIf([](Texture* texture) { return texture->size < 0x400; });
+  std::vector<Texture*> all;
+  index.GetAll(&all);
+  EXPECT_TRUE(std::all_of(all.begin(), all.end(),
+                          [](const Texture* texture) { return texture->size >= 0x400; }));
+  EXPECT_TRUE(std::is_sorted(all.begin(), all.end(), [](const Texture* a, const Texture* b) {
+    return a->addr < b->addr;
+  }));
+}
+
+// Compares the speed of both indices on a recorded trace, or a generated one without it.
+// MatchesReference covers the results, so this is disabled by default.
+TEST(TextureAddressIndex, DISABLED_ReplayTrace)
+{
+  const char* path = std::getenv("TEXTURE_ADDRESS_TRACE");
+  std::vector<TraceEntry> trace = path ? LoadTrace(path) : GenerateTrace();
+  ASSERT_FALSE(trace.empty());
+
+  std::vector<Texture> storage;
+  MultimapIndex multimap;
+  u64 start = Common::Timer::GetTimeUs();
+  const u64 expected = Replay(multimap, trace, &storage);
+  const u64 multimap_us = Common::Timer::GetTimeUs() - start;
+
+  FlatIndex flat;
+  start = Common::Timer::GetTimeUs();
+  const u64 result = Replay(flat, trace, &storage);
+  const u64 flat_us = Common::Timer::GetTimeUs() - start;
+
+  EXPECT_EQ(expected, result);
+  std::printf("[ BENCH    ] %zu operations: multimap %.2f ms, flat index %.2f ms\n",
+              trace.size(), multimap_us / 1000.0, flat_us / 1000.0);
+}
@@ -0,0 +1,223 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>  // NOLINT
+
+#include "Common/CommonTypes.h"
+#include "Common/File.h"
+#include "Common/FileUtil.h"
+#include "VideoCommon/TextureDiskCache.h"
+
+namespace
+{
+constexpr u32 DATA_VERSION = 1;
+constexpr u32 TEXTURE_SIZE = 64;
+constexpr u32 TEXTURE_BYTES = TEXTURE_SIZE * TEXTURE_SIZE * 4;
+// Header, level header and data of a single level texture
+constexpr u64 RECORD_SIZE = 48 + 16 + TEXTURE_BYTES;
+
+TextureDiskCache::Key MakeKey(u64 hash)
+{
+  return {hash, GX_TF_RGBA8, TEXTURE_SIZE, TEXTURE_SIZE, 1, 0, PC_TEX_FMT_RGBA32};
+}
+
+std::vector<u8> MakeData(u64 hash, u32 size)
+{
+  std::vector<u8> data(size);
+  for (u32 i = 0; i < size; ++i)
+    data[i] = static_cast<u8>(hash * 31 + i);
+  return data;
+}
+
+void Store(TextureDiskCache& cache, u64 hash)
+{
+  const std::vector<u8> data = MakeData(hash, TEXTURE_BYTES);
+  cache.Store(MakeKey(hash), PC_TEX_FMT_RGBA32,
+              {{TEXTURE_SIZE, TEXTURE_SIZE, TEXTURE_SIZE, TEXTURE_BYTES, nullptr}}, data.data());
+}
+
+bool Contains(TextureDiskCache& cache, u64 hash)
+{
+  TextureDiskCache::Texture texture;
+  if (!cache.Lookup(MakeKey(hash), &texture))
+    return false;
+  EXPECT_EQ(PC_TEX_FMT_RGBA32, texture.format);
+  EXPECT_EQ(1u, texture.levels.size());
+  const std::vector<u8> expected = MakeData(hash, TEXTURE_BYTES);
+  EXPECT_EQ(expected, std::vector<u8>(texture.levels[0].data,
+                                      texture.levels[0].data + texture.levels[0].size));
+  return true;
+}
+
+class TextureDiskCacheTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    m_directory = File::CreateTempDir();
+    m_filename = m_directory + "/GAME01.pack";
+  }
+  void TearDown() override { File::DeleteDirRecursively(m_directory); }
+
+  std::string m_directory;
+  std::string m_filename;
+};
+}  // namespace
+
+TEST_F(TextureDiskCacheTest, StoreAndLookup)
+{
+  TextureDiskCache cache;
+  ASSERT_TRUE(cache.Open(m_filename, 1 << 20, DATA_VERSION));
+  EXPECT_FALSE(Contains(cache, 1));
+
+  // Multiple levels, mixed with single level textures
+  const std::vector<u8> data = MakeData(7, TEXTURE_BYTES + TEXTURE_BYTES / 4);
+  const std::vector<TextureDiskCache::Level> levels = {
+      {TEXTURE_SIZE, TEXTURE_SIZE, TEXTURE_SIZE, TEXTURE_BYTES, nullptr},
+      {TEXTURE_SIZE / 2, TEXTURE_SIZE / 2, TEXTURE_SIZE / 2, TEXTURE_BYTES / 4, nullptr}};
+  TextureDiskCache::Key key = MakeKey(7);
+  key.levels = 2;
+  Store(cache, 1);
+  cache.Store(key, PC_TEX_FMT_RGBA32, levels, data.data());
+  Store(cache, 2);
+
+  // Appended this session, read back through the file
+  EXPECT_TRUE(Contains(cache, 1));
+  EXPECT_TRUE(Contains(cache, 2));
+  cache.Close();
+
+  // Read from the mapping
+  ASSERT_TRUE(cache.Open(m_filename, 1 << 20, DATA_VERSION));
+  EXPECT_EQ(3u, cache.GetEntryCount());
+  EXPECT_TRUE(Contains(cache, 1));
+  EXPECT_TRUE(Contains(cache, 2));
+  EXPECT_FALSE(Contains(cache, 3));
+  TextureDiskCache::Texture texture;
+  ASSERT_TRUE(cache.Lookup(key, &texture));
+  ASSERT_EQ(2u, texture.levels.size());
+  EXPECT_EQ(TEXTURE_SIZE / 2, texture.levels[1].width);
+  EXPECT_EQ(std::vector<u8>(data.begin() + TEXTURE_BYTES, data.end()),
+            std::vector<u8>(texture.levels[1].data,
+                            texture.levels[1].data + texture.levels[1].size));
+}
+
+TEST_F(TextureDiskCacheTest, VersionChangeDiscardsEntries)
+{
+  TextureDiskCache cache;
+  ASSERT_TRUE(cache.Open(m_filename, 1 << 20, DATA_VERSION));
+  Store(cache, 1);
+  cache.Close();
+
+  ASSERT_TRUE(cache.Open(m_filename, 1 << 20, DATA_VERSION + 1));
+  EXPECT_EQ(0u, cache.GetEntryCount());
+  EXPECT_FALSE(Contains(cache, 1));
+}
+
+TEST_F(TextureDiskCacheTest, DropsTruncatedRecord)
+{
+  TextureDiskCache cache;
+  ASSERT_TRUE(cache.Open(m_filename, 1 << 20, DATA_VERSION));
+  Store(cache, 1);
+  Store(cache, 2);
+  cache.Close();
+
+  // Simulate a crash in the middle of writing the second texture
+  const u64 size = File::GetSize(m_filename);
+  {
+    File::IOFile file(m_filename, "r+b");
+    ASSERT_TRUE(file.Resize(size - 100));
+  }
+
+  ASSERT_TRUE(cache.Open(m_filename, 1 << 20, DATA_VERSION));
+  EXPECT_EQ(1u, cache.GetEntryCount());
+  EXPECT_TRUE(Contains(cache, 1));
+  EXPECT_FALSE(Contains(cache, 2));
+  Store(cache, 2);
+  cache.Close();
+
+  ASSERT_TRUE(cache.Open(m_filename, 1 << 20, DATA_VERSION));
+  EXPECT_TRUE(Contains(cache, 1));
+  EXPECT_TRUE(Contains(cache, 2));
+}
+
+TEST_F(TextureDiskCacheTest, HostFormatIsPartOfTheKey)
+{
+  TextureDiskCache cache;
+  ASSERT_TRUE(cache.Open(m_filename, 1 << 20, DATA_VERSION));
+  Store(cache, 1);
+
+  // A backend which supports other formats must not get the texture decoded for another one
+  TextureDiskCache::Key key = MakeKey(1);
+  key.host_format = PC_TEX_FMT_BGRA32;
+  TextureDiskCache::Texture texture;
+  EXPECT_FALSE(cache.Lookup(key, &texture));
+  EXPECT_TRUE(Contains(cache, 1));
+}
+
+TEST_F(TextureDiskCacheTest, RejectsCorruptRecordSize)
+{
+  TextureDiskCache cache;
+  ASSERT_TRUE(cache.Open(m_filename, 1 << 20, DATA_VERSION));
+  Store(cache, 1);
+  Store(cache, 2);
+  cache.Close();
+
+  // A data_size which makes the record size wrap around in 32 bits, with a matching level size
+  {
+    File::IOFile file(m_filename, "r+b");
+    const u32 data_size = 0xfffffff0;
+    ASSERT_TRUE(file.Seek(16 + RECORD_SIZE + 40, SEEK_SET));
+    ASSERT_TRUE(file.WriteBytes(&data_size, sizeof(data_size)));
+    ASSERT_TRUE(file.Seek(16 + RECORD_SIZE + 48 + 12, SEEK_SET));
+    ASSERT_TRUE(file.WriteBytes(&data_size, sizeof(data_size)));
+  }
+
+  ASSERT_TRUE(cache.Open(m_filename, 1 << 20, DATA_VERSION));
+  EXPECT_EQ(1u, cache.GetEntryCount());
+  EXPECT_TRUE(Contains(cache, 1));
+  EXPECT_FALSE(Contains(cache, 2));
+  EXPECT_EQ(16 + RECORD_SIZE, File::GetSize(m_filename));
+}
+
+TEST_F(TextureDiskCacheTest, EvictsLeastRecentlyUsed)
+{
+  // Room for five textures, shrunk to three when almost full
+  const u64 size_limit = 16 + 5 * RECORD_SIZE;
+  TextureDiskCache cache;
+
+  ASSERT_TRUE(cache.Open(m_filename, size_limit, DATA_VERSION));
+  Store(cache, 1);
+  Store(cache, 2);
+  Store(cache, 3);
+  cache.Close();
+
+  ASSERT_TRUE(cache.Open(m_filename, size_limit, DATA_VERSION));
+  EXPECT_EQ(3u, cache.GetEntryCount());
+  EXPECT_TRUE(Contains(cache, 3));
+  Store(cache, 4);
+  cache.Close();
+
+  ASSERT_TRUE(cache.Open(m_filename, size_limit, DATA_VERSION));
+  EXPECT_EQ(4u, cache.GetEntryCount());
+  EXPECT_TRUE(Contains(cache, 2));
+  Store(cache, 5);
+  // Doesn't fit anymore
+  Store(cache, 6);
+  EXPECT_EQ(5u, cache.GetEntryCount());
+  EXPECT_LE(cache.GetFileSize(), size_limit);
+  cache.Close();
+
+  // 2 and 5 were used in the last session, 3 and 4 in the one before
+  ASSERT_TRUE(cache.Open(m_filename, size_limit, DATA_VERSION));
+  EXPECT_EQ(3u, cache.GetEntryCount());
+  EXPECT_FALSE(Contains(cache, 1));
+  EXPECT_TRUE(Contains(cache, 2));
+  EXPECT_TRUE(Contains(cache, 3));
+  EXPECT_FALSE(Contains(cache, 4));
+  EXPECT_TRUE(Contains(cache, 5));
+  EXPECT_LE(File::GetSize(m_filename), size_limit * 3 / 4);
+}
@@ -0,0 +1,122 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <gtest/gtest.h>  // NOLINT
+
+#include "Common/CommonTypes.h"
+#include "Common/Timer.h"
+#include "VideoCommon/TextureScalerCommon.h"
+#include "VideoCommon/VideoConfig.h"
+
+namespace
+{
+constexpr int SCALING_TYPES[] = {
+    TextureScaler::XBRZ,         TextureScaler::HYBRID,      TextureScaler::BICUBIC,
+    TextureScaler::HYBRID_BICUBIC, TextureScaler::JINC,      TextureScaler::JINC_SHARPER,
+    TextureScaler::SMOOTHSTEP,   TextureScaler::THREE_POINT, TextureScaler::DDT,
+    TextureScaler::DDT_SHARP};
+
+// Gradients with some hard edges and noise, so every filter has something to do.
+std::vector<u32> MakeTexture(int width, int height)
+{
+  std::vector<u32> texture(width * height);
+  u32 seed = 0x12345678;
+  for (int y = 0; y < height; ++y)
+  {
+    for (int x = 0; x < width; ++x)
+    {
+      seed = seed * 1664525 + 1013904223;
+      const u32 r = (x * 255 / width) ^ ((x / 8 % 2) * 0x40);
+      const u32 g = (y * 255 / height) ^ ((y / 8 % 2) * 0x40);
+      const u32 b = seed >> 24;
+      const u32 a = ((x + y) / 16 % 3) ? 0xFF : 0x80;
+      texture[y * width + x] = (a << 24) | (b << 16) | (g << 8) | r;
+    }
+  }
+  return texture;
+}
+
+std::vector<u32> RunScaler(TextureScaler& scaler, std::vector<u32>& texture, int width,
+                           int height)
+{
+  const int factor = g_ActiveConfig.iTexScalingFactor;
+  const u32* result = scaler.Scale(texture.data(), width, height);
+  return std::vector<u32>(result, result + width * height * factor * factor);
+}
+
+class TextureScalerTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    m_saved_config = g_ActiveConfig;
+    g_ActiveConfig.iTexScalingFactor = 3;
+    g_ActiveConfig.bTexDeposterize = false;
+  }
+  void TearDown() override { g_ActiveConfig = m_saved_config; }
+
+private:
+  VideoConfig m_saved_config;
+};
+}  // namespace
+
+TEST_F(TextureScalerTest, MultithreadedMatchesSerial)
+{
+  // An odd size, so the last band is shorter than the others.
+  const int width = 67, height = 101;
+  std::vector<u32> texture = MakeTexture(width, height);
+  TextureScaler serial, parallel;
+  serial.SetMultithreaded(false);
+  parallel.SetMultithreaded(true);
+
+  for (bool deposterize : {false, true})
+  {
+    g_ActiveConfig.bTexDeposterize = deposterize;
+    for (int factor = 2; factor <= 4; ++factor)
+    {
+      g_ActiveConfig.iTexScalingFactor = factor;
+      for (int type : SCALING_TYPES)
+      {
+        g_ActiveConfig.iTexScalingType = type;
+        EXPECT_EQ(RunScaler(serial, texture, width, height),
+                  RunScaler(parallel, texture, width, height))
+            << "type " << type << ", factor " << factor << ", deposterize " << deposterize;
+      }
+    }
+  }
+}
+
+// Not a correctness test, prints the numbers to compare scaler changes with.
+TEST_F(TextureScalerTest, DISABLED_Throughput)
+{
+  const int width = 256, height = 256, iterations = 2;
+  std::vector<u32> texture = MakeTexture(width, height);
+  TextureScaler serial, parallel;
+  serial.SetMultithreaded(false);
+  parallel.SetMultithreaded(true);
+
+  for (int type : SCALING_TYPES)
+  {
+    g_ActiveConfig.iTexScalingType = type;
+    u64 serial_us = 0, parallel_us = 0;
+    for (int i = 0; i < iterations; ++i)
+    {
+      u64 start = Common::Timer::GetTimeUs();
+      serial.Scale(texture.data(), width, height);
+      serial_us += Common::Timer::GetTimeUs() - start;
+
+      start = Common::Timer::GetTimeUs();
+      parallel.Scale(texture.data(), width, height);
+      parallel_us += Common::Timer::GetTimeUs() - start;
+    }
+    const double mpixels = double(width) * height * iterations / 1000000.0;
+    std::printf("[ BENCH    ] type %2d: serial %8.2f Mpx/s, parallel %8.2f Mpx/s\n", type,
+                mpixels / (serial_us / 1000000.0 + 1e-9),
+                mpixels / (parallel_us / 1000000.0 + 1e-9));
+  }
+}
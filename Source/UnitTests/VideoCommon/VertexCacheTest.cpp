@@ -0,0 +1,201 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>  // NOLINT
+
+#include "Common/CommonTypes.h"
+#include "Common/Hash.h"
+#include "Common/Swap.h"
+#include "Core/HW/Memmap.h"
+#include "VideoCommon/CPMemory.h"
+#include "VideoCommon/OpcodeDecoding.h"
+#include "VideoCommon/VertexCache.h"
+#include "VideoCommon/VertexLoader.h"
+#include "VideoCommon/VertexLoaderBase.h"
+
+namespace
+{
+constexpr u32 POSITION_ARRAY = 0x10000;
+constexpr u32 POSITION_STRIDE = 12;
+constexpr int VERTEX_COUNT = 64;
+
+// Float positions indexed with 8 bits followed by direct 16 bit texture coordinates.
+class VertexCacheTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    m_ram.assign(Memory::RAM_SIZE, 0);
+    Memory::m_pRAM = m_ram.data();
+    for (u32 i = 0; i < 256 * 3; i++)
+    {
+      const float value = static_cast<float>(i);
+      u32 bits;
+      std::memcpy(&bits, &value, sizeof(bits));
+      bits = Common::swap32(bits);
+      std::memcpy(&m_ram[POSITION_ARRAY + i * 4], &bits, sizeof(bits));
+    }
+    g_main_cp_state.array_bases[ARRAY_POSITION] = POSITION_ARRAY;
+    g_main_cp_state.array_strides[ARRAY_POSITION] = POSITION_STRIDE;
+    cached_arraybases[ARRAY_POSITION] = Memory::GetPointer(POSITION_ARRAY);
+
+    m_desc.Hex = 0;
+    m_desc.Position = INDEX8;
+    m_desc.Tex0Coord = DIRECT;
+    m_vat.g0.Hex = 0;
+    m_vat.g1.Hex = 0;
+    m_vat.g2.Hex = 0;
+    m_vat.g0.PosElements = 1;
+    m_vat.g0.PosFormat = FORMAT_FLOAT;
+    m_vat.g0.Tex0CoordElements = 1;
+    m_vat.g0.Tex0CoordFormat = FORMAT_SHORT;
+    m_loader = std::make_unique<VertexLoader>(m_desc, m_vat);
+
+    m_input.resize(VERTEX_COUNT * m_loader->m_VertexSize);
+    for (int i = 0; i < VERTEX_COUNT; i++)
+    {
+      u8* vertex = &m_input[i * m_loader->m_VertexSize];
+      const u16 texcoord[2] = {Common::swap16(static_cast<u16>(i)),
+                               Common::swap16(static_cast<u16>(i * 7))};
+      vertex[0] = static_cast<u8>(i * 3 % 100);
+      std::memcpy(vertex + 1, texcoord, sizeof(texcoord));
+    }
+    SetHash64Function();
+    VertexCache::Init();
+  }
+
+  void TearDown() override
+  {
+    VertexCache::Shutdown();
+    Memory::m_pRAM = nullptr;
+  }
+
+  // Runs the draw through the cache, returns the converted vertices.
+  std::vector<u8> Draw()
+  {
+    std::vector<u8> output(VERTEX_COUNT * m_loader->m_native_stride);
+    VertexLoaderParameters parameters = {};
+    parameters.source = m_input.data();
+    parameters.destination = output.data();
+    parameters.VtxDesc = &m_desc;
+    parameters.VtxAttr = &m_vat;
+    parameters.buf_size = m_input.size();
+    parameters.primitive = OpcodeDecoder::GX_DRAW_TRIANGLES;
+    parameters.count = VERTEX_COUNT;
+    const s32 count = VertexCache::ConvertVertices(
+        m_loader.get(), parameters, static_cast<u32>(m_input.size()), [&] {
+          m_conversions++;
+          return m_loader->RunVertices(parameters);
+        });
+    EXPECT_EQ(VERTEX_COUNT, count);
+    return output;
+  }
+
+  // Converts the draw without the cache.
+  std::vector<u8> Reference()
+  {
+    std::vector<u8> output(VERTEX_COUNT * m_loader->m_native_stride);
+    VertexLoaderParameters parameters = {};
+    parameters.source = m_input.data();
+    parameters.destination = output.data();
+    parameters.VtxDesc = &m_desc;
+    parameters.VtxAttr = &m_vat;
+    parameters.count = VERTEX_COUNT;
+    m_loader->RunVertices(parameters);
+    return output;
+  }
+
+  std::vector<u8> m_ram;
+  std::vector<u8> m_input;
+  TVtxDesc m_desc;
+  VAT m_vat;
+  std::unique_ptr<VertexLoaderBase> m_loader;
+  int m_conversions = 0;
+};
+}  // namespace
+
+TEST_F(VertexCacheTest, RepeatedDrawsAreCopied)
+{
+  const std::vector<u8> first = Draw();
+  const std::vector<u8> second = Draw();
+  EXPECT_EQ(1, m_conversions);
+  EXPECT_EQ(Reference(), first);
+  EXPECT_EQ(first, second);
+
+  // Different vertex data or a different array base is a different draw.
+  m_input[m_loader->m_VertexSize + 2] ^= 1;
+  Draw();
+  EXPECT_EQ(2, m_conversions);
+  g_main_cp_state.array_bases[ARRAY_POSITION] += POSITION_STRIDE;
+  cached_arraybases[ARRAY_POSITION] += POSITION_STRIDE;
+  EXPECT_EQ(Reference(), Draw());
+  EXPECT_EQ(3, m_conversions);
+}
+
+TEST_F(VertexCacheTest, ChangedArraysAreCheckedInNewContext)
+{
+  Draw();
+  // Index 99 is the largest one used, its element is still part of the checked range.
+  m_ram[POSITION_ARRAY + 99 * POSITION_STRIDE + 8] ^= 0x40;
+  Draw();
+  EXPECT_EQ(1, m_conversions);
+
+  VertexCache::IncrementCheckContextId();
+  EXPECT_EQ(Reference(), Draw());
+  EXPECT_EQ(2, m_conversions);
+
+  // Elements past the largest index don't matter.
+  m_ram[POSITION_ARRAY + 120 * POSITION_STRIDE] ^= 0x40;
+  VertexCache::IncrementCheckContextId();
+  Draw();
+  EXPECT_EQ(2, m_conversions);
+}
+
+TEST_F(VertexCacheTest, InvalidatedRangesDropEntries)
+{
+  Draw();
+  VertexCache::InvalidateRange(POSITION_ARRAY + 128 * POSITION_STRIDE, 0x1000);
+  Draw();
+  EXPECT_EQ(1, m_conversions);
+
+  m_ram[POSITION_ARRAY + 50 * POSITION_STRIDE] ^= 0x40;
+  VertexCache::InvalidateRange(POSITION_ARRAY + 50 * POSITION_STRIDE, 4);
+  EXPECT_EQ(Reference(), Draw());
+  EXPECT_EQ(2, m_conversions);
+}
+
+TEST_F(VertexCacheTest, ArrayIndexOffsets)
+{
+  TVtxDesc desc;
+  desc.Hex = 0;
+  desc.PosMatIdx = 1;
+  desc.Tex1MatIdx = 1;
+  desc.Position = INDEX16;
+  desc.Normal = DIRECT;
+  desc.Color0 = INDEX8;
+  desc.Color1 = DIRECT;
+  desc.Tex0Coord = DIRECT;
+  desc.Tex3Coord = INDEX16;
+  VAT vat;
+  vat.g0.Hex = 0;
+  vat.g1.Hex = 0;
+  vat.g2.Hex = 0;
+  vat.g0.NormalFormat = FORMAT_SHORT;
+  vat.g0.Color1Comp = FORMAT_24B_888;
+  vat.g0.Tex0CoordElements = 1;
+  vat.g0.Tex0CoordFormat = FORMAT_FLOAT;
+  VertexLoader loader(desc, vat);
+
+  s32 offsets[12];
+  loader.GetArrayIndexOffsets(offsets);
+  // 2 matrix indices, 2 position, 6 normal, 1 color0, 3 color1, 8 tex0
+  const s32 expected[12] = {2, -1, 10, -1, -1, -1, -1, 22, -1, -1, -1, -1};
+  for (int i = 0; i < 12; i++)
+    EXPECT_EQ(expected[i], offsets[i]) << "array " << i;
+  EXPECT_EQ(24, loader.m_VertexSize);
+}
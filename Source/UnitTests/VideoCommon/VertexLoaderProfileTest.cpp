@@ -0,0 +1,117 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <string>
+
+#include <gtest/gtest.h>  // NOLINT
+
+#include "Common/CommonTypes.h"
+#include "Common/FileUtil.h"
+#include "VideoCommon/VertexLoaderBase.h"
+#include "VideoCommon/VertexLoaderCompiled.h"
+#include "VideoCommon/VertexLoaderProfile.h"
+
+namespace
+{
+VertexLoaderProfile::Entry MakeEntry(u32 id, u64 num_verts, const std::string& kind)
+{
+  VertexLoaderProfile::Entry entry;
+  for (u32 i = 0; i < 4; i++)
+    entry.uid[i] = id * 0x01010101u + i;
+  entry.num_verts = num_verts;
+  entry.kind = kind;
+  entry.name = "P_mtx0_3_Dir_flt_" + std::to_string(id);
+  return entry;
+}
+
+class VertexLoaderProfileTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    m_directory = File::CreateTempDir();
+    m_filename = m_directory + "/profiles/GTEST01.txt";
+  }
+  void TearDown() override { File::DeleteDirRecursively(m_directory); }
+
+  std::string m_directory;
+  std::string m_filename;
+};
+}  // namespace
+
+TEST_F(VertexLoaderProfileTest, SaveAndLoad)
+{
+  VertexLoaderProfile::Profile profile;
+  profile[0xFEDCBA9876543210ull] = MakeEntry(1, 1234567890123ull, "jit");
+  profile[42] = MakeEntry(2, 3, "generic");
+  ASSERT_TRUE(VertexLoaderProfile::Save(m_filename, profile));
+
+  VertexLoaderProfile::Profile loaded;
+  ASSERT_TRUE(VertexLoaderProfile::Load(m_filename, &loaded));
+  ASSERT_EQ(2u, loaded.size());
+  for (const auto& item : profile)
+  {
+    const VertexLoaderProfile::Entry& entry = loaded[item.first];
+    for (u32 i = 0; i < 4; i++)
+      EXPECT_EQ(item.second.uid[i], entry.uid[i]);
+    EXPECT_EQ(item.second.num_verts, entry.num_verts);
+    EXPECT_EQ(item.second.kind, entry.kind);
+    EXPECT_EQ(item.second.name, entry.name);
+  }
+}
+
+TEST_F(VertexLoaderProfileTest, MergeAccumulatesSessions)
+{
+  VertexLoaderProfile::Profile profile;
+  profile[1] = MakeEntry(1, 100, "generic");
+  profile[2] = MakeEntry(2, 50, "jit");
+
+  VertexLoaderProfile::Profile session;
+  session[1] = MakeEntry(1, 20, "compiled");
+  session[3] = MakeEntry(3, 7, "jit");
+  VertexLoaderProfile::Merge(&profile, session);
+
+  ASSERT_EQ(3u, profile.size());
+  EXPECT_EQ(120u, profile[1].num_verts);
+  EXPECT_EQ("compiled", profile[1].kind);
+  EXPECT_EQ(50u, profile[2].num_verts);
+  EXPECT_EQ(7u, profile[3].num_verts);
+}
+
+TEST_F(VertexLoaderProfileTest, RejectsMalformedFiles)
+{
+  VertexLoaderProfile::Profile profile;
+  EXPECT_FALSE(VertexLoaderProfile::Load(m_filename, &profile));
+
+  File::CreateFullPath(m_filename);
+  ASSERT_TRUE(File::WriteStringToFile("# comment\n0000000000000001 00000001 00000002\n", m_filename));
+  EXPECT_FALSE(VertexLoaderProfile::Load(m_filename, &profile));
+}
+
+// The uid elements stored in a profile are the template arguments of the generated
+// TemplatedLoader and the hash is the key VertexLoaderCompiled looks the loader up with.
+TEST_F(VertexLoaderProfileTest, KeysMatchPrecompiledLoaders)
+{
+  // P_mtx1_3_I16_flt_Nrm_0_0_I16_s16_T0_mtx0_1_I16_s16_T1_mtx1_1_Inv_flt_ from G_GZ2P01_pvt.cpp
+  TVtxDesc vtx_desc;
+  vtx_desc.Hex = (u64(0x00030f02u) << 1) | 1;
+  VAT vat;
+  vat.g0.Hex = 0x40e00c09u;
+  vat.g1.Hex = 0x00000009u;
+  vat.g2.Hex = 0x00000000u;
+
+  VertexLoaderUID uid(vtx_desc, vat);
+  EXPECT_EQ(21237928937659ull, uid.GetHash());
+  EXPECT_EQ(0x00030f02u, uid.GetElement(0));
+  EXPECT_EQ(0x40e00c09u, uid.GetElement(1));
+  EXPECT_EQ(0x80000009u, uid.GetElement(2));
+  EXPECT_EQ(0x00000000u, uid.GetElement(3));
+
+  VertexLoaderCompiled loader(vtx_desc, vat);
+  EXPECT_TRUE(loader.IsInitialized());
+  EXPECT_EQ(VertexLoaderKind::Compiled, loader.GetKind());
+  EXPECT_STREQ("compiled", VertexLoaderBase::GetKindName(loader.GetKind()));
+  EXPECT_EQ("P_mtx1_3_I16_flt_Nrm_0_0_I16_s16_T0_mtx0_1_I16_s16_T1_mtx1_1_Inv_flt_",
+            loader.GetName());
+}
@@ -0,0 +1,430 @@
+// Copyright 2017 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "Common/BitSet.h"
+#include "Common/CPUDetect.h"
+#include "Common/CommonTypes.h"
+#include "Common/ThreadPool.h"
+#include "VideoCommon/CPMemory.h"
+#include "VideoCommon/OpcodeDecoding.h"
+#include "VideoCommon/VertexLoader.h"
+#include "VideoCommon/VertexLoaderBase.h"
+#include "VideoCommon/VertexLoaderManager.h"
+#include "VideoCommon/VertexLoaderX64.h"
+
+// Included last, the TEST macro of gtest conflicts with the TEST method of the x64 emitter
+#include <gtest/gtest.h>  // NOLINT
+
+// The generic VertexLoader is the reference the x64 loaders are compared against, the same way
+// VertexLoaderTester does it when COMPARE_VERTEXLOADERS is defined.
+namespace
+{
+constexpr int MAX_ATTRIBUTE_SIZE = 40;
+constexpr u32 ARRAY_ELEMENTS = 0x10000;
+
+// The position follows the matrix indices
+int GetPositionIndexOffset(const TVtxDesc& desc)
+{
+  return BitSet32(u32(desc.Hex & 0x1FF)).Count();
+}
+
+struct VertexFormat
+{
+  const char* name;
+  TVtxDesc desc;
+  VAT vat;
+};
+
+// Extra attributes added to every position format of the comparison matrix
+enum Attributes
+{
+  ATTR_NONE,
+  ATTR_NORMAL_BYTE,
+  ATTR_NBT_SHORT_INDEX3,
+  ATTR_NBT_FLOAT,
+  ATTR_COLORS_565_8888,
+  ATTR_COLORS_6666_4444,
+  ATTR_TEXCOORDS,
+  ATTR_TEXCOORD_MATRICES,
+  ATTR_MATRICES_ONLY,
+  ATTR_ALL,
+  ATTR_COUNT,
+};
+
+class VertexLoaderX64Test
+    : public testing::TestWithParam<std::tuple<int, int, int, int, int>>
+{
+protected:
+  void SetUp() override
+  {
+    std::mt19937 rng(1234);
+    m_array.resize(ARRAY_ELEMENTS * MAX_ATTRIBUTE_SIZE + 16);
+    for (u8& byte : m_array)
+      byte = static_cast<u8>(rng());
+    for (int i = 0; i < 16; i++)
+    {
+      cached_arraybases[i] = m_array.data();
+      g_main_cp_state.array_strides[i] = MAX_ATTRIBUTE_SIZE;
+    }
+    g_main_cp_state.matrix_index_a.Hex = 0x2a;
+  }
+
+  // Runs count random vertices through the loader, vertices listed in skipped get a position
+  // index of -1. With more than one range, the draw is split like large draws are.
+  int Run(VertexLoaderBase* loader, const VertexFormat& format, int count, std::vector<u8>* out,
+          const std::vector<int>& skipped = {}, int num_ranges = 1)
+  {
+    std::mt19937 rng(count);
+    m_input.resize(count * loader->m_VertexSize + 16);
+    for (u8& byte : m_input)
+      byte = static_cast<u8>(rng());
+    const int position_index = GetPositionIndexOffset(format.desc);
+    for (int vertex : skipped)
+    {
+      if (vertex < count)
+        memset(&m_input[vertex * loader->m_VertexSize + position_index], 0xFF,
+               format.desc.Position == INDEX8 ? 1 : 2);
+    }
+
+    out->assign(count * loader->m_native_vtx_decl.stride + 16, 0xCC);
+    VertexLoaderParameters parameters = {};
+    parameters.source = m_input.data();
+    parameters.destination = out->data();
+    parameters.VtxDesc = &format.desc;
+    parameters.VtxAttr = &format.vat;
+    parameters.buf_size = m_input.size();
+    parameters.primitive = OpcodeDecoder::GX_DRAW_TRIANGLES;
+    parameters.count = count;
+    if (num_ranges > 1)
+      return VertexLoaderManager::RunVerticesParallel(loader, parameters, num_ranges);
+    return loader->RunVertices(parameters);
+  }
+
+  std::vector<u8> m_array;
+  std::vector<u8> m_input;
+};
+
+VertexFormat MakeFormat(int position, int format, int elements, int frac, int attributes)
+{
+  VertexFormat vf;
+  vf.name = "";
+  vf.desc.Hex = 0;
+  vf.vat.g0.Hex = 0;
+  vf.vat.g1.Hex = 0;
+  vf.vat.g2.Hex = 0;
+  vf.desc.Position = position;
+  vf.vat.g0.PosFormat = format;
+  vf.vat.g0.PosElements = elements;
+  vf.vat.g0.PosFrac = frac;
+  vf.vat.g0.ByteDequant = 1;
+
+  switch (attributes)
+  {
+  case ATTR_NORMAL_BYTE:
+    vf.desc.Normal = DIRECT;
+    vf.vat.g0.NormalFormat = FORMAT_BYTE;
+    break;
+  case ATTR_NBT_SHORT_INDEX3:
+    vf.desc.Normal = INDEX16;
+    vf.vat.g0.NormalFormat = FORMAT_SHORT;
+    vf.vat.g0.NormalElements = 1;
+    vf.vat.g0.NormalIndex3 = 1;
+    break;
+  case ATTR_NBT_FLOAT:
+    vf.desc.Normal = INDEX8;
+    vf.vat.g0.NormalFormat = FORMAT_FLOAT;
+    vf.vat.g0.NormalElements = 1;
+    break;
+  case ATTR_COLORS_565_8888:
+    vf.desc.Color0 = DIRECT;
+    vf.vat.g0.Color0Comp = FORMAT_16B_565;
+    vf.desc.Color1 = INDEX8;
+    vf.vat.g0.Color1Comp = FORMAT_32B_8888;
+    break;
+  case ATTR_COLORS_6666_4444:
+    vf.desc.Color0 = INDEX16;
+    vf.vat.g0.Color0Comp = FORMAT_24B_6666;
+    vf.desc.Color1 = DIRECT;
+    vf.vat.g0.Color1Comp = FORMAT_16B_4444;
+    break;
+  case ATTR_TEXCOORDS:
+    vf.desc.Tex0Coord = DIRECT;
+    vf.vat.g0.Tex0CoordFormat = FORMAT_SHORT;
+    vf.vat.g0.Tex0CoordElements = 1;
+    vf.vat.g0.Tex0Frac = 8;
+    vf.desc.Tex1Coord = INDEX16;
+    vf.vat.g1.Tex1CoordFormat = FORMAT_UBYTE;
+    vf.vat.g1.Tex1Frac = 3;
+    break;
+  case ATTR_TEXCOORD_MATRICES:
+    vf.desc.Tex0MatIdx = 1;
+    vf.desc.Tex0Coord = DIRECT;
+    vf.vat.g0.Tex0CoordFormat = FORMAT_FLOAT;
+    vf.vat.g0.Tex0CoordElements = 1;
+    vf.desc.Tex1MatIdx = 1;
+    vf.desc.Tex1Coord = INDEX8;
+    vf.vat.g1.Tex1CoordFormat = FORMAT_USHORT;
+    vf.vat.g1.Tex1Frac = 15;
+    break;
+  case ATTR_MATRICES_ONLY:
+    vf.desc.PosMatIdx = 1;
+    vf.desc.Tex0MatIdx = 1;
+    vf.desc.Tex3MatIdx = 1;
+    break;
+  case ATTR_ALL:
+    vf.desc.PosMatIdx = 1;
+    vf.desc.Tex2MatIdx = 1;
+    vf.desc.Normal = DIRECT;
+    vf.vat.g0.NormalFormat = FORMAT_SHORT;
+    vf.desc.Color0 = DIRECT;
+    vf.vat.g0.Color0Comp = FORMAT_24B_888;
+    vf.desc.Color1 = INDEX16;
+    vf.vat.g0.Color1Comp = FORMAT_32B_888x;
+    for (int i = 0; i < 8; i++)
+      vf.desc.Hex |= u64(i & 1 ? INDEX16 : DIRECT) << (2 * i + 17);
+    vf.vat.g0.Tex0CoordFormat = FORMAT_BYTE;
+    vf.vat.g1.Tex1CoordFormat = FORMAT_FLOAT;
+    vf.vat.g1.Tex2CoordFormat = FORMAT_USHORT;
+    vf.vat.g1.Tex2CoordElements = 1;
+    vf.vat.g1.Tex3CoordFormat = FORMAT_SHORT;
+    vf.vat.g1.Tex3Frac = 10;
+    vf.vat.g1.Tex4CoordFormat = FORMAT_UBYTE;
+    vf.vat.g1.Tex4CoordElements = 1;
+    vf.vat.g2.Tex5CoordFormat = FORMAT_SHORT;
+    vf.vat.g2.Tex5CoordElements = 1;
+    vf.vat.g2.Tex6CoordFormat = FORMAT_FLOAT;
+    vf.vat.g2.Tex7CoordFormat = FORMAT_BYTE;
+    vf.vat.g2.Tex7Frac = 5;
+    break;
+  }
+  return vf;
+}
+}  // namespace
+
+TEST_P(VertexLoaderX64Test, MatchesReference)
+{
+  int position, format, elements, frac, attributes;
+  std::tie(position, format, elements, frac, attributes) = GetParam();
+  const VertexFormat vf = MakeFormat(position, format, elements, frac, attributes);
+
+  VertexLoader reference(vf.desc, vf.vat);
+  std::vector<std::unique_ptr<VertexLoaderBase>> loaders;
+  loaders.push_back(std::make_unique<VertexLoaderX64>(vf.desc, vf.vat, false));
+  if (cpu_info.bAVX2)
+    loaders.push_back(std::make_unique<VertexLoaderX64>(vf.desc, vf.vat, true));
+
+  // Odd counts leave a vertex to the single vertex loop of the batched loader, the skipped
+  // position indices hit both lanes of a batch.
+  const std::vector<int> skipped = {4, 7, 8, 15};
+  for (int count : {1, 2, 3, 16, 67})
+  {
+    std::vector<u8> expected;
+    const int expected_count = Run(&reference, vf, count, &expected, skipped);
+    for (const auto& loader : loaders)
+    {
+      ASSERT_EQ(reference.m_VertexSize, loader->m_VertexSize);
+      ASSERT_EQ(reference.m_native_vtx_decl.stride, loader->m_native_vtx_decl.stride);
+      ASSERT_EQ(reference.m_native_components, loader->m_native_components);
+
+      std::vector<u8> actual;
+      const int actual_count = Run(loader.get(), vf, count, &actual, skipped);
+      ASSERT_EQ(expected_count, actual_count) << "count " << count;
+      EXPECT_EQ(0, memcmp(expected.data(), actual.data(),
+                          expected_count * reference.m_native_vtx_decl.stride))
+          << "count " << count << ", " << reference.GetName();
+
+      // The ranges of a split draw end up around the skipped vertices
+      if (count < 16)
+        continue;
+      std::vector<u8> parallel;
+      const int parallel_count = Run(loader.get(), vf, count, &parallel, skipped, 5);
+      ASSERT_EQ(expected_count, parallel_count) << "count " << count;
+      EXPECT_EQ(0, memcmp(expected.data(), parallel.data(),
+                          expected_count * reference.m_native_vtx_decl.stride))
+          << "count " << count << " in ranges, " << reference.GetName();
+    }
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(
+    AllFormats, VertexLoaderX64Test,
+    testing::Combine(testing::Values(DIRECT, INDEX8, INDEX16),
+                     testing::Values(FORMAT_UBYTE, FORMAT_BYTE, FORMAT_USHORT, FORMAT_SHORT,
+                                     FORMAT_FLOAT),
+                     testing::Values(0, 1),      // elements
+                     testing::Values(0, 6),      // frac
+                     testing::Range(0, int(ATTR_COUNT))));
+
+// The size of a vertex is known before its loader is created
+TEST(VertexLoaderBase, GetVertexSize)
+{
+  std::mt19937 rng(7);
+  for (int i = 0; i < 1000; i++)
+  {
+    TVtxDesc desc;
+    desc.Hex = (static_cast<u64>(rng()) << 32 | rng()) & ((1ull << 33) - 1);
+    VAT vat;
+    vat.g0.Hex = rng();
+    vat.g1.Hex = rng();
+    vat.g2.Hex = rng();
+    // Only valid formats, the loaders panic on the others.
+    vat.g0.PosFormat = rng() % 5;
+    vat.g0.NormalFormat = rng() % 5;
+    vat.g0.Color0Comp = rng() % 6;
+    vat.g0.Color1Comp = rng() % 6;
+    vat.g0.Tex0CoordFormat = rng() % 5;
+    vat.g1.Tex1CoordFormat = rng() % 5;
+    vat.g1.Tex2CoordFormat = rng() % 5;
+    vat.g1.Tex3CoordFormat = rng() % 5;
+    vat.g1.Tex4CoordFormat = rng() % 5;
+    vat.g2.Tex5CoordFormat = rng() % 5;
+    vat.g2.Tex6CoordFormat = rng() % 5;
+    vat.g2.Tex7CoordFormat = rng() % 5;
+    VertexLoader loader(desc, vat);
+    EXPECT_EQ(static_cast<u32>(loader.m_VertexSize), VertexLoaderBase::GetVertexSize(desc, vat))
+        << "desc " << desc.Hex << " vat " << vat.g0.Hex << " " << vat.g1.Hex << " " << vat.g2.Hex;
+  }
+}
+
+// The benchmarks only print numbers, run them with --gtest_also_run_disabled_tests.
+TEST(VertexLoaderX64Benchmark, DISABLED_CommonFormats)
+{
+  constexpr int VERTICES_PER_DRAW = 1024;
+  constexpr int ITERATIONS = 2000;
+
+  // Typical GX vertex formats: 2D overlays, skinned and static geometry, terrain
+  struct
+  {
+    const char* name;
+    int position, format, elements, attributes;
+  } const formats[] = {
+      {"pos f32 direct", DIRECT, FORMAT_FLOAT, 1, ATTR_NONE},
+      {"pos s16 index16", INDEX16, FORMAT_SHORT, 1, ATTR_NONE},
+      {"pos s16 + nrm s8", DIRECT, FORMAT_SHORT, 1, ATTR_NORMAL_BYTE},
+      {"pos f32 index16 + nbt s16", INDEX16, FORMAT_FLOAT, 1, ATTR_NBT_SHORT_INDEX3},
+      {"pos s16 index8 + colors", INDEX8, FORMAT_SHORT, 1, ATTR_COLORS_565_8888},
+      {"pos s16 index16 + 2 uv", INDEX16, FORMAT_SHORT, 1, ATTR_TEXCOORDS},
+      {"pos f32 + uv with texmtx", DIRECT, FORMAT_FLOAT, 1, ATTR_TEXCOORD_MATRICES},
+      {"pos s8 xy + everything", DIRECT, FORMAT_BYTE, 0, ATTR_ALL},
+  };
+
+  std::vector<u8> array(ARRAY_ELEMENTS * MAX_ATTRIBUTE_SIZE + 16);
+  std::mt19937 rng(42);
+  for (u8& byte : array)
+    byte = static_cast<u8>(rng());
+  for (int i = 0; i < 16; i++)
+  {
+    cached_arraybases[i] = array.data();
+    g_main_cp_state.array_strides[i] = MAX_ATTRIBUTE_SIZE;
+  }
+
+  for (const auto& entry : formats)
+  {
+    const VertexFormat vf =
+        MakeFormat(entry.position, entry.format, entry.elements, 6, entry.attributes);
+    std::unique_ptr<VertexLoaderBase> loaders[3] = {
+        std::make_unique<VertexLoader>(vf.desc, vf.vat),
+        std::make_unique<VertexLoaderX64>(vf.desc, vf.vat, false),
+        cpu_info.bAVX2 ? std::make_unique<VertexLoaderX64>(vf.desc, vf.vat, true) : nullptr,
+    };
+
+    std::vector<u8> input(VERTICES_PER_DRAW * loaders[0]->m_VertexSize + 16);
+    for (u8& byte : input)
+      byte = static_cast<u8>(rng());
+    // Keep the position indices away from the skip value
+    if (entry.position != DIRECT)
+    {
+      for (int i = 0; i < VERTICES_PER_DRAW; i++)
+        input[i * loaders[0]->m_VertexSize + GetPositionIndexOffset(vf.desc)] &= 0x7F;
+    }
+    std::vector<u8> output(VERTICES_PER_DRAW * loaders[0]->m_native_vtx_decl.stride + 16);
+
+    VertexLoaderParameters parameters = {};
+    parameters.source = input.data();
+    parameters.destination = output.data();
+    parameters.VtxDesc = &vf.desc;
+    parameters.VtxAttr = &vf.vat;
+    parameters.buf_size = input.size();
+    parameters.primitive = OpcodeDecoder::GX_DRAW_TRIANGLES;
+    parameters.count = VERTICES_PER_DRAW;
+
+    double rate[3] = {};
+    for (int i = 0; i < 3; i++)
+    {
+      if (!loaders[i])
+        continue;
+      const auto start = std::chrono::high_resolution_clock::now();
+      for (int j = 0; j < ITERATIONS; j++)
+        loaders[i]->RunVertices(parameters);
+      const auto end = std::chrono::high_resolution_clock::now();
+      rate[i] = double(VERTICES_PER_DRAW) * ITERATIONS / 1000000 /
+                std::chrono::duration<double>(end - start).count();
+    }
+    printf("[ BENCH    ] %-28s (%2d -> %3d bytes): generic %5.0f, sse %5.0f, avx2 %5.0f Mverts/s\n",
+           entry.name, loaders[0]->m_VertexSize, loaders[0]->m_native_vtx_decl.stride, rate[0],
+           rate[1], rate[2]);
+  }
+}
+
+TEST(VertexLoaderX64Benchmark, DISABLED_ParallelLargeDraw)
+{
+  constexpr int VERTICES_PER_DRAW = 65536;
+  constexpr int ITERATIONS = 100;
+
+  std::vector<u8> array(ARRAY_ELEMENTS * MAX_ATTRIBUTE_SIZE + 16);
+  std::mt19937 rng(42);
+  for (u8& byte : array)
+    byte = static_cast<u8>(rng());
+  for (int i = 0; i < 16; i++)
+  {
+    cached_arraybases[i] = array.data();
+    g_main_cp_state.array_strides[i] = MAX_ATTRIBUTE_SIZE;
+  }
+
+  const VertexFormat vf = MakeFormat(INDEX16, FORMAT_FLOAT, 1, 0, ATTR_NBT_SHORT_INDEX3);
+  std::unique_ptr<VertexLoaderBase> loader = std::make_unique<VertexLoaderX64>(vf.desc, vf.vat);
+  std::vector<u8> input(VERTICES_PER_DRAW * loader->m_VertexSize + 16);
+  for (u8& byte : input)
+    byte = static_cast<u8>(rng());
+  for (int i = 0; i < VERTICES_PER_DRAW; i++)
+    input[i * loader->m_VertexSize + GetPositionIndexOffset(vf.desc)] &= 0x7F;
+  std::vector<u8> output(VERTICES_PER_DRAW * loader->m_native_vtx_decl.stride + 16);
+
+  VertexLoaderParameters parameters = {};
+  parameters.source = input.data();
+  parameters.destination = output.data();
+  parameters.VtxDesc = &vf.desc;
+  parameters.VtxAttr = &vf.vat;
+  parameters.buf_size = input.size();
+  parameters.primitive = OpcodeDecoder::GX_DRAW_TRIANGLES;
+  parameters.count = VERTICES_PER_DRAW;
+
+  const int num_ranges = static_cast<int>(Common::ThreadPool::GetThreadCount()) + 1;
+  double rate[2] = {};
+  for (int i = 0; i < 2; i++)
+  {
+    const auto start = std::chrono::high_resolution_clock::now();
+    for (int j = 0; j < ITERATIONS; j++)
+    {
+      if (i == 0)
+        loader->RunVertices(parameters);
+      else
+        VertexLoaderManager::RunVerticesParallel(loader.get(), parameters, num_ranges);
+    }
+    const auto end = std::chrono::high_resolution_clock::now();
+    rate[i] = double(VERTICES_PER_DRAW) * ITERATIONS / 1000000 /
+              std::chrono::duration<double>(end - start).count();
+  }
+  printf("[ BENCH    ] %d vertices, %d ranges: serial %5.0f, parallel %5.0f Mverts/s\n",
+         VERTICES_PER_DRAW, num_ranges, rate[0], rate[1]);
+}
@@ -0,0 +1,187 @@
+#! /usr/bin/env python3
+
+"""
+generate-vertex-loaders.py [--min-verts N] [--max-formats N] <profile...>
+
+Turns the vertex loader profiles the emulator writes to
+User/Cache/VertexLoaders/<game id>.txt into precompiled vertex loaders.
+
+For every profile, Source/Core/VideoCommon/G_<game id>_pvt.{h,cpp} is
+(re)written with a TemplatedLoader instantiation for each of the most used
+formats. The list of precompiled loaders in PrecompiledVertexLoaders.h and
+the VideoCommon CMakeLists.txt and Visual Studio projects are then updated to
+match the G_*_pvt files present in the directory, so the loaders are picked up
+by the next build. Run it without profiles to only refresh the lists.
+"""
+
+import argparse
+import os
+import re
+import sys
+
+VIDEOCOMMON_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                               '..', 'Source', 'Core', 'VideoCommon')
+
+COPYRIGHT = '''// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+'''
+
+LOADER_TEMPLATE = '''  // {name}
+  // num_verts= {num_verts}
+#if _M_SSE >= 0x301
+  if (cpu_info.bSSSE3)
+  {{
+    pvlmap[{hash}] = TemplatedLoader<0x301, {uid}>;
+  }}
+  else
+#endif
+  {{
+    pvlmap[{hash}] = TemplatedLoader<0, {uid}>;
+  }}
+'''
+
+COMPILED_LOADERS_FILTER = 'Vertex Loading\\Compiled Loaders'
+
+
+def read_profile(path):
+    '''Returns the (hash, uid, num_verts, name) entries of a profile, most used first.'''
+    entries = []
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if not line or line.startswith('#'):
+                continue
+            fields = line.split()
+            if len(fields) < 8:
+                raise ValueError('%s: malformed line "%s"' % (path, line))
+            uid = [int(x, 16) for x in fields[1:5]]
+            entries.append((int(fields[0], 16), uid, int(fields[5]), fields[7]))
+    entries.sort(key=lambda e: e[2], reverse=True)
+    return entries
+
+
+def write_game_loaders(game_id, entries):
+    name = 'G_%s_pvt' % game_id
+    with open(os.path.join(VIDEOCOMMON_DIR, name + '.h'), 'w', newline='\n') as f:
+        f.write(COPYRIGHT)
+        f.write('// Generated by Tools/generate-vertex-loaders.py\n')
+        f.write('#pragma once\n')
+        f.write('#include <map>\n')
+        f.write('#include "VideoCommon/NativeVertexFormat.h"\n')
+        f.write('class %s\n{\npublic:\n' % name)
+        f.write('  static void Initialize(std::map<u64, TCompiledLoaderFunction> &pvlmap);\n};\n')
+    with open(os.path.join(VIDEOCOMMON_DIR, name + '.cpp'), 'w', newline='\n') as f:
+        f.write(COPYRIGHT)
+        f.write('// Generated by Tools/generate-vertex-loaders.py\n')
+        f.write('#include "VideoCommon/%s.h"\n' % name)
+        f.write('#include "VideoCommon/VertexLoader_Template.h"\n\n')
+        f.write('void %s::Initialize(std::map<u64, TCompiledLoaderFunction> &pvlmap)\n{\n' % name)
+        for uid_hash, uid, num_verts, loader_name in entries:
+            # Keep the literal in range of a signed 64 bit integer
+            literal = str(uid_hash) if uid_hash < 1 << 63 else '%dull' % uid_hash
+            f.write(LOADER_TEMPLATE.format(name=loader_name, num_verts=num_verts, hash=literal,
+                                           uid=', '.join('0x%08xu' % x for x in uid)))
+        f.write('}\n')
+
+
+def write_loader_list(names):
+    with open(os.path.join(VIDEOCOMMON_DIR, 'PrecompiledVertexLoaders.h'), 'w', newline='\n') as f:
+        f.write(COPYRIGHT.replace('2013', '2017'))
+        f.write('\n// Generated by Tools/generate-vertex-loaders.py from the G_*_pvt files.\n\n')
+        f.write('#pragma once\n')
+        f.write('#include <map>\n')
+        f.write('#include "VideoCommon/NativeVertexFormat.h"\n\n')
+        for name in names:
+            f.write('#include "VideoCommon/%s.h"\n' % name)
+        f.write('\ninline void InitializePrecompiledVertexLoaders('
+                'std::map<u64, TCompiledLoaderFunction> &pvlmap)\n{\n')
+        for name in names:
+            f.write('  %s::Initialize(pvlmap);\n' % name)
+        f.write('}\n')
+
+
+def replace_entries(text, pattern, entries):
+    '''Replaces all the matches of pattern with entries, at the place of the first match.'''
+    first = re.search(pattern, text)
+    if not first:
+        raise ValueError('no precompiled loader found to anchor the list')
+    text = text[:first.start()] + '\0' + text[first.end():]
+    text = re.sub(pattern, '', text)
+    return text.replace('\0', ''.join(entries))
+
+
+def update_file(path, update):
+    with open(path, 'rb') as f:
+        raw = f.read()
+    bom = raw.startswith(b'\xef\xbb\xbf')
+    text = raw.decode('utf-8-sig')
+    nl = '\r\n' if '\r\n' in text else '\n'
+    text = update(text, nl)
+    with open(path, 'wb') as f:
+        f.write((b'\xef\xbb\xbf' if bom else b'') + text.encode('utf-8'))
+
+
+def update_build_files(names):
+    def cmake(text, nl):
+        return replace_entries(text, r'\t\t\tG_\w+_pvt\.cpp' + nl,
+                               ['\t\t\t%s.cpp%s' % (n, nl) for n in names])
+
+    def vcxproj(text, nl):
+        for kind, ext in (('ClCompile', 'cpp'), ('ClInclude', 'h')):
+            text = replace_entries(text, r'    <%s Include="G_\w+_pvt\.%s" />%s' % (kind, ext, nl),
+                                   ['    <%s Include="%s.%s" />%s' % (kind, n, ext, nl)
+                                    for n in names])
+        return text
+
+    def filters(text, nl):
+        # The filter entries are not sorted, only add the new loaders and drop the removed ones
+        for kind, ext in (('ClCompile', 'cpp'), ('ClInclude', 'h')):
+            entry = '    <{kind} Include="{name}.{ext}">{nl}      <Filter>{filter}</Filter>{nl}    </{kind}>{nl}'
+            pattern = entry.format(kind=kind, name=r'(G_\w+_pvt)', ext=ext, nl=nl,
+                                   filter=re.escape(COMPILED_LOADERS_FILTER))
+            text = re.sub(pattern, lambda m: m.group(0) if m.group(1) in names else '', text)
+            last = list(re.finditer(pattern, text))[-1]
+            present = set(re.findall(pattern, text))
+            added = [entry.format(kind=kind, name=n, ext=ext, nl=nl, filter=COMPILED_LOADERS_FILTER)
+                     for n in names if n not in present]
+            text = text[:last.end()] + ''.join(added) + text[last.end():]
+        return text
+
+    update_file(os.path.join(VIDEOCOMMON_DIR, 'CMakeLists.txt'), cmake)
+    update_file(os.path.join(VIDEOCOMMON_DIR, 'VideoCommon.vcxproj'), vcxproj)
+    update_file(os.path.join(VIDEOCOMMON_DIR, 'VideoCommon.vcxproj.filters'), filters)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--min-verts', type=int, default=1000,
+                        help='skip formats that loaded fewer vertices (default: %(default)s)')
+    parser.add_argument('--max-formats', type=int, default=64,
+                        help='maximum number of loaders per game (default: %(default)s)')
+    parser.add_argument('profiles', nargs='*')
+    args = parser.parse_args()
+
+    for path in args.profiles:
+        game_id = os.path.splitext(os.path.basename(path))[0]
+        if not re.match(r'^\w+$', game_id):
+            sys.stderr.write('%s: not a game id, skipped\n' % game_id)
+            continue
+        entries = [e for e in read_profile(path) if e[2] >= args.min_verts]
+        entries = entries[:args.max_formats]
+        if not entries:
+            sys.stderr.write('%s: no format above %d vertices, skipped\n' %
+                             (game_id, args.min_verts))
+            continue
+        write_game_loaders(game_id, entries)
+        print('%s: %d loaders' % (game_id, len(entries)))
+
+    names = sorted(os.path.splitext(f)[0] for f in os.listdir(VIDEOCOMMON_DIR)
+                   if re.match(r'^G_\w+_pvt\.cpp$', f))
+    write_loader_list(names)
+    update_build_files(names)
+
+
+if __name__ == '__main__':
+    main()